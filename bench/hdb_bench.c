@@ -0,0 +1,390 @@
+#include "amdgpu_device.h"
+#include "bo.h"
+#include "mailbox.h"
+#include "pm4.h"
+#include "regs.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Core path microbenchmarks (make bench).
+ *
+ * Every result is one JSON object per line:
+ *
+ *   {"bench": "...", <parameters>, "iters": N, "ns_per_op": ...,
+ *    "ops_per_s": ..., "p50_ns": ..., "p99_ns": ..., "max_ns": ...}
+ *
+ * Build with HDB_LOG_RING=1 (make clean bench HDB_LOG_RING=1) to keep the
+ * per-submission [INFO] lines out of the timed loops.
+ *
+ * DANGER: --trap-handler installs the handler for VMIDs 1-8 (see
+ *         dev_setup_trap_handler()) and leaves it installed.
+ */
+
+// COMPUTE_PGM_RSRC1 / RSRC2 bits used by the benchmark shaders
+#define BENCH_RSRC1_DX10_CLAMP    (1u << 21)
+#define BENCH_RSRC1_IEEE_MODE     (1u << 23)
+#define BENCH_RSRC2_TRAP_PRESENT  (1u << 6)
+
+#define BENCH_WAIT_TIMEOUT_NS     (1000ull * 1000 * 1000)
+
+// examples/nop.gfx11.s: s_endpgm, padded with s_code_end
+static const uint32_t bench_nop_shader[] = {
+    0xBFB00000, 0xBF9F0000, 0xBF9F0000, 0xBF9F0000,
+};
+
+// s_trap 1; s_endpgm
+static const uint32_t bench_trap_shader[] = {
+    0xBF900001, 0xBFB00000, 0xBF9F0000, 0xBF9F0000,
+};
+
+typedef struct {
+    FILE*        out;
+    uint32_t     iters;
+    const char*  only;
+} bench_t;
+
+static inline void bench_sample(stats_histogram_t* h, uint64_t ns) {
+    h->buckets[stats_bucket(ns)]++;
+    h->count++;
+    h->sum += ns;
+    h->max = MAX(h->max, ns);
+}
+
+/**
+ * Print the collected samples; params is a JSON fragment ("\"size\": 4096").
+ */
+static void bench_report(bench_t* b, const stats_histogram_t* h, const char* name,
+                         const char* params) {
+    double ns_per_op = h->count ? (double)h->sum / (double)h->count : 0.0;
+
+    fprintf(b->out, "{\"bench\": \"%s\"%s%s, \"iters\": %lu, \"ns_per_op\": %.1f, "
+            "\"ops_per_s\": %.1f, \"p50_ns\": %lu, \"p99_ns\": %lu, \"max_ns\": %lu}\n",
+            name, params[0] ? ", " : "", params, h->count, ns_per_op,
+            ns_per_op > 0 ? 1e9 / ns_per_op : 0.0,
+            stats_quantile(h, 0.5), stats_quantile(h, 0.99), h->max);
+    fflush(b->out);
+    HDB_LOG_DRAIN();
+}
+
+static void bench_skip(bench_t* b, const char* name, const char* reason) {
+    fprintf(b->out, "{\"bench\": \"%s\", \"skipped\": \"%s\"}\n", name, reason);
+}
+
+static bool bench_selected(const bench_t* b, const char* name) {
+    return b->only == NULL || strcmp(b->only, name) == 0;
+}
+
+static void bench_bo_alloc(bench_t* b, amdgpu_t* dev) {
+    static const size_t sizes[] = { 4096, 64 * 1024, 2 * 1024 * 1024, 64 * 1024 * 1024 };
+    static const struct {
+        uint32_t     domain;
+        const char*  name;
+    } domains[] = {
+        { AMDGPU_GEM_DOMAIN_GTT,  "gtt" },
+        { AMDGPU_GEM_DOMAIN_VRAM, "vram" },
+    };
+
+    for_range(d, 0, ARRAY_SIZE(domains)) {
+        for_range(s, 0, ARRAY_SIZE(sizes)) {
+            // Large BOs are cleared on allocation; keep the run short
+            uint32_t iters = (uint32_t)MAX(b->iters / (1 + sizes[s] / (1024 * 1024)), 1);
+            char params[96];
+            snprintf(params, sizeof(params), "\"domain\": \"%s\", \"size\": %zu",
+                     domains[d].name, sizes[s]);
+
+            static stats_histogram_t allocs;
+            static stats_histogram_t frees;
+            allocs = (stats_histogram_t){0};
+            frees = (stats_histogram_t){0};
+            for_range(i, 0, iters) {
+                amdgpu_bo_t bo = {0};
+                uint64_t t0 = hdb_now_ns();
+                int32_t ret = bo_alloc(dev, sizes[s], domains[d].domain, false, &bo);
+                uint64_t t1 = hdb_now_ns();
+                if (ret != 0) {
+                    fprintf(stderr, "[ERROR] bo_alloc(%zu) failed: %d\n", sizes[s], ret);
+                    break;
+                }
+                bo_free(dev, &bo);
+                uint64_t t2 = hdb_now_ns();
+
+                bench_sample(&allocs, t1 - t0);
+                bench_sample(&frees, t2 - t1);
+            }
+
+            bench_report(b, &allocs, "bo_alloc", params);
+            bench_report(b, &frees, "bo_free", params);
+        }
+    }
+}
+
+static void bench_packet_build(bench_t* b) {
+    pkt3_packets_t packets;
+    pkt3_init(&packets);
+
+    // Packet building is cheap; time batches so the clock does not dominate
+    const uint32_t batch = 64;
+    uint32_t rounds = MAX(b->iters * 10 / batch, 1);
+
+    static stats_histogram_t hist;
+    hist = (stats_histogram_t){0};
+    for_range(r, 0, rounds) {
+        uint64_t t0 = hdb_now_ns();
+        for_range(i, 0, batch) {
+            pkt3_reset(&packets);
+            build_compute_dispatch(&packets, 0x100000000ull + i * 256,
+                                   BENCH_RSRC1_DX10_CLAMP | BENCH_RSRC1_IEEE_MODE, 0, 0,
+                                   64, 1, 1, 1, 1, 1);
+        }
+        uint64_t per_op = (hdb_now_ns() - t0) / batch;
+        for_range(i, 0, batch) {
+            bench_sample(&hist, per_op);
+        }
+    }
+
+    char params[64];
+    snprintf(params, sizeof(params), "\"dwords\": %zu", pkt3_size(&packets) / 4);
+    bench_report(b, &hist, "build_compute_dispatch", params);
+    pkt3_free(&packets);
+}
+
+/**
+ * Upload a shader into a fresh code BO.
+ */
+static int32_t bench_load_code(amdgpu_t* dev, const void* code, size_t size, amdgpu_bo_t* bo) {
+    int32_t ret = bo_alloc(dev, size, AMDGPU_GEM_DOMAIN_GTT, false, bo);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to allocate code BO: %d\n", ret);
+        return ret;
+    }
+    bo_upload(bo, code, size);
+    hdb_wc_fence();
+    return 0;
+}
+
+static void bench_submit(bench_t* b, amdgpu_t* dev) {
+    amdgpu_bo_t code = {0};
+    if (bench_load_code(dev, bench_nop_shader, sizeof(bench_nop_shader), &code) != 0) {
+        bench_skip(b, "submit_wait", "code BO allocation failed");
+        return;
+    }
+
+    pkt3_packets_t packets;
+    pkt3_init(&packets);
+
+    static stats_histogram_t hist;
+    hist = (stats_histogram_t){0};
+    for_range(i, 0, b->iters) {
+        pkt3_reset(&packets);
+        build_compute_dispatch(&packets, code.va_addr,
+                               BENCH_RSRC1_DX10_CLAMP | BENCH_RSRC1_IEEE_MODE, 0, 0,
+                               32, 1, 1, 1, 1, 1);
+
+        amdgpu_submit_t submit = {0};
+        uint64_t t0 = hdb_now_ns();
+        int32_t ret = dev_submit(dev, &packets, &code.bo_handle, 1, &submit);
+        if (ret == 0) {
+            ret = dev_wait(dev, &submit, BENCH_WAIT_TIMEOUT_NS);
+        }
+        uint64_t t1 = hdb_now_ns();
+        dev_submit_cleanup(dev, &submit);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] Submission %zu failed: %d\n", i, ret);
+            break;
+        }
+        bench_sample(&hist, t1 - t0);
+    }
+
+    bench_report(b, &hist, "submit_wait", "\"shader\": \"nop\"");
+    pkt3_free(&packets);
+    bo_free(dev, &code);
+}
+
+static void bench_reg(bench_t* b, amdgpu_t* dev) {
+    if (!dev_regs_available(dev)) {
+        bench_skip(b, "reg_read", "register access not available");
+        return;
+    }
+
+    regs2_ioc_data_t ioc = { .xcc_id = 0 };
+
+    static stats_histogram_t hist;
+    hist = (stats_histogram_t){0};
+    for_range(i, 0, b->iters) {
+        uint32_t value = 0;
+        uint64_t t0 = hdb_now_ns();
+        dev_op_reg32(dev, REG_GRBM_STATUS, ioc, REG_OP_READ, &value);
+        bench_sample(&hist, hdb_now_ns() - t0);
+    }
+    bench_report(b, &hist, "reg_read", "\"reg\": \"GRBM_STATUS\"");
+}
+
+/**
+ * Dispatch one wave that hits s_trap: time dispatch-to-trap-seen and
+ * resume-to-completion separately.
+ */
+static void bench_trap(bench_t* b, amdgpu_t* dev, const char* handler_path) {
+    if (handler_path == NULL) {
+        bench_skip(b, "trap_roundtrip", "no --trap-handler binary");
+        return;
+    }
+
+    void* handler = NULL;
+    size_t handler_size = 0;
+    int32_t ret = hdb_read_file(handler_path, &handler, &handler_size);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to read trap handler %s: %d\n", handler_path, ret);
+        bench_skip(b, "trap_roundtrip", "trap handler unreadable");
+        return;
+    }
+
+    mailbox_t mb = {0};
+    amdgpu_bo_t tba = {0};
+    amdgpu_bo_t code = {0};
+    ret = mailbox_init(dev, NULL, 2, 32, &mb);
+    if (ret == 0) {
+        ret = bench_load_code(dev, handler, handler_size, &tba);
+    }
+    if (ret == 0) {
+        ret = bench_load_code(dev, bench_trap_shader, sizeof(bench_trap_shader), &code);
+    }
+    free(handler);
+    if (ret != 0) {
+        bench_skip(b, "trap_roundtrip", "setup failed");
+        goto out;
+    }
+
+    if (dev_setup_trap_handler(dev, tba.va_addr, mb.bo.va_addr) != 0) {
+        bench_skip(b, "trap_roundtrip", "register access not available");
+        goto out;
+    }
+
+    amdgpu_bo_handle handles[] = { code.bo_handle, tba.bo_handle, mb.bo.bo_handle };
+    pkt3_packets_t packets;
+    pkt3_init(&packets);
+
+    static stats_histogram_t trapped;
+    static stats_histogram_t resumed;
+    trapped = (stats_histogram_t){0};
+    resumed = (stats_histogram_t){0};
+    for_range(i, 0, b->iters) {
+        pkt3_reset(&packets);
+        build_compute_dispatch(&packets, code.va_addr,
+                               BENCH_RSRC1_DX10_CLAMP | BENCH_RSRC1_IEEE_MODE,
+                               BENCH_RSRC2_TRAP_PRESENT, 0, 32, 1, 1, 1, 1, 1);
+
+        amdgpu_submit_t submit = {0};
+        uint64_t t0 = hdb_now_ns();
+        ret = dev_submit(dev, &packets, handles, ARRAY_SIZE(handles), &submit);
+        if (ret == 0) {
+            ret = mailbox_wait_any(&mb, NULL, &submit, BENCH_WAIT_TIMEOUT_NS);
+        }
+        if (ret != MAILBOX_WAIT_TRAPPED) {
+            fprintf(stderr, "[ERROR] Trap %zu not seen: %d\n", i, ret);
+            dev_submit_cleanup(dev, &submit);
+            break;
+        }
+        uint64_t t1 = hdb_now_ns();
+
+        uint32_t slots[4];
+        uint32_t count = mailbox_drain(&mb, slots, ARRAY_SIZE(slots));
+        mailbox_resume_batch(&mb, slots, count);
+        ret = dev_wait(dev, &submit, BENCH_WAIT_TIMEOUT_NS);
+        uint64_t t2 = hdb_now_ns();
+        dev_submit_cleanup(dev, &submit);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] Dispatch %zu did not finish after resume: %d\n", i, ret);
+            break;
+        }
+
+        bench_sample(&trapped, t1 - t0);
+        bench_sample(&resumed, t2 - t1);
+    }
+
+    bench_report(b, &trapped, "trap_roundtrip", "\"phase\": \"submit_to_trap\"");
+    bench_report(b, &resumed, "trap_roundtrip", "\"phase\": \"resume_to_done\"");
+    pkt3_free(&packets);
+
+out:
+    bo_free(dev, &code);
+    bo_free(dev, &tba);
+    mailbox_fini(dev, &mb);
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --device <path>        DRM device path (default: first AMD GPU)\n");
+    fprintf(stderr, "  --iters <n>            Iterations per benchmark (default: 1000)\n");
+    fprintf(stderr, "  --only <name>          Run one benchmark: bo_alloc, build_compute_dispatch,\n");
+    fprintf(stderr, "                         submit_wait, reg_read, trap_roundtrip\n");
+    fprintf(stderr, "  --trap-handler <bin>   Raw trap handler binary (enables trap_roundtrip)\n");
+    fprintf(stderr, "  --out <path>           Write results there instead of stdout\n");
+}
+
+int main(int argc, char** argv) {
+    const char* device_path = NULL;
+    const char* handler_path = NULL;
+    const char* out_path = NULL;
+    bench_t b = { .iters = 1000 };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) {
+            device_path = argv[++i];
+        } else if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) {
+            b.iters = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+            b.only = argv[++i];
+        } else if (strcmp(argv[i], "--trap-handler") == 0 && i + 1 < argc) {
+            handler_path = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (b.iters == 0) {
+        b.iters = 1;
+    }
+
+    b.out = out_path ? fopen(out_path, "w") : stdout;
+    if (b.out == NULL) {
+        fprintf(stderr, "[FATAL] Cannot open %s\n", out_path);
+        return 1;
+    }
+
+    // CPU-only
+    if (bench_selected(&b, "build_compute_dispatch")) {
+        bench_packet_build(&b);
+    }
+
+    amdgpu_t dev = {0};
+    int32_t ret = amdgpu_device_init(device_path, &dev);
+    if (ret != 0) {
+        fprintf(stderr, "[FATAL] Device initialization failed: %d\n", ret);
+        return 1;
+    }
+
+    if (bench_selected(&b, "bo_alloc")) {
+        bench_bo_alloc(&b, &dev);
+    }
+    if (bench_selected(&b, "submit_wait")) {
+        bench_submit(&b, &dev);
+    }
+    if (bench_selected(&b, "reg_read")) {
+        bench_reg(&b, &dev);
+    }
+    if (bench_selected(&b, "trap_roundtrip")) {
+        bench_trap(&b, &dev, handler_path);
+    }
+
+    amdgpu_device_cleanup(&dev);
+    if (b.out != stdout) {
+        fclose(b.out);
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+# Generate src/regdb_gc11.h from regdb/gc_11.txt (see that file for syntax).
+
+import sys
+
+MAX_SEGMENTS = 6
+
+
+def fail(path, lineno, msg):
+    sys.exit(f"{path}:{lineno}: {msg}")
+
+
+def parse(path):
+    asics, devices, regs = [], [], []
+    with open(path) as f:
+        for lineno, line in enumerate(f, 1):
+            tok = line.split("#", 1)[0].split()
+            if not tok:
+                continue
+
+            if tok[0] == "asic":
+                if len(tok) < 5 or tok[3] != "bases" or "devices" not in tok:
+                    fail(path, lineno, "expected: asic <name> <ver> bases ... devices ...")
+                dev_at = tok.index("devices")
+                bases = [int(b, 0) for b in tok[4:dev_at]]
+                if len(bases) > MAX_SEGMENTS:
+                    fail(path, lineno, f"at most {MAX_SEGMENTS} segment bases")
+                ver = [int(v) for v in tok[2].split(".")]
+                if len(ver) != 3:
+                    fail(path, lineno, "GC version must be major.minor.rev")
+                asics.append((tok[1], ver, bases))
+                devices += [(int(d, 0), tok[1]) for d in tok[dev_at + 1:]]
+            elif tok[0] == "reg":
+                if len(tok) not in (5, 7) or tok[4] not in ("mmio", "indirect"):
+                    fail(path, lineno, "expected: reg <name> <seg> <offset> <mmio|indirect> [count stride]")
+                count, stride = (int(tok[5]), int(tok[6])) if len(tok) == 7 else (1, 0)
+                seg = int(tok[2])
+                if seg >= MAX_SEGMENTS:
+                    fail(path, lineno, "segment out of range")
+                if any(r["name"] == tok[1] for r in regs):
+                    fail(path, lineno, f"duplicate register {tok[1]}")
+                regs.append({
+                    "name": tok[1], "seg": seg, "offset": int(tok[3], 0),
+                    "type": "REG_MMIO" if tok[4] == "mmio" else "REG_INDIRECT",
+                    "count": count, "stride": stride, "fields": [],
+                })
+            elif tok[0] == "field":
+                if not regs or len(tok) != 4:
+                    fail(path, lineno, "expected: field <name> <shift> <width> after a reg")
+                shift, width = int(tok[2]), int(tok[3])
+                if width < 1 or shift + width > 32:
+                    fail(path, lineno, "field outside 32 bits")
+                regs[-1]["fields"].append((tok[1], shift, width))
+            else:
+                fail(path, lineno, f"unknown directive {tok[0]}")
+    return asics, devices, regs
+
+
+def emit(asics, devices, regs, src):
+    out = []
+    w = out.append
+
+    w(f"// Generated by scripts/gen-regdb.py from {src}. Do not edit;")
+    w("// change the source and run `make regdb`.")
+    w("#pragma once")
+    w("")
+    w(f"#define REGDB_GC11_MAX_SEGMENTS  {MAX_SEGMENTS}")
+    w("")
+    w("/**")
+    w(" * Registers: X(name, segment, offset, type, count, stride)")
+    w(" */")
+    w("#define REGDB_GC11_REGS(X) \\")
+    for r in regs:
+        w(f"    X({r['name']}, {r['seg']}, 0x{r['offset']:04X}, {r['type']}, "
+          f"{r['count']}, {r['stride']}) \\")
+    w("")
+    w("")
+    w("/**")
+    w(" * Fields: X(reg, field, shift, width)")
+    w(" */")
+    w("#define REGDB_GC11_FIELDS(X) \\")
+    for r in regs:
+        for name, shift, width in r["fields"]:
+            w(f"    X({r['name']}, {name}, {shift}, {width}) \\")
+    w("")
+    w("")
+    w("/**")
+    w(" * ASICs: X(name, gc_major, gc_minor, gc_rev, fallback segment bases...)")
+    w(" */")
+    w("#define REGDB_GC11_ASICS(X) \\")
+    for name, ver, bases in asics:
+        padded = bases + [0] * (MAX_SEGMENTS - len(bases))
+        b = ", ".join(f"0x{v:08X}" for v in padded)
+        w(f"    X({name}, {ver[0]}, {ver[1]}, {ver[2]}, {b}) \\")
+    w("")
+    w("")
+    w("/**")
+    w(" * PCI device IDs: X(device_id, asic)")
+    w(" */")
+    w("#define REGDB_GC11_DEVICES(X) \\")
+    for dev, name in devices:
+        w(f"    X(0x{dev:04X}, {name}) \\")
+    w("")
+    w("")
+    w("/**")
+    w(" * Field shifts and masks (<REG>__<FIELD>__SHIFT, <REG>__<FIELD>_MASK).")
+    w(" */")
+    for r in regs:
+        for name, shift, width in r["fields"]:
+            mask = ((1 << width) - 1) << shift
+            w(f"#define {r['name']}__{name}__SHIFT  {shift}")
+            w(f"#define {r['name']}__{name}_MASK    0x{mask:08X}u")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(f"usage: {sys.argv[0]} regdb/gc_11.txt src/regdb_gc11.h")
+    asics, devices, regs = parse(sys.argv[1])
+    with open(sys.argv[2], "w") as f:
+        f.write(emit(asics, devices, regs, sys.argv[1]))
+
+
+if __name__ == "__main__":
+    main()
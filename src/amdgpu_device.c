@@ -1,14 +1,143 @@
-#include "bo.h"
+#include "amdgpu_device.h"
+#include "bo_list_cache.h"
+#include "bo_pool.h"
+#include "ib_ring.h"
 #include "regs.h"
+#include "stats.h"
+#include <dirent.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
 
+/**
+ * Root of the per-device DRM debugfs directories.
+ */
+#define DEBUGFS_DRI_PATH  "/sys/kernel/debug/dri"
+
+/**
+ * AMD PCI vendor ID.
+ */
+#define PCI_VENDOR_ID_AMD  0x1002
+
+/**
+ * Format a PCI address the way debugfs names it ("dddd:bb:dd.f").
+ */
+static void dev_format_bus_id(const drmPciBusInfo* pci, char* out, size_t size) {
+    snprintf(out, size, "%04x:%02x:%02x.%u",
+             pci->domain, pci->bus, pci->dev, pci->func);
+}
+
+int32_t amdgpu_enumerate_devices(amdgpu_device_desc_t* descs, uint32_t max,
+                                 uint32_t* count) {
+    drmDevicePtr devices[AMDGPU_MAX_DEVICES];
+
+    *count = 0;
+    int n = drmGetDevices2(0, devices, AMDGPU_MAX_DEVICES);
+    if (n < 0) {
+        fprintf(stderr, "[ERROR] drmGetDevices2 failed: %d\n", n);
+        return n;
+    }
+
+    for_range(i, 0, (size_t)n) {
+        drmDevicePtr d = devices[i];
+        if (d->bustype != DRM_BUS_PCI || d->deviceinfo.pci->vendor_id != PCI_VENDOR_ID_AMD) {
+            continue;
+        }
+        if (*count == max) {
+            fprintf(stderr, "[WARN] More than %u AMD GPUs; ignoring the rest\n", max);
+            break;
+        }
+
+        amdgpu_device_desc_t* desc = &descs[(*count)++];
+        *desc = (amdgpu_device_desc_t){
+            .device_id = d->deviceinfo.pci->device_id,
+        };
+        dev_format_bus_id(d->businfo.pci, desc->pci_bus_id, sizeof(desc->pci_bus_id));
+        if (d->available_nodes & (1 << DRM_NODE_RENDER)) {
+            snprintf(desc->render_path, sizeof(desc->render_path), "%s",
+                     d->nodes[DRM_NODE_RENDER]);
+        }
+        if (d->available_nodes & (1 << DRM_NODE_PRIMARY)) {
+            snprintf(desc->primary_path, sizeof(desc->primary_path), "%s",
+                     d->nodes[DRM_NODE_PRIMARY]);
+        }
+    }
+
+    drmFreeDevices(devices, n);
+    return 0;
+}
+
+/**
+ * Does a debugfs dri/<entry> directory belong to the GPU at bus_id?
+ *
+ * Newer kernels name the directory after the PCI address; older ones use
+ * the DRM minor and list the address in its "name" file
+ * ("amdgpu dev=0000:03:00.0 unique=0000:03:00.0").
+ */
+static bool dev_debugfs_matches(const char* entry, const char* bus_id) {
+    if (strcmp(entry, bus_id) == 0) {
+        return true;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), DEBUGFS_DRI_PATH "/%s/name", entry);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    char name[256] = {0};
+    ssize_t len = read(fd, name, sizeof(name) - 1);
+    close(fd);
+    if (len <= 0) {
+        return false;
+    }
+
+    const char* dev = strstr(name, "dev=");
+    return dev != NULL && strncmp(dev + 4, bus_id, strlen(bus_id)) == 0;
+}
+
+/**
+ * Open a debugfs file (regs2, amdgpu_vram, ...) of the GPU at bus_id.
+ *
+ * @return: File descriptor, or negative error code (-ENOENT if no debugfs
+ *          directory matches)
+ */
+static int dev_open_debugfs(const char* bus_id, const char* name, int flags) {
+    DIR* dir = opendir(DEBUGFS_DRI_PATH);
+    if (dir == NULL) {
+        return -errno;
+    }
+
+    int fd = -ENOENT;
+    struct dirent* entry = NULL;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' || !dev_debugfs_matches(entry->d_name, bus_id)) {
+            continue;
+        }
+
+        // Render-minor directories match too but carry no amdgpu files; keep looking
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), DEBUGFS_DRI_PATH "/%s/%s", entry->d_name, name);
+        fd = open(path, flags);
+        if (fd >= 0) {
+            fprintf(stdout, "[INFO] Opened debugfs: %s\n", path);
+            break;
+        }
+        fd = -errno;
+    }
+
+    closedir(dir);
+    return fd;
+}
+
 /**
  * Open DRM device node and initialize AMDGPU device context.
  * 
- * @param device_path: Path to DRM device (e.g., "/dev/dri/card0" or NULL for auto)
+ * @param device_path: Path to DRM device (e.g., "/dev/dri/renderD128" or NULL for
+ *                     the first AMD GPU)
  * @param dev: Output device structure
  * @return: 0 on success, negative error code on failure
  * 
@@ -23,8 +152,18 @@ int32_t amdgpu_device_init(const char* device_path, amdgpu_t* dev) {
     int regs2_fd = -1;
     uint32_t drm_major = 0, drm_minor = 0;
 
-    // Default to card0 if no path specified
-    const char* path = device_path ? device_path : "/dev/dri/card0";
+    // Default to the first AMD GPU, preferring its render node
+    amdgpu_device_desc_t first = {0};
+    const char* path = device_path;
+    if (path == NULL) {
+        uint32_t found = 0;
+        ret = amdgpu_enumerate_devices(&first, 1, &found);
+        if (ret != 0 || found == 0) {
+            fprintf(stderr, "[ERROR] No AMD GPU found\n");
+            return ret != 0 ? ret : -ENODEV;
+        }
+        path = first.render_path[0] ? first.render_path : first.primary_path;
+    }
 
     // Open DRM device
     drm_fd = open(path, O_RDWR);
@@ -76,20 +215,50 @@ int32_t amdgpu_device_init(const char* device_path, amdgpu_t* dev) {
         return ret;
     }
 
-    // Open debugfs regs2 for privileged register access
-    // Try card0 first, then card1, etc.
-    char regs2_path[256];
-    for (int i = 0; i < 8; i++) {
-        snprintf(regs2_path, sizeof(regs2_path),
-                 "/sys/kernel/debug/dri/%d/regs2", i);
-        regs2_fd = open(regs2_path, O_RDWR);
-        if (regs2_fd >= 0) {
-            fprintf(stdout, "[INFO] Opened debugfs: %s\n", regs2_path);
-            break;
+    // Compute rings; without the query only ring 0 is known to exist
+    struct drm_amdgpu_info_hw_ip compute_info = {0};
+    uint32_t compute_rings = 1;
+    if (amdgpu_query_hw_ip_info(dev_handle, AMDGPU_HW_IP_COMPUTE, 0, &compute_info) == 0 &&
+        compute_info.available_rings != 0) {
+        compute_rings = compute_info.available_rings;
+    } else {
+        fprintf(stderr, "[WARN] Compute ring query failed, using ring 0 only\n");
+    }
+
+    // Highest ring is the control ring, unless it is the only one
+    uint32_t control_ring = 31 - __builtin_clz(compute_rings);
+    uint32_t work_rings = compute_rings & ~(1u << control_ring);
+    if (work_rings == 0) {
+        work_rings = compute_rings;
+    }
+
+    fprintf(stdout, "[INFO] Compute rings: mask=0x%x control=%u\n",
+            compute_rings, control_ring);
+
+    // SDMA rings for the transfer engine (sdma.c); none is not fatal
+    struct drm_amdgpu_info_hw_ip dma_info = {0};
+    uint32_t dma_rings = 0;
+    if (amdgpu_query_hw_ip_info(dev_handle, AMDGPU_HW_IP_DMA, 0, &dma_info) == 0) {
+        dma_rings = dma_info.available_rings;
+    }
+
+    // Open debugfs regs2 for privileged register access. The debugfs
+    // directory is matched by PCI address, so on multi-GPU systems the
+    // registers belong to the GPU that was opened.
+    char pci_bus_id[16] = {0};
+    drmDevicePtr drm_dev = NULL;
+    if (drmGetDevice2(drm_fd, 0, &drm_dev) == 0) {
+        if (drm_dev->bustype == DRM_BUS_PCI) {
+            dev_format_bus_id(drm_dev->businfo.pci, pci_bus_id, sizeof(pci_bus_id));
+            regs2_fd = dev_open_debugfs(pci_bus_id, "regs2", O_RDWR);
         }
+        drmFreeDevice(&drm_dev);
+    } else {
+        fprintf(stderr, "[WARN] drmGetDevice2 failed; cannot pair debugfs with %s\n", path);
     }
 
     if (regs2_fd < 0) {
+        regs2_fd = -1;
         fprintf(stderr, "[WARN] Failed to open debugfs regs2\n");
         fprintf(stderr, "[WARN] Ensure debugfs is mounted: mount -t debugfs none /sys/kernel/debug\n");
         fprintf(stderr, "[WARN] Or run as root / with CAP_SYS_ADMIN\n");
@@ -97,21 +266,6 @@ int32_t amdgpu_device_init(const char* device_path, amdgpu_t* dev) {
         // Continue without regs2 - some features will be disabled
     }
 
-    // Initialize GC register base addresses
-    // DANGER: Hardcoded for typical RDNA3 layout
-    // 
-    // FIXME: These are PLACEHOLDER values that must be determined from
-    //        actual hardware before use. The correct base addresses can be
-    //        obtained via:
-    //        1. amdgpu_query_hw_ip_info() for IP-specific base addresses
-    //        2. Reading from kernel amdgpu driver sources
-    //        3. UMR register database for specific ASIC
-    // 
-    // Using incorrect base addresses WILL cause register access to fail
-    // or write to wrong locations, potentially hanging the GPU.
-    uint64_t gc_regs_base_addr[16] = {0};
-    gc_regs_base_addr[0] = 0x0; // PLACEHOLDER - GC base (MUST VERIFY)
-
     // Fill output structure
     *dev = (amdgpu_t){
         .drm_fd = drm_fd,
@@ -121,14 +275,45 @@ int32_t amdgpu_device_init(const char* device_path, amdgpu_t* dev) {
         .device_id = gpu_info.asic_id,
         .chip_rev = gpu_info.chip_rev,
         .chip_external_rev = gpu_info.chip_external_rev,
+        .num_shader_engines = gpu_info.num_shader_engines,
+        .num_shader_arrays_per_engine = gpu_info.num_shader_arrays_per_engine,
+        .drm_minor = drm_minor,
+        // AMDGPU_CHUNK_ID_BO_HANDLES lets the CS ioctl carry the BO set
+        // itself, so no list object has to be created at all
+        .use_bo_handles_chunk = drm_minor >= 27,
+        .compute_rings = compute_rings,
+        .work_rings = work_rings,
+        .control_ring = control_ring,
+        .dma_rings = dma_rings,
     };
 
-    memcpy(dev->gc_regs_base_addr, gc_regs_base_addr, sizeof(gc_regs_base_addr));
+    memcpy(dev->pci_bus_id, pci_bus_id, sizeof(pci_bus_id));
+    memcpy(dev->cu_bitmap, gpu_info.cu_bitmap, sizeof(dev->cu_bitmap));
+
+    // GC segment bases from IP discovery and the flat register offset table
+    regs_resolve(dev);
+
+    // Persistent IB memory; dev_submit() falls back to per-submit BOs without it
+    ret = ib_ring_init(dev, &dev->ib_ring);
+    if (ret != 0) {
+        fprintf(stderr, "[WARN] IB ring unavailable, using per-submission IBs\n");
+    }
 
     fprintf(stdout, "[INFO] Device context initialized\n");
     return 0;
 }
 
+int amdgpu_device_open_debugfs(const amdgpu_t* dev, const char* name, int flags) {
+    if (dev->pci_bus_id[0] == '\0') {
+        return -ENODEV;
+    }
+    return dev_open_debugfs(dev->pci_bus_id, name, flags);
+}
+
+int amdgpu_device_open_regs2(const amdgpu_t* dev) {
+    return amdgpu_device_open_debugfs(dev, "regs2", O_RDWR);
+}
+
 /**
  * Clean up device context and free resources.
  * 
@@ -138,6 +323,10 @@ int32_t amdgpu_device_init(const char* device_path, amdgpu_t* dev) {
  * DANGER: GPU must be idle before calling this.
  */
 void amdgpu_device_cleanup(amdgpu_t* dev) {
+    bo_pools_fini(dev);
+    ib_ring_fini(dev, &dev->ib_ring);
+    bo_list_cache_fini(dev);
+
     if (dev->ctx_handle != NULL) {
         amdgpu_cs_ctx_free(dev->ctx_handle);
         dev->ctx_handle = NULL;
@@ -151,6 +340,7 @@ void amdgpu_device_cleanup(amdgpu_t* dev) {
     if (dev->regs2_fd >= 0) {
         close(dev->regs2_fd);
         dev->regs2_fd = -1;
+        dev_regs_invalidate_state(dev);
     }
 
     if (dev->drm_fd >= 0) {
@@ -162,7 +352,67 @@ void amdgpu_device_cleanup(amdgpu_t* dev) {
 }
 
 /**
- * Submit command buffer to GPU.
+ * Start a packet stream directly in IB memory.
+ * 
+ * @param dev: Device context
+ * @param packets: Output packet array
+ * @return: true if the stream lives in an IB ring slice, false if the ring
+ *          is unavailable and packets is a plain heap array instead
+ * 
+ * Either way the stream is built and submitted the same way; streams that
+ * outgrow the slice move to the heap on their own.
+ * 
+ * DANGER: The slice stays acquired until dev_submit() or pkt3_free().
+ */
+bool dev_packets_begin(amdgpu_t* dev, pkt3_packets_t* packets) {
+    amdgpu_ib_slice_t* slice = NULL;
+    if (ib_ring_acquire(&dev->ib_ring, IB_RING_SLICE_SIZE,
+                        IB_RING_ACQUIRE_TIMEOUT_NS, &slice) != 0) {
+        pkt3_init(packets);
+        return false;
+    }
+
+    pkt3_init_external(packets, slice->host_addr,
+                       IB_RING_SLICE_SIZE / sizeof(uint32_t));
+    packets->ib_slice = slice;
+    return true;
+}
+
+/**
+ * Resolve a ring selector to a compute ring index.
+ * 
+ * @param dev: Device context
+ * @param ring: Ring index, DEV_RING_ANY, DEV_RING_DEFAULT or DEV_RING_CONTROL
+ * @return: Ring index, or -EINVAL if the ring does not exist
+ * 
+ * DEV_RING_ANY rotates over the work rings in index order. Every call
+ * advances it, so callers that need in-order retirement (submit queues)
+ * resolve a ring once and keep it.
+ */
+int32_t dev_pick_ring(amdgpu_t* dev, uint32_t ring) {
+    if (ring == DEV_RING_CONTROL) {
+        return (int32_t)dev->control_ring;
+    }
+    if (ring == DEV_RING_DEFAULT) {
+        return __builtin_ctz(dev->work_rings);
+    }
+
+    if (ring == DEV_RING_ANY) {
+        // Next set bit at or after the cursor, wrapping around
+        uint32_t above = dev->work_rings & ~((1u << (dev->next_ring & 31)) - 1);
+        uint32_t pick = (uint32_t)__builtin_ctz(above ? above : dev->work_rings);
+        dev->next_ring = pick + 1;
+        return (int32_t)pick;
+    }
+
+    if (ring >= 32 || !(dev->compute_rings & (1u << ring))) {
+        return -EINVAL;
+    }
+    return (int32_t)ring;
+}
+
+/**
+ * Submit command buffer to GPU (default (lowest) work ring, no dependencies).
  * 
  * @param dev: Device context
  * @param packets: PM4 packet array
@@ -171,6 +421,14 @@ void amdgpu_device_cleanup(amdgpu_t* dev) {
  * @param submit: Output submission info (for fence wait)
  * @return: 0 on success, negative error code on failure
  * 
+ * The packets are copied into the next free slice of dev->ib_ring; a
+ * dedicated IB BO is only allocated if the ring cannot serve the request.
+ * Streams built in a slice (dev_packets_begin()) are submitted in place
+ * without a copy; the submission takes the slice and packets is left
+ * empty, whether or not the submit succeeds.
+ * The BO set travels inline in an AMDGPU_CHUNK_ID_BO_HANDLES chunk where
+ * the kernel supports it, otherwise through the device BO list cache.
+ * 
  * DANGER: Submits PM4 commands directly to GPU compute queue.
  * DANGER: Malformed packets can hang or reset the GPU.
  */
@@ -179,93 +437,277 @@ int32_t dev_submit(amdgpu_t* dev,
                    amdgpu_bo_handle* buffers,
                    uint32_t buffers_count,
                    amdgpu_submit_t* submit) {
-    int32_t ret = -1;
-    amdgpu_bo_t ib = {0};
+    return dev_submit_ex(dev, packets, buffers, buffers_count, DEV_RING_DEFAULT,
+                         NULL, 0, submit);
+}
 
-    // Allocate indirect buffer for PM4 packets
-    ret = bo_alloc(dev, pkt3_size(packets), AMDGPU_GEM_DOMAIN_GTT, false, &ib);
-    if (ret != 0) {
-        fprintf(stderr, "[ERROR] Failed to allocate IB: %d\n", ret);
-        return ret;
+/**
+ * Fail a submission before it reaches the kernel.
+ * 
+ * IB-backed streams are consumed on failure too, like in dev_submit_ip().
+ */
+static int32_t dev_submit_reject(pkt3_packets_t* packets) {
+    if (packets->ib_slice != NULL) {
+        pkt3_free(packets);
+    }
+    return -EINVAL;
+}
+
+/**
+ * Submit command buffer to GPU after other submissions complete.
+ * 
+ * @param dev: Device context
+ * @param packets: PM4 packet array
+ * @param buffers: Array of BO handles to include in submission
+ * @param buffers_count: Number of BOs
+ * @param ring: Compute ring index, DEV_RING_ANY (next work ring),
+ *              DEV_RING_DEFAULT or DEV_RING_CONTROL
+ * @param deps: Fences the submission waits for (any context/ring)
+ * @param dep_count: Number of fences (at most DEV_SUBMIT_MAX_DEPS)
+ * @param submit: Output submission info (for fence wait)
+ * @return: 0 on success, -EINVAL on a bad ring or too many dependencies,
+ *          negative error code on failure
+ * 
+ * Dependencies travel in an AMDGPU_CHUNK_ID_DEPENDENCIES chunk, so the
+ * wait happens in the kernel scheduler and the caller never blocks.
+ */
+int32_t dev_submit_ex(amdgpu_t* dev,
+                      pkt3_packets_t* packets,
+                      amdgpu_bo_handle* buffers,
+                      uint32_t buffers_count,
+                      uint32_t ring,
+                      const struct amdgpu_cs_fence* deps,
+                      uint32_t dep_count,
+                      amdgpu_submit_t* submit) {
+    int32_t ring_index = dev_pick_ring(dev, ring);
+    if (ring_index < 0) {
+        fprintf(stderr, "[ERROR] No compute ring %u\n", ring);
+        return dev_submit_reject(packets);
+    }
+    return dev_submit_ip(dev, AMDGPU_HW_IP_COMPUTE, (uint32_t)ring_index,
+                         packets, buffers, buffers_count, deps, dep_count, submit);
+}
+
+/**
+ * Submit command buffer to any hardware IP.
+ * 
+ * @param dev: Device context
+ * @param ip_type: AMDGPU_HW_IP_COMPUTE or AMDGPU_HW_IP_DMA
+ * @param ring: Ring index of that IP
+ * @param packets: Packets for that IP (PM4 or SDMA)
+ * @param buffers: Array of BO handles to include in submission
+ * @param buffers_count: Number of BOs
+ * @param deps: Fences the submission waits for (any context/ring)
+ * @param dep_count: Number of fences (at most DEV_SUBMIT_MAX_DEPS)
+ * @param submit: Output submission info (for fence wait)
+ * @return: 0 on success, -EINVAL on a bad IP, ring or too many
+ *          dependencies, negative error code on failure
+ */
+int32_t dev_submit_ip(amdgpu_t* dev,
+                      uint32_t ip_type,
+                      uint32_t ring,
+                      pkt3_packets_t* packets,
+                      amdgpu_bo_handle* buffers,
+                      uint32_t buffers_count,
+                      const struct amdgpu_cs_fence* deps,
+                      uint32_t dep_count,
+                      amdgpu_submit_t* submit) {
+    uint32_t rings = ip_type == AMDGPU_HW_IP_COMPUTE ? dev->compute_rings :
+                     ip_type == AMDGPU_HW_IP_DMA ? dev->dma_rings : 0;
+    if (ring >= 32 || !(rings & (1u << ring)) || dep_count > DEV_SUBMIT_MAX_DEPS) {
+        fprintf(stderr, "[ERROR] Invalid submission: ip %u ring %u, %u dependencies\n",
+                ip_type, ring, dep_count);
+        return dev_submit_reject(packets);
     }
 
-    // Upload packets to IB
-    bo_upload(&ib, packets->data, pkt3_size(packets));
+    int32_t ret = -1;
+    amdgpu_bo_t ib = {0};
+    amdgpu_ib_slice_t* ib_slice = NULL;
+    uint64_t ib_va = 0;
+    amdgpu_bo_handle ib_handle = NULL;
+    uint32_t ib_bytes = (uint32_t)pkt3_size(packets);
+    uint64_t t0 = stats_begin();
+
+    if (packets->ib_slice != NULL) {
+        // Built in place (dev_packets_begin()): the slice is the IB already.
+        // The submission owns the slice from here on.
+        ib_slice = packets->ib_slice;
+        ib_va = ib_slice->va_addr;
+        ib_handle = dev->ib_ring.bo.bo_handle;
+        pkt3_init(packets);
+    } else if (ib_ring_acquire(&dev->ib_ring, ib_bytes,
+                               IB_RING_ACQUIRE_TIMEOUT_NS, &ib_slice) == 0) {
+        // Prefer a slice of the persistent IB ring; fall back to a dedicated
+        // BO for oversized streams or when the oldest slice is still in flight
+        memcpy(ib_slice->host_addr, packets->data, ib_bytes);
+        ib_va = ib_slice->va_addr;
+        ib_handle = dev->ib_ring.bo.bo_handle;
+    } else {
+        ib_slice = NULL;
+        stats_count(STAT_IB_FALLBACK, 1);
+
+        // Packets overwrite the IB, so skip clearing it
+        ret = bo_alloc_ex(dev, ib_bytes, AMDGPU_GEM_DOMAIN_GTT, false, 0, &ib);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] Failed to allocate IB: %d\n", ret);
+            stats_count(STAT_SUBMIT_FAIL, 1);
+            return ret;
+        }
 
-    // Build BO list (IB + user BOs)
-    amdgpu_bo_handle* bo_handles =
-        malloc(sizeof(amdgpu_bo_handle) * (buffers_count + 1));
+        bo_upload(&ib, packets->data, ib_bytes);
+        ib_va = ib.va_addr;
+        ib_handle = ib.bo_handle;
+    }
+    stats_end(STAT_IB_ALLOC, t0);
+    t0 = stats_begin();
+
+    // BO set: IB + user BOs (sorted/de-duplicated for the cache key).
+    // Typical sets fit on the stack, keeping malloc off the submit path.
+    uint32_t bo_count = buffers_count + 1;
+    amdgpu_bo_handle stack_handles[BO_LIST_CACHE_MAX_BOS];
+    struct drm_amdgpu_bo_list_entry stack_entries[BO_LIST_CACHE_MAX_BOS];
+    bool on_stack = bo_count <= BO_LIST_CACHE_MAX_BOS;
+
+    amdgpu_bo_handle* bo_handles = on_stack ? stack_handles :
+        malloc(sizeof(amdgpu_bo_handle) * bo_count);
     if (bo_handles == NULL) {
         fprintf(stderr, "[ERROR] malloc failed for BO list\n");
-        bo_free(dev, &ib);
-        return -ENOMEM;
+        ret = -ENOMEM;
+        goto fail_ib;
     }
 
-    bo_handles[0] = ib.bo_handle;
+    bo_handles[0] = ib_handle;
     for_range(i, 0, buffers_count) {
         bo_handles[i + 1] = buffers[i];
     }
 
-    amdgpu_bo_list_handle bo_list = NULL;
-    ret = amdgpu_bo_list_create(dev->dev_handle,
-                                buffers_count + 1,
-                                bo_handles,
-                                NULL,
-                                &bo_list);
-    free(bo_handles);
+    struct drm_amdgpu_bo_list_entry* bo_entries = NULL;
+    struct drm_amdgpu_bo_list_in bo_list_in = {0};
+    uint32_t bo_list = 0;
+    bool bo_list_owned = false;
+
+    if (dev->use_bo_handles_chunk) {
+        bo_count = bo_handles_normalize(bo_handles, bo_count);
+        bo_entries = on_stack ? stack_entries :
+                     malloc(sizeof(*bo_entries) * bo_count);
+        ret = bo_entries != NULL ?
+              bo_handles_to_entries(bo_handles, bo_count, bo_entries) : -ENOMEM;
+
+        bo_list_in = (struct drm_amdgpu_bo_list_in){
+            .operation = ~0u,
+            .list_handle = ~0u,
+            .bo_number = bo_count,
+            .bo_info_size = sizeof(struct drm_amdgpu_bo_list_entry),
+            .bo_info_ptr = (uint64_t)(uintptr_t)bo_entries,
+        };
+    } else {
+        ret = bo_list_cache_get(dev, bo_handles, &bo_count, &bo_list,
+                                &bo_list_owned);
+    }
+    if (!on_stack) {
+        free(bo_handles);
+    }
+    stats_end(STAT_BO_LIST, t0);
 
     if (ret != 0) {
-        fprintf(stderr, "[ERROR] amdgpu_bo_list_create failed: %d\n", ret);
-        bo_free(dev, &ib);
-        return ret;
+        fprintf(stderr, "[ERROR] Failed to build BO list: %d\n", ret);
+        if (!on_stack) {
+            free(bo_entries);
+        }
+        goto fail_ib;
     }
 
     // Prepare submission
-    struct amdgpu_cs_ib_info ib_info = {
+    struct drm_amdgpu_cs_chunk_ib ib_info = {
         .flags = 0,
-        .ib_mc_address = ib.va_addr,
-        .size = packets->count, // Size in dwords
+        .va_start = ib_va,
+        .ib_bytes = ib_bytes,
+        .ip_type = ip_type,
+        .ip_instance = 0,
+        .ring = ring,
     };
 
-    struct amdgpu_cs_request req = {
-        .flags = 0,
-        .ip_type = AMDGPU_HW_IP_COMPUTE,
-        .ip_instance = 0,
-        .ring = 0,
-        .resources = bo_list,
-        .number_of_dependencies = 0,
-        .dependencies = NULL,
-        .number_of_ibs = 1,
-        .ibs = &ib_info,
-        .seq_no = 0,
-        .fence_info = {0},
+    struct drm_amdgpu_cs_chunk chunks[3] = {
+        {
+            .chunk_id = AMDGPU_CHUNK_ID_IB,
+            .length_dw = sizeof(ib_info) / 4,
+            .chunk_data = (uint64_t)(uintptr_t)&ib_info,
+        },
     };
+    int num_chunks = 1;
+
+    if (dev->use_bo_handles_chunk) {
+        chunks[num_chunks++] = (struct drm_amdgpu_cs_chunk){
+            .chunk_id = AMDGPU_CHUNK_ID_BO_HANDLES,
+            .length_dw = sizeof(bo_list_in) / 4,
+            .chunk_data = (uint64_t)(uintptr_t)&bo_list_in,
+        };
+    }
+
+    // The scheduler holds the job until every dependency fence signals
+    struct drm_amdgpu_cs_chunk_dep dep_entries[DEV_SUBMIT_MAX_DEPS];
+    if (dep_count > 0) {
+        for_range(i, 0, dep_count) {
+            amdgpu_cs_chunk_fence_to_dep((struct amdgpu_cs_fence*)&deps[i],
+                                         &dep_entries[i]);
+        }
+        chunks[num_chunks++] = (struct drm_amdgpu_cs_chunk){
+            .chunk_id = AMDGPU_CHUNK_ID_DEPENDENCIES,
+            .length_dw = (uint32_t)(sizeof(dep_entries[0]) / 4 * dep_count),
+            .chunk_data = (uint64_t)(uintptr_t)dep_entries,
+        };
+    }
 
     // Submit
-    ret = amdgpu_cs_submit(dev->ctx_handle, 0, &req, 1);
+    uint64_t seq_no = 0;
+    t0 = stats_begin();
+    ret = amdgpu_cs_submit_raw2(dev->dev_handle, dev->ctx_handle,
+                                bo_list, num_chunks, chunks, &seq_no);
+    stats_end(STAT_CS_SUBMIT, t0);
+    if (!on_stack) {
+        free(bo_entries);
+    }
+
+    // The kernel holds its own references now; uncached lists can go
+    if (bo_list_owned) {
+        amdgpu_bo_list_destroy_raw(dev->dev_handle, bo_list);
+    }
+
     if (ret != 0) {
-        fprintf(stderr, "[ERROR] amdgpu_cs_submit failed: %d\n", ret);
-        amdgpu_bo_list_destroy(bo_list);
-        bo_free(dev, &ib);
-        return ret;
+        fprintf(stderr, "[ERROR] amdgpu_cs_submit_raw2 failed: %d\n", ret);
+        goto fail_ib;
     }
 
-    fprintf(stdout, "[INFO] Command buffer submitted (seq=%lu)\n", req.seq_no);
+    HDB_LOG(stdout, "[INFO] Command buffer submitted (ip=%u ring=%u seq=%lu)\n",
+            ip_type, ring, seq_no);
 
     // Fill output structure
     *submit = (amdgpu_submit_t){
         .ib = ib,
-        .bo_list = bo_list,
+        .ib_slice = ib_slice,
         .fence = {
             .context = dev->ctx_handle,
-            .ip_type = AMDGPU_HW_IP_COMPUTE,
+            .ip_type = ip_type,
             .ip_instance = 0,
-            .ring = 0,
-            .fence = req.seq_no,
+            .ring = ring,
+            .fence = seq_no,
         },
     };
 
+    if (ib_slice != NULL) {
+        ib_ring_commit(ib_slice, &submit->fence);
+    }
+
     return 0;
+
+fail_ib:
+    stats_count(STAT_SUBMIT_FAIL, 1);
+    if (ib_slice != NULL) {
+        ib_ring_abort(ib_slice);
+    } else {
+        bo_free(dev, &ib);
+    }
+    return ret;
 }
 
 /**
@@ -282,10 +724,12 @@ int32_t dev_wait(amdgpu_t* dev, amdgpu_submit_t* submit, uint64_t timeout_ns) {
     (void)dev; // Unused
 
     uint32_t expired = 0;
+    uint64_t t0 = stats_begin();
     int32_t ret = amdgpu_cs_query_fence_status(&submit->fence,
                                                timeout_ns,
                                                0, // flags
                                                &expired);
+    stats_end(STAT_FENCE_WAIT, t0);
     if (ret != 0) {
         fprintf(stderr, "[ERROR] amdgpu_cs_query_fence_status failed: %d\n", ret);
         return ret;
@@ -296,10 +740,57 @@ int32_t dev_wait(amdgpu_t* dev, amdgpu_submit_t* submit, uint64_t timeout_ns) {
         return -ETIMEDOUT;
     }
 
-    fprintf(stdout, "[INFO] Command buffer completed\n");
+    HDB_LOG(stdout, "[INFO] Command buffer completed\n");
+    return 0;
+}
+
+/**
+ * Convert a fence with amdgpu_cs_fence_to_handle() into an fd.
+ */
+static int32_t dev_fence_export(amdgpu_t* dev, const struct amdgpu_cs_fence* fence,
+                                uint32_t what, int* fd) {
+    uint32_t handle = 0;
+    int32_t ret = amdgpu_cs_fence_to_handle(dev->dev_handle,
+                                            (struct amdgpu_cs_fence*)fence,
+                                            what, &handle);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] amdgpu_cs_fence_to_handle failed: %d\n", ret);
+        return ret;
+    }
+
+    *fd = (int)handle;
     return 0;
 }
 
+/**
+ * Export a submission fence as a sync_file fd.
+ * 
+ * @param dev: Device context
+ * @param fence: Fence from dev_submit()
+ * @param fd: Output fd; polls readable (EPOLLIN) once the fence signals
+ * @return: 0 on success, negative error code on failure
+ * 
+ * Unlike dev_wait() this never blocks, so many submissions (on any number
+ * of devices) can be waited on from one epoll set.
+ */
+int32_t dev_fence_to_sync_file(amdgpu_t* dev, const struct amdgpu_cs_fence* fence,
+                               int* fd) {
+    return dev_fence_export(dev, fence, AMDGPU_FENCE_TO_HANDLE_GET_SYNC_FILE_FD, fd);
+}
+
+/**
+ * Export a submission fence as a DRM syncobj fd.
+ * 
+ * @param dev: Device context
+ * @param fence: Fence from dev_submit()
+ * @param fd: Output fd (caller closes it)
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t dev_fence_to_syncobj(amdgpu_t* dev, const struct amdgpu_cs_fence* fence,
+                             int* fd) {
+    return dev_fence_export(dev, fence, AMDGPU_FENCE_TO_HANDLE_GET_SYNCOBJ_FD, fd);
+}
+
 /**
  * Clean up submission resources.
  * 
@@ -307,10 +798,8 @@ int32_t dev_wait(amdgpu_t* dev, amdgpu_submit_t* submit, uint64_t timeout_ns) {
  * @param submit: Submission to clean up
  */
 void dev_submit_cleanup(amdgpu_t* dev, amdgpu_submit_t* submit) {
-    if (submit->bo_list != NULL) {
-        amdgpu_bo_list_destroy(submit->bo_list);
-        submit->bo_list = NULL;
-    }
+    // Ring slices are reclaimed by ib_ring_acquire() once their fence signals
+    submit->ib_slice = NULL;
 
     bo_free(dev, &submit->ib);
 }
@@ -2,15 +2,64 @@
 
 #include "bo.h"
 
+/**
+ * Max GPUs amdgpu_enumerate_devices() reports.
+ */
+#define AMDGPU_MAX_DEVICES  16
+
+/**
+ * amdgpu_device_desc_t: One AMD GPU found by amdgpu_enumerate_devices().
+ */
+typedef struct {
+    char     render_path[64];   // /dev/dri/renderD* ("" if none)
+    char     primary_path[64];  // /dev/dri/card* ("" if none)
+    char     pci_bus_id[16];    // PCI address, also the debugfs pairing key
+    uint32_t device_id;         // PCI device ID
+} amdgpu_device_desc_t;
+
+/**
+ * List the AMD GPUs in the system (drmGetDevices2()).
+ * 
+ * @param descs: Output descriptors
+ * @param max: Capacity of descs
+ * @param count: Output number of GPUs found
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t amdgpu_enumerate_devices(amdgpu_device_desc_t* descs, uint32_t max,
+                                 uint32_t* count);
+
 /**
  * Initialize AMDGPU device and create command submission context.
  * 
- * @param device_path: Path to DRM device (NULL for auto-detect)
+ * @param device_path: Path to DRM device (NULL for the first AMD GPU)
  * @param dev: Output device structure
  * @return: 0 on success, negative error code on failure
  */
 int32_t amdgpu_device_init(const char* device_path, amdgpu_t* dev);
 
+/**
+ * Open one of the device's debugfs files (e.g. "amdgpu_vram").
+ * 
+ * @param dev: Device context
+ * @param name: File name inside the device's debugfs directory
+ * @param flags: open() flags
+ * @return: File descriptor, or negative error code (-ENODEV without a
+ *          PCI address)
+ */
+int amdgpu_device_open_debugfs(const amdgpu_t* dev, const char* name, int flags);
+
+/**
+ * Open a new debugfs regs2 descriptor for the device.
+ * 
+ * Each descriptor carries its own SRBM/GRBM selector, so threads that
+ * access registers concurrently need one each (see reg_channel_t).
+ * 
+ * @param dev: Device context
+ * @return: File descriptor, or negative error code (-ENODEV without a
+ *          PCI address)
+ */
+int amdgpu_device_open_regs2(const amdgpu_t* dev);
+
 /**
  * Clean up device context and free resources.
  * 
@@ -18,15 +67,31 @@ int32_t amdgpu_device_init(const char* device_path, amdgpu_t* dev);
  */
 void amdgpu_device_cleanup(amdgpu_t* dev);
 
+/**
+ * Start a packet stream directly in IB memory (no copy at dev_submit()).
+ * 
+ * @param dev: Device context
+ * @param packets: Output packet array
+ * @return: true if the stream lives in an IB ring slice, false if it fell
+ *          back to a heap array (still usable the same way)
+ * 
+ * DANGER: The slice stays acquired until dev_submit() or pkt3_free().
+ */
+bool dev_packets_begin(amdgpu_t* dev, pkt3_packets_t* packets);
+
 /**
  * Submit command buffer to GPU.
  * 
  * @param dev: Device context
- * @param packets: PM4 packet array
+ * @param packets: PM4 packet array (emptied if built by dev_packets_begin())
  * @param buffers: Array of BO handles to include in submission
  * @param buffers_count: Number of BOs
  * @param submit: Output submission info (for fence wait)
  * @return: 0 on success, negative error code on failure
+ *
+ * Always uses the same work ring (DEV_RING_DEFAULT), so back-to-back
+ * submissions execute and retire in order. Spread work over the rings
+ * with dev_submit_ex(..., DEV_RING_ANY, ...).
  */
 int32_t dev_submit(amdgpu_t* dev,
                    pkt3_packets_t* packets,
@@ -34,6 +99,79 @@ int32_t dev_submit(amdgpu_t* dev,
                    uint32_t buffers_count,
                    amdgpu_submit_t* submit);
 
+/**
+ * Max fences one submission can depend on (dev_submit_ex()).
+ */
+#define DEV_SUBMIT_MAX_DEPS  16
+
+/**
+ * Ring selectors for dev_submit_ex() besides a compute ring index.
+ * 
+ * With two or more compute rings the highest one is reserved for the
+ * debugger itself (save-area readback, state patching, BO clears), so
+ * that work never queues behind long-running or halted user dispatches.
+ */
+#define DEV_RING_ANY      0xFFFFFFFFu  // Round-robin across the work rings
+#define DEV_RING_CONTROL  0xFFFFFFFEu  // Dedicated debugger control ring
+#define DEV_RING_DEFAULT  0xFFFFFFFDu  // Lowest work ring (dev_submit())
+
+/**
+ * Resolve a ring selector to a compute ring index.
+ * 
+ * @param dev: Device context
+ * @param ring: Ring index, DEV_RING_ANY (advances the round-robin),
+ *              DEV_RING_DEFAULT or DEV_RING_CONTROL
+ * @return: Ring index, or -EINVAL if the ring does not exist
+ */
+int32_t dev_pick_ring(amdgpu_t* dev, uint32_t ring);
+
+/**
+ * Submit command buffer to GPU once the given fences have signaled.
+ * 
+ * @param dev: Device context
+ * @param packets: PM4 packet array (emptied if built by dev_packets_begin())
+ * @param buffers: Array of BO handles to include in submission
+ * @param buffers_count: Number of BOs
+ * @param ring: Compute ring index, DEV_RING_ANY, DEV_RING_DEFAULT or
+ *              DEV_RING_CONTROL
+ * @param deps: Fences to wait for in the kernel scheduler (NULL if none)
+ * @param dep_count: Number of fences (at most DEV_SUBMIT_MAX_DEPS)
+ * @param submit: Output submission info (for fence wait)
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t dev_submit_ex(amdgpu_t* dev,
+                      pkt3_packets_t* packets,
+                      amdgpu_bo_handle* buffers,
+                      uint32_t buffers_count,
+                      uint32_t ring,
+                      const struct amdgpu_cs_fence* deps,
+                      uint32_t dep_count,
+                      amdgpu_submit_t* submit);
+
+/**
+ * Submit command buffer to any hardware IP (e.g. SDMA).
+ * 
+ * @param dev: Device context
+ * @param ip_type: AMDGPU_HW_IP_COMPUTE or AMDGPU_HW_IP_DMA
+ * @param ring: Ring index of that IP (see compute_rings / dma_rings)
+ * @param packets: Packets for that IP (PM4 or SDMA)
+ * @param buffers: Array of BO handles to include in submission
+ * @param buffers_count: Number of BOs
+ * @param deps: Fences to wait for in the kernel scheduler (NULL if none)
+ * @param dep_count: Number of fences (at most DEV_SUBMIT_MAX_DEPS)
+ * @param submit: Output submission info (for fence wait)
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t dev_submit_ip(amdgpu_t* dev,
+                      uint32_t ip_type,
+                      uint32_t ring,
+                      pkt3_packets_t* packets,
+                      amdgpu_bo_handle* buffers,
+                      uint32_t buffers_count,
+                      const struct amdgpu_cs_fence* deps,
+                      uint32_t dep_count,
+                      amdgpu_submit_t* submit);
+
 /**
  * Wait for command submission to complete.
  * 
@@ -44,6 +182,31 @@ int32_t dev_submit(amdgpu_t* dev,
  */
 int32_t dev_wait(amdgpu_t* dev, amdgpu_submit_t* submit, uint64_t timeout_ns);
 
+/**
+ * Export a submission fence as a sync_file fd.
+ * 
+ * @param dev: Device context
+ * @param fence: Fence from dev_submit()
+ * @param fd: Output fd; polls readable (EPOLLIN) once the fence signals
+ * @return: 0 on success, negative error code on failure
+ * 
+ * DANGER: The caller owns fd and must close() it.
+ */
+int32_t dev_fence_to_sync_file(amdgpu_t* dev, const struct amdgpu_cs_fence* fence,
+                               int* fd);
+
+/**
+ * Export a submission fence as a DRM syncobj fd (for another process or
+ * device to import with drmSyncobjFDToHandle()).
+ * 
+ * @param dev: Device context
+ * @param fence: Fence from dev_submit()
+ * @param fd: Output fd (caller closes it)
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t dev_fence_to_syncobj(amdgpu_t* dev, const struct amdgpu_cs_fence* fence,
+                             int* fd);
+
 /**
  * Clean up submission resources.
  * 
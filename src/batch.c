@@ -0,0 +1,716 @@
+#include "batch.h"
+#include "breakpoint.h"
+#include "mailbox.h"
+#include "pm4.h"
+#include "regs.h"
+#include <stdlib.h>
+
+// Defaults until a script sets rsrc / grid (one wave32 workgroup)
+#define BATCH_RSRC1_DX10_CLAMP      (1u << 21)
+#define BATCH_RSRC1_DEBUG_MODE      (1u << 22)
+#define BATCH_RSRC1_IEEE_MODE       (1u << 23)
+#define BATCH_RSRC2_TRAP_PRESENT    (1u << 6)
+
+#define BATCH_CODE_ALIGN            256
+#define BATCH_DEFAULT_VGPRS         2
+#define BATCH_MAX_VGPRS             256
+#define BATCH_DEFAULT_TIMEOUT_MS    10000
+#define BATCH_MAX_TOKENS            8
+#define BATCH_DRAIN_MAX             64
+
+static bool batch_parse_u64(const char* tok, uint64_t* value) {
+    char* end = NULL;
+    errno = 0;
+    *value = strtoull(tok, &end, 0);
+    return errno == 0 && end != tok && *end == '\0' && tok[0] != '-';
+}
+
+static bool batch_parse_u32(const char* tok, uint32_t* value) {
+    uint64_t v = 0;
+    if (!batch_parse_u64(tok, &v) || v > UINT32_MAX) {
+        return false;
+    }
+    *value = (uint32_t)v;
+    return true;
+}
+
+/**
+ * Parser state: dispatch parameters in effect at the current line.
+ */
+typedef struct {
+    batch_script_t*   s;
+    const char*       path;
+    uint32_t          line;
+    uint32_t          op_capacity;
+    uint32_t          dispatch_capacity;
+    batch_dispatch_t  current;
+    uint64_t          code_size;     // Bytes of the current code object (0 = none yet)
+    uint32_t          watches[BATCH_MAX_WATCHES];
+    uint32_t          watch_count;
+} batch_parser_t;
+
+static int32_t batch_syntax(const batch_parser_t* p, const char* msg) {
+    fprintf(stderr, "[ERROR] %s:%u: %s\n", p->path, p->line, msg);
+    return -EINVAL;
+}
+
+static batch_op_t* batch_push_op(batch_parser_t* p, batch_op_kind_t kind) {
+    batch_script_t* s = p->s;
+    if (s->op_count == p->op_capacity) {
+        uint32_t capacity = MAX(p->op_capacity * 2, 64u);
+        batch_op_t* ops = realloc(s->ops, capacity * sizeof(*ops));
+        if (ops == NULL) {
+            return NULL;
+        }
+        s->ops = ops;
+        p->op_capacity = capacity;
+    }
+
+    batch_op_t* op = &s->ops[s->op_count++];
+    *op = (batch_op_t){ .kind = kind, .line = p->line };
+    return op;
+}
+
+static int32_t batch_parse_code(batch_parser_t* p, const char* file) {
+    void* data = NULL;
+    size_t size = 0;
+    int32_t ret = hdb_read_file(file, &data, &size);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] %s:%u: Failed to read code object %s: %d\n",
+                p->path, p->line, file, ret);
+        return ret;
+    }
+    if (size % 4 != 0) {
+        free(data);
+        return batch_syntax(p, "code object size is not a multiple of 4 bytes");
+    }
+
+    // PGM_LO holds the address >> 8, so every object starts 256-byte aligned
+    batch_script_t* s = p->s;
+    size_t offset = ALIGN_UP(s->image_size, (size_t)BATCH_CODE_ALIGN);
+    uint8_t* image = realloc(s->image, offset + size);
+    if (image == NULL) {
+        free(data);
+        return -ENOMEM;
+    }
+    memset(image + s->image_size, 0, offset - s->image_size);
+    memcpy(image + offset, data, size);
+    free(data);
+
+    s->image = image;
+    s->image_size = offset + size;
+    p->current.code_offset = offset;
+    p->code_size = size;
+    return 0;
+}
+
+/**
+ * Byte offset into the current code object, as an offset into the image.
+ */
+static int32_t batch_parse_offset(batch_parser_t* p, const char* tok, uint64_t* offset) {
+    uint64_t v = 0;
+    if (p->code_size == 0) {
+        return batch_syntax(p, "breakpoint before any code object");
+    }
+    if (!batch_parse_u64(tok, &v) || v >= p->code_size || v % 4 != 0) {
+        return batch_syntax(p, "breakpoint offset is not a dword inside the code object");
+    }
+    *offset = p->current.code_offset + v;
+    return 0;
+}
+
+static int32_t batch_parse_line(batch_parser_t* p, char** tok, uint32_t n) {
+    batch_script_t* s = p->s;
+    const char* cmd = tok[0];
+    batch_op_t* op = NULL;
+
+    if (strcmp(cmd, "vgprs") == 0) {
+        if (n != 2 || !batch_parse_u32(tok[1], &s->vgprs) || s->vgprs < 2 ||
+            s->vgprs > BATCH_MAX_VGPRS) {
+            return batch_syntax(p, "usage: vgprs <2..256>");
+        }
+        return 0;
+    }
+    if (strcmp(cmd, "timeout") == 0) {
+        uint64_t ms = 0;
+        if (n != 2 || !batch_parse_u64(tok[1], &ms) || ms > UINT64_MAX / 1000000) {
+            return batch_syntax(p, "usage: timeout <ms>");
+        }
+        s->timeout_ns = ms * 1000000;
+        return 0;
+    }
+    if (strcmp(cmd, "code") == 0) {
+        if (n != 2) {
+            return batch_syntax(p, "usage: code <file>");
+        }
+        return batch_parse_code(p, tok[1]);
+    }
+    if (strcmp(cmd, "rsrc") == 0) {
+        if (n != 4) {
+            return batch_syntax(p, "usage: rsrc <rsrc1> <rsrc2> <rsrc3>");
+        }
+        for_range(i, 0, 3) {
+            if (!batch_parse_u32(tok[i + 1], &p->current.rsrc[i])) {
+                return batch_syntax(p, "bad rsrc value");
+            }
+        }
+        p->current.rsrc[1] |= BATCH_RSRC2_TRAP_PRESENT;
+        return 0;
+    }
+    if (strcmp(cmd, "grid") == 0) {
+        if (n != 7) {
+            return batch_syntax(p, "usage: grid <tx> <ty> <tz> <gx> <gy> <gz>");
+        }
+        uint32_t v[6];
+        for_range(i, 0, 6) {
+            if (!batch_parse_u32(tok[i + 1], &v[i]) || v[i] == 0) {
+                return batch_syntax(p, "grid dimensions must be positive");
+            }
+        }
+        memcpy(p->current.threads, &v[0], sizeof(p->current.threads));
+        memcpy(p->current.groups, &v[3], sizeof(p->current.groups));
+        return 0;
+    }
+
+    if (strcmp(cmd, "dispatch") == 0) {
+        uint64_t count = 1;
+        if (n > 2 || (n == 2 && (!batch_parse_u64(tok[1], &count) || count == 0))) {
+            return batch_syntax(p, "usage: dispatch [count]");
+        }
+        if (p->code_size == 0) {
+            return batch_syntax(p, "dispatch before any code object");
+        }
+
+        if (s->dispatch_count == p->dispatch_capacity) {
+            uint32_t capacity = MAX(p->dispatch_capacity * 2, 16u);
+            batch_dispatch_t* d = realloc(s->dispatches, capacity * sizeof(*d));
+            if (d == NULL) {
+                return -ENOMEM;
+            }
+            s->dispatches = d;
+            p->dispatch_capacity = capacity;
+        }
+
+        s->dispatches[s->dispatch_count++] = p->current;
+        op = batch_push_op(p, BATCH_OP_DISPATCH);
+        if (op != NULL) {
+            op->arg = count;
+            op->dispatch = s->dispatch_count - 1;
+        }
+    } else if (strcmp(cmd, "break") == 0 || strcmp(cmd, "delete") == 0) {
+        uint64_t offset = 0;
+        if (n != 2) {
+            return batch_syntax(p, "usage: break|delete <offset>");
+        }
+        int32_t ret = batch_parse_offset(p, tok[1], &offset);
+        if (ret != 0) {
+            return ret;
+        }
+        op = batch_push_op(p, cmd[0] == 'b' ? BATCH_OP_BREAK : BATCH_OP_DELETE);
+        if (op != NULL) {
+            op->arg = offset;
+        }
+    } else if (strcmp(cmd, "watch") == 0) {
+        uint32_t sgpr = 0;
+        if (n != 2 || !batch_parse_u32(tok[1], &sgpr) || sgpr >= MAILBOX_MAX_SGPRS) {
+            return batch_syntax(p, "usage: watch <sgpr 0..127>");
+        }
+        for_range(i, 0, p->watch_count) {
+            if (p->watches[i] == sgpr) {
+                return 0;
+            }
+        }
+        if (p->watch_count == BATCH_MAX_WATCHES) {
+            return batch_syntax(p, "too many watched SGPRs");
+        }
+        p->watches[p->watch_count++] = sgpr;
+        op = batch_push_op(p, BATCH_OP_WATCH);
+        if (op != NULL) {
+            op->arg = sgpr;
+        }
+    } else if (strcmp(cmd, "dump-regs") == 0) {
+        if (n != 2) {
+            return batch_syntax(p, "usage: dump-regs <file>|off");
+        }
+        char* file = NULL;
+        if (strcmp(tok[1], "off") != 0 && (file = strdup(tok[1])) == NULL) {
+            return -ENOMEM;
+        }
+        op = batch_push_op(p, BATCH_OP_DUMP_REGS);
+        if (op == NULL) {
+            free(file);
+        } else {
+            op->path = file;
+        }
+    } else if (strcmp(cmd, "continue") == 0) {
+        uint64_t stops = 1;
+        if (n > 2 || (n == 2 && (!batch_parse_u64(tok[1], &stops) || stops == 0))) {
+            return batch_syntax(p, "usage: continue [n]");
+        }
+        op = batch_push_op(p, BATCH_OP_CONTINUE);
+        if (op != NULL) {
+            op->arg = stops;
+        }
+    } else if (strcmp(cmd, "wait") == 0) {
+        if (n != 1) {
+            return batch_syntax(p, "usage: wait");
+        }
+        op = batch_push_op(p, BATCH_OP_WAIT);
+    } else {
+        return batch_syntax(p, "unknown command");
+    }
+
+    return op != NULL ? 0 : -ENOMEM;
+}
+
+int32_t batch_script_load(const char* path, batch_script_t* s) {
+    *s = (batch_script_t){
+        .vgprs = BATCH_DEFAULT_VGPRS,
+        .timeout_ns = BATCH_DEFAULT_TIMEOUT_MS * 1000000ull,
+    };
+
+    bool use_stdin = strcmp(path, "-") == 0;
+    FILE* f = use_stdin ? stdin : fopen(path, "r");
+    if (f == NULL) {
+        int32_t ret = -errno;
+        fprintf(stderr, "[ERROR] Failed to open script %s: %d\n", path, ret);
+        return ret;
+    }
+
+    batch_parser_t p = {
+        .s = s,
+        .path = path,
+        .current = {
+            .rsrc = { BATCH_RSRC1_DX10_CLAMP | BATCH_RSRC1_IEEE_MODE,
+                      BATCH_RSRC2_TRAP_PRESENT, 0 },
+            .threads = { 32, 1, 1 },
+            .groups = { 1, 1, 1 },
+        },
+    };
+
+    int32_t ret = 0;
+    char* line = NULL;
+    size_t line_capacity = 0;
+    while (ret == 0 && getline(&line, &line_capacity, f) >= 0) {
+        p.line++;
+
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        char* tok[BATCH_MAX_TOKENS];
+        uint32_t n = 0;
+        char* save = NULL;
+        for (char* t = strtok_r(line, " \t\r\n", &save); t != NULL;
+             t = strtok_r(NULL, " \t\r\n", &save)) {
+            if (n == BATCH_MAX_TOKENS) {
+                ret = batch_syntax(&p, "too many arguments");
+                break;
+            }
+            tok[n++] = t;
+        }
+        if (ret == 0 && n != 0) {
+            ret = batch_parse_line(&p, tok, n);
+        }
+    }
+    if (ret == 0 && ferror(f)) {
+        ret = -EIO;
+    }
+
+    free(line);
+    if (!use_stdin) {
+        fclose(f);
+    }
+    if (ret != 0) {
+        batch_script_free(s);
+    }
+    return ret;
+}
+
+void batch_script_free(batch_script_t* s) {
+    for_range(i, 0, s->op_count) {
+        free(s->ops[i].path);
+    }
+    free(s->ops);
+    free(s->dispatches);
+    free(s->image);
+    *s = (batch_script_t){0};
+}
+
+/**
+ * batch_run_t: Executor state.
+ */
+typedef struct {
+    amdgpu_t*              dev;
+    const batch_script_t*  s;
+    batch_result_t*        result;
+    uint64_t               start_ns;
+
+    mailbox_t              mb;
+    bp_table_t             bp;
+    amdgpu_bo_t            code;
+    amdgpu_bo_t            tba;
+    amdgpu_bo_handle       handles[4];
+
+    // Pipeline: queue[head] is the oldest dispatch in flight
+    pm4_template_t         base;
+    pm4_template_t         prepared;
+    uint32_t               prepared_for;  // Dispatch index (UINT32_MAX = none)
+    bool                   prepared_debug; // DEBUG_MODE forced in the prepared stream
+    amdgpu_submit_t        queue[BATCH_PIPELINE_DEPTH];
+    uint32_t               head;
+    uint32_t               inflight;
+
+    // Stop consumers
+    uint32_t               watches[BATCH_MAX_WATCHES];
+    uint32_t               watch_count;
+    uint32_t*              watch_last;    // slot_count x BATCH_MAX_WATCHES
+    uint16_t*              watch_seen;    // Per slot, bit per watch
+    trace_file_writer_t    dump;
+    bool                   dump_open;
+    uint32_t               reg_count;
+    uint32_t*              regs;          // Dump record scratch
+} batch_run_t;
+
+/**
+ * Breakpoints only fire on a trap, so dispatches single-step (filtered by
+ * the trap handler) while any breakpoint is set.
+ */
+static inline bool batch_debug_mode(const batch_run_t* r) {
+    return r->bp.count != 0;
+}
+
+static void batch_prepare(batch_run_t* r, uint32_t index) {
+    const batch_dispatch_t* d = &r->s->dispatches[index];
+    bool debug = batch_debug_mode(r);
+
+    r->prepared = r->base;
+    pm4_template_set_code(&r->prepared, r->code.va_addr + d->code_offset);
+    pm4_template_set_rsrc(&r->prepared, d->rsrc[0] | (debug ? BATCH_RSRC1_DEBUG_MODE : 0),
+                          d->rsrc[1], d->rsrc[2]);
+    pm4_template_set_grid(&r->prepared, d->threads[0], d->threads[1], d->threads[2],
+                          d->groups[0], d->groups[1], d->groups[2]);
+    r->prepared_for = index;
+    r->prepared_debug = debug;
+}
+
+/**
+ * Consume one stop: watches, then the dump record.
+ */
+static int32_t batch_stop(batch_run_t* r, uint32_t slot) {
+    const mailbox_slot_t* ms = mailbox_slot(&r->mb, slot);
+    const uint32_t* sgprs = mailbox_slot_sgprs(&r->mb, slot);
+    uint64_t pc = ((uint64_t)ms->pc_hi << 32) | ms->pc_lo;
+
+    r->result->stops++;
+
+    uint32_t* last = &r->watch_last[(size_t)slot * BATCH_MAX_WATCHES];
+    for_range(w, 0, r->watch_count) {
+        uint32_t value = sgprs[r->watches[w]];
+        uint16_t bit = (uint16_t)(1u << w);
+        if ((r->watch_seen[slot] & bit) == 0 || last[w] != value) {
+            HDB_LOG(stdout, "[INFO] wave 0x%08x pc=0x%012lx s%u=0x%08x\n",
+                    ms->hw_id1, pc, r->watches[w], value);
+            last[w] = value;
+            r->watch_seen[slot] |= bit;
+        }
+    }
+
+    if (!r->dump_open) {
+        return 0;
+    }
+
+    uint32_t* regs = r->regs;
+    regs[0] = ms->exec_lo;
+    regs[1] = ms->exec_hi;
+    regs[2] = ms->vcc_lo;
+    regs[3] = ms->vcc_hi;
+    regs[4] = ms->m0;
+    regs[5] = ms->status;
+    regs[6] = ms->trap_sts;
+    memcpy(&regs[BATCH_DUMP_FIXED_REGS], sgprs, MAILBOX_MAX_SGPRS * sizeof(uint32_t));
+    memcpy(&regs[BATCH_DUMP_FIXED_REGS + MAILBOX_MAX_SGPRS], mailbox_slot_vgprs(&r->mb, slot),
+           (size_t)r->mb.vgpr_count * r->mb.lanes * sizeof(uint32_t));
+
+    int32_t ret = trace_file_append(&r->dump, ms->hw_id1, pc, hdb_now_ns() - r->start_ns, regs);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to write dump record: %d\n", ret);
+        return ret;
+    }
+    r->result->records++;
+    return 0;
+}
+
+/**
+ * Consume stops until `stops` were handled (UINT64_MAX = no limit) or at
+ * most max_inflight dispatches are left in flight.
+ */
+static int32_t batch_pump(batch_run_t* r, uint64_t stops, uint32_t max_inflight) {
+    while (r->inflight > max_inflight && stops > 0) {
+        // Edits since the last pump go out once, before waves move on
+        bp_table_commit(&r->bp);
+        HDB_LOG_DRAIN();
+
+        amdgpu_submit_t* oldest = &r->queue[r->head];
+        int32_t ret = mailbox_wait_any(&r->mb, NULL, oldest, r->s->timeout_ns);
+        if (ret < 0) {
+            fprintf(stderr, "[ERROR] Batch wait failed: %d\n", ret);
+            return ret;
+        }
+
+        if (ret == MAILBOX_WAIT_COMPLETED) {
+            dev_submit_cleanup(r->dev, oldest);
+            r->head = (r->head + 1) % BATCH_PIPELINE_DEPTH;
+            r->inflight--;
+            r->result->dispatches++;
+            continue;
+        }
+        if (ret != MAILBOX_WAIT_TRAPPED) {
+            continue;
+        }
+
+        // Stops beyond the budget stay parked for the next command
+        uint32_t slots[BATCH_DRAIN_MAX];
+        uint32_t count = mailbox_drain(&r->mb, slots,
+                                       (uint32_t)MIN(stops, (uint64_t)BATCH_DRAIN_MAX));
+        for_range(i, 0, count) {
+            ret = batch_stop(r, slots[i]);
+            if (ret != 0) {
+                mailbox_resume_batch(&r->mb, slots, count);
+                return ret;
+            }
+        }
+        mailbox_resume_batch(&r->mb, slots, count);
+
+        if (stops != UINT64_MAX) {
+            stops -= count;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Submit a dispatch from the prepared stream, then prepare the next one
+ * while this one runs.
+ */
+static int32_t batch_submit(batch_run_t* r, uint32_t index, uint32_t next) {
+    if (r->inflight == BATCH_PIPELINE_DEPTH) {
+        int32_t ret = batch_pump(r, UINT64_MAX, BATCH_PIPELINE_DEPTH - 1);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    // Re-patch if breakpoints were set or all cleared since it was prepared
+    if (r->prepared_for != index || r->prepared_debug != batch_debug_mode(r)) {
+        batch_prepare(r, index);
+    }
+    bp_table_commit(&r->bp);
+
+    amdgpu_submit_t* submit = &r->queue[(r->head + r->inflight) % BATCH_PIPELINE_DEPTH];
+    *submit = (amdgpu_submit_t){0};
+    pkt3_packets_t packets = pm4_template_packets(&r->prepared);
+    int32_t ret = dev_submit(r->dev, &packets, r->handles, ARRAY_SIZE(r->handles), submit);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Batch dispatch submission failed: %d\n", ret);
+        return ret;
+    }
+    r->inflight++;
+
+    if (next != UINT32_MAX && next != index) {
+        batch_prepare(r, next);
+    }
+    return 0;
+}
+
+/**
+ * Dispatch index of the first "dispatch" after op i (UINT32_MAX = none).
+ */
+static uint32_t batch_next_dispatch(const batch_script_t* s, uint32_t i) {
+    for (uint32_t j = i + 1; j < s->op_count; j++) {
+        if (s->ops[j].kind == BATCH_OP_DISPATCH) {
+            return s->ops[j].dispatch;
+        }
+    }
+    return UINT32_MAX;
+}
+
+static int32_t batch_dump_regs(batch_run_t* r, const char* path) {
+    if (r->dump_open) {
+        r->dump_open = false;
+        int32_t ret = trace_file_finish(&r->dump);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] Failed to finish dump file: %d\n", ret);
+            return ret;
+        }
+    }
+    if (path == NULL) {
+        return 0;
+    }
+
+    // Full register dumps are large; keep each chunk's buffers bounded
+    uint32_t chunk = trace_file_chunk_records(r->reg_count, TRACE_FILE_CHUNK_BYTES);
+    int32_t ret = trace_file_create(path, r->code.va_addr, r->reg_count, chunk, &r->dump);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to create dump file %s: %d\n", path, ret);
+        return ret;
+    }
+    r->dump_open = true;
+    return 0;
+}
+
+static int32_t batch_exec(batch_run_t* r, uint32_t i) {
+    const batch_op_t* op = &r->s->ops[i];
+    uint64_t pc = r->code.va_addr + op->arg;
+    int32_t ret = 0;
+
+    switch ((batch_op_kind_t)op->kind) {
+    case BATCH_OP_DISPATCH: {
+        uint32_t next = batch_next_dispatch(r->s, i);
+        for (uint64_t k = 0; k < op->arg && ret == 0; k++) {
+            ret = batch_submit(r, op->dispatch, k + 1 < op->arg ? op->dispatch : next);
+        }
+        break;
+    }
+    case BATCH_OP_BREAK:
+        ret = bp_add(&r->bp, pc);
+        if (ret == -EEXIST) {
+            fprintf(stderr, "[WARN] line %u: breakpoint already set\n", op->line);
+            ret = 0;
+        }
+        break;
+    case BATCH_OP_DELETE:
+        ret = bp_remove(&r->bp, pc);
+        if (ret == -ENOENT) {
+            fprintf(stderr, "[WARN] line %u: no breakpoint to delete\n", op->line);
+            ret = 0;
+        }
+        break;
+    case BATCH_OP_WATCH:
+        r->watches[r->watch_count++] = (uint32_t)op->arg;
+        break;
+    case BATCH_OP_DUMP_REGS:
+        ret = batch_dump_regs(r, op->path);
+        break;
+    case BATCH_OP_CONTINUE: {
+        uint64_t before = r->result->stops;
+        ret = batch_pump(r, op->arg, 0);
+        uint64_t seen = r->result->stops - before;
+        if (ret == 0 && seen < op->arg) {
+            fprintf(stderr, "[WARN] line %u: every dispatch retired after %lu of %lu stops\n",
+                    op->line, seen, op->arg);
+        }
+        break;
+    }
+    case BATCH_OP_WAIT:
+        ret = batch_pump(r, UINT64_MAX, 0);
+        break;
+    }
+
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Script line %u failed: %d\n", op->line, ret);
+    }
+    return ret;
+}
+
+static int32_t batch_load_bo(amdgpu_t* dev, const void* data, size_t size, amdgpu_bo_t* bo) {
+    int32_t ret = bo_alloc(dev, size, AMDGPU_GEM_DOMAIN_GTT, false, bo);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to allocate code BO: %d\n", ret);
+        return ret;
+    }
+    bo_upload(bo, data, size);
+    hdb_wc_fence();
+    return 0;
+}
+
+int32_t batch_run(amdgpu_t* dev, const batch_script_t* s, const void* handler,
+                  size_t handler_size, batch_result_t* result) {
+    *result = (batch_result_t){0};
+    if (s->image_size == 0) {
+        return 0;  // No code object, so no dispatch either
+    }
+
+    batch_run_t* r = calloc(1, sizeof(*r));
+    if (r == NULL) {
+        return -ENOMEM;
+    }
+    r->dev = dev;
+    r->s = s;
+    r->result = result;
+    r->prepared_for = UINT32_MAX;
+    r->start_ns = hdb_now_ns();
+
+    int32_t ret = mailbox_init(dev, NULL, s->vgprs, BATCH_LANES, &r->mb);
+    if (ret == 0) {
+        ret = batch_load_bo(dev, handler, handler_size, &r->tba);
+    }
+    if (ret == 0) {
+        ret = batch_load_bo(dev, s->image, s->image_size, &r->code);
+    }
+    if (ret == 0) {
+        ret = bp_table_init(dev, r->code.va_addr, 0, &r->bp);
+    }
+    if (ret != 0) {
+        goto out;
+    }
+
+    r->reg_count = BATCH_DUMP_FIXED_REGS + MAILBOX_MAX_SGPRS + s->vgprs * BATCH_LANES;
+    r->regs = malloc(r->reg_count * sizeof(uint32_t));
+    r->watch_last = calloc((size_t)r->mb.slot_count * BATCH_MAX_WATCHES, sizeof(uint32_t));
+    r->watch_seen = calloc(r->mb.slot_count, sizeof(uint16_t));
+    if (r->regs == NULL || r->watch_last == NULL || r->watch_seen == NULL) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    mailbox_set_breakpoints(&r->mb, r->bp.bo.va_addr);
+    ret = dev_setup_trap_handler(dev, r->tba.va_addr, r->mb.bo.va_addr);
+    if (ret != 0) {
+        goto out;
+    }
+
+    r->handles[0] = r->code.bo_handle;
+    r->handles[1] = r->tba.bo_handle;
+    r->handles[2] = r->mb.bo.bo_handle;
+    r->handles[3] = r->bp.bo.bo_handle;
+    pm4_template_record_dispatch(&r->base, false);
+
+    for (uint32_t i = 0; i < s->op_count && ret == 0; i++) {
+        ret = batch_exec(r, i);
+    }
+    if (ret == 0) {
+        ret = batch_pump(r, UINT64_MAX, 0);
+    }
+
+out:
+    if (r->dump_open) {
+        r->dump_open = false;
+        int32_t finish = trace_file_finish(&r->dump);
+        ret = ret != 0 ? ret : finish;
+    }
+
+    // After a failure, still release parked waves so the dispatches retire
+    if (r->inflight != 0) {
+        r->watch_count = 0;
+        batch_pump(r, UINT64_MAX, 0);
+    }
+    result->elapsed_ns = hdb_now_ns() - r->start_ns;
+
+    if (r->inflight != 0) {
+        HDB_WARN("batch dispatches still in flight; leaking trap buffers");
+    } else {
+        if (r->bp.bo.va_addr != 0) {
+            mailbox_set_breakpoints(&r->mb, 0);
+        }
+        bp_table_fini(dev, &r->bp);
+        bo_free(dev, &r->code);
+        bo_free(dev, &r->tba);
+        mailbox_fini(dev, &r->mb);
+        free(r->regs);
+        free(r->watch_last);
+        free(r->watch_seen);
+        free(r);
+    }
+    return ret;
+}
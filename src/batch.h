@@ -0,0 +1,150 @@
+#pragma once
+
+#include "amdgpu_device.h"
+#include "trace_file.h"
+
+/**
+ * Headless batch debugging.
+ *
+ * A script is parsed and every code object is read before anything is
+ * submitted, so a typo on line 9000 fails in milliseconds instead of
+ * after an overnight run. The executor then walks the commands without
+ * any terminal round-trip: up to BATCH_PIPELINE_DEPTH dispatches are in
+ * flight at once, and the PM4 stream of the next dispatch is patched from
+ * a recorded template while the current one runs, so it is submitted the
+ * moment a pipeline entry frees up.
+ *
+ * Every stop is consumed the same way: logged for each watched SGPR that
+ * changed since the previous stop in the same wave slot, appended to the
+ * dump-regs trace file when one is open, then resumed. Stops nobody
+ * consumed yet stay parked in the trap ring, so edits made after
+ * "continue N" apply to them.
+ *
+ * Script syntax, one command per line, '#' starts a comment, numbers are
+ * decimal or 0x hex, offsets are bytes into the current code object:
+ *
+ *   vgprs <n>                  VGPRs saved per stop (setup, default 2)
+ *   timeout <ms>               Limit per wait, 0 = none (setup, default 10000)
+ *   code <file>                Raw GFX11 binary run by later dispatches
+ *   rsrc <rsrc1> <rsrc2> <rsrc3>  COMPUTE_PGM_RSRC1..3 (TRAP_PRESENT forced)
+ *   grid <tx> <ty> <tz> <gx> <gy> <gz>  Workgroup size and count
+ *   dispatch [count]           Submit count dispatches (default 1)
+ *   break <offset>             Set a breakpoint (bp_table, GPU-filtered)
+ *   delete <offset>            Clear a breakpoint
+ *   watch <sgpr>               Log s<sgpr> whenever it changed at a stop
+ *   dump-regs <file>|off       Append every later stop to a trace file
+ *   continue [n]               Consume n stops (default 1) before going on
+ *   wait                       Consume stops until every dispatch retired
+ *
+ * The end of the script implies "wait".
+ *
+ * Breakpoints are looked up by the trap handler only once a wave traps,
+ * so every dispatch submitted while at least one breakpoint is set gets
+ * DEBUG_MODE (COMPUTE_PGM_RSRC1 bit 22) forced on: it traps after every
+ * instruction and the handler resumes misses without reaching the host.
+ * Dispatches submitted with no breakpoint set run at full speed and stop
+ * only on s_trap or exceptions; breakpoints set while such a dispatch is
+ * already running never fire in it. "continue N" warns when every
+ * dispatch retired before N stops.
+ *
+ * Dump records (trace_file.h, wave_id = HW_ID1) hold BATCH_DUMP_FIXED_REGS
+ * registers (EXEC lo/hi, VCC lo/hi, M0, STATUS, TRAPSTS), then
+ * MAILBOX_MAX_SGPRS SGPRs, then vgprs x BATCH_LANES VGPR dwords.
+ *
+ * DANGER: Installs the trap handler for VMIDs 1-8 (dev_setup_trap_handler()).
+ */
+
+#define BATCH_PIPELINE_DEPTH   2
+#define BATCH_MAX_WATCHES      16
+#define BATCH_LANES            32
+#define BATCH_DUMP_FIXED_REGS  7
+
+/**
+ * Script commands.
+ */
+typedef enum {
+    BATCH_OP_DISPATCH = 0,  // arg = repeat count, dispatch = batch_dispatch_t index
+    BATCH_OP_BREAK,         // arg = offset into the code image
+    BATCH_OP_DELETE,        // arg = offset into the code image
+    BATCH_OP_WATCH,         // arg = SGPR
+    BATCH_OP_DUMP_REGS,     // path (NULL = off)
+    BATCH_OP_CONTINUE,      // arg = stops
+    BATCH_OP_WAIT,
+} batch_op_kind_t;
+
+/**
+ * batch_op_t: One parsed command.
+ */
+typedef struct {
+    uint32_t  kind;      // batch_op_kind_t
+    uint32_t  line;      // Script line, for messages
+    uint64_t  arg;
+    uint32_t  dispatch;
+    char*     path;
+} batch_op_t;
+
+/**
+ * batch_dispatch_t: Dispatch state captured when "dispatch" was parsed.
+ */
+typedef struct {
+    uint64_t  code_offset;  // Offset of the code object in the image
+    uint32_t  rsrc[3];
+    uint32_t  threads[3];
+    uint32_t  groups[3];
+} batch_dispatch_t;
+
+/**
+ * batch_script_t: Parsed script.
+ */
+typedef struct {
+    batch_op_t*        ops;
+    uint32_t           op_count;
+    batch_dispatch_t*  dispatches;
+    uint32_t           dispatch_count;
+    uint8_t*           image;        // Every code object, 256-byte aligned
+    size_t             image_size;
+    uint32_t           vgprs;
+    uint64_t           timeout_ns;   // 0 = infinite
+} batch_script_t;
+
+/**
+ * batch_result_t: Run totals.
+ */
+typedef struct {
+    uint64_t  dispatches;   // Dispatches that retired
+    uint64_t  stops;        // Stops consumed
+    uint64_t  records;      // Dump records written
+    uint64_t  elapsed_ns;
+} batch_result_t;
+
+/**
+ * Parse a script and load its code objects.
+ *
+ * @param path: Script path ("-" = stdin)
+ * @param s: Output script
+ * @return: 0 on success, -EINVAL on a syntax error (reported with its
+ *          line), negative error code if a file could not be read
+ */
+int32_t batch_script_load(const char* path, batch_script_t* s);
+
+/**
+ * Free a parsed script (safe on a zeroed script).
+ */
+void batch_script_free(batch_script_t* s);
+
+/**
+ * Run a script to completion.
+ *
+ * @param dev: Device context
+ * @param s: Parsed script
+ * @param handler: Raw trap handler binary (scripts/ll-as.sh src/trap_handler.s)
+ * @param handler_size: Bytes of handler
+ * @param result: Output totals (filled in on failure too)
+ * @return: 0 on success, -ETIMEDOUT if a wait hit the script timeout,
+ *          negative error code on failure
+ *
+ * DANGER: If dispatches are still in flight after a failure, the trap
+ *         buffers are leaked rather than freed under running waves.
+ */
+int32_t batch_run(amdgpu_t* dev, const batch_script_t* s, const void* handler,
+                  size_t handler_size, batch_result_t* result);
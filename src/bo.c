@@ -1,4 +1,7 @@
 #include "bo.h"
+#include "amdgpu_device.h"
+#include "bo_list_cache.h"
+#include "pm4.h"
 #include <sys/ioctl.h>
 #include <unistd.h>
 
@@ -21,11 +24,43 @@ static int32_t drm_ioctl_write_read(int fd, unsigned long request,
     return 0;
 }
 
+/**
+ * Timeout for the CP DMA fill behind BO_ALLOC_CLEAR_GPU.
+ */
+#define BO_CLEAR_GPU_TIMEOUT_NS  (1000ull * 1000 * 1000)
+
+/**
+ * Zero a BO with a CP DMA fill on the compute ring and wait for it.
+ */
+static int32_t bo_clear_gpu(amdgpu_t* dev, amdgpu_bo_t* bo) {
+    pkt3_packets_t packets;
+    dev_packets_begin(dev, &packets);
+    pkt3_dma_fill(&packets, bo->va_addr, 0, bo->size);
+
+    amdgpu_submit_t submit = {0};
+    int32_t ret = dev_submit_ex(dev, &packets, &bo->bo_handle, 1, DEV_RING_CONTROL,
+                                NULL, 0, &submit);
+    pkt3_free(&packets);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] GPU clear submission failed: %d\n", ret);
+        return ret;
+    }
+
+    ret = dev_wait(dev, &submit, BO_CLEAR_GPU_TIMEOUT_NS);
+    dev_submit_cleanup(dev, &submit);
+    return ret;
+}
+
 int32_t bo_alloc(amdgpu_t* dev, size_t size, uint32_t domain,
                  bool uncached, amdgpu_bo_t* bo) {
+    return bo_alloc_ex(dev, size, domain, uncached, BO_ALLOC_DEFAULT, bo);
+}
+
+int32_t bo_alloc_ex(amdgpu_t* dev, size_t size, uint32_t domain,
+                    bool uncached, uint32_t flags, amdgpu_bo_t* bo) {
     int32_t ret = -1;
     uint32_t alignment = 0;
-    uint32_t flags = 0;
+    uint32_t gem_flags = 0;
     size_t actual_size = 0;
 
     amdgpu_bo_handle bo_handle = NULL;
@@ -34,6 +69,11 @@ int32_t bo_alloc(amdgpu_t* dev, size_t size, uint32_t domain,
     void* host_addr = NULL;
     uint32_t kms_handle = 0;
 
+    if ((flags & BO_ALLOC_CLEAR_CPU) && (flags & BO_ALLOC_CLEAR_GPU)) {
+        fprintf(stderr, "[ERROR] bo_alloc_ex: CLEAR_CPU and CLEAR_GPU are exclusive\n");
+        return -EINVAL;
+    }
+
     // Special domains (GWS, GDS, OA) don't have CPU access
     if (domain != AMDGPU_GEM_DOMAIN_GWS &&
         domain != AMDGPU_GEM_DOMAIN_GDS &&
@@ -42,20 +82,34 @@ int32_t bo_alloc(amdgpu_t* dev, size_t size, uint32_t domain,
         actual_size = ALIGN_UP(size, PAGE_SIZE);
         alignment = PAGE_SIZE;
         
-        // Standard flags for CPU-accessible memory
-        flags = AMDGPU_GEM_CREATE_CPU_ACCESS_REQUIRED |
-                AMDGPU_GEM_CREATE_VRAM_CLEARED |
-                AMDGPU_GEM_CREATE_VM_ALWAYS_VALID;
+        gem_flags = AMDGPU_GEM_CREATE_VM_ALWAYS_VALID;
+
+        if (flags & BO_ALLOC_NO_CPU_ACCESS) {
+            if (flags & BO_ALLOC_CLEAR_CPU) {
+                fprintf(stderr, "[ERROR] bo_alloc_ex: CLEAR_CPU needs CPU access\n");
+                return -EINVAL;
+            }
+            gem_flags |= AMDGPU_GEM_CREATE_NO_CPU_ACCESS;
+        } else {
+            gem_flags |= AMDGPU_GEM_CREATE_CPU_ACCESS_REQUIRED;
+        }
+
+        // Kernel-side clear backs up the CPU clear (the historical default)
+        if (flags & BO_ALLOC_CLEAR_CPU) {
+            gem_flags |= AMDGPU_GEM_CREATE_VRAM_CLEARED;
+        }
 
         // Uncached write-combined for GTT (needed for CPU-GPU sync)
         if (uncached && domain == AMDGPU_GEM_DOMAIN_GTT) {
-            flags |= AMDGPU_GEM_CREATE_CPU_GTT_USWC;
+            gem_flags |= AMDGPU_GEM_CREATE_CPU_GTT_USWC;
         }
     } else {
         // Special domains: no alignment, no CPU access
         actual_size = size;
         alignment = 1;
-        flags = AMDGPU_GEM_CREATE_NO_CPU_ACCESS;
+        gem_flags = AMDGPU_GEM_CREATE_NO_CPU_ACCESS;
+        flags = (flags & ~(BO_ALLOC_CLEAR_CPU | BO_ALLOC_CLEAR_GPU | BO_ALLOC_LAZY_MAP)) |
+                BO_ALLOC_NO_CPU_ACCESS;
     }
 
     // Allocate BO via libdrm
@@ -63,7 +117,7 @@ int32_t bo_alloc(amdgpu_t* dev, size_t size, uint32_t domain,
         .alloc_size = actual_size,
         .phys_alignment = alignment,
         .preferred_heap = domain,
-        .flags = flags,
+        .flags = gem_flags,
     };
 
     ret = amdgpu_bo_alloc(dev->dev_handle, &req, &bo_handle);
@@ -124,8 +178,13 @@ int32_t bo_alloc(amdgpu_t* dev, size_t size, uint32_t domain,
         return ret;
     }
 
-    // CPU mapping if required
-    if (flags & AMDGPU_GEM_CREATE_CPU_ACCESS_REQUIRED) {
+    // Page-table walkers must not trust entries cached before the map
+    __atomic_add_fetch(&dev->vm_generation, 1, __ATOMIC_RELEASE);
+
+    // CPU mapping if required (deferred to bo_map() for LAZY_MAP)
+    bool map_now = (gem_flags & AMDGPU_GEM_CREATE_CPU_ACCESS_REQUIRED) &&
+                   !(flags & BO_ALLOC_LAZY_MAP);
+    if (map_now) {
         ret = amdgpu_bo_cpu_map(bo_handle, &host_addr);
         if (ret != 0) {
             fprintf(stderr, "[ERROR] amdgpu_bo_cpu_map failed: %d\n", ret);
@@ -139,7 +198,9 @@ int32_t bo_alloc(amdgpu_t* dev, size_t size, uint32_t domain,
         }
         
         // Zero the buffer (VRAM_CLEARED flag may not always work)
-        memset(host_addr, 0x0, actual_size);
+        if (flags & BO_ALLOC_CLEAR_CPU) {
+            memset(host_addr, 0x0, actual_size);
+        }
     }
 
     // Fill output structure
@@ -150,16 +211,51 @@ int32_t bo_alloc(amdgpu_t* dev, size_t size, uint32_t domain,
         .host_addr = host_addr,
         .size = actual_size,
         .kms_handle = kms_handle,
+        .alloc_flags = flags,
+        .clear_pending = !map_now && (flags & BO_ALLOC_CLEAR_CPU),
     };
 
+    if (flags & BO_ALLOC_CLEAR_GPU) {
+        ret = bo_clear_gpu(dev, bo);
+        if (ret != 0) {
+            bo_free(dev, bo);
+            return ret;
+        }
+    }
+
     return 0;
 }
 
+void* bo_map(amdgpu_bo_t* bo) {
+    if (bo->host_addr != NULL) {
+        return bo->host_addr;
+    }
+
+    if (bo->bo_handle == NULL || (bo->alloc_flags & BO_ALLOC_NO_CPU_ACCESS)) {
+        return NULL;
+    }
+
+    int32_t ret = amdgpu_bo_cpu_map(bo->bo_handle, &bo->host_addr);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] amdgpu_bo_cpu_map failed: %d\n", ret);
+        bo->host_addr = NULL;
+        return NULL;
+    }
+
+    if (bo->clear_pending) {
+        memset(bo->host_addr, 0x0, bo->size);
+        bo->clear_pending = false;
+    }
+
+    return bo->host_addr;
+}
+
 void bo_upload(amdgpu_bo_t* bo, const void* data, size_t size) {
-    HDB_ASSERT(bo->host_addr != NULL, "BO is not CPU-mapped");
+    void* host_addr = bo_map(bo);
+    HDB_ASSERT(host_addr != NULL, "BO is not CPU-mapped");
     HDB_ASSERT(size <= bo->size, "Upload size exceeds BO size");
     
-    memcpy(bo->host_addr, data, size);
+    memcpy(host_addr, data, size);
 }
 
 void bo_free(amdgpu_t* dev, amdgpu_bo_t* bo) {
@@ -192,8 +288,12 @@ void bo_free(amdgpu_t* dev, amdgpu_bo_t* bo) {
 
         amdgpu_va_range_free(bo->va_handle);
         bo->va_handle = NULL;
+        __atomic_add_fetch(&dev->vm_generation, 1, __ATOMIC_RELEASE);
     }
 
+    // Cached BO lists hold kernel references to this BO
+    bo_list_cache_invalidate(dev, bo->bo_handle);
+
     // Free BO
     amdgpu_bo_free(bo->bo_handle);
     bo->bo_handle = NULL;
@@ -13,7 +13,8 @@
  * address space, which is per-context.
  * 
  * DANGER: bo_handle and va_handle must be freed explicitly.
- * DANGER: host_addr may be NULL if CPU_ACCESS_REQUIRED was not set.
+ * DANGER: host_addr may be NULL if CPU_ACCESS_REQUIRED was not set, or
+ *         until bo_map() for BOs allocated with BO_ALLOC_LAZY_MAP.
  * DANGER: va_addr is only valid within the owning context/VMID.
  */
 typedef struct {
@@ -23,8 +24,141 @@ typedef struct {
     void*              host_addr;   // CPU-mapped address (nullable)
     size_t             size;        // Actual allocated size (aligned)
     uint32_t           kms_handle;  // KMS handle for IOCTL operations
+    uint32_t           alloc_flags; // bo_alloc_flags_t used at allocation
+    bool               clear_pending; // CPU clear deferred to first bo_map()
 } amdgpu_bo_t;
 
+/**
+ * bo_alloc_ex() flags.
+ * 
+ * Clearing: at most one of CLEAR_CPU / CLEAR_GPU. Without either, the
+ * contents are whatever the kernel hands out (fastest for buffers that
+ * are fully overwritten, e.g. IBs and save areas).
+ * 
+ * Mapping: LAZY_MAP keeps the BO CPU-accessible but defers
+ * amdgpu_bo_cpu_map() (and a CPU clear) to the first bo_map().
+ * NO_CPU_ACCESS drops CPU_ACCESS_REQUIRED so VRAM may be placed outside
+ * the CPU-visible BAR; such BOs can never be mapped.
+ */
+typedef enum {
+    BO_ALLOC_CLEAR_CPU     = 1 << 0, // memset through the CPU mapping
+    BO_ALLOC_CLEAR_GPU     = 1 << 1, // CP DMA fill on the compute ring
+    BO_ALLOC_LAZY_MAP      = 1 << 2, // Map on first bo_map()
+    BO_ALLOC_NO_CPU_ACCESS = 1 << 3, // Never CPU-mapped
+} bo_alloc_flags_t;
+
+/**
+ * Flags used by bo_alloc(): eager map, kernel VRAM clear plus CPU clear.
+ */
+#define BO_ALLOC_DEFAULT  BO_ALLOC_CLEAR_CPU
+
+/**
+ * IB ring geometry.
+ *
+ * The ring is one GTT BO carved into fixed-size slices. Each submission
+ * takes one slice; packet streams larger than a slice fall back to a
+ * dedicated per-submission BO.
+ */
+#define IB_RING_SLICE_SIZE   (16 * 1024)
+#define IB_RING_SLICE_COUNT  64
+
+/**
+ * IB ring slice state.
+ */
+typedef enum {
+    IB_SLICE_FREE = 0,   // Never submitted, or fence observed as signaled
+    IB_SLICE_ACQUIRED,   // Handed out to a submitter, not yet submitted
+    IB_SLICE_PENDING,    // Submitted; reusable once fence signals
+} ib_slice_state_t;
+
+/**
+ * amdgpu_ib_slice_t: One slice of the IB ring.
+ *
+ * DANGER: host_addr/va_addr point into the ring BO; never bo_free() them.
+ */
+typedef struct {
+    uint64_t               va_addr;    // GPU VA of the slice
+    void*                  host_addr;  // CPU pointer into the ring mapping
+    uint32_t               index;      // Slice index within the ring
+    ib_slice_state_t       state;      // Ownership / reuse state
+    struct amdgpu_cs_fence fence;      // Fence of the last submission
+} amdgpu_ib_slice_t;
+
+/**
+ * amdgpu_ib_ring_t: Persistent, fence-tracked indirect buffer memory.
+ *
+ * Slices are handed out round-robin, so the next slice is always the
+ * oldest submission. A zeroed ring (bo.bo_handle == NULL) is disabled.
+ */
+typedef struct {
+    amdgpu_bo_t        bo;                           // Backing GTT BO
+    amdgpu_ib_slice_t  slices[IB_RING_SLICE_COUNT];  // Slice bookkeeping
+    uint32_t           next;                         // Next slice to hand out
+} amdgpu_ib_ring_t;
+
+/**
+ * BO list cache geometry.
+ *
+ * A debugging session resubmits the same handful of BO sets (IB ring,
+ * code, TMA, data) over and over, so a small LRU table is sufficient.
+ * Sets larger than BO_LIST_CACHE_MAX_BOS bypass the cache.
+ */
+#define BO_LIST_CACHE_SIZE     16
+#define BO_LIST_CACHE_MAX_BOS  32
+
+/**
+ * bo_list_cache_entry_t: Kernel BO list for one sorted set of BOs.
+ */
+typedef struct {
+    amdgpu_bo_handle handles[BO_LIST_CACHE_MAX_BOS]; // Sorted, unique
+    uint32_t         count;        // Number of handles (0 = empty entry)
+    uint32_t         list_handle;  // Raw kernel BO list handle
+    uint64_t         last_use;     // LRU stamp
+} bo_list_cache_entry_t;
+
+/**
+ * bo_list_cache_t: Per-device cache of kernel BO lists.
+ *
+ * DANGER: Entries hold kernel references to their BOs; bo_free() must
+ *         invalidate them or the GEM objects leak until device cleanup.
+ */
+typedef struct {
+    bo_list_cache_entry_t entries[BO_LIST_CACHE_SIZE];
+    uint64_t              clock;   // Monotonic LRU clock
+} bo_list_cache_t;
+
+/**
+ * debugfs regs2 IOCTL data structure (v2).
+ * 
+ * Used to set SRBM/GRBM state before register access.
+ * Allows targeting specific SEs, SHs, CUs, VMIDs, etc.
+ * 
+ * DANGER: use_srbm=1 with vmid=X affects that VMID's registers.
+ * DANGER: xcc_id=(uint32_t)-1 means "all XCCs" (multi-die GPUs).
+ */
+typedef struct amdgpu_debugfs_regs2_iocdata_v2 {
+    uint32_t use_srbm, use_grbm, pg_lock;
+    struct {
+        uint32_t se, sh, instance;
+    } grbm;
+    struct {
+        uint32_t me, pipe, queue, vmid;
+    } srbm;
+    uint32_t xcc_id;
+} regs2_ioc_data_t;
+
+/**
+ * Device-owned sub-allocating pools, one per (domain, uncached)
+ * combination: GTT, GTT uncached, VRAM, VRAM uncached (see bo_pool.h).
+ */
+#define BO_POOL_KIND_COUNT  4
+struct bo_pool;
+
+/**
+ * Capacity of the resolved register offset table (see regs.h).
+ */
+#define REGDB_MAX_REGS  128
+
 /**
  * amdgpu_t: Main device context
  * 
@@ -40,10 +174,30 @@ typedef struct {
     amdgpu_device_handle     dev_handle;     // libdrm device handle
     amdgpu_context_handle    ctx_handle;     // Command submission context
     int                      regs2_fd;       // debugfs regs2 file descriptor
+    char                     pci_bus_id[16]; // PCI address ("dddd:bb:dd.f", "" if unknown)
     uint64_t                 gc_regs_base_addr[16]; // GC register base addresses per SOC block
+    uint64_t                 reg_offsets[REGDB_MAX_REGS]; // Resolved offsets (regs_resolve)
+    const char*              asic_name;      // Register database ASIC ("gfx1100", NULL if unknown)
+    uint32_t                 gc_version;     // GC IP version (major << 16 | minor << 8 | rev)
     uint32_t                 device_id;      // PCI device ID
     uint32_t                 chip_rev;       // Chip revision
     uint32_t                 chip_external_rev; // External chip revision
+    uint32_t                 num_shader_engines; // Shader engines (SE)
+    uint32_t                 num_shader_arrays_per_engine; // Shader arrays per SE
+    uint32_t                 cu_bitmap[4][4]; // Active CUs per SE/SH (amdgpu_gpu_info layout)
+    uint32_t                 drm_minor;      // amdgpu DRM interface minor version
+    bool                     use_bo_handles_chunk; // Pass BOs inline (DRM >= 3.27)
+    uint32_t                 compute_rings;  // Available compute rings (bitmask)
+    uint32_t                 work_rings;     // Rings DEV_RING_ANY rotates over
+    uint32_t                 control_ring;   // Ring for debugger-internal work
+    uint32_t                 next_ring;      // DEV_RING_ANY round-robin cursor
+    uint32_t                 dma_rings;      // Available SDMA rings (bitmask)
+    amdgpu_ib_ring_t         ib_ring;        // Reusable IB memory for dev_submit
+    bo_list_cache_t          bo_list_cache;  // Cached BO lists for older kernels
+    struct bo_pool*          bo_pools[BO_POOL_KIND_COUNT]; // Lazily created pools
+    regs2_ioc_data_t         regs2_state;    // Last selector programmed on regs2_fd
+    bool                     regs2_state_valid; // regs2_state matches the kernel
+    uint64_t                 vm_generation;  // Bumped on every GPU VA map/unmap
 } amdgpu_t;
 
 /**
@@ -52,12 +206,15 @@ typedef struct {
  * Holds the indirect buffer and fence for a submitted command.
  * Must be used to wait for completion and free resources.
  * 
- * DANGER: bo_list must be freed after submission completes.
+ * The IB lives either in a slice of the device IB ring (ib_slice != NULL)
+ * or, for oversized streams, in a dedicated BO (ib). BO lists are owned
+ * by the device BO list cache, not by the submission.
+ * 
  * DANGER: ib buffer must be freed to avoid memory leak.
  */
 typedef struct {
-    amdgpu_bo_t          ib;         // Indirect buffer containing PM4 packets
-    amdgpu_bo_list_handle bo_list;   // BO list for submission
+    amdgpu_bo_t          ib;         // Dedicated IB (unused if ib_slice is set)
+    amdgpu_ib_slice_t*   ib_slice;   // IB ring slice (NULL if ib is used)
     struct amdgpu_cs_fence fence;    // Fence for synchronization
 } amdgpu_submit_t;
 
@@ -66,11 +223,23 @@ typedef struct {
  * 
  * Grows automatically as packets are appended.
  * Used to build command buffers before uploading to GPU.
+ * 
+ * The dwords live in one of three places:
+ * - heap memory owned by the array (pkt3_init(); owned = true)
+ * - a caller-supplied arena (pkt3_init_external())
+ * - an acquired IB ring slice (dev_packets_begin(); ib_slice != NULL),
+ *   which dev_submit() hands to the GPU without copying
+ * 
+ * Borrowed memory is never reallocated: a stream that outgrows it moves
+ * to the heap once (releasing an IB slice) and keeps growing there.
+ * A zeroed array is a valid empty array.
  */
 typedef struct {
-    uint32_t* data;     // Packet data (dwords)
-    size_t    count;    // Number of dwords
-    size_t    capacity; // Allocated capacity
+    uint32_t*          data;      // Packet data (dwords)
+    size_t             count;     // Number of dwords
+    size_t             capacity;  // Capacity of data in dwords
+    bool               owned;     // data is heap memory freed by pkt3_free()
+    amdgpu_ib_slice_t* ib_slice;  // data is this acquired IB ring slice
 } pkt3_packets_t;
 
 /**
@@ -80,21 +249,94 @@ static inline void pkt3_init(pkt3_packets_t* packets) {
     packets->data = NULL;
     packets->count = 0;
     packets->capacity = 0;
+    packets->owned = true;
+    packets->ib_slice = NULL;
 }
 
 /**
- * Append a dword to the packet array, growing if necessary.
+ * Initialize an empty packet array on caller memory.
+ * 
+ * @param packets: Packet array
+ * @param buffer: Arena memory (outlives the array; not freed by pkt3_free())
+ * @param capacity: Arena size in dwords
  */
-static inline void da_append(pkt3_packets_t* packets, uint32_t value) {
-    if (packets->count >= packets->capacity) {
-        size_t new_cap = packets->capacity == 0 ? 64 : packets->capacity * 2;
+static inline void pkt3_init_external(pkt3_packets_t* packets, uint32_t* buffer,
+                                      size_t capacity) {
+    packets->data = buffer;
+    packets->count = 0;
+    packets->capacity = capacity;
+    packets->owned = false;
+    packets->ib_slice = NULL;
+}
+
+/**
+ * Slow path of pkt3_reserve(): grow to fit n more dwords.
+ */
+static inline void pkt3_grow(pkt3_packets_t* packets, size_t n) {
+    size_t new_cap = packets->capacity == 0 ? 64 : packets->capacity * 2;
+    while (new_cap < packets->count + n) {
+        new_cap *= 2;
+    }
+
+    if (packets->owned) {
         packets->data = realloc(packets->data, new_cap * sizeof(uint32_t));
         HDB_ASSERT(packets->data != NULL, "realloc failed for packet array");
-        packets->capacity = new_cap;
+    } else {
+        uint32_t* data = malloc(new_cap * sizeof(uint32_t));
+        HDB_ASSERT(data != NULL, "malloc failed for packet array");
+        if (packets->count > 0) {
+            memcpy(data, packets->data, packets->count * sizeof(uint32_t));
+        }
+
+        // Same as ib_ring_abort(): the slice was never submitted
+        if (packets->ib_slice != NULL) {
+            packets->ib_slice->state = IB_SLICE_FREE;
+            packets->ib_slice = NULL;
+        }
+        packets->data = data;
+        packets->owned = true;
+    }
+    packets->capacity = new_cap;
+}
+
+/**
+ * Make room for n more dwords, so the next n pkt3_emit() calls need no
+ * capacity checks.
+ */
+static inline void pkt3_reserve(pkt3_packets_t* packets, size_t n) {
+    if (packets->count + n > packets->capacity) {
+        pkt3_grow(packets, n);
     }
+}
+
+/**
+ * Append a dword without a capacity check.
+ * 
+ * DANGER: Only valid within a preceding pkt3_reserve().
+ */
+static inline void pkt3_emit(pkt3_packets_t* packets, uint32_t value) {
     packets->data[packets->count++] = value;
 }
 
+/**
+ * Append n dwords without a capacity check.
+ * 
+ * DANGER: Only valid within a preceding pkt3_reserve().
+ */
+static inline void pkt3_emit_n(pkt3_packets_t* packets, const uint32_t* values,
+                               size_t n) {
+    memcpy(&packets->data[packets->count], values, n * sizeof(uint32_t));
+    packets->count += n;
+}
+
+/**
+ * Append a dword to the packet array, growing if necessary.
+ */
+static inline void da_append(pkt3_packets_t* packets, uint32_t value) {
+    pkt3_reserve(packets, 1);
+    pkt3_emit(packets, value);
+}
+
 /**
  * Get size in bytes of packet array.
  */
@@ -102,14 +344,27 @@ static inline size_t pkt3_size(pkt3_packets_t* packets) {
     return packets->count * sizeof(uint32_t);
 }
 
+/**
+ * Drop all packets but keep the memory, for rebuilding a stream without
+ * heap traffic.
+ */
+static inline void pkt3_reset(pkt3_packets_t* packets) {
+    packets->count = 0;
+}
+
 /**
  * Free packet array resources.
+ * 
+ * Heap memory is freed, arenas are left alone, and an IB slice that was
+ * never submitted goes back to the ring.
  */
 static inline void pkt3_free(pkt3_packets_t* packets) {
-    free(packets->data);
-    packets->data = NULL;
-    packets->count = 0;
-    packets->capacity = 0;
+    if (packets->owned) {
+        free(packets->data);
+    } else if (packets->ib_slice != NULL) {
+        packets->ib_slice->state = IB_SLICE_FREE;
+    }
+    pkt3_init(packets);
 }
 
 /**
@@ -129,6 +384,33 @@ static inline void pkt3_free(pkt3_packets_t* packets) {
 int32_t bo_alloc(amdgpu_t* dev, size_t size, uint32_t domain, 
                  bool uncached, amdgpu_bo_t* bo);
 
+/**
+ * Buffer object allocation with explicit clear / mapping policy.
+ * 
+ * @param dev: Device context
+ * @param size: Requested size in bytes (will be page-aligned)
+ * @param domain: Memory domain (VRAM, GTT, etc.)
+ * @param uncached: If true, set uncached flags for GTT
+ * @param flags: bo_alloc_flags_t mask
+ * @param bo: Output BO structure
+ * @return: 0 on success, negative error code on failure
+ * 
+ * DANGER: BO_ALLOC_CLEAR_GPU submits and waits for a compute dispatch.
+ * DANGER: Without a CLEAR flag, the BO may contain stale data.
+ */
+int32_t bo_alloc_ex(amdgpu_t* dev, size_t size, uint32_t domain,
+                    bool uncached, uint32_t flags, amdgpu_bo_t* bo);
+
+/**
+ * Get the CPU mapping of a BO, mapping it on first use.
+ * 
+ * @param bo: Buffer object
+ * @return: CPU address, or NULL if the BO cannot be CPU-mapped
+ * 
+ * Performs a deferred BO_ALLOC_CLEAR_CPU clear on first mapping.
+ */
+void* bo_map(amdgpu_bo_t* bo);
+
 /**
  * Upload data to buffer object.
  * 
@@ -136,8 +418,9 @@ int32_t bo_alloc(amdgpu_t* dev, size_t size, uint32_t domain,
  * @param data: Source data
  * @param size: Number of bytes to copy
  * 
- * DANGER: Assumes bo->host_addr is mapped and size <= bo->size.
- * DANGER: No bounds checking performed - caller must ensure validity.
+ * Maps lazily-mapped BOs on first use (see bo_map()).
+ * 
+ * DANGER: Asserts the BO is CPU-mappable and size <= bo->size.
  */
 void bo_upload(amdgpu_bo_t* bo, const void* data, size_t size);
 
@@ -0,0 +1,158 @@
+#include "bo_list_cache.h"
+
+static int bo_handle_cmp(const void* a, const void* b) {
+    uintptr_t ha = (uintptr_t)*(const amdgpu_bo_handle*)a;
+    uintptr_t hb = (uintptr_t)*(const amdgpu_bo_handle*)b;
+    return (ha > hb) - (ha < hb);
+}
+
+uint32_t bo_handles_normalize(amdgpu_bo_handle* handles, uint32_t count) {
+    if (count < 2) {
+        return count;
+    }
+
+    qsort(handles, count, sizeof(*handles), bo_handle_cmp);
+
+    uint32_t unique = 1;
+    for_range(i, 1, count) {
+        if (handles[i] != handles[unique - 1]) {
+            handles[unique++] = handles[i];
+        }
+    }
+    return unique;
+}
+
+int32_t bo_handles_to_entries(const amdgpu_bo_handle* handles,
+                              uint32_t count,
+                              struct drm_amdgpu_bo_list_entry* entries) {
+    for_range(i, 0, count) {
+        // KMS export is a userspace lookup in libdrm; no ioctl involved
+        uint32_t kms_handle = 0;
+        int32_t ret = amdgpu_bo_export(handles[i], amdgpu_bo_handle_type_kms,
+                                       &kms_handle);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] amdgpu_bo_export failed: %d\n", ret);
+            return ret;
+        }
+
+        entries[i] = (struct drm_amdgpu_bo_list_entry){
+            .bo_handle = kms_handle,
+            .bo_priority = 0,
+        };
+    }
+    return 0;
+}
+
+static int32_t bo_list_create(amdgpu_t* dev,
+                              const amdgpu_bo_handle* handles,
+                              uint32_t count,
+                              uint32_t* list_handle) {
+    struct drm_amdgpu_bo_list_entry* entries = malloc(sizeof(*entries) * count);
+    if (entries == NULL) {
+        fprintf(stderr, "[ERROR] malloc failed for BO list\n");
+        return -ENOMEM;
+    }
+
+    int32_t ret = bo_handles_to_entries(handles, count, entries);
+    if (ret == 0) {
+        ret = amdgpu_bo_list_create_raw(dev->dev_handle, count, entries,
+                                        list_handle);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] amdgpu_bo_list_create_raw failed: %d\n", ret);
+        }
+    }
+
+    free(entries);
+    return ret;
+}
+
+static void bo_list_cache_evict(amdgpu_t* dev, bo_list_cache_entry_t* entry) {
+    if (entry->count == 0) {
+        return;
+    }
+
+    int32_t ret = amdgpu_bo_list_destroy_raw(dev->dev_handle, entry->list_handle);
+    if (ret != 0) {
+        fprintf(stderr, "[WARN] amdgpu_bo_list_destroy_raw failed: %d\n", ret);
+    }
+
+    *entry = (bo_list_cache_entry_t){0};
+}
+
+int32_t bo_list_cache_get(amdgpu_t* dev,
+                          amdgpu_bo_handle* handles,
+                          uint32_t* count,
+                          uint32_t* list_handle,
+                          bool* owned) {
+    bo_list_cache_t* cache = &dev->bo_list_cache;
+    uint32_t n = bo_handles_normalize(handles, *count);
+    *count = n;
+
+    if (n > BO_LIST_CACHE_MAX_BOS) {
+        *owned = true;
+        return bo_list_create(dev, handles, n, list_handle);
+    }
+
+    // Hit: identical sorted key. Remember the LRU victim on the way.
+    bo_list_cache_entry_t* victim = &cache->entries[0];
+    for_range(i, 0, BO_LIST_CACHE_SIZE) {
+        bo_list_cache_entry_t* entry = &cache->entries[i];
+
+        if (entry->count == n &&
+            memcmp(entry->handles, handles, n * sizeof(*handles)) == 0) {
+            entry->last_use = ++cache->clock;
+            *list_handle = entry->list_handle;
+            *owned = false;
+            return 0;
+        }
+
+        if (victim->count != 0 &&
+            (entry->count == 0 || entry->last_use < victim->last_use)) {
+            victim = entry;
+        }
+    }
+
+    // Miss: replace the empty or least recently used entry
+    uint32_t new_list = 0;
+    int32_t ret = bo_list_create(dev, handles, n, &new_list);
+    if (ret != 0) {
+        return ret;
+    }
+
+    bo_list_cache_evict(dev, victim);
+
+    memcpy(victim->handles, handles, n * sizeof(*handles));
+    victim->count = n;
+    victim->list_handle = new_list;
+    victim->last_use = ++cache->clock;
+
+    *list_handle = new_list;
+    *owned = false;
+    return 0;
+}
+
+void bo_list_cache_invalidate(amdgpu_t* dev, amdgpu_bo_handle bo) {
+    bo_list_cache_t* cache = &dev->bo_list_cache;
+
+    for_range(i, 0, BO_LIST_CACHE_SIZE) {
+        bo_list_cache_entry_t* entry = &cache->entries[i];
+        if (entry->count == 0) {
+            continue;
+        }
+
+        // Keys are sorted, so a binary search would do; sets are tiny
+        for_range(j, 0, entry->count) {
+            if (entry->handles[j] == bo) {
+                bo_list_cache_evict(dev, entry);
+                break;
+            }
+        }
+    }
+}
+
+void bo_list_cache_fini(amdgpu_t* dev) {
+    for_range(i, 0, BO_LIST_CACHE_SIZE) {
+        bo_list_cache_evict(dev, &dev->bo_list_cache.entries[i]);
+    }
+    dev->bo_list_cache.clock = 0;
+}
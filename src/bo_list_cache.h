@@ -0,0 +1,69 @@
+#pragma once
+
+#include "bo.h"
+
+/**
+ * Cached kernel BO lists for dev_submit().
+ *
+ * Lists are keyed by the sorted, de-duplicated set of amdgpu_bo_handle
+ * values, so the same buffers passed in any order hit the same entry.
+ * On a hit, submission skips amdgpu_bo_list_create()/destroy() entirely.
+ *
+ * DANGER: Not thread-safe; one submitter per device context.
+ */
+
+/**
+ * Look up (or create) the kernel BO list for a set of BOs.
+ *
+ * @param dev: Device context
+ * @param handles: BO handles; sorted and de-duplicated in place
+ * @param count: Number of handles (updated to the de-duplicated count)
+ * @param list_handle: Output raw kernel BO list handle
+ * @param owned: Output; true if the caller must destroy list_handle with
+ *               amdgpu_bo_list_destroy_raw() after submission (set too
+ *               large to cache)
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t bo_list_cache_get(amdgpu_t* dev,
+                          amdgpu_bo_handle* handles,
+                          uint32_t* count,
+                          uint32_t* list_handle,
+                          bool* owned);
+
+/**
+ * Drop every cached list that references a BO.
+ *
+ * @param dev: Device context
+ * @param bo: BO about to be freed
+ *
+ * Called from bo_free(); cheap when the BO is not cached.
+ */
+void bo_list_cache_invalidate(amdgpu_t* dev, amdgpu_bo_handle bo);
+
+/**
+ * Destroy all cached lists.
+ *
+ * @param dev: Device context
+ */
+void bo_list_cache_fini(amdgpu_t* dev);
+
+/**
+ * Sort and de-duplicate a BO handle array in place.
+ *
+ * @param handles: BO handles
+ * @param count: Number of handles
+ * @return: Number of unique handles
+ */
+uint32_t bo_handles_normalize(amdgpu_bo_handle* handles, uint32_t count);
+
+/**
+ * Fill kernel BO list entries (KMS handles) for a set of BOs.
+ *
+ * @param handles: BO handles
+ * @param count: Number of handles
+ * @param entries: Output array of at least count entries
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t bo_handles_to_entries(const amdgpu_bo_handle* handles,
+                              uint32_t count,
+                              struct drm_amdgpu_bo_list_entry* entries);
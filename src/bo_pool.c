@@ -0,0 +1,178 @@
+#include "bo_pool.h"
+
+/**
+ * Index of the device-owned pool for a (domain, uncached) combination.
+ */
+static int32_t bo_pool_kind(uint32_t domain, bool uncached) {
+    int32_t kind = 0;
+
+    switch (domain) {
+    case AMDGPU_GEM_DOMAIN_GTT:
+        kind = 0;
+        break;
+    case AMDGPU_GEM_DOMAIN_VRAM:
+        kind = 2;
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    return kind + (uncached ? 1 : 0);
+}
+
+int32_t bo_pool_create(amdgpu_t* dev, uint32_t domain, bool uncached,
+                       size_t slab_size, bo_pool_t** pool) {
+    (void)dev; // Slabs are allocated lazily
+
+    if (bo_pool_kind(domain, uncached) < 0) {
+        fprintf(stderr, "[ERROR] BO pools support GTT and VRAM only\n");
+        return -EINVAL;
+    }
+
+    bo_pool_t* p = calloc(1, sizeof(*p));
+    if (p == NULL) {
+        return -ENOMEM;
+    }
+
+    p->domain = domain;
+    p->uncached = uncached;
+    p->slab_size = ALIGN_UP(slab_size ? slab_size : BO_POOL_DEFAULT_SLAB_SIZE,
+                            PAGE_SIZE);
+
+    *pool = p;
+    return 0;
+}
+
+bo_pool_t* bo_pool_get(amdgpu_t* dev, uint32_t domain, bool uncached) {
+    int32_t kind = bo_pool_kind(domain, uncached);
+    if (kind < 0) {
+        fprintf(stderr, "[ERROR] No device BO pool for domain 0x%x\n", domain);
+        return NULL;
+    }
+
+    if (dev->bo_pools[kind] == NULL &&
+        bo_pool_create(dev, domain, uncached, 0, &dev->bo_pools[kind]) != 0) {
+        return NULL;
+    }
+
+    return dev->bo_pools[kind];
+}
+
+/**
+ * Append a new slab of at least min_size bytes.
+ */
+static int32_t bo_pool_grow(amdgpu_t* dev, bo_pool_t* pool, size_t min_size,
+                            uint32_t* index) {
+    if (pool->slab_count == pool->slab_cap) {
+        uint32_t new_cap = pool->slab_cap == 0 ? 4 : pool->slab_cap * 2;
+        bo_pool_slab_t* slabs = realloc(pool->slabs, new_cap * sizeof(*slabs));
+        if (slabs == NULL) {
+            return -ENOMEM;
+        }
+        pool->slabs = slabs;
+        pool->slab_cap = new_cap;
+    }
+
+    bo_pool_slab_t* slab = &pool->slabs[pool->slab_count];
+    *slab = (bo_pool_slab_t){0};
+
+    // Sub-allocations are documented as uncleared; skip the slab clear
+    int32_t ret = bo_alloc_ex(dev, MAX(pool->slab_size, min_size), pool->domain,
+                              pool->uncached, 0, &slab->bo);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] BO pool slab allocation failed: %d\n", ret);
+        return ret;
+    }
+
+    *index = pool->slab_count++;
+    return 0;
+}
+
+int32_t bo_pool_alloc(amdgpu_t* dev, bo_pool_t* pool, size_t size,
+                      size_t alignment, bo_suballoc_t* out) {
+    if (alignment == 0) {
+        alignment = BO_POOL_DEFAULT_ALIGNMENT;
+    }
+
+    HDB_ASSERT((alignment & (alignment - 1)) == 0, "alignment must be a power of 2");
+    HDB_ASSERT(alignment <= PAGE_SIZE, "alignment exceeds slab alignment");
+
+    if (size == 0) {
+        return -EINVAL;
+    }
+
+    // Bump-allocate from the current slab, moving forward through slabs
+    // that survived the last reset before growing the pool
+    uint32_t index = pool->current;
+    size_t offset = 0;
+    for (; index < pool->slab_count; index++) {
+        bo_pool_slab_t* slab = &pool->slabs[index];
+        offset = ALIGN_UP(slab->used, alignment);
+        if (offset + size <= slab->bo.size) {
+            break;
+        }
+    }
+
+    if (index == pool->slab_count) {
+        int32_t ret = bo_pool_grow(dev, pool, size, &index);
+        if (ret != 0) {
+            return ret;
+        }
+        offset = 0;
+    }
+
+    bo_pool_slab_t* slab = &pool->slabs[index];
+    slab->used = offset + size;
+
+    // Oversized dedicated slabs are full immediately; stay on the
+    // regular slab so small allocations keep filling it
+    if (slab->bo.size <= pool->slab_size) {
+        pool->current = index;
+    }
+
+    *out = (bo_suballoc_t){
+        .bo_handle = slab->bo.bo_handle,
+        .va_addr = slab->bo.va_addr + offset,
+        .host_addr = slab->bo.host_addr ?
+                     (uint8_t*)slab->bo.host_addr + offset : NULL,
+        .offset = offset,
+        .size = size,
+    };
+
+    return 0;
+}
+
+void bo_pool_reset(bo_pool_t* pool) {
+    for_range(i, 0, pool->slab_count) {
+        pool->slabs[i].used = 0;
+    }
+    pool->current = 0;
+}
+
+void bo_pool_destroy(amdgpu_t* dev, bo_pool_t* pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    for_range(i, 0, pool->slab_count) {
+        bo_free(dev, &pool->slabs[i].bo);
+    }
+
+    free(pool->slabs);
+    free(pool);
+}
+
+uint32_t bo_pool_handles(const bo_pool_t* pool, amdgpu_bo_handle* handles,
+                         uint32_t max) {
+    for_range(i, 0, MIN(pool->slab_count, max)) {
+        handles[i] = pool->slabs[i].bo.bo_handle;
+    }
+    return pool->slab_count;
+}
+
+void bo_pools_fini(amdgpu_t* dev) {
+    for_range(i, 0, BO_POOL_KIND_COUNT) {
+        bo_pool_destroy(dev, dev->bo_pools[i]);
+        dev->bo_pools[i] = NULL;
+    }
+}
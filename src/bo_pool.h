@@ -0,0 +1,140 @@
+#pragma once
+
+#include "bo.h"
+
+/**
+ * Sub-allocating BO pool (arena allocator on top of bo_alloc).
+ *
+ * Small GPU objects (fence words, breakpoint tables, per-wave save slots)
+ * are carved out of large backing BOs ("slabs") instead of paying for a
+ * page-sized BO and ~5 ioctls each. Allocation is a bump of the current
+ * slab offset; memory is returned in bulk with bo_pool_reset(), which
+ * keeps the slabs for reuse (per-dispatch scratch).
+ *
+ * Each pool serves exactly one (domain, uncached) combination, since those
+ * are per-BO properties. bo_pool_get() returns the device-owned pool for a
+ * combination; bo_pool_create() makes private pools.
+ *
+ * DANGER: Not thread-safe; one allocator per pool.
+ * DANGER: Sub-allocations are not individually freeable.
+ */
+
+/**
+ * Default slab size and sub-allocation alignment.
+ */
+#define BO_POOL_DEFAULT_SLAB_SIZE   (2 * 1024 * 1024)
+#define BO_POOL_DEFAULT_ALIGNMENT   64
+
+/**
+ * bo_pool_slab_t: One backing BO and its bump offset.
+ */
+typedef struct {
+    amdgpu_bo_t bo;    // Backing BO
+    size_t      used;  // Bytes carved out so far
+} bo_pool_slab_t;
+
+/**
+ * bo_pool_t: Arena of backing BOs for one (domain, uncached) combination.
+ */
+typedef struct bo_pool {
+    uint32_t        domain;      // AMDGPU_GEM_DOMAIN_GTT or _VRAM
+    bool            uncached;    // Uncached GPU mapping / USWC
+    size_t          slab_size;   // Size of regular slabs
+    bo_pool_slab_t* slabs;       // Backing BOs (grows as needed)
+    uint32_t        slab_count;  // Number of slabs
+    uint32_t        slab_cap;    // Capacity of slabs array
+    uint32_t        current;     // Slab currently being carved
+} bo_pool_t;
+
+/**
+ * bo_suballoc_t: A sub-range of a pool slab.
+ *
+ * bo_handle must be included in the dev_submit() BO set when the GPU
+ * accesses the range (see bo_pool_handles()).
+ */
+typedef struct {
+    amdgpu_bo_handle bo_handle;  // Backing BO handle
+    uint64_t         va_addr;    // GPU VA of the sub-range
+    void*            host_addr;  // CPU pointer (nullable, like amdgpu_bo_t)
+    size_t           offset;     // Offset into the backing BO
+    size_t           size;       // Requested size in bytes
+} bo_suballoc_t;
+
+/**
+ * Create a private pool.
+ *
+ * @param dev: Device context
+ * @param domain: AMDGPU_GEM_DOMAIN_GTT or AMDGPU_GEM_DOMAIN_VRAM
+ * @param uncached: Uncached flag passed to bo_alloc() for every slab
+ * @param slab_size: Backing BO size (0 = BO_POOL_DEFAULT_SLAB_SIZE)
+ * @param pool: Output pool
+ * @return: 0 on success, negative error code on failure
+ *
+ * No GPU memory is allocated until the first bo_pool_alloc().
+ */
+int32_t bo_pool_create(amdgpu_t* dev, uint32_t domain, bool uncached,
+                       size_t slab_size, bo_pool_t** pool);
+
+/**
+ * Get the device-owned pool for a (domain, uncached) combination.
+ *
+ * @param dev: Device context
+ * @param domain: AMDGPU_GEM_DOMAIN_GTT or AMDGPU_GEM_DOMAIN_VRAM
+ * @param uncached: Uncached flag
+ * @return: Pool (created on first use), or NULL on failure
+ *
+ * Device pools are destroyed by amdgpu_device_cleanup().
+ */
+bo_pool_t* bo_pool_get(amdgpu_t* dev, uint32_t domain, bool uncached);
+
+/**
+ * Carve an aligned sub-range out of the pool.
+ *
+ * @param dev: Device context
+ * @param pool: Pool to allocate from
+ * @param size: Size in bytes
+ * @param alignment: Power-of-two alignment (0 = BO_POOL_DEFAULT_ALIGNMENT;
+ *                   at most PAGE_SIZE)
+ * @param out: Output sub-allocation
+ * @return: 0 on success, negative error code on failure
+ *
+ * Requests larger than the slab size get a dedicated slab.
+ * DANGER: Contents are not cleared; after bo_pool_reset() they are stale.
+ */
+int32_t bo_pool_alloc(amdgpu_t* dev, bo_pool_t* pool, size_t size,
+                      size_t alignment, bo_suballoc_t* out);
+
+/**
+ * Release every sub-allocation at once, keeping the slabs.
+ *
+ * @param pool: Pool to reset
+ *
+ * DANGER: The GPU must be done with all previous sub-allocations.
+ */
+void bo_pool_reset(bo_pool_t* pool);
+
+/**
+ * Free all slabs and the pool itself.
+ *
+ * @param dev: Device context
+ * @param pool: Pool to destroy (NULL is a no-op)
+ */
+void bo_pool_destroy(amdgpu_t* dev, bo_pool_t* pool);
+
+/**
+ * List the backing BO handles of a pool, for dev_submit().
+ *
+ * @param pool: Pool
+ * @param handles: Output array
+ * @param max: Capacity of handles
+ * @return: Number of slabs (may exceed max; only max are written)
+ */
+uint32_t bo_pool_handles(const bo_pool_t* pool, amdgpu_bo_handle* handles,
+                         uint32_t max);
+
+/**
+ * Destroy every device-owned pool.
+ *
+ * @param dev: Device context
+ */
+void bo_pools_fini(amdgpu_t* dev);
@@ -0,0 +1,187 @@
+#include "breakpoint.h"
+
+static inline bp_table_header_t* bp_header(bp_table_t* bp) {
+    return (bp_table_header_t*)bp->bo.host_addr;
+}
+
+static inline uint32_t* bp_copy(bp_table_t* bp, uint32_t copy) {
+    return (uint32_t*)((uint8_t*)bp->bo.host_addr + BP_TABLE_HEADER_SIZE) +
+           (size_t)copy * bp->capacity;
+}
+
+/**
+ * Lower bound of offset in the sorted shadow.
+ */
+static uint32_t bp_lower_bound(const bp_table_t* bp, uint32_t offset) {
+    uint32_t lo = 0;
+    uint32_t hi = bp->count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (bp->offsets[mid] < offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Record that shadow entries [lo, count) changed, for both copies.
+ */
+static void bp_mark_dirty(bp_table_t* bp, uint32_t lo) {
+    for_range(c, 0, 2) {
+        bp->dirty_lo[c] = MIN(bp->dirty_lo[c], lo);
+        bp->dirty_hi[c] = MAX(bp->dirty_hi[c], bp->count);
+    }
+}
+
+int32_t bp_table_init(amdgpu_t* dev, uint64_t code_base, uint32_t capacity,
+                      bp_table_t* bp) {
+    if (capacity == 0) {
+        capacity = BP_TABLE_DEFAULT_CAPACITY;
+    }
+
+    *bp = (bp_table_t){0};
+
+    bp->offsets = malloc(capacity * sizeof(*bp->offsets));
+    if (bp->offsets == NULL) {
+        return -ENOMEM;
+    }
+
+    // VRAM keeps the per-trap probes local; uncached so host edits are
+    // visible without cache flushes
+    size_t size = BP_TABLE_HEADER_SIZE + 2 * (size_t)capacity * sizeof(uint32_t);
+    int32_t ret = bo_alloc(dev, size, AMDGPU_GEM_DOMAIN_VRAM, true, &bp->bo);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to allocate breakpoint table: %d\n", ret);
+        free(bp->offsets);
+        bp->offsets = NULL;
+        return ret;
+    }
+
+    bp->code_base = code_base;
+    bp->capacity = capacity;
+    for_range(c, 0, 2) {
+        bp->dirty_lo[c] = UINT32_MAX;
+        bp->dirty_hi[c] = 0;
+    }
+
+    bp_table_header_t header = {
+        .flags = BP_TABLE_FILTER,
+        .code_base = code_base,
+        .capacity = capacity,
+    };
+    bo_upload(&bp->bo, &header, sizeof(header));
+    hdb_wc_fence();
+    return 0;
+}
+
+void bp_table_fini(amdgpu_t* dev, bp_table_t* bp) {
+    bo_free(dev, &bp->bo);
+    free(bp->offsets);
+    *bp = (bp_table_t){0};
+}
+
+static int32_t bp_offset(const bp_table_t* bp, uint64_t pc, uint32_t* offset) {
+    if (pc < bp->code_base || pc - bp->code_base > UINT32_MAX) {
+        return -ERANGE;
+    }
+    *offset = (uint32_t)(pc - bp->code_base);
+    return 0;
+}
+
+int32_t bp_add(bp_table_t* bp, uint64_t pc) {
+    uint32_t offset = 0;
+    int32_t ret = bp_offset(bp, pc, &offset);
+    if (ret != 0) {
+        return ret;
+    }
+
+    uint32_t i = bp_lower_bound(bp, offset);
+    if (i < bp->count && bp->offsets[i] == offset) {
+        return -EEXIST;
+    }
+    if (bp->count == bp->capacity) {
+        fprintf(stderr, "[ERROR] Breakpoint table full (%u entries)\n", bp->capacity);
+        return -ENOSPC;
+    }
+
+    memmove(&bp->offsets[i + 1], &bp->offsets[i],
+            (bp->count - i) * sizeof(*bp->offsets));
+    bp->offsets[i] = offset;
+    bp->count++;
+
+    bp_mark_dirty(bp, i);
+    return 0;
+}
+
+int32_t bp_remove(bp_table_t* bp, uint64_t pc) {
+    uint32_t offset = 0;
+    if (bp_offset(bp, pc, &offset) != 0) {
+        return -ENOENT;
+    }
+
+    uint32_t i = bp_lower_bound(bp, offset);
+    if (i == bp->count || bp->offsets[i] != offset) {
+        return -ENOENT;
+    }
+
+    memmove(&bp->offsets[i], &bp->offsets[i + 1],
+            (bp->count - i - 1) * sizeof(*bp->offsets));
+    bp->count--;
+
+    bp_mark_dirty(bp, i);
+    return 0;
+}
+
+bool bp_contains(const bp_table_t* bp, uint64_t pc) {
+    uint32_t offset = 0;
+    if (bp_offset(bp, pc, &offset) != 0) {
+        return false;
+    }
+
+    uint32_t i = bp_lower_bound(bp, offset);
+    return i < bp->count && bp->offsets[i] == offset;
+}
+
+uint32_t bp_table_commit(bp_table_t* bp) {
+    uint32_t target = bp->active ^ 1;
+    bp_table_header_t* header = bp_header(bp);
+
+    // Entries past count are never searched, so clip the upload there
+    uint32_t lo = bp->dirty_lo[target];
+    uint32_t hi = MIN(bp->dirty_hi[target], bp->count);
+    if (lo == UINT32_MAX && header->count[target] == bp->count) {
+        return 0;
+    }
+
+    uint32_t uploaded = 0;
+    if (lo < hi) {
+        memcpy(bp_copy(bp, target) + lo, &bp->offsets[lo],
+               (hi - lo) * sizeof(*bp->offsets));
+        uploaded = hi - lo;
+    }
+    header->count[target] = bp->count;
+
+    // The copy must be complete before the handler can switch to it
+    hdb_wc_fence();
+    __atomic_store_n(&header->active, target, __ATOMIC_RELEASE);
+    hdb_wc_fence();
+
+    bp->active = target;
+    bp->dirty_lo[target] = UINT32_MAX;
+    bp->dirty_hi[target] = 0;
+    return uploaded;
+}
+
+void bp_table_set_filter(bp_table_t* bp, bool filter) {
+    bp_table_header_t* header = bp_header(bp);
+
+    __atomic_store_n(&header->flags,
+                     filter ? header->flags | BP_TABLE_FILTER :
+                              header->flags & ~BP_TABLE_FILTER,
+                     __ATOMIC_RELEASE);
+    hdb_wc_fence();
+}
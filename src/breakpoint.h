@@ -0,0 +1,138 @@
+#pragma once
+
+#include "bo.h"
+#include <stddef.h>
+
+/**
+ * GPU-side breakpoint table.
+ *
+ * Breakpoints are PC offsets from a code base, kept sorted in a VRAM BO
+ * that the trap handler binary-searches before saving any state. A trap
+ * that is neither an exception nor an s_trap (e.g. DEBUG_MODE stepping
+ * every instruction) and whose PC is not in the table returns immediately
+ * via s_rfe_b64; only hits reach the mailbox and the host.
+ *
+ * The BO holds two copies of the table. The host edits a sorted shadow
+ * with bp_add() / bp_remove(), which only record the changed index range.
+ * bp_table_commit() uploads the ranges the inactive copy is missing, then
+ * flips header->active, so a wave searching concurrently always sees a
+ * complete, sorted copy.
+ *
+ * Layout (byte offsets from the BO base):
+ *
+ *   0x000  bp_table_header_t
+ *   0x040  copy 0            capacity dwords
+ *   ...    copy 1            capacity dwords
+ *
+ * DANGER: The layout is shared with src/trap_handler.s.
+ * DANGER: A wave still searching the previous copy when the one after is
+ *         committed may miss a hit; batch edits and commit once.
+ * DANGER: Not thread-safe; one editor per table.
+ */
+
+#define BP_TABLE_HEADER_SIZE        64
+#define BP_TABLE_DEFAULT_CAPACITY   1024
+
+/**
+ * Header flags (bp_table_header_t.flags).
+ */
+#define BP_TABLE_FILTER   (1u << 0)  // Fast path on; clear to report every trap
+
+/**
+ * bp_table_header_t: Start of the breakpoint BO (read by the trap handler).
+ */
+typedef struct {
+    uint32_t flags;       // BP_TABLE_*
+    uint32_t active;      // Copy the handler searches (0 or 1)
+    uint32_t count[2];    // Entries in each copy
+    uint64_t code_base;   // PC offsets are relative to this VA
+    uint32_t capacity;    // Entries per copy
+    uint32_t reserved[9];
+} bp_table_header_t;
+
+_Static_assert(sizeof(bp_table_header_t) == BP_TABLE_HEADER_SIZE,
+               "breakpoint table header size is part of the GPU ABI");
+_Static_assert(offsetof(bp_table_header_t, code_base) == 0x10,
+               "breakpoint table header layout is part of the GPU ABI");
+
+/**
+ * bp_table_t: Host view of a breakpoint table.
+ */
+typedef struct {
+    amdgpu_bo_t bo;           // Uncached VRAM BO (header + two copies)
+    uint64_t    code_base;    // Code VA the offsets are relative to
+    uint32_t    capacity;     // Max breakpoints
+    uint32_t*   offsets;      // Sorted host shadow
+    uint32_t    count;        // Breakpoints in the shadow
+    uint32_t    dirty_lo[2];  // Per-copy index range not yet uploaded
+    uint32_t    dirty_hi[2];
+    uint32_t    active;       // Copy last published
+} bp_table_t;
+
+/**
+ * Allocate an empty breakpoint table.
+ *
+ * @param dev: Device context
+ * @param code_base: GPU VA of the code breakpoints are relative to
+ * @param capacity: Max breakpoints (0 = BP_TABLE_DEFAULT_CAPACITY)
+ * @param bp: Output table
+ * @return: 0 on success, negative error code on failure
+ *
+ * The filter starts enabled. Attach the table with
+ * mailbox_set_breakpoints(mb, bp->bo.va_addr).
+ */
+int32_t bp_table_init(amdgpu_t* dev, uint64_t code_base, uint32_t capacity,
+                      bp_table_t* bp);
+
+/**
+ * Free the table.
+ *
+ * @param dev: Device context
+ * @param bp: Table
+ *
+ * DANGER: Detach it from the mailbox first (mailbox_set_breakpoints(mb, 0)).
+ */
+void bp_table_fini(amdgpu_t* dev, bp_table_t* bp);
+
+/**
+ * Add a breakpoint (takes effect at the next bp_table_commit()).
+ *
+ * @param bp: Table
+ * @param pc: Instruction VA
+ * @return: 0 on success, -EEXIST, -ENOSPC, or -ERANGE if pc is not
+ *          within 4 GiB above code_base
+ */
+int32_t bp_add(bp_table_t* bp, uint64_t pc);
+
+/**
+ * Remove a breakpoint (takes effect at the next bp_table_commit()).
+ *
+ * @param bp: Table
+ * @param pc: Instruction VA
+ * @return: 0 on success, -ENOENT if not set
+ */
+int32_t bp_remove(bp_table_t* bp, uint64_t pc);
+
+/**
+ * Is a breakpoint set at pc (in the host shadow)?
+ */
+bool bp_contains(const bp_table_t* bp, uint64_t pc);
+
+/**
+ * Publish pending edits to the GPU.
+ *
+ * @param bp: Table
+ * @return: Number of entries uploaded
+ *
+ * Uploads only the index ranges changed since the inactive copy was last
+ * written, then flips the active copy. No-op without pending edits.
+ */
+uint32_t bp_table_commit(bp_table_t* bp);
+
+/**
+ * Enable or disable the trap handler fast path.
+ *
+ * @param bp: Table
+ * @param filter: false reports every trap (single-stepping)
+ */
+void bp_table_set_filter(bp_table_t* bp, bool filter);
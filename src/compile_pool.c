@@ -0,0 +1,610 @@
+#include "compile_pool.h"
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * Wire format between the parent and a worker process.
+ */
+typedef struct {
+    uint32_t stage;
+    uint32_t reserved;
+    uint64_t size;             // SPIR-V bytes that follow
+} compile_request_t;
+
+typedef struct {
+    int32_t  status;
+    uint32_t rsrc1;
+    uint32_t rsrc2;
+    uint32_t rsrc3;
+    uint64_t bin_size;         // Bytes that follow, then debug_info_size
+    uint64_t debug_info_size;
+    uint64_t debug_info_count;
+} compile_reply_t;
+
+static int32_t compile_send_all(int fd, const void* data, size_t size) {
+    const uint8_t* p = data;
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * Receive exactly size bytes; -EPIPE if the peer closed first.
+ */
+static int32_t compile_recv_all(int fd, void* data, size_t size) {
+    uint8_t* p = data;
+    while (size > 0) {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (n == 0) {
+            return -EPIPE;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * Worker process: compile requests until the parent closes the socket.
+ */
+static void compile_worker_child(int fd) {
+    for (;;) {
+        compile_request_t req;
+        if (compile_recv_all(fd, &req, sizeof(req)) != 0) {
+            return;
+        }
+
+        void* spirv = malloc(req.size ? req.size : 1);
+        if (spirv == NULL || compile_recv_all(fd, spirv, req.size) != 0) {
+            return;
+        }
+
+        hdb_shader_t shader = {0};
+        int32_t ret = hdb_compile_spirv_to_bin(spirv, req.size, req.stage, &shader);
+        free(spirv);
+
+        compile_reply_t reply = { .status = ret };
+        if (ret == 0) {
+            reply = (compile_reply_t){
+                .rsrc1 = shader.rsrc1,
+                .rsrc2 = shader.rsrc2,
+                .rsrc3 = shader.rsrc3,
+                .bin_size = shader.bin_size,
+                .debug_info_size = shader.debug_info ? shader.debug_info_size : 0,
+                .debug_info_count = shader.debug_info ? shader.debug_info_count : 0,
+            };
+        }
+
+        if (compile_send_all(fd, &reply, sizeof(reply)) != 0 ||
+            (ret == 0 && compile_send_all(fd, shader.bin, reply.bin_size) != 0) ||
+            (ret == 0 && compile_send_all(fd, shader.debug_info, reply.debug_info_size) != 0)) {
+            return;
+        }
+    }
+}
+
+/**
+ * Spawner reply; the worker socket travels as SCM_RIGHTS when status == 0.
+ */
+typedef struct {
+    int32_t status;
+    int32_t pid;
+} compile_spawn_reply_t;
+
+/**
+ * Send a spawn reply, with fd attached when it is not -1.
+ */
+static int32_t compile_send_fd(int sock, const compile_spawn_reply_t* reply, int fd) {
+    union {
+        struct cmsghdr hdr;
+        char           buf[CMSG_SPACE(sizeof(int))];
+    } control = {0};
+    struct iovec iov = { .iov_base = (void*)reply, .iov_len = sizeof(*reply) };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    if (fd >= 0) {
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    for (;;) {
+        if (sendmsg(sock, &msg, MSG_NOSIGNAL) >= 0) {
+            return 0;
+        }
+        if (errno != EINTR) {
+            return -errno;
+        }
+    }
+}
+
+/**
+ * Receive a spawn reply and its fd (-1 if none was attached).
+ */
+static int32_t compile_recv_fd(int sock, compile_spawn_reply_t* reply, int* fd) {
+    union {
+        struct cmsghdr hdr;
+        char           buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct iovec iov = { .iov_base = reply, .iov_len = sizeof(*reply) };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+
+    *fd = -1;
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        return -errno;
+    }
+    if (n == 0) {
+        return -EPIPE;
+    }
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+        memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if ((size_t)n != sizeof(*reply) || (msg.msg_flags & MSG_CTRUNC)) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+        return -EBADMSG;
+    }
+    return 0;
+}
+
+/**
+ * Spawner process: fork one worker per request until the parent closes
+ * the socket. Workers are reaped by the kernel (SA_NOCLDWAIT).
+ */
+static void compile_spawner_child(int sock) {
+    struct sigaction sa = { .sa_handler = SIG_DFL, .sa_flags = SA_NOCLDWAIT };
+    sigaction(SIGCHLD, &sa, NULL);
+
+    for (;;) {
+        uint8_t req;
+        if (compile_recv_all(sock, &req, sizeof(req)) != 0) {
+            return;
+        }
+
+        compile_spawn_reply_t reply = {0};
+        int sv[2] = { -1, -1 };
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) {
+            reply.status = -errno;
+        } else {
+            pid_t pid = fork();
+            if (pid == 0) {
+                // The compiler may wait for children of its own
+                struct sigaction dfl = { .sa_handler = SIG_DFL };
+                sigaction(SIGCHLD, &dfl, NULL);
+                close(sock);
+                close(sv[0]);
+                compile_worker_child(sv[1]);
+                _exit(0);
+            }
+            if (pid < 0) {
+                reply.status = -errno;
+                close(sv[0]);
+                sv[0] = -1;
+            }
+            reply.pid = pid;
+            close(sv[1]);
+        }
+
+        // Dropping our copy right away keeps it out of the next worker
+        int32_t ret = compile_send_fd(sock, &reply, sv[0]);
+        if (sv[0] >= 0) {
+            close(sv[0]);
+        }
+        if (ret != 0) {
+            return;
+        }
+    }
+}
+
+/**
+ * Fork the spawner.
+ */
+static int32_t compile_spawner_start(compile_pool_t* p) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0) {
+        return -errno;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        int32_t ret = -errno;
+        close(sv[0]);
+        close(sv[1]);
+        return ret;
+    }
+
+    if (pid == 0) {
+        close(sv[0]);
+        compile_spawner_child(sv[1]);
+        _exit(0);
+    }
+
+    close(sv[1]);
+    p->spawner_pid = pid;
+    p->spawner_fd = sv[0];
+    return 0;
+}
+
+static void compile_spawner_stop(compile_pool_t* p) {
+    if (p->spawner_fd >= 0) {
+        close(p->spawner_fd);
+        p->spawner_fd = -1;
+    }
+    if (p->spawner_pid > 0) {
+        waitpid(p->spawner_pid, NULL, 0);
+        p->spawner_pid = 0;
+    }
+}
+
+/**
+ * Have the spawner fork a worker for w.
+ */
+static int32_t compile_worker_spawn(compile_worker_t* w) {
+    compile_pool_t* p = w->pool;
+    compile_spawn_reply_t reply;
+    int fd = -1;
+    uint8_t req = 1;
+
+    pthread_mutex_lock(&p->spawn_lock);
+    int32_t ret = p->spawner_fd < 0 ? -EPIPE : compile_send_all(p->spawner_fd, &req, sizeof(req));
+    if (ret == 0) {
+        ret = compile_recv_fd(p->spawner_fd, &reply, &fd);
+    }
+    pthread_mutex_unlock(&p->spawn_lock);
+
+    if (ret == 0 && reply.status != 0) {
+        ret = reply.status;
+    }
+    if (ret == 0 && fd < 0) {
+        ret = -EBADMSG;
+    }
+    if (ret != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return ret;
+    }
+
+    w->pid = reply.pid;
+    w->fd = fd;
+    return 0;
+}
+
+/**
+ * Drop the link to a worker; it exits once it sees EOF.
+ */
+static void compile_worker_reap(compile_worker_t* w) {
+    if (w->fd >= 0) {
+        close(w->fd);
+        w->fd = -1;
+    }
+    w->pid = 0;
+}
+
+static void compile_future_complete(compile_future_t* f, int32_t status) {
+    f->status = status;
+    __atomic_store_n(&f->done, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &f->done, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/**
+ * Copy a compiled shader into the code pool and the future.
+ */
+static int32_t compile_upload(compile_pool_t* p, compile_future_t* f, const hdb_shader_t* shader) {
+    // Before the pool allocation: pool space cannot be given back
+    void* debug_info = NULL;
+    if (shader->debug_info != NULL && shader->debug_info_size != 0) {
+        debug_info = malloc(shader->debug_info_size);
+        if (debug_info == NULL) {
+            return -ENOMEM;
+        }
+        memcpy(debug_info, shader->debug_info, shader->debug_info_size);
+    }
+
+    pthread_mutex_lock(&p->upload_lock);
+    int32_t ret = bo_pool_alloc(p->dev, p->code_pool, shader->bin_size,
+                                COMPILE_CODE_ALIGNMENT, &f->code);
+    pthread_mutex_unlock(&p->upload_lock);
+    if (ret == 0 && f->code.host_addr == NULL) {
+        ret = -EFAULT;
+    }
+    if (ret != 0) {
+        free(debug_info);
+        return ret;
+    }
+    memcpy(f->code.host_addr, shader->bin, shader->bin_size);
+
+    f->shader = (hdb_shader_t){
+        .bin = f->code.host_addr,
+        .bin_size = shader->bin_size,
+        .rsrc1 = shader->rsrc1,
+        .rsrc2 = shader->rsrc2,
+        .rsrc3 = shader->rsrc3,
+        .debug_info = debug_info,
+        .debug_info_count = debug_info ? shader->debug_info_count : 0,
+        .debug_info_size = debug_info ? shader->debug_info_size : 0,
+    };
+    return 0;
+}
+
+/**
+ * Run one job on a worker; the child is respawned if the link breaks.
+ */
+static void compile_run(compile_worker_t* w, compile_future_t* f) {
+    compile_pool_t* p = w->pool;
+    compile_request_t req = { .stage = f->job.stage, .size = f->job.size };
+    compile_reply_t reply;
+    uint8_t* payload = NULL;
+
+    // A previous respawn failed; try again before giving up on this job
+    if (w->fd < 0) {
+        int32_t ret = compile_worker_spawn(w);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] Failed to respawn compile worker: %d\n", ret);
+            compile_future_complete(f, ret);
+            return;
+        }
+    }
+
+    int32_t ret = compile_send_all(w->fd, &req, sizeof(req));
+    if (ret == 0) {
+        ret = compile_send_all(w->fd, f->job.spirv, f->job.size);
+    }
+    if (ret == 0) {
+        ret = compile_recv_all(w->fd, &reply, sizeof(reply));
+    }
+    if (ret == 0 && reply.status == 0) {
+        payload = malloc(reply.bin_size + reply.debug_info_size + 1);
+        ret = payload ? compile_recv_all(w->fd, payload, reply.bin_size + reply.debug_info_size)
+                      : -ENOMEM;
+    }
+
+    if (ret != 0) {
+        fprintf(stderr, "[WARN] Compile worker %d failed (%d); respawning\n", w->pid, ret);
+        free(payload);
+        compile_worker_reap(w);
+        int32_t spawn_ret = compile_worker_spawn(w);
+        if (spawn_ret != 0) {
+            // Retried by the next job this thread takes
+            fprintf(stderr, "[ERROR] Failed to respawn compile worker: %d\n", spawn_ret);
+        }
+        compile_future_complete(f, -EPIPE);
+        return;
+    }
+    if (reply.status != 0) {
+        compile_future_complete(f, reply.status);
+        return;
+    }
+
+    hdb_shader_t shader = {
+        .bin = payload,
+        .bin_size = reply.bin_size,
+        .rsrc1 = reply.rsrc1,
+        .rsrc2 = reply.rsrc2,
+        .rsrc3 = reply.rsrc3,
+        .debug_info = reply.debug_info_size ? payload + reply.bin_size : NULL,
+        .debug_info_count = reply.debug_info_count,
+        .debug_info_size = reply.debug_info_size,
+    };
+
+    if (p->cache != NULL) {
+        shader_cache_put(p->cache, f->job.spirv, f->job.size, f->job.stage, &shader);
+    }
+
+    ret = compile_upload(p, f, &shader);
+    free(payload);
+    w->compiled++;
+    compile_future_complete(f, ret);
+}
+
+static void* compile_worker_main(void* arg) {
+    compile_worker_t* w = arg;
+    compile_pool_t* p = w->pool;
+
+    for (;;) {
+        pthread_mutex_lock(&p->lock);
+        while (!p->stop && p->head == NULL) {
+            pthread_cond_wait(&p->cond, &p->lock);
+        }
+        if (p->stop) {
+            pthread_mutex_unlock(&p->lock);
+            return NULL;
+        }
+
+        compile_future_t* f = p->head;
+        p->head = f->next;
+        if (p->head == NULL) {
+            p->tail = NULL;
+        }
+        pthread_mutex_unlock(&p->lock);
+
+        compile_run(w, f);
+    }
+}
+
+int32_t compile_pool_init(amdgpu_t* dev, uint32_t workers, shader_cache_t* cache,
+                          compile_pool_t* p) {
+    if (workers == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (uint32_t)cpus : 1;
+    }
+    workers = MIN(workers, (uint32_t)COMPILE_POOL_MAX_WORKERS);
+
+    *p = (compile_pool_t){ .dev = dev, .cache = cache, .spawner_fd = -1 };
+    pthread_mutex_init(&p->upload_lock, NULL);
+    pthread_mutex_init(&p->spawn_lock, NULL);
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    for_range(i, 0, COMPILE_POOL_MAX_WORKERS) {
+        p->workers[i] = (compile_worker_t){ .pool = p, .fd = -1 };
+    }
+
+    int32_t ret = bo_pool_create(dev, AMDGPU_GEM_DOMAIN_GTT, false, 0, &p->code_pool);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to create code BO pool: %d\n", ret);
+        compile_pool_fini(p);
+        return ret;
+    }
+
+    // The only fork in this process, before any feeding thread exists
+    ret = compile_spawner_start(p);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to fork compile spawner: %d\n", ret);
+        compile_pool_fini(p);
+        return ret;
+    }
+
+    for_range(i, 0, workers) {
+        ret = compile_worker_spawn(&p->workers[i]);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] Failed to spawn compile worker: %d\n", ret);
+            compile_pool_fini(p);
+            return ret;
+        }
+        p->worker_count++;
+    }
+
+    for_range(i, 0, p->worker_count) {
+        ret = -pthread_create(&p->workers[i].thread, NULL, compile_worker_main, &p->workers[i]);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] Failed to start compile thread: %d\n", ret);
+            // compile_pool_fini() joins only the threads that started
+            p->worker_count = (uint32_t)i;
+            compile_pool_fini(p);
+            return ret;
+        }
+    }
+
+    fprintf(stdout, "[INFO] Compile pool: %u workers\n", p->worker_count);
+    return 0;
+}
+
+void compile_pool_fini(compile_pool_t* p) {
+    if (p->dev == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&p->lock);
+    p->stop = true;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+
+    for_range(i, 0, COMPILE_POOL_MAX_WORKERS) {
+        compile_worker_t* w = &p->workers[i];
+        if (i < p->worker_count) {
+            pthread_join(w->thread, NULL);
+        }
+        compile_worker_reap(w);
+    }
+    compile_spawner_stop(p);
+
+    for (compile_future_t* f = p->head; f != NULL; ) {
+        compile_future_t* next = f->next;
+        compile_future_complete(f, -ECANCELED);
+        f = next;
+    }
+
+    bo_pool_destroy(p->dev, p->code_pool);
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->lock);
+    pthread_mutex_destroy(&p->spawn_lock);
+    pthread_mutex_destroy(&p->upload_lock);
+    *p = (compile_pool_t){0};
+}
+
+int32_t compile_pool_submit(compile_pool_t* p, const compile_job_t* jobs, size_t count,
+                            compile_future_t* futures) {
+    compile_future_t* head = NULL;
+    compile_future_t* tail = NULL;
+
+    for_range(i, 0, count) {
+        compile_future_t* f = &futures[i];
+        *f = (compile_future_t){ .job = jobs[i] };
+
+        // Cache hits never reach a worker
+        shader_cache_entry_t entry;
+        if (p->cache != NULL &&
+            shader_cache_find(p->cache, jobs[i].spirv, jobs[i].size, jobs[i].stage, &entry) == 0) {
+            int32_t ret = compile_upload(p, f, &entry.shader);
+            shader_cache_release(&entry);
+            f->cached = true;
+            compile_future_complete(f, ret);
+            continue;
+        }
+
+        if (tail != NULL) {
+            tail->next = f;
+        } else {
+            head = f;
+        }
+        tail = f;
+    }
+
+    if (head == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&p->lock);
+    if (p->tail != NULL) {
+        p->tail->next = head;
+    } else {
+        p->head = head;
+    }
+    p->tail = tail;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    return 0;
+}
+
+int32_t compile_future_wait(compile_future_t* f) {
+    while (!__atomic_load_n(&f->done, __ATOMIC_ACQUIRE)) {
+        syscall(SYS_futex, &f->done, FUTEX_WAIT_PRIVATE, 0, NULL, NULL, 0);
+    }
+    return f->status;
+}
+
+void compile_future_release(compile_future_t* f) {
+    free((void*)f->shader.debug_info);
+    f->shader.debug_info = NULL;
+    f->shader.debug_info_count = 0;
+    f->shader.debug_info_size = 0;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "bo_pool.h"
+#include "shader_cache.h"
+#include <pthread.h>
+#include <sys/types.h>
+
+/**
+ * Parallel shader compile service.
+ *
+ * hdb_compile_spirv_to_bin() is not thread-safe, so compiles run in N
+ * forked worker processes, each with its own compiler instance. Work is
+ * submitted in batches and each job gets a compile_future_t. A parent
+ * thread per worker feeds its child over a socketpair, uploads the
+ * finished binary into the service's code BO pool (GTT, 256-byte aligned
+ * for SPI_SHADER_PGM_LO) and completes the future.
+ *
+ * With a shader cache, hits are served in compile_pool_submit() without
+ * reaching a worker, and fresh compiles are stored for the next session.
+ * A worker that crashes fails only its current job (-EPIPE) and is
+ * respawned.
+ *
+ * Workers are never forked from a feeding thread: a spawner process forked
+ * by compile_pool_init() forks every worker, initial and respawned, and
+ * passes the parent its socket end (SCM_RIGHTS). The spawner is
+ * single-threaded and holds no other worker's socket, so a new worker
+ * inherits nothing it must close. If a respawn fails, the worker's jobs
+ * fail with that error until a later respawn succeeds.
+ *
+ * DANGER: Create the pool before starting other threads; the spawner is
+ *         forked from the calling process.
+ */
+
+#define COMPILE_POOL_MAX_WORKERS  64
+#define COMPILE_CODE_ALIGNMENT    256
+
+/**
+ * compile_job_t: One SPIR-V module to compile.
+ */
+typedef struct {
+    const void*         spirv;   // Must stay valid until the future completes
+    size_t              size;
+    hdb_shader_stage_t  stage;
+} compile_job_t;
+
+/**
+ * compile_future_t: Result of one job.
+ *
+ * shader.bin points at the uploaded code (code.host_addr); debug info is
+ * owned by the future until compile_future_release().
+ */
+typedef struct compile_future {
+    uint32_t                done;    // Futex word, 1 once complete
+    int32_t                 status;  // 0 or negative error code
+    hdb_shader_t            shader;
+    bo_suballoc_t           code;    // Code in the service's BO pool
+    bool                    cached;  // Served from the shader cache
+
+    // Internal
+    compile_job_t           job;
+    struct compile_future*  next;
+} compile_future_t;
+
+/**
+ * compile_worker_t: One compiler subprocess and its feeding thread.
+ *
+ * pid and fd are only touched by the feeding thread once it runs.
+ */
+typedef struct {
+    struct compile_pool*  pool;
+    pid_t                 pid;       // Child of the spawner, for messages
+    int                   fd;        // Parent end of the socketpair, -1 = none
+    pthread_t             thread;
+    uint64_t              compiled;  // Statistics
+} compile_worker_t;
+
+/**
+ * compile_pool_t: Compile service.
+ */
+typedef struct compile_pool {
+    amdgpu_t*           dev;
+    shader_cache_t*     cache;       // Nullable
+    bo_pool_t*          code_pool;   // Shared code BOs (see bo_pool_handles())
+    pthread_mutex_t     upload_lock; // code_pool is not thread-safe
+
+    pthread_mutex_t     spawn_lock;  // One spawn request at a time
+    int                 spawner_fd;  // Parent end of the spawner socket
+    pid_t               spawner_pid;
+
+    pthread_mutex_t     lock;        // Protects the queue and stop
+    pthread_cond_t      cond;
+    compile_future_t*   head;
+    compile_future_t*   tail;
+    bool                stop;
+
+    uint32_t            worker_count;
+    compile_worker_t    workers[COMPILE_POOL_MAX_WORKERS];
+} compile_pool_t;
+
+/**
+ * Start the compile service.
+ *
+ * @param dev: Device context
+ * @param workers: Worker processes (0 = online CPUs)
+ * @param cache: Shader cache consulted first (nullable)
+ * @param p: Output service
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t compile_pool_init(amdgpu_t* dev, uint32_t workers, shader_cache_t* cache,
+                          compile_pool_t* p);
+
+/**
+ * Stop the workers and free the code pool.
+ *
+ * @param p: Service (safe to call on a zeroed one)
+ *
+ * DANGER: Pending futures complete with -ECANCELED; uploaded code is freed.
+ */
+void compile_pool_fini(compile_pool_t* p);
+
+/**
+ * Queue a batch of compiles.
+ *
+ * @param p: Service
+ * @param jobs: Jobs (copied into the futures)
+ * @param count: Number of jobs
+ * @param futures: count output futures; must stay valid until completed
+ * @return: 0 on success (per-job failures are reported by the futures)
+ */
+int32_t compile_pool_submit(compile_pool_t* p, const compile_job_t* jobs, size_t count,
+                            compile_future_t* futures);
+
+/**
+ * Wait for a future.
+ *
+ * @param f: Future
+ * @return: f->status
+ */
+int32_t compile_future_wait(compile_future_t* f);
+
+/**
+ * Free the debug info copy of a completed future.
+ *
+ * @param f: Future
+ */
+void compile_future_release(compile_future_t* f);
@@ -1,7 +1,10 @@
 #include "amdgpu_device.h"
+#include "batch.h"
 #include "bo.h"
 #include "regs.h"
 #include "spirv_compile.h"
+#include "stats.h"
+#include "wave_scan.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -25,12 +28,65 @@
  * - User in 'video' group for DRM access
  */
 
+static const char* stats_format;
+
+/**
+ * Print instrumentation at exit (--stats).
+ */
+static void print_stats(void) {
+    HDB_LOG_DRAIN();
+
+    stats_snapshot_t* snap = malloc(sizeof(*snap));
+    if (snap == NULL) {
+        return;
+    }
+    stats_snapshot(snap);
+    if (strcmp(stats_format, "prometheus") == 0) {
+        stats_write_prometheus(stdout, snap);
+    } else {
+        stats_write_json(stdout, snap);
+    }
+    free(snap);
+}
+
+/**
+ * Run a batch script (--batch) and print its totals.
+ */
+static int run_batch(amdgpu_t* dev, const batch_script_t* script, const char* handler_path) {
+    void* handler = NULL;
+    size_t handler_size = 0;
+    int32_t ret = hdb_read_file(handler_path, &handler, &handler_size);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to read trap handler %s: %d\n", handler_path, ret);
+        return 1;
+    }
+
+    batch_result_t result = {0};
+    ret = batch_run(dev, script, handler, handler_size, &result);
+    free(handler);
+
+    HDB_LOG_DRAIN();
+    fprintf(stdout, "[INFO] Batch: %lu dispatches, %lu stops, %lu records, %.2f ms\n",
+            result.dispatches, result.stops, result.records,
+            (double)result.elapsed_ns / 1e6);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Batch run failed: %d\n", ret);
+        return 1;
+    }
+    return 0;
+}
+
 static void print_usage(const char* prog) {
     fprintf(stderr, "Usage: %s [options]\n", prog);
     fprintf(stderr, "\n");
     fprintf(stderr, "Options:\n");
-    fprintf(stderr, "  --device <path>    DRM device path (default: /dev/dri/card0)\n");
+    fprintf(stderr, "  --device <path>    DRM device path (default: first AMD GPU)\n");
+    fprintf(stderr, "  --list-devices     List AMD GPUs and exit\n");
     fprintf(stderr, "  --test-init        Test device initialization only\n");
+    fprintf(stderr, "  --waves            Snapshot all resident waves and exit\n");
+    fprintf(stderr, "  --stats <fmt>      Print latency stats at exit (json|prometheus)\n");
+    fprintf(stderr, "  --batch <script>   Run a debug script unattended (see src/batch.h)\n");
+    fprintf(stderr, "  --trap-handler <bin>  Raw trap handler binary (required by --batch)\n");
     fprintf(stderr, "  --help             Show this help message\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "WARNING: This is experimental low-level code.\n");
@@ -41,6 +97,10 @@ static void print_usage(const char* prog) {
 int main(int argc, char** argv) {
     const char* device_path = NULL;
     bool test_init = false;
+    bool list_devices = false;
+    bool show_waves = false;
+    const char* batch_path = NULL;
+    const char* handler_path = NULL;
 
     // Parse arguments
     for (int i = 1; i < argc; i++) {
@@ -48,6 +108,18 @@ int main(int argc, char** argv) {
             device_path = argv[++i];
         } else if (strcmp(argv[i], "--test-init") == 0) {
             test_init = true;
+        } else if (strcmp(argv[i], "--waves") == 0) {
+            show_waves = true;
+        } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc &&
+                   (strcmp(argv[i + 1], "json") == 0 ||
+                    strcmp(argv[i + 1], "prometheus") == 0)) {
+            stats_format = argv[++i];
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_path = argv[++i];
+        } else if (strcmp(argv[i], "--trap-handler") == 0 && i + 1 < argc) {
+            handler_path = argv[++i];
+        } else if (strcmp(argv[i], "--list-devices") == 0) {
+            list_devices = true;
         } else if (strcmp(argv[i], "--help") == 0) {
             print_usage(argv[0]);
             return 0;
@@ -58,6 +130,36 @@ int main(int argc, char** argv) {
         }
     }
 
+    if (stats_format != NULL) {
+        atexit(print_stats);
+    }
+
+    if (list_devices) {
+        amdgpu_device_desc_t descs[AMDGPU_MAX_DEVICES];
+        uint32_t count = 0;
+        if (amdgpu_enumerate_devices(descs, AMDGPU_MAX_DEVICES, &count) != 0) {
+            return 1;
+        }
+        for_range(i, 0, count) {
+            fprintf(stdout, "%zu: %s device_id=0x%04x %s %s\n", i,
+                    descs[i].pci_bus_id, descs[i].device_id,
+                    descs[i].render_path, descs[i].primary_path);
+        }
+        return 0;
+    }
+
+    // Parse the whole script before touching the GPU
+    batch_script_t script = {0};
+    if (batch_path != NULL) {
+        if (handler_path == NULL) {
+            fprintf(stderr, "--batch requires --trap-handler\n");
+            return 1;
+        }
+        if (batch_script_load(batch_path, &script) != 0) {
+            return 1;
+        }
+    }
+
     fprintf(stdout, "\n");
     fprintf(stdout, "==================================================\n");
     fprintf(stdout, "AMD GPU Debugger (Experimental RDNA3 PoC)\n");
@@ -69,9 +171,17 @@ int main(int argc, char** argv) {
     int32_t ret = amdgpu_device_init(device_path, &dev);
     if (ret != 0) {
         fprintf(stderr, "[FATAL] Device initialization failed: %d\n", ret);
+        batch_script_free(&script);
         return 1;
     }
 
+    if (batch_path != NULL) {
+        int status = run_batch(&dev, &script, handler_path);
+        batch_script_free(&script);
+        amdgpu_device_cleanup(&dev);
+        return status;
+    }
+
     if (test_init) {
         fprintf(stdout, "\n");
         fprintf(stdout, "[SUCCESS] Device initialization test passed\n");
@@ -81,6 +191,32 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+    if (show_waves) {
+        wave_snapshot_t snap = {0};
+        ret = wave_scan(&dev, &snap);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] Wave scan failed: %d\n", ret);
+            amdgpu_device_cleanup(&dev);
+            return 1;
+        }
+
+        for_range(i, 0, snap.count) {
+            const wave_state_t* w = &snap.waves[i];
+            fprintf(stdout, "se%u sa%u wgp%u simd%u slot%-2u pc=0x%012lx exec=0x%016lx "
+                    "status=0x%08x trapsts=0x%08x vmid=%u%s\n",
+                    w->se, w->sa, w->wgp, w->simd, w->slot, wave_state_pc(w),
+                    wave_state_exec(w), w->status, w->trapsts,
+                    REG_GET_FIELD(w->hw_id2, SQ_WAVE_HW_ID2, VM_ID),
+                    REG_GET_FIELD(w->status, SQ_WAVE_STATUS, HALT) ? " halted" : "");
+        }
+        fprintf(stdout, "[INFO] %zu waves in %u slots, %.2f ms\n", snap.count,
+                snap.slots_scanned, (double)snap.elapsed_ns / 1e6);
+
+        wave_snapshot_free(&snap);
+        amdgpu_device_cleanup(&dev);
+        return 0;
+    }
+
     // Example: Allocate a test buffer
     fprintf(stdout, "\n");
     fprintf(stdout, "Testing buffer object allocation...\n");
@@ -0,0 +1,416 @@
+#include "disasm.h"
+
+#define GFX11_SRC_LITERAL  255
+#define GFX11_SRC_DPP16    250
+#define GFX11_SRC_DPP8     233  // FI = 0
+#define GFX11_SRC_DPP8FI   234  // FI = 1
+
+/**
+ * Where an encoding's sources can request a trailing literal / DPP dword.
+ */
+enum {
+    GFX11_LIT_NONE = 0,
+    GFX11_LIT_SSRC0,     // Scalar src0 in word 0 [7:0]
+    GFX11_LIT_SSRC01,    // Scalar src0 / src1 in word 0 [7:0] / [15:8]
+    GFX11_LIT_VSRC0,     // VOP1/2/C src0 in word 0 [8:0], may select DPP
+    GFX11_LIT_VOP3,      // src0 / src1 / src2 in word 1, src0 may select DPP
+    GFX11_LIT_VOPD,      // srcX0 in word 0 [8:0], srcY0 in word 1 [8:0]
+};
+
+/**
+ * Encoding prefixes, most specific first.
+ */
+static const struct {
+    uint32_t  mask;
+    uint32_t  match;
+    uint8_t   enc;
+    uint8_t   dwords;     // Without literal / DPP / NSA dwords
+    uint8_t   lit;        // GFX11_LIT_*
+    uint8_t   op_shift;
+    uint8_t   op_bits;
+} gfx11_encodings[] = {
+    { 0xFF800000, 0xBE800000, GFX11_ENC_SOP1,    1, GFX11_LIT_SSRC0,   8, 8 },
+    { 0xFF800000, 0xBF000000, GFX11_ENC_SOPC,    1, GFX11_LIT_SSRC01, 16, 7 },
+    { 0xFF800000, 0xBF800000, GFX11_ENC_SOPP,    1, GFX11_LIT_NONE,   16, 7 },
+    { 0xF0000000, 0xB0000000, GFX11_ENC_SOPK,    1, GFX11_LIT_NONE,   23, 5 },
+    { 0xC0000000, 0x80000000, GFX11_ENC_SOP2,    1, GFX11_LIT_SSRC01, 23, 7 },
+    { 0xFE000000, 0x7E000000, GFX11_ENC_VOP1,    1, GFX11_LIT_VSRC0,   9, 8 },
+    { 0xFE000000, 0x7C000000, GFX11_ENC_VOPC,    1, GFX11_LIT_VSRC0,  17, 8 },
+    { 0x80000000, 0x00000000, GFX11_ENC_VOP2,    1, GFX11_LIT_VSRC0,  25, 6 },
+    { 0xFF000000, 0xCC000000, GFX11_ENC_VOP3P,   2, GFX11_LIT_VOP3,   16, 7 },
+    { 0xFF000000, 0xCD000000, GFX11_ENC_VINTERP, 2, GFX11_LIT_NONE,   16, 7 },
+    { 0xFF000000, 0xCE000000, GFX11_ENC_LDSDIR,  1, GFX11_LIT_NONE,   20, 2 },
+    { 0xFC000000, 0xC8000000, GFX11_ENC_VOPD,    2, GFX11_LIT_VOPD,   22, 4 },
+    { 0xFC000000, 0xD4000000, GFX11_ENC_VOP3,    2, GFX11_LIT_VOP3,   16, 10 },
+    { 0xFC000000, 0xD8000000, GFX11_ENC_DS,      2, GFX11_LIT_NONE,   18, 8 },
+    { 0xFC000000, 0xDC000000, GFX11_ENC_FLAT,    2, GFX11_LIT_NONE,   18, 7 },
+    { 0xFC000000, 0xE0000000, GFX11_ENC_MUBUF,   2, GFX11_LIT_NONE,   18, 8 },
+    { 0xFC000000, 0xE8000000, GFX11_ENC_MTBUF,   2, GFX11_LIT_NONE,   15, 4 },
+    { 0xFC000000, 0xF0000000, GFX11_ENC_MIMG,    2, GFX11_LIT_NONE,   18, 8 },
+    { 0xFC000000, 0xF4000000, GFX11_ENC_SMEM,    2, GFX11_LIT_NONE,   18, 8 },
+    { 0xFC000000, 0xF8000000, GFX11_ENC_EXP,     2, GFX11_LIT_NONE,    0, 0 },
+};
+
+static const char* const gfx11_enc_names[GFX11_ENC_COUNT] = {
+    [GFX11_ENC_UNKNOWN] = "unknown",
+    [GFX11_ENC_SOP1]    = "sop1",
+    [GFX11_ENC_SOPC]    = "sopc",
+    [GFX11_ENC_SOPP]    = "sopp",
+    [GFX11_ENC_SOPK]    = "sopk",
+    [GFX11_ENC_SOP2]    = "sop2",
+    [GFX11_ENC_SMEM]    = "smem",
+    [GFX11_ENC_VOP1]    = "vop1",
+    [GFX11_ENC_VOPC]    = "vopc",
+    [GFX11_ENC_VOP2]    = "vop2",
+    [GFX11_ENC_VOP3]    = "vop3",
+    [GFX11_ENC_VOP3P]   = "vop3p",
+    [GFX11_ENC_VOPD]    = "vopd",
+    [GFX11_ENC_VINTERP] = "vinterp",
+    [GFX11_ENC_LDSDIR]  = "ldsdir",
+    [GFX11_ENC_DS]      = "ds",
+    [GFX11_ENC_FLAT]    = "flat",
+    [GFX11_ENC_MUBUF]   = "mubuf",
+    [GFX11_ENC_MTBUF]   = "mtbuf",
+    [GFX11_ENC_MIMG]    = "mimg",
+    [GFX11_ENC_EXP]     = "exp",
+};
+
+/**
+ * SOPP opcodes.
+ */
+static const struct {
+    const char*  name;
+    uint8_t      flow;
+    bool         simm;   // Print simm16 (branch target for branches)
+} gfx11_sopp[128] = {
+    [0x00] = { "s_nop",                    GFX11_FLOW_NEXT,    true },
+    [0x01] = { "s_setkill",                GFX11_FLOW_NEXT,    true },
+    [0x02] = { "s_sethalt",                GFX11_FLOW_NEXT,    true },
+    [0x03] = { "s_sleep",                  GFX11_FLOW_NEXT,    true },
+    [0x05] = { "s_clause",                 GFX11_FLOW_NEXT,    true },
+    [0x07] = { "s_delay_alu",              GFX11_FLOW_NEXT,    true },
+    [0x08] = { "s_waitcnt_depctr",         GFX11_FLOW_NEXT,    true },
+    [0x09] = { "s_waitcnt",                GFX11_FLOW_NEXT,    true },
+    [0x0A] = { "s_wait_idle",              GFX11_FLOW_NEXT,    false },
+    [0x0B] = { "s_wait_event",             GFX11_FLOW_NEXT,    true },
+    [0x10] = { "s_trap",                   GFX11_FLOW_TRAP,    true },
+    [0x11] = { "s_round_mode",             GFX11_FLOW_NEXT,    true },
+    [0x12] = { "s_denorm_mode",            GFX11_FLOW_NEXT,    true },
+    [0x1F] = { "s_code_end",               GFX11_FLOW_END,     false },
+    [0x20] = { "s_branch",                 GFX11_FLOW_BRANCH,  true },
+    [0x21] = { "s_cbranch_scc0",           GFX11_FLOW_CBRANCH, true },
+    [0x22] = { "s_cbranch_scc1",           GFX11_FLOW_CBRANCH, true },
+    [0x23] = { "s_cbranch_vccz",           GFX11_FLOW_CBRANCH, true },
+    [0x24] = { "s_cbranch_vccnz",          GFX11_FLOW_CBRANCH, true },
+    [0x25] = { "s_cbranch_execz",          GFX11_FLOW_CBRANCH, true },
+    [0x26] = { "s_cbranch_execnz",         GFX11_FLOW_CBRANCH, true },
+    [0x27] = { "s_cbranch_cdbgsys",        GFX11_FLOW_CBRANCH, true },
+    [0x28] = { "s_cbranch_cdbguser",       GFX11_FLOW_CBRANCH, true },
+    [0x29] = { "s_cbranch_cdbgsys_or_user",  GFX11_FLOW_CBRANCH, true },
+    [0x2A] = { "s_cbranch_cdbgsys_and_user", GFX11_FLOW_CBRANCH, true },
+    [0x30] = { "s_endpgm",                 GFX11_FLOW_END,     false },
+    [0x31] = { "s_endpgm_saved",           GFX11_FLOW_END,     false },
+    [0x32] = { "s_endpgm_ordered_ps_done", GFX11_FLOW_END,     false },
+    [0x34] = { "s_wakeup",                 GFX11_FLOW_NEXT,    false },
+    [0x35] = { "s_setprio",                GFX11_FLOW_NEXT,    true },
+    [0x36] = { "s_sendmsg",                GFX11_FLOW_NEXT,    true },
+    [0x37] = { "s_sendmsghalt",            GFX11_FLOW_NEXT,    true },
+    [0x38] = { "s_incperflevel",           GFX11_FLOW_NEXT,    true },
+    [0x39] = { "s_decperflevel",           GFX11_FLOW_NEXT,    true },
+    [0x3C] = { "s_icache_inv",             GFX11_FLOW_NEXT,    false },
+    [0x3D] = { "s_barrier",                GFX11_FLOW_NEXT,    false },
+};
+
+#define GFX11_SOP1_GETPC_B64    0x47
+#define GFX11_SOP1_SETPC_B64    0x48
+#define GFX11_SOP1_SWAPPC_B64   0x49
+#define GFX11_SOP1_RFE_B64      0x4A
+#define GFX11_SOPK_SETREG_IMM32 0x13
+#define GFX11_SOPK_CALL_B64     0x14
+#define GFX11_VOP2_FMAMK_F32    0x2C
+#define GFX11_VOP2_FMAAK_F32    0x2D
+#define GFX11_VOP2_FMAMK_F16    0x37
+#define GFX11_VOP2_FMAAK_F16    0x38
+#define GFX11_VOPD_FMAAK_F32    0x1
+#define GFX11_VOPD_FMAMK_F32    0x2
+
+static inline bool gfx11_vopd_literal_op(uint32_t op) {
+    return op == GFX11_VOPD_FMAAK_F32 || op == GFX11_VOPD_FMAMK_F32;
+}
+
+/**
+ * Extra dwords requested by the source operands.
+ */
+static uint32_t gfx11_extra_dwords(const uint32_t* code, size_t avail, uint32_t lit,
+                                   gfx11_insn_t* insn) {
+    uint32_t w0 = code[0];
+    uint32_t w1 = avail > 1 ? code[1] : 0;
+
+    switch (lit) {
+    case GFX11_LIT_SSRC0:
+        insn->literal = (w0 & 0xFF) == GFX11_SRC_LITERAL;
+        return insn->literal;
+    case GFX11_LIT_SSRC01:
+        insn->literal = (w0 & 0xFF) == GFX11_SRC_LITERAL ||
+                        ((w0 >> 8) & 0xFF) == GFX11_SRC_LITERAL;
+        return insn->literal;
+    case GFX11_LIT_VSRC0:
+    case GFX11_LIT_VOP3: {
+        uint32_t srcs = lit == GFX11_LIT_VSRC0 ? w0 : w1;
+        uint32_t src0 = srcs & 0x1FF;
+        if (src0 == GFX11_SRC_DPP16 || src0 == GFX11_SRC_DPP8 ||
+            src0 == GFX11_SRC_DPP8FI) {
+            return 1;  // DPP control dword; DPP excludes a literal
+        }
+        insn->literal = src0 == GFX11_SRC_LITERAL;
+        if (lit == GFX11_LIT_VOP3) {
+            insn->literal |= ((srcs >> 9) & 0x1FF) == GFX11_SRC_LITERAL ||
+                             ((srcs >> 18) & 0x1FF) == GFX11_SRC_LITERAL;
+        }
+        return insn->literal;
+    }
+    case GFX11_LIT_VOPD:
+        insn->literal = (w0 & 0x1FF) == GFX11_SRC_LITERAL ||
+                        (w1 & 0x1FF) == GFX11_SRC_LITERAL ||
+                        gfx11_vopd_literal_op(insn->op) ||
+                        gfx11_vopd_literal_op((w0 >> 17) & 0x1F);
+        return insn->literal;
+    default:
+        return 0;
+    }
+}
+
+uint32_t gfx11_decode(const uint32_t* code, size_t avail, gfx11_insn_t* insn) {
+    *insn = (gfx11_insn_t){ .enc = GFX11_ENC_UNKNOWN, .dwords = 1 };
+    if (avail == 0) {
+        return 1;
+    }
+
+    uint32_t w0 = code[0];
+    size_t e = 0;
+    while (e < ARRAY_SIZE(gfx11_encodings) &&
+           (w0 & gfx11_encodings[e].mask) != gfx11_encodings[e].match) {
+        e++;
+    }
+    if (e == ARRAY_SIZE(gfx11_encodings)) {
+        return 1;
+    }
+
+    gfx11_insn_t d = {
+        .enc = gfx11_encodings[e].enc,
+        .flow = GFX11_FLOW_NEXT,
+        .op = (uint16_t)((w0 >> gfx11_encodings[e].op_shift) &
+                         ((1u << gfx11_encodings[e].op_bits) - 1)),
+    };
+    uint32_t dwords = gfx11_encodings[e].dwords;
+    dwords += gfx11_extra_dwords(code, avail, gfx11_encodings[e].lit, &d);
+
+    switch (d.enc) {
+    case GFX11_ENC_SOPP:
+        d.simm16 = (int16_t)(w0 & 0xFFFF);
+        if (gfx11_sopp[d.op].name != NULL) {
+            d.flow = gfx11_sopp[d.op].flow;
+        }
+        break;
+    case GFX11_ENC_SOPK:
+        d.simm16 = (int16_t)(w0 & 0xFFFF);
+        if (d.op == GFX11_SOPK_SETREG_IMM32) {
+            d.literal = 1;
+            dwords++;
+        } else if (d.op == GFX11_SOPK_CALL_B64) {
+            d.flow = GFX11_FLOW_CALL;
+        }
+        break;
+    case GFX11_ENC_SOP1:
+        if (d.op == GFX11_SOP1_SETPC_B64 || d.op == GFX11_SOP1_SWAPPC_B64 ||
+            d.op == GFX11_SOP1_RFE_B64) {
+            d.flow = GFX11_FLOW_INDIRECT;
+        }
+        break;
+    case GFX11_ENC_VOP2:
+        if (!d.literal && (d.op == GFX11_VOP2_FMAMK_F32 || d.op == GFX11_VOP2_FMAAK_F32 ||
+                           d.op == GFX11_VOP2_FMAMK_F16 || d.op == GFX11_VOP2_FMAAK_F16)) {
+            d.literal = 1;
+            dwords++;
+        }
+        break;
+    case GFX11_ENC_MIMG:
+        // NSA: vaddr1..4 in one extra dword
+        dwords += w0 & 1;
+        break;
+    default:
+        break;
+    }
+
+    HDB_ASSERT(dwords <= GFX11_MAX_INSN_DWORDS, "GFX11 instruction length out of range");
+    if (dwords > avail) {
+        return 1;  // Truncated: keep the unknown dword
+    }
+
+    d.dwords = (uint8_t)dwords;
+    *insn = d;
+    return dwords;
+}
+
+const char* gfx11_enc_name(uint32_t enc) {
+    return enc < GFX11_ENC_COUNT ? gfx11_enc_names[enc] : "unknown";
+}
+
+/**
+ * Mnemonic of the scalar instructions whose flow the decoder knows.
+ */
+static const char* gfx11_mnemonic(const gfx11_insn_t* insn) {
+    switch (insn->enc) {
+    case GFX11_ENC_SOPP:
+        return gfx11_sopp[insn->op].name;
+    case GFX11_ENC_SOPK:
+        return insn->op == GFX11_SOPK_CALL_B64 ? "s_call_b64" :
+               insn->op == GFX11_SOPK_SETREG_IMM32 ? "s_setreg_imm32_b32" : NULL;
+    case GFX11_ENC_SOP1:
+        switch (insn->op) {
+        case GFX11_SOP1_GETPC_B64:  return "s_getpc_b64";
+        case GFX11_SOP1_SETPC_B64:  return "s_setpc_b64";
+        case GFX11_SOP1_SWAPPC_B64: return "s_swappc_b64";
+        case GFX11_SOP1_RFE_B64:    return "s_rfe_b64";
+        default:                    return NULL;
+        }
+    default:
+        return NULL;
+    }
+}
+
+int gfx11_format(const uint32_t* code, const gfx11_insn_t* insn, uint64_t pc,
+                 char* buf, size_t size) {
+    const char* name = gfx11_mnemonic(insn);
+    int n;
+
+    if (name == NULL) {
+        n = snprintf(buf, size, "%-6s op 0x%x", gfx11_enc_name(insn->enc), insn->op);
+    } else if (insn->flow == GFX11_FLOW_BRANCH || insn->flow == GFX11_FLOW_CBRANCH ||
+               insn->flow == GFX11_FLOW_CALL) {
+        n = snprintf(buf, size, "%s 0x%lx", name, gfx11_branch_target(insn, pc));
+    } else if (insn->enc == GFX11_ENC_SOPP && gfx11_sopp[insn->op].simm) {
+        n = snprintf(buf, size, "%s 0x%x", name, (uint16_t)insn->simm16);
+    } else {
+        n = snprintf(buf, size, "%s", name);
+    }
+
+    // Raw dwords, as in llvm-objdump
+    for_range(i, 0, insn->dwords) {
+        if (n >= 0 && (size_t)n < size) {
+            n += snprintf(buf + n, size - (size_t)n, "%s%08x", i ? " " : "    // ", code[i]);
+        }
+    }
+    return n;
+}
+
+/**
+ * Decode from dword start until the stream reaches an old boundary at or
+ * past end (or the end of the code).
+ */
+static uint32_t disasm_decode_range(disasm_cache_t* c, uint32_t start, uint32_t end) {
+    uint32_t i = start;
+
+    while (i < c->dwords) {
+        if (i >= end && i != start && c->insns[i].dwords != 0) {
+            break;  // Lined up with the previous decode again
+        }
+
+        gfx11_insn_t insn;
+        uint32_t n = gfx11_decode(&c->code[i], c->dwords - i, &insn);
+        for_range(k, i, i + n) {
+            c->insn_count -= c->insns[k].dwords != 0;
+            c->insns[k] = (gfx11_insn_t){0};
+        }
+        c->insns[i] = insn;
+        c->insn_count++;
+        i += n;
+    }
+
+    c->decoded += i - start;
+    return i - start;
+}
+
+int32_t disasm_cache_init(const void* code, size_t size, disasm_cache_t* c) {
+    *c = (disasm_cache_t){ .code = code, .dwords = (uint32_t)(size / 4) };
+    HDB_ASSERT(size / 4 <= UINT32_MAX, "code buffer over 16 GiB");
+
+    if (c->dwords == 0) {
+        return 0;
+    }
+
+    c->insns = calloc(c->dwords, sizeof(*c->insns));
+    if (c->insns == NULL) {
+        return -ENOMEM;
+    }
+
+    disasm_decode_range(c, 0, c->dwords);
+    return 0;
+}
+
+void disasm_cache_fini(disasm_cache_t* c) {
+    free(c->insns);
+    *c = (disasm_cache_t){0};
+}
+
+/**
+ * Boundary at or before dword i.
+ */
+static inline uint32_t disasm_start_of(const disasm_cache_t* c, uint32_t i) {
+    while (i > 0 && c->insns[i].dwords == 0) {
+        i--;
+    }
+    return i;
+}
+
+uint32_t disasm_cache_update(disasm_cache_t* c, uint32_t offset, uint32_t size) {
+    if (size == 0 || offset / 4 >= c->dwords) {
+        return 0;
+    }
+
+    uint32_t first = offset / 4;
+    uint32_t end = (uint32_t)MIN(((uint64_t)offset + size + 3) / 4, c->dwords);
+    return disasm_decode_range(c, disasm_start_of(c, first), end);
+}
+
+int64_t disasm_align(const disasm_cache_t* c, uint64_t offset) {
+    if (offset / 4 >= c->dwords) {
+        return -ERANGE;
+    }
+    return (int64_t)disasm_start_of(c, (uint32_t)(offset / 4)) * 4;
+}
+
+int32_t disasm_successors(const disasm_cache_t* c, uint64_t offset, uint64_t next[2]) {
+    const gfx11_insn_t* insn = disasm_at(c, offset);
+    if (insn == NULL) {
+        return -EINVAL;
+    }
+
+    uint64_t size = (uint64_t)c->dwords * 4;
+    uint64_t fall = offset + insn->dwords * 4u;
+    uint64_t target = gfx11_branch_target(insn, offset);
+    int32_t n = 0;
+
+    switch (insn->flow) {
+    case GFX11_FLOW_NEXT:
+    case GFX11_FLOW_TRAP:
+        if (fall < size) {
+            next[n++] = fall;
+        }
+        break;
+    case GFX11_FLOW_CBRANCH:
+        if (fall < size) {
+            next[n++] = fall;
+        }
+        // fallthrough
+    case GFX11_FLOW_BRANCH:
+    case GFX11_FLOW_CALL:
+        if (target < size && (n == 0 || target != next[0])) {
+            next[n++] = target;
+        }
+        break;
+    default:
+        break;
+    }
+    return n;
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "util.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Built-in GFX11 instruction decoder.
+ *
+ * gfx11_decode() classifies one instruction with a table of encoding
+ * prefixes and computes its length (base size, literal constant, DPP and
+ * MIMG NSA dwords) plus its control flow. disasm_cache_t decodes a code
+ * buffer once into one gfx11_insn_t per dword, so instruction boundaries,
+ * "next instruction" and branch targets are array lookups while stepping
+ * and tracing. After code is patched, disasm_cache_update() re-decodes
+ * only from the instruction containing the patch until the stream lines
+ * up with the old boundaries again.
+ *
+ * Mnemonics are known for the scalar control-flow instructions; other
+ * instructions are printed as their encoding and opcode.
+ *
+ * DANGER: Opcode numbers follow LLVM's GFX11 tables (AMDGPU SOPInstructions
+ *         / VOP2Instructions); verify against the RDNA3 ISA guide.
+ */
+
+/**
+ * gfx11_enc_t: Instruction encoding.
+ */
+typedef enum {
+    GFX11_ENC_UNKNOWN = 0,
+    GFX11_ENC_SOP1,
+    GFX11_ENC_SOPC,
+    GFX11_ENC_SOPP,
+    GFX11_ENC_SOPK,
+    GFX11_ENC_SOP2,
+    GFX11_ENC_SMEM,
+    GFX11_ENC_VOP1,
+    GFX11_ENC_VOPC,
+    GFX11_ENC_VOP2,
+    GFX11_ENC_VOP3,
+    GFX11_ENC_VOP3P,
+    GFX11_ENC_VOPD,
+    GFX11_ENC_VINTERP,
+    GFX11_ENC_LDSDIR,
+    GFX11_ENC_DS,
+    GFX11_ENC_FLAT,
+    GFX11_ENC_MUBUF,
+    GFX11_ENC_MTBUF,
+    GFX11_ENC_MIMG,
+    GFX11_ENC_EXP,
+    GFX11_ENC_COUNT,
+} gfx11_enc_t;
+
+/**
+ * gfx11_flow_t: How an instruction leaves the PC.
+ */
+typedef enum {
+    GFX11_FLOW_NEXT = 0,   // Falls through
+    GFX11_FLOW_BRANCH,     // Always jumps to target
+    GFX11_FLOW_CBRANCH,    // Falls through or jumps to target
+    GFX11_FLOW_CALL,       // s_call_b64: jumps to target, returns later
+    GFX11_FLOW_INDIRECT,   // s_setpc / s_swappc / s_rfe: target in SGPRs
+    GFX11_FLOW_TRAP,       // s_trap: enters the trap handler, then falls through
+    GFX11_FLOW_END,        // s_endpgm and friends
+} gfx11_flow_t;
+
+#define GFX11_MAX_INSN_DWORDS  4
+
+/**
+ * gfx11_insn_t: Decoded instruction (one per code dword in disasm_cache_t).
+ */
+typedef struct {
+    uint8_t   enc;      // gfx11_enc_t
+    uint8_t   dwords;   // Length, 0 for dwords inside an instruction
+    uint8_t   flow;     // gfx11_flow_t
+    uint8_t   literal;  // Has a 32-bit literal (the last dword)
+    uint16_t  op;       // Opcode within the encoding (VOPD: OPX)
+    int16_t   simm16;   // SOPP / SOPK immediate (branch offset in dwords)
+} gfx11_insn_t;
+
+_Static_assert(sizeof(gfx11_insn_t) == 8, "gfx11_insn_t is stored per code dword");
+
+/**
+ * Decode the instruction at code[0].
+ *
+ * @param code: Instruction dwords
+ * @param avail: Dwords readable at code
+ * @param insn: Output instruction
+ * @return: Length in dwords; an unknown or truncated instruction is
+ *          reported as one dword of GFX11_ENC_UNKNOWN
+ */
+uint32_t gfx11_decode(const uint32_t* code, size_t avail, gfx11_insn_t* insn);
+
+/**
+ * Encoding name ("sopp", "vop3", ...).
+ */
+const char* gfx11_enc_name(uint32_t enc);
+
+/**
+ * Branch / call target of an instruction at offset.
+ */
+static inline uint64_t gfx11_branch_target(const gfx11_insn_t* insn, uint64_t offset) {
+    return offset + 4 + (int64_t)insn->simm16 * 4;
+}
+
+/**
+ * Format an instruction.
+ *
+ * @param code: Instruction dwords
+ * @param insn: Decoded instruction
+ * @param pc: Address of the instruction (for branch targets)
+ * @param buf: Output buffer
+ * @param size: Size of buf
+ * @return: Length of the text (as snprintf)
+ */
+int gfx11_format(const uint32_t* code, const gfx11_insn_t* insn, uint64_t pc,
+                 char* buf, size_t size);
+
+/**
+ * disasm_cache_t: Decoded view of a code buffer.
+ */
+typedef struct {
+    const uint32_t*  code;        // Host mapping of the code
+    uint32_t         dwords;      // Size of code in dwords
+    gfx11_insn_t*    insns;       // One per dword
+    uint32_t         insn_count;  // Instruction starts
+    uint64_t         decoded;     // Statistics: dwords decoded so far
+} disasm_cache_t;
+
+/**
+ * Decode a code buffer.
+ *
+ * @param code: Host mapping of the code (e.g. code BO host_addr)
+ * @param size: Code size in bytes (rounded down to dwords)
+ * @param c: Output cache
+ * @return: 0 on success, -ENOMEM
+ *
+ * DANGER: code must stay mapped for the life of the cache.
+ */
+int32_t disasm_cache_init(const void* code, size_t size, disasm_cache_t* c);
+
+/**
+ * Free a cache.
+ *
+ * @param c: Cache (safe to call on a zeroed one)
+ */
+void disasm_cache_fini(disasm_cache_t* c);
+
+/**
+ * Re-decode after code was patched.
+ *
+ * @param c: Cache
+ * @param offset: First patched byte
+ * @param size: Patched bytes
+ * @return: Dwords re-decoded
+ */
+uint32_t disasm_cache_update(disasm_cache_t* c, uint32_t offset, uint32_t size);
+
+/**
+ * Instruction starting at offset.
+ *
+ * @return: Instruction, or NULL if offset is not an instruction boundary
+ */
+static inline const gfx11_insn_t* disasm_at(const disasm_cache_t* c, uint64_t offset) {
+    if ((offset & 3) != 0 || offset / 4 >= c->dwords || c->insns[offset / 4].dwords == 0) {
+        return NULL;
+    }
+    return &c->insns[offset / 4];
+}
+
+/**
+ * Start of the instruction containing offset (to snap breakpoints).
+ *
+ * @return: Boundary offset, or -ERANGE outside the code
+ */
+int64_t disasm_align(const disasm_cache_t* c, uint64_t offset);
+
+/**
+ * Offsets the wave can execute after the instruction at offset.
+ *
+ * @param c: Cache
+ * @param offset: Instruction boundary
+ * @param next: Output offsets (fall-through first)
+ * @return: Number of offsets (0 for s_endpgm and indirect jumps, whose
+ *          target is in SGPRs), or -EINVAL if offset is not a boundary
+ *
+ * Targets outside the code are not returned.
+ */
+int32_t disasm_successors(const disasm_cache_t* c, uint64_t offset, uint64_t next[2]);
@@ -0,0 +1,180 @@
+#include "event_loop.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+
+int32_t event_loop_init(event_loop_t* loop) {
+    *loop = (event_loop_t){0};
+
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epfd < 0) {
+        int32_t ret = -errno;
+        fprintf(stderr, "[ERROR] epoll_create1 failed: %d\n", ret);
+        loop->epfd = -1;
+        return ret;
+    }
+    return 0;
+}
+
+void event_loop_fini(event_loop_t* loop) {
+    if (loop->epfd < 0) {
+        return;
+    }
+
+    for_range(i, 0, EVENT_LOOP_MAX_SOURCES) {
+        event_loop_remove(loop, &loop->sources[i]);
+    }
+
+    close(loop->epfd);
+    loop->epfd = -1;
+}
+
+/**
+ * Register fd under a free source entry.
+ */
+static int32_t event_loop_add(event_loop_t* loop, event_source_kind_t kind,
+                              int fd, uint32_t events, event_cb_t cb, void* user,
+                              event_source_t** out) {
+    event_source_t* src = NULL;
+    for_range(i, 0, EVENT_LOOP_MAX_SOURCES) {
+        if (!loop->sources[i].in_use) {
+            src = &loop->sources[i];
+            break;
+        }
+    }
+    if (src == NULL) {
+        fprintf(stderr, "[ERROR] Event loop full (%d sources)\n", EVENT_LOOP_MAX_SOURCES);
+        return -ENOSPC;
+    }
+
+    struct epoll_event ev = {
+        .events = events,
+        .data.ptr = src,
+    };
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        int32_t ret = -errno;
+        fprintf(stderr, "[ERROR] epoll_ctl(ADD, fd=%d) failed: %d\n", fd, ret);
+        return ret;
+    }
+
+    *src = (event_source_t){
+        .kind = kind,
+        .fd = fd,
+        .cb = cb,
+        .user = user,
+        .id = ++loop->next_id,
+        .in_use = true,
+    };
+    loop->active++;
+
+    if (out != NULL) {
+        *out = src;
+    }
+    return 0;
+}
+
+int32_t event_loop_add_fd(event_loop_t* loop, int fd, uint32_t events,
+                          event_cb_t cb, void* user, event_source_t** src) {
+    return event_loop_add(loop, EVENT_SOURCE_FD, fd, events, cb, user, src);
+}
+
+int32_t event_loop_add_fence(event_loop_t* loop, amdgpu_t* dev,
+                             const struct amdgpu_cs_fence* fence,
+                             event_cb_t cb, void* user, event_source_t** src) {
+    int fd = -1;
+    int32_t ret = dev_fence_to_sync_file(dev, fence, &fd);
+    if (ret != 0) {
+        return ret;
+    }
+
+    ret = event_loop_add(loop, EVENT_SOURCE_FENCE, fd, EPOLLIN, cb, user, src);
+    if (ret != 0) {
+        close(fd);
+    }
+    return ret;
+}
+
+int32_t event_loop_add_mailbox(event_loop_t* loop, mailbox_notifier_t* notifier,
+                               event_cb_t cb, void* user, event_source_t** src) {
+    event_source_t* s = NULL;
+    int32_t ret = event_loop_add(loop, EVENT_SOURCE_MAILBOX, notifier->fd, EPOLLIN,
+                                 cb, user, &s);
+    if (ret != 0) {
+        return ret;
+    }
+
+    s->notifier = notifier;
+    if (src != NULL) {
+        *src = s;
+    }
+    return 0;
+}
+
+void event_loop_remove(event_loop_t* loop, event_source_t* src) {
+    if (!src->in_use) {
+        return;
+    }
+
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, src->fd, NULL);
+    if (src->kind == EVENT_SOURCE_FENCE) {
+        close(src->fd);
+    }
+
+    *src = (event_source_t){0};
+    loop->active--;
+}
+
+int32_t event_loop_run_once(event_loop_t* loop, int timeout_ms) {
+    struct epoll_event events[EVENT_LOOP_MAX_SOURCES];
+
+    // Write out queued log lines before sleeping
+    HDB_LOG_DRAIN();
+
+    int n = epoll_wait(loop->epfd, events, EVENT_LOOP_MAX_SOURCES, timeout_ms);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -errno;
+    }
+
+    // Snapshot ids first: an earlier callback in this batch may remove a
+    // later source and register a new one in the same slot
+    uint64_t ids[EVENT_LOOP_MAX_SOURCES];
+    for_range(i, 0, (size_t)n) {
+        ids[i] = ((event_source_t*)events[i].data.ptr)->id;
+    }
+
+    int32_t dispatched = 0;
+    for_range(i, 0, (size_t)n) {
+        event_source_t* src = events[i].data.ptr;
+
+        if (!src->in_use || src->id != ids[i]) {
+            continue;
+        }
+
+        // Ack first so entries published during the callback re-arm the fd
+        if (src->kind == EVENT_SOURCE_MAILBOX) {
+            src->pending = mailbox_notifier_ack(src->notifier);
+        }
+
+        event_source_kind_t kind = src->kind;
+        src->cb(loop, src, events[i].events);
+        dispatched++;
+
+        // A signaled sync_file stays readable; fire fences once
+        if (kind == EVENT_SOURCE_FENCE && src->id == ids[i]) {
+            event_loop_remove(loop, src);
+        }
+    }
+    return dispatched;
+}
+
+int32_t event_loop_run(event_loop_t* loop) {
+    loop->stop = false;
+
+    while (!loop->stop && loop->active > 0) {
+        int32_t ret = event_loop_run_once(loop, -1);
+        if (ret < 0) {
+            fprintf(stderr, "[ERROR] epoll_wait failed: %d\n", ret);
+            return ret;
+        }
+    }
+    return 0;
+}
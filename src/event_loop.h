@@ -0,0 +1,157 @@
+#pragma once
+
+#include "amdgpu_device.h"
+#include "mailbox.h"
+
+/**
+ * epoll-based event loop for completions, traps and input.
+ *
+ * Every event source is an fd: submission fences are exported as
+ * sync_files, trap rings signal through a mailbox_notifier_t eventfd, and
+ * CLI input is stdin. One thread can multiplex any number of submissions
+ * and devices with event_loop_run_once() instead of blocking in dev_wait()
+ * or spinning in mailbox_wait_any().
+ *
+ * DANGER: Not thread-safe; add, remove and run from one thread.
+ */
+
+#define EVENT_LOOP_MAX_SOURCES  64
+
+typedef struct event_loop event_loop_t;
+typedef struct event_source event_source_t;
+
+/**
+ * Source callback.
+ *
+ * @param loop: Loop that dispatched the event
+ * @param src: Source that became ready (src->user holds the caller's data)
+ * @param events: EPOLL* bits
+ *
+ * The callback may remove any source, including src. Fence sources are
+ * removed automatically after their callback returns.
+ */
+typedef void (*event_cb_t)(event_loop_t* loop, event_source_t* src, uint32_t events);
+
+/**
+ * Source kinds.
+ */
+typedef enum {
+    EVENT_SOURCE_FD = 0,   // Caller's fd (not closed by the loop)
+    EVENT_SOURCE_FENCE,    // Sync_file of a submission; one-shot, closed by the loop
+    EVENT_SOURCE_MAILBOX,  // mailbox_notifier_t eventfd; acked before the callback
+} event_source_kind_t;
+
+/**
+ * event_source_t: One registered fd.
+ */
+struct event_source {
+    event_source_kind_t  kind;
+    int                  fd;
+    event_cb_t           cb;
+    void*                user;
+    mailbox_notifier_t*  notifier;  // EVENT_SOURCE_MAILBOX only
+    uint64_t             pending;   // EVENT_SOURCE_MAILBOX: entries acked this event
+    uint64_t             id;        // Unique per registration (0 = unused)
+    bool                 in_use;
+};
+
+/**
+ * event_loop_t: epoll set plus source storage.
+ */
+struct event_loop {
+    int             epfd;
+    event_source_t  sources[EVENT_LOOP_MAX_SOURCES];
+    uint32_t        active;   // Sources in use
+    uint64_t        next_id;  // Id of the next registration
+    bool            stop;     // Set by event_loop_stop()
+};
+
+/**
+ * Create an empty loop.
+ *
+ * @param loop: Output loop
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t event_loop_init(event_loop_t* loop);
+
+/**
+ * Remove every source (closing fence fds) and close the epoll set.
+ *
+ * @param loop: Loop
+ */
+void event_loop_fini(event_loop_t* loop);
+
+/**
+ * Watch a caller-owned fd (e.g. STDIN_FILENO).
+ *
+ * @param loop: Loop
+ * @param fd: File descriptor
+ * @param events: EPOLL* interest bits (e.g. EPOLLIN)
+ * @param cb: Callback
+ * @param user: Passed back in src->user
+ * @param src: Output source (may be NULL)
+ * @return: 0 on success, -ENOSPC if the loop is full, negative error code
+ */
+int32_t event_loop_add_fd(event_loop_t* loop, int fd, uint32_t events,
+                          event_cb_t cb, void* user, event_source_t** src);
+
+/**
+ * Call cb once a submission completes.
+ *
+ * @param loop: Loop
+ * @param dev: Device the fence belongs to (any device works)
+ * @param fence: Submission fence
+ * @param cb: Callback, run once
+ * @param user: Passed back in src->user
+ * @param src: Output source (may be NULL)
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t event_loop_add_fence(event_loop_t* loop, amdgpu_t* dev,
+                             const struct amdgpu_cs_fence* fence,
+                             event_cb_t cb, void* user, event_source_t** src);
+
+/**
+ * Call cb whenever waves publish trap ring entries.
+ *
+ * @param loop: Loop
+ * @param notifier: Started notifier (must outlive the source)
+ * @param cb: Callback; src->pending holds the number of new entries,
+ *            to be consumed with mailbox_drain()
+ * @param user: Passed back in src->user
+ * @param src: Output source (may be NULL)
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t event_loop_add_mailbox(event_loop_t* loop, mailbox_notifier_t* notifier,
+                               event_cb_t cb, void* user, event_source_t** src);
+
+/**
+ * Unregister a source (closing the fd of fence sources).
+ *
+ * @param loop: Loop
+ * @param src: Source (no-op if already removed)
+ */
+void event_loop_remove(event_loop_t* loop, event_source_t* src);
+
+/**
+ * Wait for events and run their callbacks.
+ *
+ * @param loop: Loop
+ * @param timeout_ms: epoll_wait() timeout (-1 = infinite, 0 = poll)
+ * @return: Number of callbacks run, or negative error code
+ */
+int32_t event_loop_run_once(event_loop_t* loop, int timeout_ms);
+
+/**
+ * Run until event_loop_stop() is called or no sources remain.
+ *
+ * @param loop: Loop
+ * @return: 0 on success, negative error code if epoll_wait() failed
+ */
+int32_t event_loop_run(event_loop_t* loop);
+
+/**
+ * Make event_loop_run() return after the current callbacks.
+ */
+static inline void event_loop_stop(event_loop_t* loop) {
+    loop->stop = true;
+}
@@ -0,0 +1,126 @@
+#include "ib_ring.h"
+
+/**
+ * Check (and optionally wait for) retirement of a pending slice.
+ *
+ * @return: 0 if the slice is reusable, -ETIMEDOUT if still in flight,
+ *          libdrm error code if the fence query failed
+ */
+static int32_t ib_slice_retire(amdgpu_ib_slice_t* slice, uint64_t timeout_ns) {
+    if (slice->state != IB_SLICE_PENDING) {
+        return 0;
+    }
+
+    uint32_t expired = 0;
+    int32_t ret = amdgpu_cs_query_fence_status(&slice->fence, timeout_ns,
+                                               0, &expired);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] IB slice %u fence query failed: %d\n",
+                slice->index, ret);
+        return ret;
+    }
+
+    if (!expired) {
+        return -ETIMEDOUT;
+    }
+
+    slice->state = IB_SLICE_FREE;
+    return 0;
+}
+
+int32_t ib_ring_init(amdgpu_t* dev, amdgpu_ib_ring_t* ring) {
+    *ring = (amdgpu_ib_ring_t){0};
+
+    int32_t ret = bo_alloc(dev, IB_RING_SLICE_SIZE * IB_RING_SLICE_COUNT,
+                           AMDGPU_GEM_DOMAIN_GTT, false, &ring->bo);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to allocate IB ring: %d\n", ret);
+        *ring = (amdgpu_ib_ring_t){0};
+        return ret;
+    }
+
+    for_range(i, 0, IB_RING_SLICE_COUNT) {
+        ring->slices[i] = (amdgpu_ib_slice_t){
+            .va_addr = ring->bo.va_addr + i * IB_RING_SLICE_SIZE,
+            .host_addr = (uint8_t*)ring->bo.host_addr + i * IB_RING_SLICE_SIZE,
+            .index = (uint32_t)i,
+            .state = IB_SLICE_FREE,
+        };
+    }
+
+    fprintf(stdout, "[INFO] IB ring: %d x %d bytes at VA=0x%lx\n",
+            IB_RING_SLICE_COUNT, IB_RING_SLICE_SIZE, ring->bo.va_addr);
+    return 0;
+}
+
+void ib_ring_fini(amdgpu_t* dev, amdgpu_ib_ring_t* ring) {
+    if (ring->bo.bo_handle == NULL) {
+        return;
+    }
+
+    // The GPU may still be reading slices; bo_free() must come after retirement
+    for_range(i, 0, IB_RING_SLICE_COUNT) {
+        if (ib_slice_retire(&ring->slices[i], 1000000000ull) != 0) {
+            fprintf(stderr, "[WARN] IB slice %zu still busy at teardown\n", i);
+        }
+    }
+
+    bo_free(dev, &ring->bo);
+    *ring = (amdgpu_ib_ring_t){0};
+}
+
+int32_t ib_ring_acquire(amdgpu_ib_ring_t* ring, size_t size,
+                        uint64_t timeout_ns, amdgpu_ib_slice_t** slice) {
+    if (ring->bo.bo_handle == NULL) {
+        return -ENODEV;
+    }
+
+    if (size > IB_RING_SLICE_SIZE) {
+        return -E2BIG;
+    }
+
+    // Round-robin order means the next slice is normally the oldest
+    // submission. If it is still in flight (e.g. pinned by a halted wave),
+    // skip ahead to any slice that has already retired before blocking.
+    amdgpu_ib_slice_t* s = NULL;
+    for_range(i, 0, IB_RING_SLICE_COUNT) {
+        amdgpu_ib_slice_t* candidate =
+            &ring->slices[(ring->next + i) % IB_RING_SLICE_COUNT];
+        if (candidate->state != IB_SLICE_ACQUIRED &&
+            ib_slice_retire(candidate, 0) == 0) {
+            s = candidate;
+            break;
+        }
+    }
+
+    if (s == NULL) {
+        s = &ring->slices[ring->next];
+        if (s->state == IB_SLICE_ACQUIRED) {
+            return -EBUSY;
+        }
+
+        int32_t ret = ib_slice_retire(s, timeout_ns);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    s->state = IB_SLICE_ACQUIRED;
+    ring->next = (s->index + 1) % IB_RING_SLICE_COUNT;
+
+    *slice = s;
+    return 0;
+}
+
+void ib_ring_commit(amdgpu_ib_slice_t* slice, const struct amdgpu_cs_fence* fence) {
+    HDB_ASSERT(slice->state == IB_SLICE_ACQUIRED, "committing an unacquired IB slice");
+
+    slice->fence = *fence;
+    slice->state = IB_SLICE_PENDING;
+}
+
+void ib_ring_abort(amdgpu_ib_slice_t* slice) {
+    HDB_ASSERT(slice->state == IB_SLICE_ACQUIRED, "aborting an unacquired IB slice");
+
+    slice->state = IB_SLICE_FREE;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "bo.h"
+
+/**
+ * Reusable indirect buffer (IB) ring.
+ *
+ * Replaces the per-submission IB allocation in dev_submit(). The ring is
+ * allocated once per device context; submissions copy their packets into
+ * the next slice and record the submission fence on it. A slice is only
+ * handed out again after its fence has signaled.
+ *
+ * DANGER: Not thread-safe; one submitter per device context.
+ */
+
+/**
+ * How long dev_submit() waits for the oldest slice before falling back
+ * to a dedicated IB BO. Kept short: a halted wave can pin a slice forever.
+ */
+#define IB_RING_ACQUIRE_TIMEOUT_NS  (10ull * 1000 * 1000)
+
+/**
+ * Allocate the ring BO and initialize slice bookkeeping.
+ *
+ * @param dev: Device context
+ * @param ring: Ring to initialize
+ * @return: 0 on success, negative error code on failure
+ *
+ * DANGER: Ring must be released with ib_ring_fini() before device cleanup.
+ */
+int32_t ib_ring_init(amdgpu_t* dev, amdgpu_ib_ring_t* ring);
+
+/**
+ * Wait for all pending slices and free the ring BO.
+ *
+ * @param dev: Device context
+ * @param ring: Ring to destroy (safe to call on a disabled ring)
+ */
+void ib_ring_fini(amdgpu_t* dev, amdgpu_ib_ring_t* ring);
+
+/**
+ * Acquire the next slice for a packet stream of the given size.
+ *
+ * @param ring: IB ring
+ * @param size: Packet stream size in bytes
+ * @param timeout_ns: How long to wait for the oldest submission to retire
+ * @param slice: Output slice
+ * @return: 0 on success
+ *          -ENODEV if the ring is disabled
+ *          -E2BIG if size exceeds IB_RING_SLICE_SIZE
+ *          -EBUSY if the next slice is still held by a submitter
+ *          -ETIMEDOUT if the oldest submission did not retire in time
+ *
+ * All failures are recoverable: callers fall back to a dedicated IB BO.
+ */
+int32_t ib_ring_acquire(amdgpu_ib_ring_t* ring, size_t size,
+                        uint64_t timeout_ns, amdgpu_ib_slice_t** slice);
+
+/**
+ * Mark an acquired slice as submitted.
+ *
+ * @param slice: Slice returned by ib_ring_acquire()
+ * @param fence: Fence of the submission that reads this slice
+ */
+void ib_ring_commit(amdgpu_ib_slice_t* slice, const struct amdgpu_cs_fence* fence);
+
+/**
+ * Return an acquired slice without submitting it (e.g. on submit failure).
+ *
+ * @param slice: Slice returned by ib_ring_acquire()
+ */
+void ib_ring_abort(amdgpu_ib_slice_t* slice);
@@ -0,0 +1,291 @@
+#include "line_index.h"
+#include <stdlib.h>
+
+/**
+ * An entry and its position in the debug info, for a stable sort.
+ */
+typedef struct {
+    line_entry_t  entry;
+    uint32_t      seq;
+} line_entry_seq_t;
+
+static int line_entry_cmp(const void* a, const void* b) {
+    const line_entry_seq_t* x = a;
+    const line_entry_seq_t* y = b;
+    if (x->entry.offset != y->entry.offset) {
+        return x->entry.offset < y->entry.offset ? -1 : 1;
+    }
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static inline bool line_range_less(const line_range_t* x, uint32_t file, uint32_t line,
+                                   uint32_t start) {
+    if (x->file != file) {
+        return x->file < file;
+    }
+    if (x->line != line) {
+        return x->line < line;
+    }
+    return x->start < start;
+}
+
+static int line_range_cmp(const void* a, const void* b) {
+    const line_range_t* x = a;
+    const line_range_t* y = b;
+    if (line_range_less(x, y->file, y->line, y->start)) {
+        return -1;
+    }
+    return line_range_less(y, x->file, x->line, x->start);
+}
+
+/**
+ * Copy and split the file name list that follows the entries.
+ */
+static int32_t line_index_parse_files(line_index_t* idx, const char* names, size_t size) {
+    // The list may be NUL-padded to the entry alignment
+    while (size > 1 && names[size - 1] == '\0' && names[size - 2] == '\0') {
+        size--;
+    }
+    if (size == 1 && names[0] == '\0') {
+        size = 0;
+    }
+
+    idx->strings = malloc(size + 1);
+    if (idx->strings == NULL) {
+        return -ENOMEM;
+    }
+    memcpy(idx->strings, names, size);
+    idx->strings[size] = '\0';
+
+    size_t count = 0;
+    for_range(i, 0, size) {
+        count += idx->strings[i] == '\0';
+    }
+    if (size != 0 && idx->strings[size - 1] != '\0') {
+        count++;  // Unterminated last name
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    idx->files = malloc(count * sizeof(*idx->files));
+    if (idx->files == NULL) {
+        return -ENOMEM;
+    }
+    for (size_t pos = 0; pos < size; pos += strlen(idx->strings + pos) + 1) {
+        idx->files[idx->file_count++] = idx->strings + pos;
+    }
+    return 0;
+}
+
+/**
+ * Build the line -> code reverse index from the sorted entries.
+ */
+static int32_t line_index_build_ranges(line_index_t* idx) {
+    if (idx->count == 0) {
+        return 0;
+    }
+
+    idx->ranges = malloc(idx->count * sizeof(*idx->ranges));
+    if (idx->ranges == NULL) {
+        return -ENOMEM;
+    }
+
+    uint32_t n = 0;
+    for_range(i, 0, idx->count) {
+        const line_entry_t* e = &idx->entries[i];
+        if (e->line == 0) {
+            continue;
+        }
+        idx->ranges[n++] = (line_range_t){
+            .file = e->file,
+            .line = e->line,
+            .start = e->offset,
+            .end = i + 1 < idx->count ? idx->entries[i + 1].offset : idx->code_size,
+        };
+    }
+    qsort(idx->ranges, n, sizeof(*idx->ranges), line_range_cmp);
+
+    // Merge ranges of a line that touch (split only by line-0 entries)
+    uint32_t merged = 0;
+    for_range(i, 0, n) {
+        line_range_t* r = &idx->ranges[i];
+        line_range_t* last = merged ? &idx->ranges[merged - 1] : NULL;
+        if (last != NULL && last->file == r->file && last->line == r->line &&
+            last->end == r->start) {
+            last->end = r->end;
+        } else {
+            idx->ranges[merged++] = *r;
+        }
+    }
+    idx->range_count = merged;
+    return 0;
+}
+
+int32_t line_index_build(const hdb_shader_t* shader, line_index_t* idx) {
+    *idx = (line_index_t){ .code_size = (uint32_t)shader->bin_size };
+    HDB_ASSERT(shader->bin_size <= UINT32_MAX, "shader binary over 4 GiB");
+
+    if (shader->debug_info == NULL || shader->debug_info_count == 0) {
+        return 0;
+    }
+
+    size_t count = shader->debug_info_count;
+    if (count > shader->debug_info_size / sizeof(hdb_debug_loc_t)) {
+        fprintf(stderr, "[ERROR] Debug info too small for %zu entries: %zu bytes\n",
+                count, shader->debug_info_size);
+        return -EINVAL;
+    }
+
+    const hdb_debug_loc_t* locs = shader->debug_info;
+    size_t names_size = shader->debug_info_size - count * sizeof(hdb_debug_loc_t);
+    int32_t ret = line_index_parse_files(idx, (const char*)(locs + count), names_size);
+    if (ret != 0) {
+        line_index_free(idx);
+        return ret;
+    }
+
+    idx->entries = malloc(count * sizeof(*idx->entries));
+    line_entry_seq_t* sorted = malloc(count * sizeof(*sorted));
+    if (idx->entries == NULL || sorted == NULL) {
+        free(sorted);
+        line_index_free(idx);
+        return -ENOMEM;
+    }
+
+    uint32_t n = 0;
+    size_t dropped = 0;
+    for_range(i, 0, count) {
+        hdb_debug_loc_t loc;
+        memcpy(&loc, &locs[i], sizeof(loc));  // debug_info may be unaligned
+        if (loc.offset >= idx->code_size || loc.file >= idx->file_count) {
+            dropped++;
+            continue;
+        }
+        sorted[n] = (line_entry_seq_t){
+            .entry = { .offset = loc.offset, .line = loc.line, .file = loc.file },
+            .seq = n,
+        };
+        n++;
+    }
+    if (dropped != 0) {
+        fprintf(stderr, "[WARN] Dropped %zu of %zu debug entries outside the shader\n",
+                dropped, count);
+    }
+
+    qsort(sorted, n, sizeof(*sorted), line_entry_cmp);
+
+    // One entry per offset, and only where the location changes. As in a
+    // DWARF line program the last row at an offset wins, except that a
+    // line-0 row never replaces a real one
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < n; ) {
+        const line_entry_t* e = &sorted[i].entry;
+        uint32_t j = i + 1;
+        for (; j < n && sorted[j].entry.offset == e->offset; j++) {
+            if (sorted[j].entry.line != 0 || e->line == 0) {
+                e = &sorted[j].entry;
+            }
+        }
+        i = j;
+
+        const line_entry_t* last = kept ? &idx->entries[kept - 1] : NULL;
+        if (last != NULL && last->file == e->file && last->line == e->line) {
+            continue;
+        }
+        idx->entries[kept++] = *e;
+    }
+    idx->count = kept;
+    free(sorted);
+
+    ret = line_index_build_ranges(idx);
+    if (ret != 0) {
+        line_index_free(idx);
+    }
+    return ret;
+}
+
+void line_index_free(line_index_t* idx) {
+    free(idx->entries);
+    free(idx->ranges);
+    free(idx->files);
+    free(idx->strings);
+    *idx = (line_index_t){0};
+}
+
+static inline bool line_index_covers(const line_index_t* idx, uint32_t i, uint64_t offset) {
+    return idx->entries[i].offset <= offset &&
+           (i + 1 == idx->count || offset < idx->entries[i + 1].offset);
+}
+
+const line_entry_t* line_index_find(line_index_t* idx, uint64_t offset) {
+    if (idx->count == 0 || offset >= idx->code_size || offset < idx->entries[0].offset) {
+        return NULL;
+    }
+
+    // Stepping mostly stays in the same entry or moves to the next one
+    uint32_t i = idx->hint;
+    if (!line_index_covers(idx, i, offset)) {
+        if (i + 1 < idx->count && line_index_covers(idx, i + 1, offset)) {
+            i++;
+        } else {
+            // Last entry with entries[i].offset <= offset
+            uint32_t lo = 0;
+            uint32_t hi = idx->count;
+            while (hi - lo > 1) {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (idx->entries[mid].offset <= offset) {
+                    lo = mid;
+                } else {
+                    hi = mid;
+                }
+            }
+            i = lo;
+        }
+        idx->hint = i;
+    }
+
+    const line_entry_t* e = &idx->entries[i];
+    return e->line != 0 ? e : NULL;
+}
+
+uint32_t line_index_file_id(const line_index_t* idx, const char* name) {
+    for_range(i, 0, idx->file_count) {
+        if (strcmp(idx->files[i], name) == 0) {
+            return (uint32_t)i;
+        }
+    }
+
+    size_t len = strlen(name);
+    for_range(i, 0, idx->file_count) {
+        size_t flen = strlen(idx->files[i]);
+        if (flen > len && idx->files[i][flen - len - 1] == '/' &&
+            strcmp(idx->files[i] + flen - len, name) == 0) {
+            return (uint32_t)i;
+        }
+    }
+    return UINT32_MAX;
+}
+
+uint32_t line_index_ranges(const line_index_t* idx, uint32_t file, uint32_t line,
+                           const line_range_t** ranges) {
+    uint32_t lo = 0;
+    uint32_t hi = idx->range_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (line_range_less(&idx->ranges[mid], file, line, 0)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    uint32_t end = lo;
+    while (end < idx->range_count && idx->ranges[end].file == file &&
+           idx->ranges[end].line == line) {
+        end++;
+    }
+
+    *ranges = idx->ranges ? &idx->ranges[lo] : NULL;
+    return end - lo;
+}
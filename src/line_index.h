@@ -0,0 +1,113 @@
+#pragma once
+
+#include "spirv_compile.h"
+#include <stdbool.h>
+
+/**
+ * PC -> source line index of one loaded shader.
+ *
+ * Built once from hdb_shader_t::debug_info (hdb_debug_loc_t entries):
+ *
+ *   entries   sorted by code offset, runs of the same file:line merged;
+ *             entry i covers [entries[i].offset, entries[i + 1].offset)
+ *   ranges    the same code ranges sorted by (file, line, start), for
+ *             line -> PC breakpoints
+ *
+ * Lookups are binary searches over 12-byte entries, with a fast path for
+ * the common step / trace case where the PC stayed in, or moved just past,
+ * the previous hit.
+ *
+ * DANGER: The lookup hint makes line_index_find() not thread-safe; use one
+ *         index per thread.
+ */
+
+/**
+ * line_entry_t: Start of a code range with one source location.
+ */
+typedef struct {
+    uint32_t offset;   // Code offset (bytes from the shader start)
+    uint32_t line;
+    uint32_t file;     // Index into line_index_t::files
+} line_entry_t;
+
+/**
+ * line_range_t: Code range of one source line (reverse index).
+ */
+typedef struct {
+    uint32_t file;
+    uint32_t line;
+    uint32_t start;    // Code offsets [start, end)
+    uint32_t end;
+} line_range_t;
+
+/**
+ * line_index_t: Index of one shader.
+ */
+typedef struct {
+    line_entry_t*  entries;
+    uint32_t       count;
+    uint32_t       code_size;    // End of the last entry's range
+    line_range_t*  ranges;
+    uint32_t       range_count;
+    const char**   files;        // File names (point into strings)
+    uint32_t       file_count;
+    char*          strings;
+    uint32_t       hint;         // Entry of the last lookup
+} line_index_t;
+
+/**
+ * Build the index of a shader.
+ *
+ * @param shader: Shader with debug info (an index without entries is built
+ *                when it has none)
+ * @param idx: Output index
+ * @return: 0 on success, -EINVAL for malformed debug info, -ENOMEM
+ *
+ * Entries past bin_size or naming a missing file are dropped. Of several
+ * entries at one offset the last one wins, but a line-0 entry only when
+ * every entry there is line 0.
+ */
+int32_t line_index_build(const hdb_shader_t* shader, line_index_t* idx);
+
+/**
+ * Free an index.
+ *
+ * @param idx: Index (safe to call on a zeroed one)
+ */
+void line_index_free(line_index_t* idx);
+
+/**
+ * Source location of a code offset.
+ *
+ * @param idx: Index
+ * @param offset: Code offset (pc - code base)
+ * @return: Entry covering offset, or NULL outside the described code
+ */
+const line_entry_t* line_index_find(line_index_t* idx, uint64_t offset);
+
+/**
+ * File name of an entry or range file id.
+ */
+static inline const char* line_index_file(const line_index_t* idx, uint32_t file) {
+    return file < idx->file_count ? idx->files[file] : "?";
+}
+
+/**
+ * Look up a file id by name; a name also matches a file whose path ends in
+ * "/<name>".
+ *
+ * @return: File id, or UINT32_MAX if not found
+ */
+uint32_t line_index_file_id(const line_index_t* idx, const char* name);
+
+/**
+ * Code ranges of a source line.
+ *
+ * @param idx: Index
+ * @param file: File id
+ * @param line: Source line
+ * @param ranges: Output pointer to the first range (sorted by start)
+ * @return: Number of ranges (0 if the line has no code)
+ */
+uint32_t line_index_ranges(const line_index_t* idx, uint32_t file, uint32_t line,
+                           const line_range_t** ranges);
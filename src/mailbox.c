@@ -0,0 +1,400 @@
+#include "mailbox.h"
+#include "regs.h"
+#include "stats.h"
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * Sleep on a host futex word for at most timeout_ns.
+ * 
+ * Returns early if the word no longer equals expected or on FUTEX_WAKE.
+ */
+static void mailbox_futex_wait(uint32_t* word, uint32_t expected,
+                               uint64_t timeout_ns) {
+    struct timespec ts = {
+        .tv_sec = (time_t)(timeout_ns / 1000000000ull),
+        .tv_nsec = (long)(timeout_ns % 1000000000ull),
+    };
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, &ts, NULL, 0);
+}
+
+/**
+ * HW_ID1 field limits (widths of the gfx11 fields).
+ */
+#define HW_ID1_MAX_WGP    16
+#define HW_ID1_MAX_SIMD   4
+#define HW_ID1_MAX_WAVES  16  // gfx11 wave slots per SIMD
+
+void mailbox_topology_from_device(const amdgpu_t* dev, mailbox_topology_t* topo) {
+    *topo = (mailbox_topology_t){
+        .se = MAX(dev->num_shader_engines, 1u),
+        .sa = MAX(dev->num_shader_arrays_per_engine, 1u),
+        .wgp = HW_ID1_MAX_WGP,
+        .simd = HW_ID1_MAX_SIMD,
+        .waves = HW_ID1_MAX_WAVES,
+    };
+}
+
+int32_t mailbox_init(amdgpu_t* dev, const mailbox_topology_t* topo,
+                     uint32_t vgpr_count, uint32_t lanes, mailbox_t* mb) {
+    mailbox_topology_t t;
+    if (topo != NULL) {
+        t = *topo;
+    } else {
+        mailbox_topology_from_device(dev, &t);
+    }
+
+    HDB_ASSERT(t.se >= 1 && t.sa >= 1 && t.wgp >= 1 && t.simd >= 1 && t.waves >= 1,
+               "mailbox topology dimensions must be >= 1");
+    HDB_ASSERT(t.sa <= 0xFF && t.wgp <= 0xFF && t.simd <= 0xFF && t.waves <= 0xFF,
+               "mailbox topology dimensions must fit in a byte");
+    HDB_ASSERT(vgpr_count >= 2, "trap handler needs v0/v1 saved");
+    HDB_ASSERT(lanes == 32 || lanes == 64, "lanes must be 32 or 64");
+
+    uint32_t slot_count = t.se * t.sa * t.wgp * t.simd * t.waves;
+    uint32_t ring_entries = 1;
+    while (ring_entries < slot_count) {
+        ring_entries <<= 1;
+    }
+
+    uint32_t ring_offset = MAILBOX_HEADER_SIZE;
+    uint32_t slots_offset = ALIGN_UP(ring_offset + ring_entries * sizeof(uint32_t), 256);
+    uint32_t slot_stride = ALIGN_UP(MAILBOX_SLOT_VGPR_OFFSET +
+                                    vgpr_count * lanes * sizeof(uint32_t), 256);
+    size_t size = slots_offset + (size_t)slot_count * slot_stride;
+
+    *mb = (mailbox_t){0};
+
+    // Uncached GTT: CPU and GPU must observe each other's stores directly.
+    // The clear leaves every slot EMPTY and every ring entry unpublished.
+    int32_t ret = bo_alloc(dev, size, AMDGPU_GEM_DOMAIN_GTT, true, &mb->bo);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to allocate TMA mailbox: %d\n", ret);
+        return ret;
+    }
+
+    mb->topo = t;
+    mb->slot_count = slot_count;
+    mb->slot_stride = slot_stride;
+    mb->slots_offset = slots_offset;
+    mb->vgpr_count = vgpr_count;
+    mb->lanes = lanes;
+    mb->ring_mask = ring_entries - 1;
+    mb->ring = (uint32_t*)((uint8_t*)mb->bo.host_addr + ring_offset);
+
+    mailbox_header_t header = {
+        .magic = MAILBOX_MAGIC,
+        .version = MAILBOX_VERSION,
+        .slot_count = slot_count,
+        .slot_stride = slot_stride,
+        .slots_offset = slots_offset,
+        .vgpr_count = vgpr_count,
+        .lanes = lanes,
+        .slot_dims = t.waves | (t.simd << 8) | (t.wgp << 16) | (t.sa << 24),
+        .slot_se = t.se,
+        .ring_offset = ring_offset,
+        .ring_mask = ring_entries - 1,
+    };
+    bo_upload(&mb->bo, &header, sizeof(header));
+
+    fprintf(stdout, "[INFO] TMA mailbox: %u slots x %u bytes, %u ring entries at VA=0x%lx\n",
+            slot_count, slot_stride, ring_entries, mb->bo.va_addr);
+    return 0;
+}
+
+void mailbox_set_breakpoints(mailbox_t* mb, uint64_t table_va) {
+    mailbox_header_t* header = mb->bo.host_addr;
+
+    // Aligned 64-bit store; drain it so running waves see it promptly
+    header->bp_table_va = table_va;
+    hdb_wc_fence();
+}
+
+void mailbox_set_trace(mailbox_t* mb, uint64_t trace_va) {
+    mailbox_header_t* header = mb->bo.host_addr;
+
+    header->trace_va = trace_va;
+    hdb_wc_fence();
+}
+
+void mailbox_fini(amdgpu_t* dev, mailbox_t* mb) {
+    bo_free(dev, &mb->bo);
+    *mb = (mailbox_t){0};
+}
+
+mailbox_slot_t* mailbox_slot(mailbox_t* mb, uint32_t slot) {
+    HDB_ASSERT(slot < mb->slot_count, "mailbox slot out of range");
+
+    return (mailbox_slot_t*)((uint8_t*)mb->bo.host_addr + mb->slots_offset +
+                             (size_t)slot * mb->slot_stride);
+}
+
+uint32_t mailbox_slot_index(const mailbox_t* mb, uint32_t hw_id1) {
+    reg_hw_id1_t id = { .raw = hw_id1 };
+    const mailbox_topology_t* t = &mb->topo;
+
+    // Same nesting and clamping as the trap handler
+    uint32_t index = MIN(id.se_id, t->se - 1);
+    index = index * t->sa + MIN(id.sa_id, t->sa - 1);
+    index = index * t->wgp + MIN(id.wgp_id, t->wgp - 1);
+    index = index * t->simd + MIN(id.simd_id, t->simd - 1);
+    index = index * t->waves + MIN(id.wave_id, t->waves - 1);
+    return index;
+}
+
+uint32_t* mailbox_slot_sgprs(mailbox_t* mb, uint32_t slot) {
+    return (uint32_t*)((uint8_t*)mailbox_slot(mb, slot) + MAILBOX_SLOT_SGPR_OFFSET);
+}
+
+uint32_t* mailbox_slot_vgprs(mailbox_t* mb, uint32_t slot) {
+    return (uint32_t*)((uint8_t*)mailbox_slot(mb, slot) + MAILBOX_SLOT_VGPR_OFFSET);
+}
+
+/**
+ * Acquire-load of a slot state written by the GPU.
+ */
+static inline uint32_t mailbox_slot_state(mailbox_slot_t* s) {
+    return __atomic_load_n(&s->state, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Has the wave in a slot published its state?
+ */
+static bool mailbox_slot_ready(mailbox_t* mb, uint32_t slot) {
+    return mailbox_slot_state(mailbox_slot(mb, slot)) == MAILBOX_SLOT_TRAPPED;
+}
+
+/**
+ * Has a wave published a trap ring entry the host has not consumed?
+ */
+static bool mailbox_ring_ready(mailbox_t* mb, uint32_t unused) {
+    (void)unused;
+    return __atomic_load_n(&mb->ring[mb->rptr & mb->ring_mask], __ATOMIC_ACQUIRE) != 0;
+}
+
+/**
+ * Spin-then-sleep waiter shared by mailbox_wait() and mailbox_wait_any().
+ */
+static int32_t mailbox_wait_until(mailbox_t* mb,
+                                  bool (*ready)(mailbox_t*, uint32_t),
+                                  uint32_t arg,
+                                  const mailbox_wait_cfg_t* cfg,
+                                  amdgpu_submit_t* submit,
+                                  uint64_t timeout_ns) {
+    mailbox_wait_cfg_t config = cfg ? *cfg : MAILBOX_WAIT_CFG_DEFAULT;
+
+    uint64_t start = hdb_now_ns();
+    uint64_t deadline = timeout_ns ? start + timeout_ns : UINT64_MAX;
+    uint32_t wake = __atomic_load_n(&mb->wake_word, __ATOMIC_ACQUIRE);
+
+    // Phase 1: PAUSE spin. Lowest latency; bounded so we never pin a core.
+    uint64_t spin_end = MIN(start + config.spin_ns, deadline);
+    do {
+        for_range(i, 0, 64) {
+            if (ready(mb, arg)) {
+                stats_end(STAT_TRAP_WAIT, start);
+                return MAILBOX_WAIT_TRAPPED;
+            }
+            hdb_cpu_relax();
+        }
+    } while (hdb_now_ns() < spin_end);
+
+    // Phase 2: exponential backoff on the host futex or the dispatch fence
+    uint64_t sleep_ns = MAX(config.sleep_min_ns, 1000ull);
+    for (;;) {
+        if (ready(mb, arg)) {
+            stats_end(STAT_TRAP_WAIT, start);
+            return MAILBOX_WAIT_TRAPPED;
+        }
+
+        uint64_t now = hdb_now_ns();
+        if (now >= deadline) {
+            return -ETIMEDOUT;
+        }
+        uint64_t interval = MIN(sleep_ns, deadline - now);
+
+        if (submit != NULL) {
+            // With use_fence the kernel sleeps on the EOP interrupt;
+            // otherwise this is a non-blocking completion check
+            uint32_t expired = 0;
+            int32_t ret = amdgpu_cs_query_fence_status(
+                &submit->fence, config.use_fence ? interval : 0, 0, &expired);
+            if (ret != 0) {
+                fprintf(stderr, "[ERROR] Fence query failed while waiting for trap: %d\n",
+                        ret);
+                return ret;
+            }
+
+            // Last store of a trapping wave may race dispatch completion
+            if (expired) {
+                return ready(mb, arg) ? MAILBOX_WAIT_TRAPPED : MAILBOX_WAIT_COMPLETED;
+            }
+        }
+
+        if (submit == NULL || !config.use_fence) {
+            mailbox_futex_wait(&mb->wake_word, wake, interval);
+        }
+
+        if (__atomic_load_n(&mb->wake_word, __ATOMIC_ACQUIRE) != wake) {
+            return MAILBOX_WAIT_WOKEN;
+        }
+
+        sleep_ns = MIN(sleep_ns * 2, MAX(config.sleep_max_ns, sleep_ns));
+    }
+}
+
+int32_t mailbox_wait(mailbox_t* mb, uint32_t slot,
+                     const mailbox_wait_cfg_t* cfg,
+                     amdgpu_submit_t* submit,
+                     uint64_t timeout_ns) {
+    HDB_ASSERT(slot < mb->slot_count, "mailbox slot out of range");
+
+    return mailbox_wait_until(mb, mailbox_slot_ready, slot, cfg, submit, timeout_ns);
+}
+
+int32_t mailbox_wait_any(mailbox_t* mb, const mailbox_wait_cfg_t* cfg,
+                         amdgpu_submit_t* submit, uint64_t timeout_ns) {
+    return mailbox_wait_until(mb, mailbox_ring_ready, 0, cfg, submit, timeout_ns);
+}
+
+uint32_t mailbox_drain(mailbox_t* mb, uint32_t* slots, uint32_t max) {
+    uint32_t count = 0;
+
+    while (count < max) {
+        uint32_t* entry = &mb->ring[mb->rptr & mb->ring_mask];
+
+        // Reserved but not yet stored entries read as 0 (slots_offset > 0)
+        uint32_t offset = __atomic_load_n(entry, __ATOMIC_ACQUIRE);
+        if (offset == 0) {
+            break;
+        }
+
+        HDB_ASSERT(offset >= mb->slots_offset &&
+                   (offset - mb->slots_offset) % mb->slot_stride == 0,
+                   "corrupt trap ring entry");
+
+        // Clear before advancing so the entry reads unpublished when the
+        // ring wraps back to it
+        __atomic_store_n(entry, 0, __ATOMIC_RELAXED);
+        slots[count++] = (offset - mb->slots_offset) / mb->slot_stride;
+        mb->rptr++;
+    }
+
+    if (count != 0) {
+        mailbox_header_t* header = mb->bo.host_addr;
+        __atomic_store_n(&header->ring_rptr, mb->rptr, __ATOMIC_RELEASE);
+    }
+    return count;
+}
+
+void mailbox_resume(mailbox_t* mb, uint32_t slot) {
+    mailbox_slot_t* s = mailbox_slot(mb, slot);
+
+    // Host edits to saved registers must land before the wave sees RESUME
+    __atomic_store_n(&s->state, MAILBOX_SLOT_RESUME, __ATOMIC_RELEASE);
+}
+
+void mailbox_resume_batch(mailbox_t* mb, const uint32_t* slots, uint32_t count) {
+    // One release fence covers every slot's register edits
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for_range(i, 0, count) {
+        __atomic_store_n(&mailbox_slot(mb, slots[i])->state, MAILBOX_SLOT_RESUME,
+                         __ATOMIC_RELAXED);
+    }
+}
+
+void mailbox_wake(mailbox_t* mb) {
+    __atomic_add_fetch(&mb->wake_word, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &mb->wake_word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/**
+ * Notifier thread: report newly published ring entries on the eventfd.
+ */
+static void* mailbox_notifier_main(void* arg) {
+    mailbox_notifier_t* n = arg;
+    mailbox_t* mb = n->mb;
+    mailbox_header_t* header = mb->bo.host_addr;
+
+    uint64_t sleep_ns = MAX(n->cfg.sleep_min_ns, 1000ull);
+    while (!__atomic_load_n(&n->stop, __ATOMIC_ACQUIRE)) {
+        // Entries the host already drained read as 0; skip past them
+        uint32_t rptr = __atomic_load_n(&header->ring_rptr, __ATOMIC_ACQUIRE);
+        if ((int32_t)(rptr - n->cursor) > 0) {
+            n->cursor = rptr;
+        }
+
+        uint64_t published = 0;
+        while (published <= mb->ring_mask &&
+               __atomic_load_n(&mb->ring[n->cursor & mb->ring_mask],
+                               __ATOMIC_ACQUIRE) != 0) {
+            n->cursor++;
+            published++;
+        }
+
+        if (published != 0) {
+            if (write(n->fd, &published, sizeof(published)) != sizeof(published)) {
+                fprintf(stderr, "[WARN] Trap notifier eventfd write failed: %d\n",
+                        -errno);
+            }
+            sleep_ns = MAX(n->cfg.sleep_min_ns, 1000ull);
+        } else {
+            sleep_ns = MIN(sleep_ns * 2, MAX(n->cfg.sleep_max_ns, sleep_ns));
+        }
+
+        // Sleeping on the stop word makes mailbox_notifier_stop() immediate
+        mailbox_futex_wait(&n->stop, 0, sleep_ns);
+    }
+    return NULL;
+}
+
+int32_t mailbox_notifier_start(mailbox_t* mb, const mailbox_wait_cfg_t* cfg,
+                               mailbox_notifier_t* n) {
+    *n = (mailbox_notifier_t){
+        .mb = mb,
+        .cfg = cfg ? *cfg : MAILBOX_WAIT_CFG_DEFAULT,
+        .fd = -1,
+        .cursor = mb->rptr,
+    };
+
+    n->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (n->fd < 0) {
+        int32_t ret = -errno;
+        fprintf(stderr, "[ERROR] Failed to create trap notifier eventfd: %d\n", ret);
+        *n = (mailbox_notifier_t){ .fd = -1 };
+        return ret;
+    }
+
+    int32_t ret = -pthread_create(&n->thread, NULL, mailbox_notifier_main, n);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to start trap notifier thread: %d\n", ret);
+        close(n->fd);
+        *n = (mailbox_notifier_t){ .fd = -1 };
+        return ret;
+    }
+    return 0;
+}
+
+void mailbox_notifier_stop(mailbox_notifier_t* n) {
+    if (n->mb == NULL) {
+        return;
+    }
+
+    __atomic_store_n(&n->stop, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &n->stop, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    pthread_join(n->thread, NULL);
+
+    close(n->fd);
+    *n = (mailbox_notifier_t){ .fd = -1 };
+}
+
+uint64_t mailbox_notifier_ack(mailbox_notifier_t* n) {
+    uint64_t count = 0;
+    if (read(n->fd, &count, sizeof(count)) != sizeof(count)) {
+        return 0;  // EAGAIN: nothing new
+    }
+    return count;
+}
@@ -0,0 +1,401 @@
+#pragma once
+
+#include "bo.h"
+#include <pthread.h>
+#include <stddef.h>
+
+/**
+ * Trap mailbox: CPU-GPU handshake over the uncached TMA buffer.
+ *
+ * TMA layout (byte offsets from the TMA base):
+ *
+ *   0x000  mailbox_header_t  geometry, ring indices (256 bytes)
+ *   0x100  trap ring         ring_mask + 1 dwords
+ *   ...    wave slots        slot_count x slot_stride, from slots_offset
+ *
+ * Every hardware wave position has its own slot, indexed from HW_ID1
+ * (SE / SA / WGP / SIMD / wave) with the dimensions in header->slot_dims,
+ * so concurrently trapping waves never contend for memory. A wave fills its
+ * slot, publishes it by storing MAILBOX_SLOT_TRAPPED to slot->state, then
+ * appends the slot's byte offset to the trap ring: an atomic add on
+ * header->ring_wptr reserves an entry, and the offset (never 0) is stored
+ * into it. The host drains the ring in batches with mailbox_drain(),
+ * clearing entries as it consumes them. A wave is parked in its slot until
+ * the host stores MAILBOX_SLOT_RESUME; it then restores itself (including
+ * host edits), stores MAILBOX_SLOT_EMPTY and returns with s_rfe_b64.
+ *
+ * Each wave has at most one ring entry outstanding and the ring is at
+ * least slot_count entries deep, so producers can never overrun the host.
+ * The GPU side is src/trap_handler.s.
+ *
+ * With a breakpoint table attached (mailbox_set_breakpoints()), traps
+ * without an exception or s_trap are filtered on the GPU: they only reach
+ * a slot when the PC is in the table (see breakpoint.h).
+ *
+ * With a trace ring attached (mailbox_set_trace()), those same traps are
+ * instead appended to the trace ring as compact records and the wave
+ * resumes at once without the host (see trace.h).
+ *
+ * Slot layout (byte offsets from the slot base, slot_stride apart):
+ *
+ *   0x000  mailbox_slot_t   state, ids, PC, masks (64 bytes)
+ *   0x040  SGPRs            MAILBOX_MAX_SGPRS dwords
+ *   0x240  VGPRs            vgpr_count x lanes dwords, register-major
+ *                           (global_store_addtid_b32 layout)
+ *
+ * The host waits with mailbox_wait() (one slot) or mailbox_wait_any()
+ * (trap ring): a short PAUSE spin for low trap-to-CPU latency, then
+ * exponential backoff sleeping on a host futex (woken early by
+ * mailbox_wake()) or on the dispatch fence, whose wait is interrupt-backed
+ * in the kernel.
+ *
+ * DANGER: The layout is shared with the GPU trap handler; any change is
+ *         an ABI change (bump MAILBOX_VERSION).
+ * DANGER: The ring append is a GPU atomic on system memory and needs PCIe
+ *         atomics between the GPU and the host bridge.
+ * DANGER: One consumer (mailbox_drain() caller) per mailbox.
+ */
+
+#define MAILBOX_MAGIC          0x54424448u  // "HDBT"
+#define MAILBOX_VERSION        5
+#define MAILBOX_HEADER_SIZE    256
+#define MAILBOX_MAX_SGPRS      128
+#define MAILBOX_SLOT_SGPR_OFFSET  0x040
+#define MAILBOX_SLOT_VGPR_OFFSET  0x240
+
+/**
+ * Slot state values (slot->state).
+ */
+typedef enum {
+    MAILBOX_SLOT_EMPTY   = 0,  // No wave parked in this slot
+    MAILBOX_SLOT_TRAPPED = 1,  // Written by trap handler; state is valid
+    MAILBOX_SLOT_RESUME  = 2,  // Written by host; wave may continue
+} mailbox_slot_state_t;
+
+/**
+ * mailbox_header_t: Start of the TMA buffer.
+ *
+ * Written by the host at init, except ring_wptr (GPU atomics) and
+ * ring_rptr (host progress, informational). The ring indices live on
+ * separate 64-byte lines so GPU atomics and host stores do not share one.
+ */
+typedef struct {
+    uint32_t magic;         // MAILBOX_MAGIC
+    uint32_t version;       // MAILBOX_VERSION
+    uint32_t slot_count;    // Number of wave slots
+    uint32_t slot_stride;   // Bytes between consecutive slots
+    uint32_t slots_offset;  // Byte offset of slot 0 from the TMA base
+    uint32_t vgpr_count;    // VGPRs saved per wave
+    uint32_t lanes;         // Lanes saved per VGPR (32 or 64)
+    uint32_t slot_dims;     // Slot grid: [7:0] waves, [15:8] SIMDs,
+                            // [23:16] WGPs, [31:24] SAs (SEs in slot_se)
+    uint32_t ring_offset;   // Byte offset of the trap ring from the TMA base
+    uint32_t ring_mask;     // Ring entries - 1 (entries is a power of 2)
+    uint64_t bp_table_va;   // 0x28: bp_table_header_t for the fast path (0 = none)
+    uint64_t trace_va;      // 0x30: trace_header_t for trace mode (0 = off)
+    uint32_t slot_se;       // 0x38: SEs in the slot grid (outermost dimension)
+    uint32_t reserved0;
+    uint32_t ring_wptr;     // 0x40: entries reserved by trapping waves
+    uint32_t reserved1[15];
+    uint32_t ring_rptr;     // 0x80: entries consumed by the host
+    uint32_t reserved2[31];
+} mailbox_header_t;
+
+_Static_assert(sizeof(mailbox_header_t) == MAILBOX_HEADER_SIZE,
+               "mailbox header size is part of the GPU ABI");
+_Static_assert(offsetof(mailbox_header_t, bp_table_va) == 0x28,
+               "bp_table_va offset is part of the GPU ABI");
+_Static_assert(offsetof(mailbox_header_t, trace_va) == 0x30,
+               "trace_va offset is part of the GPU ABI");
+_Static_assert(offsetof(mailbox_header_t, slot_se) == 0x38,
+               "slot_se offset is part of the GPU ABI");
+_Static_assert(offsetof(mailbox_header_t, ring_wptr) == 0x40,
+               "ring_wptr offset is part of the GPU ABI");
+
+/**
+ * mailbox_slot_t: Fixed part of a wave slot (written by the trap handler).
+ *
+ * pc_lo/pc_hi and exec_lo/exec_hi are read back on resume, so host edits
+ * redirect or re-mask the wave. After s_trap the handler resumes at pc + 4.
+ */
+typedef struct {
+    uint32_t state;         // mailbox_slot_state_t
+    uint32_t seq;           // Incremented by the trap handler on every trap
+    uint32_t hw_id1;        // HW_REG_HW_ID1
+    uint32_t hw_id2;        // HW_REG_HW_ID2
+    uint32_t pc_lo;         // PC at trap (from TTMP0/1)
+    uint32_t pc_hi;
+    uint32_t exec_lo;       // EXEC at trap
+    uint32_t exec_hi;
+    uint32_t vcc_lo;        // VCC at trap
+    uint32_t vcc_hi;
+    uint32_t status;        // HW_REG_STATUS
+    uint32_t trap_sts;      // HW_REG_TRAPSTS
+    uint32_t m0;            // M0 at trap
+    uint32_t trap_id;       // s_trap immediate (0 = exception / single-step)
+    uint32_t reserved[2];
+} mailbox_slot_t;
+
+_Static_assert(sizeof(mailbox_slot_t) == MAILBOX_SLOT_SGPR_OFFSET,
+               "mailbox slot header size is part of the GPU ABI");
+
+/**
+ * mailbox_topology_t: Dimensions of the slot grid.
+ *
+ * Fields of HW_ID1 beyond a dimension are clamped by the trap handler, so
+ * dimensions smaller than the hardware alias waves onto shared slots;
+ * only do that when at most one of the aliased waves can trap at a time.
+ */
+typedef struct {
+    uint32_t se;     // Shader engines
+    uint32_t sa;     // Shader arrays per SE
+    uint32_t wgp;    // WGPs per SA
+    uint32_t simd;   // SIMDs per WGP
+    uint32_t waves;  // Wave slots per SIMD
+} mailbox_topology_t;
+
+/**
+ * mailbox_t: Host view of a TMA mailbox.
+ */
+typedef struct {
+    amdgpu_bo_t         bo;           // Uncached GTT BO (TMA)
+    mailbox_topology_t  topo;         // Slot grid
+    uint32_t            slot_count;   // Number of wave slots
+    uint32_t            slot_stride;  // Bytes between slots
+    uint32_t            slots_offset; // Byte offset of slot 0
+    uint32_t            vgpr_count;   // VGPRs saved per wave
+    uint32_t            lanes;        // Lanes per VGPR
+    uint32_t            ring_mask;    // Ring entries - 1
+    uint32_t*           ring;         // Host pointer to the trap ring
+    uint32_t            rptr;         // Next ring entry to consume
+    uint32_t            wake_word;    // Host futex word bumped by mailbox_wake()
+} mailbox_t;
+
+/**
+ * Waiter tuning.
+ *
+ * spin_ns: busy-poll budget with PAUSE before sleeping.
+ * sleep_min_ns / sleep_max_ns: exponential backoff range once spinning
+ *   gives up.
+ * use_fence: sleep on the dispatch fence (interrupt-backed) instead of
+ *   the host futex. Requires a submission to be passed to mailbox_wait().
+ */
+typedef struct {
+    uint64_t spin_ns;
+    uint64_t sleep_min_ns;
+    uint64_t sleep_max_ns;
+    bool     use_fence;
+} mailbox_wait_cfg_t;
+
+/**
+ * Default waiter tuning: 50us spin, then 10us..2ms backoff.
+ */
+#define MAILBOX_WAIT_CFG_DEFAULT ((mailbox_wait_cfg_t){ \
+    .spin_ns = 50 * 1000,                               \
+    .sleep_min_ns = 10 * 1000,                          \
+    .sleep_max_ns = 2 * 1000 * 1000,                    \
+    .use_fence = false,                                 \
+})
+
+/**
+ * mailbox_wait() / mailbox_wait_any() outcomes (non-negative); errors are
+ * negative errno.
+ */
+typedef enum {
+    MAILBOX_WAIT_TRAPPED   = 0,  // Slot (or ring) holds a trapped wave
+    MAILBOX_WAIT_COMPLETED = 1,  // Dispatch fence signaled, no trap
+    MAILBOX_WAIT_WOKEN     = 2,  // mailbox_wake() interrupted the wait
+} mailbox_wait_result_t;
+
+/**
+ * Slot grid covering every wave position of a device.
+ *
+ * @param dev: Device context
+ * @param topo: Output topology (SE/SA counts from the GPU info; WGP, SIMD
+ *              and wave dimensions at their HW_ID1 field limits)
+ */
+void mailbox_topology_from_device(const amdgpu_t* dev, mailbox_topology_t* topo);
+
+/**
+ * Allocate and initialize a TMA mailbox.
+ *
+ * @param dev: Device context
+ * @param topo: Slot grid (NULL = mailbox_topology_from_device())
+ * @param vgpr_count: VGPRs saved per wave (>= 2; v0/v1 are handler scratch)
+ * @param lanes: Lanes saved per VGPR (32 or 64)
+ * @param mb: Output mailbox
+ * @return: 0 on success, negative error code on failure
+ *
+ * DANGER: Must be freed with mailbox_fini(); pass mb->bo.va_addr as TMA
+ *         to dev_setup_trap_handler().
+ */
+int32_t mailbox_init(amdgpu_t* dev, const mailbox_topology_t* topo,
+                     uint32_t vgpr_count, uint32_t lanes, mailbox_t* mb);
+
+/**
+ * Point the trap handler's fast path at a breakpoint table.
+ *
+ * @param mb: Mailbox
+ * @param table_va: GPU VA of a bp_table_header_t (bp_table_t.bo.va_addr),
+ *                  or 0 to send every trap to the host
+ */
+void mailbox_set_breakpoints(mailbox_t* mb, uint64_t table_va);
+
+/**
+ * Switch the trap handler to trace mode.
+ *
+ * @param mb: Mailbox
+ * @param trace_va: GPU VA of a trace_header_t (trace_t.bo.va_addr), or 0
+ *                  to stop tracing
+ *
+ * Exceptions and s_trap still park in their slot as usual.
+ */
+void mailbox_set_trace(mailbox_t* mb, uint64_t trace_va);
+
+/**
+ * Free the mailbox BO.
+ *
+ * @param dev: Device context
+ * @param mb: Mailbox
+ *
+ * DANGER: No wave may still be parked in the trap handler.
+ */
+void mailbox_fini(amdgpu_t* dev, mailbox_t* mb);
+
+/**
+ * Get the fixed part of a wave slot.
+ */
+mailbox_slot_t* mailbox_slot(mailbox_t* mb, uint32_t slot);
+
+/**
+ * Slot index of a wave, computed from its HW_ID1 exactly like the trap
+ * handler does (including clamping).
+ *
+ * @param mb: Mailbox
+ * @param hw_id1: HW_REG_HW_ID1 value (e.g. from an SQ wave dump)
+ * @return: Slot index
+ */
+uint32_t mailbox_slot_index(const mailbox_t* mb, uint32_t hw_id1);
+
+/**
+ * Get the saved SGPRs of a wave slot (MAILBOX_MAX_SGPRS dwords).
+ */
+uint32_t* mailbox_slot_sgprs(mailbox_t* mb, uint32_t slot);
+
+/**
+ * Get the saved VGPRs of a wave slot (vgpr_count x lanes dwords).
+ */
+uint32_t* mailbox_slot_vgprs(mailbox_t* mb, uint32_t slot);
+
+/**
+ * Wait until a slot holds a trapped wave.
+ *
+ * @param mb: Mailbox
+ * @param slot: Slot index
+ * @param cfg: Waiter tuning (NULL = MAILBOX_WAIT_CFG_DEFAULT)
+ * @param submit: Dispatch being debugged (nullable); lets the waiter
+ *                notice completion without a trap
+ * @param timeout_ns: Overall timeout (0 = infinite)
+ * @return: mailbox_wait_result_t, or -ETIMEDOUT / negative error
+ */
+int32_t mailbox_wait(mailbox_t* mb, uint32_t slot,
+                     const mailbox_wait_cfg_t* cfg,
+                     amdgpu_submit_t* submit,
+                     uint64_t timeout_ns);
+
+/**
+ * Wait until the trap ring holds at least one entry.
+ *
+ * @param mb: Mailbox
+ * @param cfg: Waiter tuning (NULL = MAILBOX_WAIT_CFG_DEFAULT)
+ * @param submit: Dispatch being debugged (nullable)
+ * @param timeout_ns: Overall timeout (0 = infinite)
+ * @return: mailbox_wait_result_t, or -ETIMEDOUT / negative error
+ *
+ * Follow with mailbox_drain() to collect the trapped slots.
+ */
+int32_t mailbox_wait_any(mailbox_t* mb, const mailbox_wait_cfg_t* cfg,
+                         amdgpu_submit_t* submit, uint64_t timeout_ns);
+
+/**
+ * Consume published trap ring entries.
+ *
+ * @param mb: Mailbox
+ * @param slots: Output slot indices, in publication order
+ * @param max: Capacity of slots
+ * @return: Number of slots written (0 if the ring is empty)
+ *
+ * Stops at the first reserved entry whose slot offset is not stored yet;
+ * it is picked up by the next call. Never blocks.
+ */
+uint32_t mailbox_drain(mailbox_t* mb, uint32_t* slots, uint32_t max);
+
+/**
+ * Release a trapped wave (trap handler restores it and returns).
+ *
+ * @param mb: Mailbox
+ * @param slot: Slot index
+ */
+void mailbox_resume(mailbox_t* mb, uint32_t slot);
+
+/**
+ * Release a batch of trapped waves.
+ *
+ * @param mb: Mailbox
+ * @param slots: Slot indices (e.g. from mailbox_drain())
+ * @param count: Number of slots
+ */
+void mailbox_resume_batch(mailbox_t* mb, const uint32_t* slots, uint32_t count);
+
+/**
+ * Wake every thread sleeping in mailbox_wait() on this mailbox.
+ *
+ * @param mb: Mailbox
+ */
+void mailbox_wake(mailbox_t* mb);
+
+/**
+ * mailbox_notifier_t: Trap ring watcher that signals an eventfd.
+ *
+ * The trap ring lives in GPU-written memory that no fd can poll. The
+ * notifier thread watches it with the waiter's backoff and writes the
+ * number of newly published entries to an eventfd, so trapped waves can
+ * sit in one epoll set with submission fences and CLI input. It never
+ * consumes entries; the owning thread still calls mailbox_drain().
+ */
+typedef struct {
+    mailbox_t*          mb;
+    mailbox_wait_cfg_t  cfg;     // Backoff range (spin_ns / use_fence unused)
+    int                 fd;      // eventfd (EFD_NONBLOCK), counter = new entries
+    pthread_t           thread;
+    uint32_t            stop;    // Futex word, set by mailbox_notifier_stop()
+    uint32_t            cursor;  // Next ring entry not yet reported
+} mailbox_notifier_t;
+
+/**
+ * Start watching a mailbox's trap ring.
+ *
+ * @param mb: Mailbox (must outlive the notifier)
+ * @param cfg: Backoff tuning (NULL = MAILBOX_WAIT_CFG_DEFAULT)
+ * @param n: Output notifier; poll n->fd for EPOLLIN
+ * @return: 0 on success, negative error code on failure
+ *
+ * DANGER: The thread keeps a pointer to n; do not move or copy it.
+ */
+int32_t mailbox_notifier_start(mailbox_t* mb, const mailbox_wait_cfg_t* cfg,
+                               mailbox_notifier_t* n);
+
+/**
+ * Stop the watcher thread and close the eventfd.
+ *
+ * @param n: Notifier (safe to call on a zeroed or stopped notifier)
+ */
+void mailbox_notifier_stop(mailbox_notifier_t* n);
+
+/**
+ * Reset the eventfd once it polled readable (call before mailbox_drain()).
+ *
+ * @param n: Notifier
+ * @return: Entries published since the last ack
+ */
+uint64_t mailbox_notifier_ack(mailbox_notifier_t* n);
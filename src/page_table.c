@@ -0,0 +1,217 @@
+#include "page_table.h"
+#include "amdgpu_device.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+int32_t pt_walker_init(amdgpu_t* dev, pt_walker_t* w) {
+    *w = (pt_walker_t){ .dev = dev, .vram_fd = -1, .iomem_fd = -1, .generation = 1 };
+
+    if (!dev_regs_available(dev)) {
+        return -ENODEV;
+    }
+
+    int fd = amdgpu_device_open_debugfs(dev, "amdgpu_vram", O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "[ERROR] Failed to open debugfs amdgpu_vram: %d\n", fd);
+        return fd == -ENOENT ? -ENODEV : fd;
+    }
+    w->vram_fd = fd;
+
+    // Only needed for tables in system memory; translate what we can without
+    fd = amdgpu_device_open_debugfs(dev, "amdgpu_iomem", O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "[WARN] debugfs amdgpu_iomem unavailable (%d); "
+                "system-memory page tables cannot be walked\n", fd);
+    }
+    w->iomem_fd = fd;
+
+    w->blocks = calloc(PT_CACHE_BLOCKS, sizeof(*w->blocks));
+    if (w->blocks == NULL) {
+        pt_walker_fini(w);
+        return -ENOMEM;
+    }
+
+    uint32_t fb_offset = 0;
+    dev_op_reg32(dev, REG_GCMC_VM_FB_OFFSET, (regs2_ioc_data_t){0}, REG_OP_READ, &fb_offset);
+    w->fb_offset = (uint64_t)REG_GET_FIELD(fb_offset, GCMC_VM_FB_OFFSET, FB_OFFSET) << 24;
+    w->vm_generation = __atomic_load_n(&dev->vm_generation, __ATOMIC_ACQUIRE);
+    return 0;
+}
+
+void pt_walker_fini(pt_walker_t* w) {
+    if (w->vram_fd >= 0) {
+        close(w->vram_fd);
+    }
+    if (w->iomem_fd >= 0) {
+        close(w->iomem_fd);
+    }
+    free(w->blocks);
+    *w = (pt_walker_t){ .vram_fd = -1, .iomem_fd = -1 };
+}
+
+/**
+ * Read the table registers of a VMID (one batched regs2 group).
+ */
+static void pt_load_vmid(pt_walker_t* w, uint32_t vmid) {
+    uint32_t cntl, base_lo, base_hi, start_lo, start_hi, end_lo, end_hi;
+    reg_batch_op_t ops[] = {
+        { REG_GCVM_CONTEXT0_CNTL, REG_OP_READ, &cntl, vmid },
+        { REG_GCVM_CONTEXT0_PAGE_TABLE_BASE_ADDR_LO32, REG_OP_READ, &base_lo, vmid },
+        { REG_GCVM_CONTEXT0_PAGE_TABLE_BASE_ADDR_HI32, REG_OP_READ, &base_hi, vmid },
+        { REG_GCVM_CONTEXT0_PAGE_TABLE_START_ADDR_LO32, REG_OP_READ, &start_lo, vmid },
+        { REG_GCVM_CONTEXT0_PAGE_TABLE_START_ADDR_HI32, REG_OP_READ, &start_hi, vmid },
+        { REG_GCVM_CONTEXT0_PAGE_TABLE_END_ADDR_LO32, REG_OP_READ, &end_lo, vmid },
+        { REG_GCVM_CONTEXT0_PAGE_TABLE_END_ADDR_HI32, REG_OP_READ, &end_hi, vmid },
+    };
+    reg_batch_group_t group = { .ops = ops, .count = ARRAY_SIZE(ops) };
+    dev_op_reg32_batch(w->dev, &group, 1);
+
+    w->vmids[vmid] = (pt_vmid_t){
+        .generation = w->generation,
+        .enabled = REG_GET_FIELD(cntl, GCVM_CONTEXT0_CNTL, ENABLE_CONTEXT) != 0,
+        .depth = REG_GET_FIELD(cntl, GCVM_CONTEXT0_CNTL, PAGE_TABLE_DEPTH),
+        .block_size = REG_GET_FIELD(cntl, GCVM_CONTEXT0_CNTL, PAGE_TABLE_BLOCK_SIZE),
+        .root = (uint64_t)base_hi << 32 | base_lo,
+        .start_page = (uint64_t)start_hi << 32 | start_lo,
+        .end_page = (uint64_t)end_hi << 32 | end_lo,
+    };
+}
+
+/**
+ * Cache slot of a block key.
+ */
+static pt_block_t* pt_block_slot(pt_walker_t* w, uint64_t key) {
+    uint64_t hash = (key >> 12) * 0x9E3779B97F4A7C15ull;
+    return &w->blocks[(hash >> 32) & (PT_CACHE_BLOCKS - 1)];
+}
+
+/**
+ * Read one table entry; whole 4 KiB blocks are fetched and cached.
+ */
+static int32_t pt_read_entry(pt_walker_t* w, uint64_t table, bool system,
+                             uint64_t index, uint64_t* entry) {
+    uint64_t addr = table + index * 8;
+    uint64_t block = addr & ~(uint64_t)(PT_BLOCK_BYTES - 1);
+    uint64_t key = block | (system ? PT_PTE_SYSTEM : 0) | PT_PTE_VALID;
+
+    pt_block_t* slot = pt_block_slot(w, key);
+    if (slot->key != key || slot->generation != w->generation) {
+        int fd = system ? w->iomem_fd : w->vram_fd;
+        if (fd < 0) {
+            return -ENODEV;
+        }
+
+        // VRAM tables are addressed as FB_OFFSET + VRAM offset
+        uint64_t offset = system ? block : block - w->fb_offset;
+        ssize_t n = pread(fd, slot->entries, PT_BLOCK_BYTES, (off_t)offset);
+        if (n != PT_BLOCK_BYTES) {
+            slot->key = 0;
+            fprintf(stderr, "[ERROR] Page table read at %s 0x%lx failed: %s\n",
+                    system ? "system" : "VRAM", offset,
+                    n < 0 ? strerror(errno) : "short read");
+            return n < 0 ? -errno : -EIO;
+        }
+
+        slot->key = key;
+        slot->generation = w->generation;
+        w->misses++;
+        w->bytes_read += PT_BLOCK_BYTES;
+    } else {
+        w->hits++;
+    }
+
+    *entry = slot->entries[(addr & (PT_BLOCK_BYTES - 1)) / 8];
+    return 0;
+}
+
+/**
+ * Walk the tables for one VA.
+ */
+static int32_t pt_walk(pt_walker_t* w, const pt_vmid_t* vm, uint64_t va, pt_xlate_t* out) {
+    *out = (pt_xlate_t){ .status = -EFAULT };
+
+    uint64_t page = va >> 12;
+    if (page < vm->start_page || page > vm->end_page || !(vm->root & PT_PTE_VALID)) {
+        return 0;
+    }
+
+    uint64_t pfn = page - vm->start_page;
+    uint32_t ptb_bits = 9 + vm->block_size;
+    uint64_t table = vm->root & PT_PDE_ADDR_MASK;
+    bool system = (vm->root & PT_PTE_SYSTEM) != 0;
+
+    for_range(level, 0, vm->depth) {
+        uint32_t shift = ptb_bits + 9 * (vm->depth - 1 - (uint32_t)level);
+        uint64_t entry;
+        int32_t ret = pt_read_entry(w, table, system, (pfn >> shift) & 0x1FF, &entry);
+        if (ret != 0) {
+            return ret;
+        }
+        if (!(entry & PT_PTE_VALID)) {
+            return 0;
+        }
+
+        // PDE used as a PTE: maps the whole range below this level
+        if ((entry & PT_PDE_PTE) && !(entry & PT_PTE_TF)) {
+            uint64_t size = 1ull << (12 + shift);
+            *out = (pt_xlate_t){
+                .status = 0,
+                .page_shift = 12 + shift,
+                .pa = (entry & PT_PTE_ADDR_MASK & ~(size - 1)) | (va & (size - 1)),
+                .entry = entry,
+            };
+            return 0;
+        }
+
+        table = entry & PT_PDE_ADDR_MASK;
+        system = (entry & PT_PTE_SYSTEM) != 0;
+    }
+
+    uint64_t entry;
+    int32_t ret = pt_read_entry(w, table, system, pfn & ((1ull << ptb_bits) - 1), &entry);
+    if (ret != 0) {
+        return ret;
+    }
+    if (!(entry & PT_PTE_VALID)) {
+        return 0;
+    }
+
+    *out = (pt_xlate_t){
+        .status = 0,
+        .page_shift = 12,
+        .pa = (entry & PT_PTE_ADDR_MASK) | (va & 0xFFF),
+        .entry = entry,
+    };
+    return 0;
+}
+
+int32_t pt_translate(pt_walker_t* w, uint32_t vmid, const uint64_t* vas,
+                     size_t count, pt_xlate_t* out) {
+    HDB_ASSERT(vmid < PT_MAX_VMIDS, "invalid VMID");
+
+    // Any map/unmap since the last call may have rewritten table blocks
+    uint64_t vm_generation = __atomic_load_n(&w->dev->vm_generation, __ATOMIC_ACQUIRE);
+    if (vm_generation != w->vm_generation) {
+        w->vm_generation = vm_generation;
+        pt_walker_invalidate(w);
+    }
+
+    pt_vmid_t* vm = &w->vmids[vmid];
+    if (vm->generation != w->generation) {
+        pt_load_vmid(w, vmid);
+    }
+
+    for_range(i, 0, count) {
+        if (!vm->enabled) {
+            out[i] = (pt_xlate_t){ .status = -ENOENT };
+            continue;
+        }
+
+        int32_t ret = pt_walk(w, vm, vas[i], &out[i]);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
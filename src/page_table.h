@@ -0,0 +1,141 @@
+#pragma once
+
+#include "regs.h"
+
+/**
+ * GFX11 page-table walker (GPU VA -> physical address).
+ *
+ * Per VMID, GCVM_CONTEXT<n>_CNTL / PAGE_TABLE_{BASE,START,END}_ADDR give
+ * the root PDB, the table depth and the VA range. Each level is a 9-bit
+ * index into a block of 64-bit entries (the PTB level has 9 +
+ * PAGE_TABLE_BLOCK_SIZE bits):
+ *
+ *   PDB2 -> PDB1 -> PDB0 -> PTB -> 4 KiB page      (depth 3, 48-bit VA)
+ *
+ * A PDB0 entry with PT_PDE_PTE set (and PT_PTE_TF clear) maps a 2 MiB
+ * page directly.
+ *
+ * Table memory is read through debugfs (amdgpu_vram for VRAM, amdgpu_iomem
+ * for system pages), one whole 4 KiB block per miss, and kept in a
+ * block cache together with the per-VMID register state. Cached data is
+ * tagged with a generation: it goes stale when the debugger maps or unmaps
+ * a BO (amdgpu_t::vm_generation) or on pt_walker_invalidate().
+ *
+ * DANGER: The kernel updates page tables of other processes (and ours,
+ *         on eviction) without telling us; call pt_walker_invalidate()
+ *         before triage that must not see stale translations.
+ * DANGER: Requires root for debugfs amdgpu_vram / amdgpu_iomem.
+ */
+
+#define PT_BLOCK_BYTES        4096
+#define PT_BLOCK_ENTRIES      (PT_BLOCK_BYTES / 8)
+#define PT_CACHE_BLOCKS       1024          // 4 MiB of cached table blocks
+#define PT_MAX_VMIDS          16
+
+/**
+ * PDE / PTE bits (gfx10+ layout).
+ */
+#define PT_PTE_VALID          (1ull << 0)
+#define PT_PTE_SYSTEM         (1ull << 1)
+#define PT_PTE_SNOOPED        (1ull << 2)
+#define PT_PTE_TMZ            (1ull << 3)
+#define PT_PTE_EXECUTABLE     (1ull << 4)
+#define PT_PTE_READABLE       (1ull << 5)
+#define PT_PTE_WRITEABLE      (1ull << 6)
+#define PT_PTE_FRAG_SHIFT     7
+#define PT_PTE_FRAG_MASK      (0x1Full << PT_PTE_FRAG_SHIFT)
+#define PT_PDE_PTE            (1ull << 54)  // PDE maps a page itself
+#define PT_PTE_TF             (1ull << 56)  // Translate further (PTE used as PDE)
+#define PT_PDE_ADDR_MASK      0x0000FFFFFFFFFFC0ull
+#define PT_PTE_ADDR_MASK      0x0000FFFFFFFFF000ull
+
+/**
+ * pt_xlate_t: One translation.
+ */
+typedef struct {
+    int32_t   status;      // 0, -EFAULT (not mapped), -ENOENT (VMID disabled)
+    uint32_t  page_shift;  // 12 for 4 KiB pages, 21 for 2 MiB PDE pages
+    uint64_t  pa;          // VRAM offset or system (DMA) address
+    uint64_t  entry;       // Leaf PTE / PDE (flags)
+} pt_xlate_t;
+
+static inline bool pt_xlate_system(const pt_xlate_t* x) {
+    return (x->entry & PT_PTE_SYSTEM) != 0;
+}
+
+/**
+ * pt_vmid_t: Cached per-VMID table registers.
+ */
+typedef struct {
+    uint64_t  generation;  // Walker generation it was read at (0 = never)
+    bool      enabled;
+    uint32_t  depth;       // PDB levels above the PTB
+    uint32_t  block_size;  // Extra PTB index bits
+    uint64_t  root;        // PAGE_TABLE_BASE_ADDR (a PDE)
+    uint64_t  start_page;  // First / last mapped 4 KiB page
+    uint64_t  end_page;
+} pt_vmid_t;
+
+/**
+ * pt_block_t: Cached 4 KiB block of table entries.
+ */
+typedef struct {
+    uint64_t  key;         // Block address | PT_PTE_SYSTEM for system memory
+    uint64_t  generation;
+    uint64_t  entries[PT_BLOCK_ENTRIES];
+} pt_block_t;
+
+/**
+ * pt_walker_t: Walker state.
+ */
+typedef struct {
+    amdgpu_t*    dev;
+    int          vram_fd;        // debugfs amdgpu_vram (-1 if unavailable)
+    int          iomem_fd;       // debugfs amdgpu_iomem (-1 if unavailable)
+    uint64_t     fb_offset;      // VRAM base in PDE addresses (FB_OFFSET << 24)
+    uint64_t     generation;     // Current cache generation
+    uint64_t     vm_generation;  // dev->vm_generation at the last lookup
+    pt_vmid_t    vmids[PT_MAX_VMIDS];
+    pt_block_t*  blocks;         // PT_CACHE_BLOCKS, direct-mapped
+    uint64_t     hits;           // Statistics
+    uint64_t     misses;
+    uint64_t     bytes_read;
+} pt_walker_t;
+
+/**
+ * Open the debugfs memory files and read the framebuffer offset.
+ *
+ * @param dev: Device context (register database resolved)
+ * @param w: Output walker
+ * @return: 0 on success, -ENODEV without regs2 or amdgpu_vram, negative
+ *          error code on failure
+ */
+int32_t pt_walker_init(amdgpu_t* dev, pt_walker_t* w);
+
+/**
+ * Close the walker.
+ *
+ * @param w: Walker (safe to call on a zeroed walker)
+ */
+void pt_walker_fini(pt_walker_t* w);
+
+/**
+ * Drop every cached block and VMID register.
+ */
+static inline void pt_walker_invalidate(pt_walker_t* w) {
+    w->generation++;
+}
+
+/**
+ * Translate a batch of VAs of one VMID.
+ *
+ * @param w: Walker
+ * @param vmid: VMID (0-15)
+ * @param vas: Virtual addresses
+ * @param count: Number of addresses
+ * @param out: count results; per-address failures are in out[i].status
+ * @return: 0 on success, negative error code if table memory could not
+ *          be read
+ */
+int32_t pt_translate(pt_walker_t* w, uint32_t vmid, const uint64_t* vas,
+                     size_t count, pt_xlate_t* out);
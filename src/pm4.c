@@ -1,17 +1,149 @@
 #include "pm4.h"
 
+/**
+ * Header bits other than type, count and opcode (predicate, shader type).
+ */
+#define PKT3_FLAGS_G(header)            ((header) & ~PKT3(0xFF, 0x3FFF, 0))
+
+/**
+ * Max registers gathered per run by pkt3_coalesce_sh_regs().
+ */
+#define SH_COALESCE_MAX_WRITES          64
+
 void pkt3_set_sh_reg(pkt3_packets_t* packets, uint32_t reg, uint32_t value) {
-    HDB_ASSERT(reg >= SI_SH_REG_OFFSET && reg < SI_SH_REG_END,
+    pkt3_set_sh_regs(packets, reg, &value, 1);
+}
+
+void pkt3_set_sh_regs(pkt3_packets_t* packets, uint32_t reg,
+                      const uint32_t* values, uint32_t count) {
+    HDB_ASSERT(count >= 1 && count < 0x3FFF, "invalid SET_SH_REG register count");
+    HDB_ASSERT(reg >= SI_SH_REG_OFFSET && reg + (count - 1) * 4 < SI_SH_REG_END,
                "register offset outside SH register range");
 
-    // PKT3_SET_SH_REG header (1 dword following)
-    da_append(packets, PKT3(PKT3_SET_SH_REG, 1, 0));
+    pkt3_reserve(packets, 2 + count);
+
+    // PKT3_SET_SH_REG header (offset + count values following)
+    pkt3_emit(packets, PKT3(PKT3_SET_SH_REG, count, 0));
     
     // Register offset (dword offset relative to SI_SH_REG_OFFSET)
-    da_append(packets, (reg - SI_SH_REG_OFFSET) / 4);
+    pkt3_emit(packets, (reg - SI_SH_REG_OFFSET) / 4);
     
-    // Register value
-    da_append(packets, value);
+    // Register values
+    pkt3_emit_n(packets, values, count);
+}
+
+typedef struct {
+    uint32_t reg_dw;  // Dword offset relative to SI_SH_REG_OFFSET
+    uint32_t value;
+    uint32_t order;   // Position in the run (later wins)
+} sh_write_t;
+
+/**
+ * Sort a run by register, then by order; runs are short.
+ */
+static void sh_writes_sort(sh_write_t* w, uint32_t n) {
+    for_range(i, 1, n) {
+        sh_write_t key = w[i];
+        uint32_t j = i;
+        while (j > 0 && (w[j - 1].reg_dw > key.reg_dw ||
+                         (w[j - 1].reg_dw == key.reg_dw && w[j - 1].order > key.order))) {
+            w[j] = w[j - 1];
+            j--;
+        }
+        w[j] = key;
+    }
+}
+
+/**
+ * Emit a sorted run as packets at out; returns dwords written.
+ */
+static size_t sh_writes_emit(uint32_t* out, uint32_t header_flags,
+                             sh_write_t* w, uint32_t n) {
+    size_t pos = 0;
+    uint32_t i = 0;
+
+    while (i < n) {
+        size_t header_at = pos;
+        uint32_t start = w[i].reg_dw;
+        uint32_t regs = 0;
+
+        out[pos++] = 0;
+        out[pos++] = start;
+        while (i < n && w[i].reg_dw <= start + regs) {
+            // Duplicates sort by order: the last write overwrites in place
+            if (w[i].reg_dw == start + regs) {
+                out[pos++] = w[i].value;
+                regs++;
+            } else {
+                out[pos - 1] = w[i].value;
+            }
+            i++;
+        }
+        out[header_at] = header_flags | PKT3(PKT3_SET_SH_REG, regs, 0);
+    }
+    return pos;
+}
+
+size_t pkt3_coalesce_sh_regs(pkt3_packets_t* packets) {
+    uint32_t* data = packets->data;
+    size_t count = packets->count;
+    size_t r = 0;
+    size_t w = 0;
+
+    sh_write_t run[SH_COALESCE_MAX_WRITES];
+
+    while (r < count) {
+        uint32_t header = data[r];
+        size_t len = 1 + PKT3_COUNT_G(header) + 1;
+        HDB_ASSERT(r + len <= count, "truncated PM4 packet");
+
+        if (PKT3_OPCODE_G(header) != PKT3_SET_SH_REG) {
+            memmove(&data[w], &data[r], len * sizeof(*data));
+            w += len;
+            r += len;
+            continue;
+        }
+
+        // Gather back-to-back SET_SH_REG packets with the same header flags.
+        // The whole run is read before any of it is rewritten, and the
+        // rewrite is never longer, so w never passes r.
+        uint32_t flags = PKT3_FLAGS_G(header);
+        uint32_t n = 0;
+        while (r < count && PKT3_OPCODE_G(data[r]) == PKT3_SET_SH_REG &&
+               PKT3_FLAGS_G(data[r]) == flags) {
+            uint32_t regs = PKT3_COUNT_G(data[r]);
+            HDB_ASSERT(r + 2 + regs <= count, "truncated SET_SH_REG packet");
+            if (n + regs > SH_COALESCE_MAX_WRITES) {
+                break;
+            }
+
+            uint32_t start = data[r + 1];
+            for_range(i, 0, regs) {
+                run[n] = (sh_write_t){
+                    .reg_dw = start + i,
+                    .value = data[r + 2 + i],
+                    .order = n,
+                };
+                n++;
+            }
+            r += 2 + regs;
+        }
+
+        if (n == 0) {
+            // Single packet larger than the run buffer: keep it as is
+            size_t big = 2 + PKT3_COUNT_G(data[r]);
+            memmove(&data[w], &data[r], big * sizeof(*data));
+            w += big;
+            r += big;
+            continue;
+        }
+
+        sh_writes_sort(run, n);
+        w += sh_writes_emit(&data[w], flags, run, n);
+    }
+
+    packets->count = w;
+    return count - w;
 }
 
 void pkt3_dispatch_direct(pkt3_packets_t* packets,
@@ -19,25 +151,29 @@ void pkt3_dispatch_direct(pkt3_packets_t* packets,
                           uint32_t dim_y,
                           uint32_t dim_z,
                           uint32_t dispatch_initiator) {
+    pkt3_reserve(packets, 5);
+
     // PKT3_DISPATCH_DIRECT header (3 dwords following)
     // Set shader type to compute (1)
-    da_append(packets, PKT3(PKT3_DISPATCH_DIRECT, 3, 0) | PKT3_SHADER_TYPE_S(1));
+    pkt3_emit(packets, PKT3(PKT3_DISPATCH_DIRECT, 3, 0) | PKT3_SHADER_TYPE_S(1));
     
     // Workgroup dimensions
-    da_append(packets, dim_x);
-    da_append(packets, dim_y);
-    da_append(packets, dim_z);
+    pkt3_emit(packets, dim_x);
+    pkt3_emit(packets, dim_y);
+    pkt3_emit(packets, dim_z);
     
     // Dispatch initiator
-    da_append(packets, dispatch_initiator);
+    pkt3_emit(packets, dispatch_initiator);
 }
 
 void pkt3_acquire_mem(pkt3_packets_t* packets) {
     // PKT3_ACQUIRE_MEM: Memory barrier and cache flush
     // This ensures previous writes are visible to shader
     
+    pkt3_reserve(packets, 7);
+
     // Header (5 dwords following for full barrier)
-    da_append(packets, PKT3(PKT3_ACQUIRE_MEM, 5, 0));
+    pkt3_emit(packets, PKT3(PKT3_ACQUIRE_MEM, 5, 0));
     
     // CP coher cntl: Invalidate L1, L2, flush L2
     uint32_t cp_coher_cntl = 
@@ -45,56 +181,94 @@ void pkt3_acquire_mem(pkt3_packets_t* packets) {
         (1 << 1) |  // SH_KCACHE_ACTION_ENA
         (1 << 3) |  // TC_ACTION_ENA
         (1 << 4);   // TCL1_ACTION_ENA
-    da_append(packets, cp_coher_cntl);
+    pkt3_emit(packets, cp_coher_cntl);
     
     // CP coher size (entire range)
-    da_append(packets, 0xFFFFFFFF);
+    pkt3_emit(packets, 0xFFFFFFFF);
     
     // CP coher size HI
-    da_append(packets, 0xFF);
+    pkt3_emit(packets, 0xFF);
     
     // CP coher base LO
-    da_append(packets, 0);
+    pkt3_emit(packets, 0);
     
     // CP coher base HI
-    da_append(packets, 0);
+    pkt3_emit(packets, 0);
     
     // Poll interval (unused)
-    da_append(packets, 0);
+    pkt3_emit(packets, 0);
 }
 
 void pkt3_release_mem(pkt3_packets_t* packets, uint64_t va, uint32_t fence_value) {
     // PKT3_RELEASE_MEM: Write fence value after shader completes
     // This provides CPU-GPU synchronization
     
+    pkt3_reserve(packets, 8);
+
     // Header (6 dwords following)
-    da_append(packets, PKT3(PKT3_RELEASE_MEM, 6, 0));
+    pkt3_emit(packets, PKT3(PKT3_RELEASE_MEM, 6, 0));
     
     // Event type and flags
     // EVENT_TYPE=CACHE_FLUSH_AND_INV_EVENT, EVENT_INDEX=0x5
     uint32_t event_cntl = 
         (0x5 << 0) |   // EVENT_INDEX
         (0x2E << 8);   // EVENT_TYPE (CS_DONE or similar)
-    da_append(packets, event_cntl);
+    pkt3_emit(packets, event_cntl);
     
     // Data selection: Send 32-bit fence value
     uint32_t data_sel = 1; // SEL_32_BIT
-    da_append(packets, data_sel);
+    pkt3_emit(packets, data_sel);
     
     // Address LO
-    da_append(packets, (uint32_t)(va & 0xFFFFFFFF));
+    pkt3_emit(packets, (uint32_t)(va & 0xFFFFFFFF));
     
     // Address HI
-    da_append(packets, (uint32_t)(va >> 32));
+    pkt3_emit(packets, (uint32_t)(va >> 32));
     
     // Data LO (fence value)
-    da_append(packets, fence_value);
+    pkt3_emit(packets, fence_value);
     
     // Data HI
-    da_append(packets, 0);
+    pkt3_emit(packets, 0);
     
     // INT_SEL (no interrupt)
-    da_append(packets, 0);
+    pkt3_emit(packets, 0);
+}
+
+void pkt3_dma_fill(pkt3_packets_t* packets, uint64_t va, uint32_t value,
+                   uint64_t size) {
+    HDB_ASSERT((va & 0x3) == 0, "CP DMA fill address must be 4-byte aligned");
+    HDB_ASSERT((size & 0x3) == 0, "CP DMA fill size must be a multiple of 4");
+
+    while (size > 0) {
+        uint32_t bytes = (uint32_t)MIN(size, (uint64_t)CP_DMA_MAX_BYTE_COUNT);
+        bool last = bytes == size;
+
+        pkt3_reserve(packets, 7);
+
+        // Header (5 dwords following)
+        pkt3_emit(packets, PKT3(PKT3_DMA_DATA, 5, 0));
+
+        // Control: source is the immediate DATA dword, destination is memory
+        pkt3_emit(packets, DMA_DATA_ENGINE_ME |
+                           DMA_DATA_DST_SEL_DST_ADDR |
+                           DMA_DATA_SRC_SEL_DATA |
+                           (last ? DMA_DATA_CP_SYNC : 0));
+
+        // Fill value (SRC_SEL=DATA) / unused source high dword
+        pkt3_emit(packets, value);
+        pkt3_emit(packets, 0);
+
+        // Destination address
+        pkt3_emit(packets, (uint32_t)(va & 0xFFFFFFFF));
+        pkt3_emit(packets, (uint32_t)(va >> 32));
+
+        // Command: byte count, wait for prior writes
+        pkt3_emit(packets, DMA_DATA_BYTE_COUNT(bytes) | DMA_DATA_RAW_WAIT);
+
+        va += bytes;
+        size -= bytes;
+    }
 }
 
 void build_compute_dispatch(pkt3_packets_t* packets,
@@ -113,23 +287,24 @@ void build_compute_dispatch(pkt3_packets_t* packets,
     // Memory barrier before shader execution
     pkt3_acquire_mem(packets);
 
+    // Contiguous register runs go out as one SET_SH_REG packet each
+
+    // Set workgroup thread dimensions (threads per group)
+    uint32_t num_threads[3] = { threads_x, threads_y, threads_z };
+    pkt3_set_sh_regs(packets, R_00B81C_COMPUTE_NUM_THREAD_X, num_threads, 3);
+
     // Set shader program address (low/high)
-    uint32_t pgm_lo = (uint32_t)(code_va >> 8);  // Bits [39:8]
-    uint32_t pgm_hi = (uint32_t)(code_va >> 40); // Bits [47:40]
-    
-    pkt3_set_sh_reg(packets, R_00B830_COMPUTE_PGM_LO, pgm_lo);
-    pkt3_set_sh_reg(packets, R_00B834_COMPUTE_PGM_HI, pgm_hi);
+    uint32_t pgm[2] = {
+        (uint32_t)(code_va >> 8),   // Bits [39:8]
+        (uint32_t)(code_va >> 40),  // Bits [47:40]
+    };
+    pkt3_set_sh_regs(packets, R_00B830_COMPUTE_PGM_LO, pgm, 2);
 
     // Set resource configuration
-    pkt3_set_sh_reg(packets, R_00B848_COMPUTE_PGM_RSRC1, rsrc1);
-    pkt3_set_sh_reg(packets, R_00B84C_COMPUTE_PGM_RSRC2, rsrc2);
+    uint32_t rsrc[2] = { rsrc1, rsrc2 };
+    pkt3_set_sh_regs(packets, R_00B848_COMPUTE_PGM_RSRC1, rsrc, 2);
     pkt3_set_sh_reg(packets, R_00B8A0_COMPUTE_PGM_RSRC3, rsrc3);
 
-    // Set workgroup thread dimensions (threads per group)
-    pkt3_set_sh_reg(packets, R_00B81C_COMPUTE_NUM_THREAD_X, threads_x);
-    pkt3_set_sh_reg(packets, R_00B820_COMPUTE_NUM_THREAD_Y, threads_y);
-    pkt3_set_sh_reg(packets, R_00B824_COMPUTE_NUM_THREAD_Z, threads_z);
-
     // Dispatch initiator: enable compute shader, force start at 000
     uint32_t dispatch_initiator = 
         COMPUTE_DISPATCH_INITIATOR_COMPUTE_SHADER_EN |
@@ -138,3 +313,78 @@ void build_compute_dispatch(pkt3_packets_t* packets,
     // Issue dispatch
     pkt3_dispatch_direct(packets, groups_x, groups_y, groups_z, dispatch_initiator);
 }
+
+int32_t pkt3_find_sh_reg(const uint32_t* data, size_t count, uint32_t reg) {
+    uint32_t reg_dw = (reg - SI_SH_REG_OFFSET) / 4;
+    size_t i = 0;
+
+    while (i < count) {
+        uint32_t header = data[i];
+        uint32_t body = PKT3_COUNT_G(header) + 1;
+
+        if (PKT3_OPCODE_G(header) == PKT3_SET_SH_REG && i + body < count) {
+            // Body: start offset, then body - 1 consecutive values
+            uint32_t start = data[i + 1];
+            if (reg_dw >= start && reg_dw < start + body - 1) {
+                return (int32_t)(i + 2 + (reg_dw - start));
+            }
+        }
+        i += 1 + body;
+    }
+    return -1;
+}
+
+void pm4_template_record_dispatch(pm4_template_t* tmpl, bool with_fence) {
+    *tmpl = (pm4_template_t){0};
+
+    // Record straight into the template; a spill to the heap means it overflowed
+    pkt3_packets_t packets;
+    pkt3_init_external(&packets, tmpl->dwords, PM4_TEMPLATE_MAX_DWORDS);
+
+    build_compute_dispatch(&packets, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    size_t dispatch_at = packets.count - 5;  // DISPATCH_DIRECT closes the stream
+
+    size_t fence_at = 0;
+    if (with_fence) {
+        fence_at = packets.count;
+        pkt3_release_mem(&packets, 0, 0);
+    }
+
+    HDB_ASSERT(packets.data == tmpl->dwords, "PM4 template too large");
+    tmpl->count = (uint32_t)packets.count;
+
+    static const struct {
+        pm4_field_t field;
+        uint32_t reg;
+    } sh_fields[] = {
+        { PM4_FIELD_PGM_LO,    R_00B830_COMPUTE_PGM_LO },
+        { PM4_FIELD_PGM_HI,    R_00B834_COMPUTE_PGM_HI },
+        { PM4_FIELD_RSRC1,     R_00B848_COMPUTE_PGM_RSRC1 },
+        { PM4_FIELD_RSRC2,     R_00B84C_COMPUTE_PGM_RSRC2 },
+        { PM4_FIELD_RSRC3,     R_00B8A0_COMPUTE_PGM_RSRC3 },
+        { PM4_FIELD_THREADS_X, R_00B81C_COMPUTE_NUM_THREAD_X },
+        { PM4_FIELD_THREADS_Y, R_00B820_COMPUTE_NUM_THREAD_Y },
+        { PM4_FIELD_THREADS_Z, R_00B824_COMPUTE_NUM_THREAD_Z },
+    };
+
+    for_range(i, 0, PM4_FIELD_COUNT) {
+        tmpl->offsets[i] = PM4_TEMPLATE_NO_FIELD;
+    }
+    for_range(i, 0, ARRAY_SIZE(sh_fields)) {
+        int32_t at = pkt3_find_sh_reg(tmpl->dwords, tmpl->count, sh_fields[i].reg);
+        HDB_ASSERT(at >= 0, "dispatch register missing from PM4 template");
+        tmpl->offsets[sh_fields[i].field] = (uint16_t)at;
+    }
+
+    // DISPATCH_DIRECT: header, dim_x, dim_y, dim_z, initiator
+    tmpl->offsets[PM4_FIELD_GROUPS_X] = (uint16_t)(dispatch_at + 1);
+    tmpl->offsets[PM4_FIELD_GROUPS_Y] = (uint16_t)(dispatch_at + 2);
+    tmpl->offsets[PM4_FIELD_GROUPS_Z] = (uint16_t)(dispatch_at + 3);
+
+    // RELEASE_MEM: header, event, data_sel, addr_lo, addr_hi, data_lo, ...
+    if (with_fence) {
+        tmpl->offsets[PM4_FIELD_FENCE_ADDR_LO] = (uint16_t)(fence_at + 3);
+        tmpl->offsets[PM4_FIELD_FENCE_ADDR_HI] = (uint16_t)(fence_at + 4);
+        tmpl->offsets[PM4_FIELD_FENCE_VALUE] = (uint16_t)(fence_at + 5);
+    }
+}
@@ -22,7 +22,13 @@
  * @return: PKT3 header dword
  */
 #define PKT3(op, count, predicate) \
-    ((3 << 30) | (((op) & 0xFF) << 8) | ((count) & 0x3FFF) | ((predicate) << 31))
+    ((3u << 30) | (((count) & 0x3FFF) << 16) | (((op) & 0xFF) << 8) | ((predicate) & 0x1))
+
+/**
+ * PKT3 header fields.
+ */
+#define PKT3_COUNT_G(header)            (((header) >> 16) & 0x3FFF)
+#define PKT3_OPCODE_G(header)           (((header) >> 8) & 0xFF)
 
 /**
  * PKT3 with shader type selection.
@@ -51,16 +57,18 @@
 #define PKT3_LOAD_CONTEXT_REG           0x31
 #define PKT3_WAIT_REG_MEM               0x3C
 #define PKT3_RELEASE_MEM                0x49
+#define PKT3_DMA_DATA                   0x50
 
 /**
- * Register offset ranges for SET_*_REG packets.
+ * Register offset ranges for SET_*_REG packets (byte offsets, like the
+ * R_* register definitions below).
  */
-#define SI_SH_REG_OFFSET                0x2C00
-#define SI_SH_REG_END                   0x3000
-#define SI_CONTEXT_REG_OFFSET           0xA000
-#define SI_CONTEXT_REG_END              0xB000
-#define SI_UCONFIG_REG_OFFSET           0xC000
-#define SI_UCONFIG_REG_END              0xD000
+#define SI_SH_REG_OFFSET                0xB000
+#define SI_SH_REG_END                   0xC000
+#define SI_CONTEXT_REG_OFFSET           0x28000
+#define SI_CONTEXT_REG_END              0x29000
+#define SI_UCONFIG_REG_OFFSET           0x30000
+#define SI_UCONFIG_REG_END              0x40000
 
 /**
  * Compute shader register offsets (for SET_SH_REG).
@@ -84,6 +92,21 @@
 #define COMPUTE_DISPATCH_INITIATOR_COMPUTE_SHADER_EN (1 << 0)
 #define COMPUTE_DISPATCH_INITIATOR_FORCE_START_AT_000 (1 << 1)
 
+/**
+ * PKT3_DMA_DATA control / command fields (CP DMA).
+ */
+#define DMA_DATA_ENGINE_ME              (0 << 0)
+#define DMA_DATA_DST_SEL_DST_ADDR       (0 << 20)
+#define DMA_DATA_SRC_SEL_DATA           (2u << 29)
+#define DMA_DATA_CP_SYNC                (1u << 31)
+#define DMA_DATA_BYTE_COUNT(x)          ((x) & 0x3FFFFFF)
+#define DMA_DATA_RAW_WAIT               (1 << 30)
+
+/**
+ * Largest byte count emitted per CP DMA packet (matches Mesa's limit).
+ */
+#define CP_DMA_MAX_BYTE_COUNT           ((1u << 21) - 8)
+
 /**
  * Append PKT3_SET_SH_REG packet.
  * 
@@ -98,6 +121,33 @@
  */
 void pkt3_set_sh_reg(pkt3_packets_t* packets, uint32_t reg, uint32_t value);
 
+/**
+ * Append one PKT3_SET_SH_REG packet writing consecutive registers.
+ * 
+ * @param packets: Packet array to append to
+ * @param reg: First register offset
+ * @param values: Values for reg, reg + 4, reg + 8, ...
+ * @param count: Number of registers (>= 1)
+ * 
+ * DANGER: Every register in the range is written; only use it for runs
+ *         that are really contiguous.
+ */
+void pkt3_set_sh_regs(pkt3_packets_t* packets, uint32_t reg,
+                      const uint32_t* values, uint32_t count);
+
+/**
+ * Merge SET_SH_REG packets in a stream.
+ * 
+ * Every run of back-to-back SET_SH_REG packets (no other packet in
+ * between) is rewritten as the fewest packets covering its registers:
+ * writes are sorted by register, repeated writes keep the last value, and
+ * consecutive registers share one packet. Packets are rewritten in place.
+ * 
+ * @param packets: Packet array
+ * @return: Number of dwords removed
+ */
+size_t pkt3_coalesce_sh_regs(pkt3_packets_t* packets);
+
 /**
  * Append PKT3_DISPATCH_DIRECT packet.
  * 
@@ -142,6 +192,23 @@ void pkt3_acquire_mem(pkt3_packets_t* packets);
  */
 void pkt3_release_mem(pkt3_packets_t* packets, uint64_t va, uint32_t fence_value);
 
+/**
+ * Append PKT3_DMA_DATA packets filling GPU memory with a 32-bit value.
+ * 
+ * Uses the CP DMA engine of the queue the packets are submitted to,
+ * split into CP_DMA_MAX_BYTE_COUNT chunks. The last chunk sets CP_SYNC
+ * so the fill completes before the submission's fence signals.
+ * 
+ * @param packets: Packet array to append to
+ * @param va: GPU virtual address to fill (4-byte aligned)
+ * @param value: Fill pattern
+ * @param size: Number of bytes (multiple of 4)
+ * 
+ * DANGER: va..va+size must be mapped writable in the submitting context.
+ */
+void pkt3_dma_fill(pkt3_packets_t* packets, uint64_t va, uint32_t value,
+                   uint64_t size);
+
 /**
  * Helper: Build compute shader dispatch command buffer.
  * 
@@ -174,3 +241,144 @@ void build_compute_dispatch(pkt3_packets_t* packets,
                             uint32_t groups_x,
                             uint32_t groups_y,
                             uint32_t groups_z);
+
+/**
+ * Patchable dispatch template.
+ * 
+ * A dispatch stream (acquire, shader registers, dispatch, optional fence)
+ * is recorded once into a fixed buffer together with the dword offset of
+ * every field that changes between submissions. Resubmitting then costs a
+ * few stores instead of rebuilding the stream packet by packet; the
+ * single-step loop resubmits near-identical dispatches.
+ * 
+ * Submit with pm4_template_packets(), which views the template as a
+ * pkt3_packets_t without copying.
+ */
+#define PM4_TEMPLATE_MAX_DWORDS         128
+#define PM4_TEMPLATE_NO_FIELD           0xFFFF
+
+/**
+ * Patchable fields of a dispatch template.
+ */
+typedef enum {
+    PM4_FIELD_PGM_LO = 0,
+    PM4_FIELD_PGM_HI,
+    PM4_FIELD_RSRC1,
+    PM4_FIELD_RSRC2,
+    PM4_FIELD_RSRC3,
+    PM4_FIELD_THREADS_X,
+    PM4_FIELD_THREADS_Y,
+    PM4_FIELD_THREADS_Z,
+    PM4_FIELD_GROUPS_X,
+    PM4_FIELD_GROUPS_Y,
+    PM4_FIELD_GROUPS_Z,
+    PM4_FIELD_FENCE_ADDR_LO,
+    PM4_FIELD_FENCE_ADDR_HI,
+    PM4_FIELD_FENCE_VALUE,
+    PM4_FIELD_COUNT,
+} pm4_field_t;
+
+/**
+ * pm4_template_t: Recorded stream plus field offsets.
+ */
+typedef struct {
+    uint32_t dwords[PM4_TEMPLATE_MAX_DWORDS];   // Packet stream
+    uint32_t count;                             // Dwords in use
+    uint16_t offsets[PM4_FIELD_COUNT];          // Dword index per field
+                                                // (PM4_TEMPLATE_NO_FIELD if absent)
+} pm4_template_t;
+
+/**
+ * Record a compute dispatch template.
+ * 
+ * Builds the same stream as build_compute_dispatch(), optionally followed
+ * by a PKT3_RELEASE_MEM fence write, with every field zero. Set the
+ * fields with the pm4_template_set_*() helpers before the first submit.
+ * 
+ * @param tmpl: Output template
+ * @param with_fence: Append a patchable RELEASE_MEM fence write
+ */
+void pm4_template_record_dispatch(pm4_template_t* tmpl, bool with_fence);
+
+/**
+ * Find the dword holding a register's value in a SET_SH_REG stream.
+ * 
+ * @param data: Packet stream
+ * @param count: Dwords in the stream
+ * @param reg: Register offset (e.g., R_00B848_COMPUTE_PGM_RSRC1)
+ * @return: Dword index of the value, or -1 if the register is not set
+ * 
+ * Walks packet headers, so it also finds registers inside multi-register
+ * SET_SH_REG packets.
+ */
+int32_t pkt3_find_sh_reg(const uint32_t* data, size_t count, uint32_t reg);
+
+/**
+ * Patch one template field.
+ * 
+ * DANGER: The field must exist in the template (HDB_ASSERT).
+ */
+static inline void pm4_template_patch(pm4_template_t* tmpl, pm4_field_t field,
+                                      uint32_t value) {
+    HDB_ASSERT(tmpl->offsets[field] != PM4_TEMPLATE_NO_FIELD,
+               "field not present in PM4 template");
+    tmpl->dwords[tmpl->offsets[field]] = value;
+}
+
+/**
+ * Patch the shader address (256-byte aligned).
+ */
+static inline void pm4_template_set_code(pm4_template_t* tmpl, uint64_t code_va) {
+    HDB_ASSERT((code_va & 0xFF) == 0, "shader code address must be 256-byte aligned");
+    pm4_template_patch(tmpl, PM4_FIELD_PGM_LO, (uint32_t)(code_va >> 8));
+    pm4_template_patch(tmpl, PM4_FIELD_PGM_HI, (uint32_t)(code_va >> 40));
+}
+
+/**
+ * Patch COMPUTE_PGM_RSRC1/2/3.
+ */
+static inline void pm4_template_set_rsrc(pm4_template_t* tmpl, uint32_t rsrc1,
+                                         uint32_t rsrc2, uint32_t rsrc3) {
+    pm4_template_patch(tmpl, PM4_FIELD_RSRC1, rsrc1);
+    pm4_template_patch(tmpl, PM4_FIELD_RSRC2, rsrc2);
+    pm4_template_patch(tmpl, PM4_FIELD_RSRC3, rsrc3);
+}
+
+/**
+ * Patch the workgroup size and grid.
+ */
+static inline void pm4_template_set_grid(pm4_template_t* tmpl,
+                                         uint32_t threads_x, uint32_t threads_y,
+                                         uint32_t threads_z, uint32_t groups_x,
+                                         uint32_t groups_y, uint32_t groups_z) {
+    pm4_template_patch(tmpl, PM4_FIELD_THREADS_X, threads_x);
+    pm4_template_patch(tmpl, PM4_FIELD_THREADS_Y, threads_y);
+    pm4_template_patch(tmpl, PM4_FIELD_THREADS_Z, threads_z);
+    pm4_template_patch(tmpl, PM4_FIELD_GROUPS_X, groups_x);
+    pm4_template_patch(tmpl, PM4_FIELD_GROUPS_Y, groups_y);
+    pm4_template_patch(tmpl, PM4_FIELD_GROUPS_Z, groups_z);
+}
+
+/**
+ * Patch the fence write (template recorded with_fence).
+ */
+static inline void pm4_template_set_fence(pm4_template_t* tmpl, uint64_t va,
+                                          uint32_t value) {
+    pm4_template_patch(tmpl, PM4_FIELD_FENCE_ADDR_LO, (uint32_t)(va & 0xFFFFFFFF));
+    pm4_template_patch(tmpl, PM4_FIELD_FENCE_ADDR_HI, (uint32_t)(va >> 32));
+    pm4_template_patch(tmpl, PM4_FIELD_FENCE_VALUE, value);
+}
+
+/**
+ * View a template as a packet array for dev_submit().
+ * 
+ * DANGER: The view borrows tmpl->dwords; appending to it moves the stream
+ *         to the heap (pkt3_free() it then) and leaves the template as is.
+ */
+static inline pkt3_packets_t pm4_template_packets(pm4_template_t* tmpl) {
+    return (pkt3_packets_t){
+        .data = tmpl->dwords,
+        .count = tmpl->count,
+        .capacity = tmpl->count,
+    };
+}
@@ -0,0 +1,380 @@
+// Generated by scripts/gen-regdb.py from regdb/gc_11.txt. Do not edit;
+// change the source and run `make regdb`.
+#pragma once
+
+#define REGDB_GC11_MAX_SEGMENTS  6
+
+/**
+ * Registers: X(name, segment, offset, type, count, stride)
+ */
+#define REGDB_GC11_REGS(X) \
+    X(SQ_SHADER_TBA_LO, 0, 0x2E00, REG_MMIO, 1, 0) \
+    X(SQ_SHADER_TBA_HI, 0, 0x2E01, REG_MMIO, 1, 0) \
+    X(SQ_SHADER_TMA_LO, 0, 0x2E02, REG_MMIO, 1, 0) \
+    X(SQ_SHADER_TMA_HI, 0, 0x2E03, REG_MMIO, 1, 0) \
+    X(SQ_CMD, 0, 0x2D00, REG_MMIO, 1, 0) \
+    X(SQ_IND_INDEX, 0, 0x2D04, REG_MMIO, 1, 0) \
+    X(SQ_IND_DATA, 0, 0x2D05, REG_MMIO, 1, 0) \
+    X(SQ_WAVE_MODE, 0, 0x0101, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_STATUS, 0, 0x0102, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_TRAPSTS, 0, 0x0103, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_GPR_ALLOC, 0, 0x0105, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_LDS_ALLOC, 0, 0x0106, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_IB_STS, 0, 0x0107, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_PC_LO, 0, 0x0108, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_PC_HI, 0, 0x0109, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_INST_DW0, 0, 0x010A, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_HW_ID1, 0, 0x0117, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_HW_ID2, 0, 0x0118, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_IB_STS2, 0, 0x011C, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_M0, 0, 0x027C, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_EXEC_LO, 0, 0x027E, REG_INDIRECT, 1, 0) \
+    X(SQ_WAVE_EXEC_HI, 0, 0x027F, REG_INDIRECT, 1, 0) \
+    X(SPI_GDBG_WAVE_CNTL, 0, 0x1B20, REG_MMIO, 1, 0) \
+    X(SPI_GDBG_TRAP_CONFIG, 0, 0x1B21, REG_MMIO, 1, 0) \
+    X(SPI_GDBG_PER_VMID_CNTL, 0, 0x1B3C, REG_MMIO, 1, 0) \
+    X(GRBM_STATUS, 0, 0x0DA4, REG_MMIO, 1, 0) \
+    X(GRBM_STATUS2, 0, 0x0DA2, REG_MMIO, 1, 0) \
+    X(GRBM_GFX_INDEX, 1, 0x2200, REG_MMIO, 1, 0) \
+    X(GCVM_L2_PROTECTION_FAULT_STATUS, 0, 0x15E6, REG_MMIO, 1, 0) \
+    X(GCVM_L2_PROTECTION_FAULT_ADDR_LO32, 0, 0x15E7, REG_MMIO, 1, 0) \
+    X(GCVM_L2_PROTECTION_FAULT_ADDR_HI32, 0, 0x15E8, REG_MMIO, 1, 0) \
+    X(GCMC_VM_FB_OFFSET, 0, 0x15A7, REG_MMIO, 1, 0) \
+    X(GCVM_CONTEXT0_CNTL, 0, 0x1688, REG_MMIO, 16, 1) \
+    X(GCVM_CONTEXT0_PAGE_TABLE_BASE_ADDR_LO32, 0, 0x16F3, REG_MMIO, 16, 2) \
+    X(GCVM_CONTEXT0_PAGE_TABLE_BASE_ADDR_HI32, 0, 0x16F4, REG_MMIO, 16, 2) \
+    X(GCVM_CONTEXT0_PAGE_TABLE_START_ADDR_LO32, 0, 0x1713, REG_MMIO, 16, 2) \
+    X(GCVM_CONTEXT0_PAGE_TABLE_START_ADDR_HI32, 0, 0x1714, REG_MMIO, 16, 2) \
+    X(GCVM_CONTEXT0_PAGE_TABLE_END_ADDR_LO32, 0, 0x1733, REG_MMIO, 16, 2) \
+    X(GCVM_CONTEXT0_PAGE_TABLE_END_ADDR_HI32, 0, 0x1734, REG_MMIO, 16, 2) \
+
+
+/**
+ * Fields: X(reg, field, shift, width)
+ */
+#define REGDB_GC11_FIELDS(X) \
+    X(SQ_SHADER_TBA_LO, BASE_ADDR, 0, 32) \
+    X(SQ_SHADER_TBA_HI, BASE_ADDR, 0, 8) \
+    X(SQ_SHADER_TBA_HI, TRAP_EN, 31, 1) \
+    X(SQ_SHADER_TMA_LO, BASE_ADDR, 0, 32) \
+    X(SQ_SHADER_TMA_HI, BASE_ADDR, 0, 32) \
+    X(SQ_CMD, CMD, 0, 3) \
+    X(SQ_CMD, MODE, 4, 3) \
+    X(SQ_CMD, CHECK_VMID, 7, 1) \
+    X(SQ_CMD, DATA, 8, 4) \
+    X(SQ_CMD, WAVE_ID, 16, 5) \
+    X(SQ_CMD, QUEUE_ID, 24, 3) \
+    X(SQ_CMD, VM_ID, 28, 4) \
+    X(SQ_IND_INDEX, WAVE_ID, 0, 5) \
+    X(SQ_IND_INDEX, WORKITEM_ID, 5, 6) \
+    X(SQ_IND_INDEX, AUTO_INCR, 11, 1) \
+    X(SQ_IND_INDEX, INDEX, 16, 16) \
+    X(SQ_IND_DATA, DATA, 0, 32) \
+    X(SQ_WAVE_STATUS, SCC, 0, 1) \
+    X(SQ_WAVE_STATUS, PRIV, 5, 1) \
+    X(SQ_WAVE_STATUS, TRAP_EN, 6, 1) \
+    X(SQ_WAVE_STATUS, EXECZ, 9, 1) \
+    X(SQ_WAVE_STATUS, VCCZ, 10, 1) \
+    X(SQ_WAVE_STATUS, IN_TG, 11, 1) \
+    X(SQ_WAVE_STATUS, IN_BARRIER, 12, 1) \
+    X(SQ_WAVE_STATUS, HALT, 13, 1) \
+    X(SQ_WAVE_STATUS, TRAP, 14, 1) \
+    X(SQ_WAVE_STATUS, VALID, 16, 1) \
+    X(SQ_WAVE_STATUS, ECC_ERR, 17, 1) \
+    X(SQ_WAVE_STATUS, COND_DBG_USER, 20, 1) \
+    X(SQ_WAVE_STATUS, COND_DBG_SYS, 21, 1) \
+    X(SQ_WAVE_STATUS, FATAL_HALT, 23, 1) \
+    X(SQ_WAVE_TRAPSTS, EXCP, 0, 9) \
+    X(SQ_WAVE_TRAPSTS, ILLEGAL_INST, 11, 1) \
+    X(SQ_WAVE_TRAPSTS, EXCP_HI, 12, 3) \
+    X(SQ_WAVE_GPR_ALLOC, VGPR_BASE, 0, 9) \
+    X(SQ_WAVE_GPR_ALLOC, VGPR_SIZE, 12, 8) \
+    X(SQ_WAVE_LDS_ALLOC, LDS_BASE, 0, 9) \
+    X(SQ_WAVE_LDS_ALLOC, LDS_SIZE, 12, 9) \
+    X(SQ_WAVE_PC_HI, PC_HI, 0, 16) \
+    X(SQ_WAVE_HW_ID1, WAVE_ID, 0, 5) \
+    X(SQ_WAVE_HW_ID1, SIMD_ID, 8, 2) \
+    X(SQ_WAVE_HW_ID1, WGP_ID, 10, 4) \
+    X(SQ_WAVE_HW_ID1, SA_ID, 16, 1) \
+    X(SQ_WAVE_HW_ID1, SE_ID, 18, 3) \
+    X(SQ_WAVE_HW_ID1, DP_RATE, 29, 3) \
+    X(SQ_WAVE_HW_ID2, QUEUE_ID, 0, 4) \
+    X(SQ_WAVE_HW_ID2, PIPE_ID, 4, 2) \
+    X(SQ_WAVE_HW_ID2, ME_ID, 8, 2) \
+    X(SQ_WAVE_HW_ID2, STATE_ID, 12, 3) \
+    X(SQ_WAVE_HW_ID2, WG_ID, 16, 5) \
+    X(SQ_WAVE_HW_ID2, VM_ID, 24, 4) \
+    X(SPI_GDBG_WAVE_CNTL, STALL_RA, 0, 1) \
+    X(SPI_GDBG_WAVE_CNTL, STALL_VMID, 1, 16) \
+    X(SPI_GDBG_TRAP_CONFIG, ME_SEL, 0, 2) \
+    X(SPI_GDBG_TRAP_CONFIG, PIPE_SEL, 2, 2) \
+    X(SPI_GDBG_TRAP_CONFIG, QUEUE_SEL, 4, 3) \
+    X(SPI_GDBG_TRAP_CONFIG, ME_MATCH, 7, 1) \
+    X(SPI_GDBG_TRAP_CONFIG, PIPE_MATCH, 8, 1) \
+    X(SPI_GDBG_TRAP_CONFIG, QUEUE_MATCH, 9, 1) \
+    X(SPI_GDBG_TRAP_CONFIG, TRAP_EN, 15, 1) \
+    X(SPI_GDBG_TRAP_CONFIG, VMID_SEL, 16, 16) \
+    X(SPI_GDBG_PER_VMID_CNTL, STALL_VMID, 0, 1) \
+    X(SPI_GDBG_PER_VMID_CNTL, LAUNCH_MODE, 1, 2) \
+    X(SPI_GDBG_PER_VMID_CNTL, TRAP_EN, 3, 1) \
+    X(SPI_GDBG_PER_VMID_CNTL, EXCP_EN, 4, 9) \
+    X(SPI_GDBG_PER_VMID_CNTL, EXCP_REPLACE, 13, 1) \
+    X(GRBM_STATUS, ME0PIPE0_CMDFIFO_AVAIL, 0, 4) \
+    X(GRBM_STATUS, RLC_BUSY, 8, 1) \
+    X(GRBM_STATUS, TC_BUSY, 9, 1) \
+    X(GRBM_STATUS, SPI_BUSY, 22, 1) \
+    X(GRBM_STATUS, CP_BUSY, 29, 1) \
+    X(GRBM_STATUS, CB_BUSY, 30, 1) \
+    X(GRBM_STATUS, GUI_ACTIVE, 31, 1) \
+    X(GRBM_STATUS2, RLC_RQ_PENDING, 0, 1) \
+    X(GRBM_STATUS2, CPF_RQ_PENDING, 4, 1) \
+    X(GRBM_STATUS2, CPC_BUSY, 28, 1) \
+    X(GRBM_STATUS2, CPF_BUSY, 29, 1) \
+    X(GRBM_STATUS2, CPG_BUSY, 30, 1) \
+    X(GRBM_GFX_INDEX, INSTANCE_INDEX, 0, 8) \
+    X(GRBM_GFX_INDEX, SA_INDEX, 8, 8) \
+    X(GRBM_GFX_INDEX, SE_INDEX, 16, 8) \
+    X(GRBM_GFX_INDEX, SA_BROADCAST_WRITES, 29, 1) \
+    X(GRBM_GFX_INDEX, INSTANCE_BROADCAST_WRITES, 30, 1) \
+    X(GRBM_GFX_INDEX, SE_BROADCAST_WRITES, 31, 1) \
+    X(GCVM_L2_PROTECTION_FAULT_STATUS, MORE_FAULTS, 0, 1) \
+    X(GCVM_L2_PROTECTION_FAULT_STATUS, WALKER_ERROR, 1, 3) \
+    X(GCVM_L2_PROTECTION_FAULT_STATUS, PERMISSION_FAULTS, 4, 4) \
+    X(GCVM_L2_PROTECTION_FAULT_STATUS, MAPPING_ERROR, 8, 1) \
+    X(GCVM_L2_PROTECTION_FAULT_STATUS, CID, 9, 9) \
+    X(GCVM_L2_PROTECTION_FAULT_STATUS, RW, 18, 1) \
+    X(GCVM_L2_PROTECTION_FAULT_STATUS, VMID, 20, 4) \
+    X(GCVM_L2_PROTECTION_FAULT_STATUS, VF, 24, 1) \
+    X(GCVM_L2_PROTECTION_FAULT_STATUS, VFID, 25, 4) \
+    X(GCVM_L2_PROTECTION_FAULT_ADDR_HI32, LOGICAL_PAGE_ADDR_HI4, 0, 4) \
+    X(GCMC_VM_FB_OFFSET, FB_OFFSET, 0, 24) \
+    X(GCVM_CONTEXT0_CNTL, ENABLE_CONTEXT, 0, 1) \
+    X(GCVM_CONTEXT0_CNTL, PAGE_TABLE_DEPTH, 1, 2) \
+    X(GCVM_CONTEXT0_CNTL, PAGE_TABLE_BLOCK_SIZE, 3, 4) \
+
+
+/**
+ * ASICs: X(name, gc_major, gc_minor, gc_rev, fallback segment bases...)
+ */
+#define REGDB_GC11_ASICS(X) \
+    X(gfx1100, 11, 0, 0, 0x00001260, 0x0000A000, 0x0001C000, 0x02402C00, 0x00000000, 0x00000000) \
+    X(gfx1101, 11, 0, 3, 0x00001260, 0x0000A000, 0x0001C000, 0x02402C00, 0x00000000, 0x00000000) \
+    X(gfx1102, 11, 0, 2, 0x00001260, 0x0000A000, 0x0001C000, 0x02402C00, 0x00000000, 0x00000000) \
+    X(gfx1103, 11, 0, 1, 0x00001260, 0x0000A000, 0x0001C000, 0x02402C00, 0x00000000, 0x00000000) \
+
+
+/**
+ * PCI device IDs: X(device_id, asic)
+ */
+#define REGDB_GC11_DEVICES(X) \
+    X(0x744C, gfx1100) \
+    X(0x7448, gfx1100) \
+    X(0x745E, gfx1100) \
+    X(0x747E, gfx1101) \
+    X(0x7470, gfx1101) \
+    X(0x7480, gfx1102) \
+    X(0x7483, gfx1102) \
+    X(0x7489, gfx1102) \
+    X(0x15BF, gfx1103) \
+    X(0x15C8, gfx1103) \
+
+
+/**
+ * Field shifts and masks (<REG>__<FIELD>__SHIFT, <REG>__<FIELD>_MASK).
+ */
+#define SQ_SHADER_TBA_LO__BASE_ADDR__SHIFT  0
+#define SQ_SHADER_TBA_LO__BASE_ADDR_MASK    0xFFFFFFFFu
+#define SQ_SHADER_TBA_HI__BASE_ADDR__SHIFT  0
+#define SQ_SHADER_TBA_HI__BASE_ADDR_MASK    0x000000FFu
+#define SQ_SHADER_TBA_HI__TRAP_EN__SHIFT  31
+#define SQ_SHADER_TBA_HI__TRAP_EN_MASK    0x80000000u
+#define SQ_SHADER_TMA_LO__BASE_ADDR__SHIFT  0
+#define SQ_SHADER_TMA_LO__BASE_ADDR_MASK    0xFFFFFFFFu
+#define SQ_SHADER_TMA_HI__BASE_ADDR__SHIFT  0
+#define SQ_SHADER_TMA_HI__BASE_ADDR_MASK    0xFFFFFFFFu
+#define SQ_CMD__CMD__SHIFT  0
+#define SQ_CMD__CMD_MASK    0x00000007u
+#define SQ_CMD__MODE__SHIFT  4
+#define SQ_CMD__MODE_MASK    0x00000070u
+#define SQ_CMD__CHECK_VMID__SHIFT  7
+#define SQ_CMD__CHECK_VMID_MASK    0x00000080u
+#define SQ_CMD__DATA__SHIFT  8
+#define SQ_CMD__DATA_MASK    0x00000F00u
+#define SQ_CMD__WAVE_ID__SHIFT  16
+#define SQ_CMD__WAVE_ID_MASK    0x001F0000u
+#define SQ_CMD__QUEUE_ID__SHIFT  24
+#define SQ_CMD__QUEUE_ID_MASK    0x07000000u
+#define SQ_CMD__VM_ID__SHIFT  28
+#define SQ_CMD__VM_ID_MASK    0xF0000000u
+#define SQ_IND_INDEX__WAVE_ID__SHIFT  0
+#define SQ_IND_INDEX__WAVE_ID_MASK    0x0000001Fu
+#define SQ_IND_INDEX__WORKITEM_ID__SHIFT  5
+#define SQ_IND_INDEX__WORKITEM_ID_MASK    0x000007E0u
+#define SQ_IND_INDEX__AUTO_INCR__SHIFT  11
+#define SQ_IND_INDEX__AUTO_INCR_MASK    0x00000800u
+#define SQ_IND_INDEX__INDEX__SHIFT  16
+#define SQ_IND_INDEX__INDEX_MASK    0xFFFF0000u
+#define SQ_IND_DATA__DATA__SHIFT  0
+#define SQ_IND_DATA__DATA_MASK    0xFFFFFFFFu
+#define SQ_WAVE_STATUS__SCC__SHIFT  0
+#define SQ_WAVE_STATUS__SCC_MASK    0x00000001u
+#define SQ_WAVE_STATUS__PRIV__SHIFT  5
+#define SQ_WAVE_STATUS__PRIV_MASK    0x00000020u
+#define SQ_WAVE_STATUS__TRAP_EN__SHIFT  6
+#define SQ_WAVE_STATUS__TRAP_EN_MASK    0x00000040u
+#define SQ_WAVE_STATUS__EXECZ__SHIFT  9
+#define SQ_WAVE_STATUS__EXECZ_MASK    0x00000200u
+#define SQ_WAVE_STATUS__VCCZ__SHIFT  10
+#define SQ_WAVE_STATUS__VCCZ_MASK    0x00000400u
+#define SQ_WAVE_STATUS__IN_TG__SHIFT  11
+#define SQ_WAVE_STATUS__IN_TG_MASK    0x00000800u
+#define SQ_WAVE_STATUS__IN_BARRIER__SHIFT  12
+#define SQ_WAVE_STATUS__IN_BARRIER_MASK    0x00001000u
+#define SQ_WAVE_STATUS__HALT__SHIFT  13
+#define SQ_WAVE_STATUS__HALT_MASK    0x00002000u
+#define SQ_WAVE_STATUS__TRAP__SHIFT  14
+#define SQ_WAVE_STATUS__TRAP_MASK    0x00004000u
+#define SQ_WAVE_STATUS__VALID__SHIFT  16
+#define SQ_WAVE_STATUS__VALID_MASK    0x00010000u
+#define SQ_WAVE_STATUS__ECC_ERR__SHIFT  17
+#define SQ_WAVE_STATUS__ECC_ERR_MASK    0x00020000u
+#define SQ_WAVE_STATUS__COND_DBG_USER__SHIFT  20
+#define SQ_WAVE_STATUS__COND_DBG_USER_MASK    0x00100000u
+#define SQ_WAVE_STATUS__COND_DBG_SYS__SHIFT  21
+#define SQ_WAVE_STATUS__COND_DBG_SYS_MASK    0x00200000u
+#define SQ_WAVE_STATUS__FATAL_HALT__SHIFT  23
+#define SQ_WAVE_STATUS__FATAL_HALT_MASK    0x00800000u
+#define SQ_WAVE_TRAPSTS__EXCP__SHIFT  0
+#define SQ_WAVE_TRAPSTS__EXCP_MASK    0x000001FFu
+#define SQ_WAVE_TRAPSTS__ILLEGAL_INST__SHIFT  11
+#define SQ_WAVE_TRAPSTS__ILLEGAL_INST_MASK    0x00000800u
+#define SQ_WAVE_TRAPSTS__EXCP_HI__SHIFT  12
+#define SQ_WAVE_TRAPSTS__EXCP_HI_MASK    0x00007000u
+#define SQ_WAVE_GPR_ALLOC__VGPR_BASE__SHIFT  0
+#define SQ_WAVE_GPR_ALLOC__VGPR_BASE_MASK    0x000001FFu
+#define SQ_WAVE_GPR_ALLOC__VGPR_SIZE__SHIFT  12
+#define SQ_WAVE_GPR_ALLOC__VGPR_SIZE_MASK    0x000FF000u
+#define SQ_WAVE_LDS_ALLOC__LDS_BASE__SHIFT  0
+#define SQ_WAVE_LDS_ALLOC__LDS_BASE_MASK    0x000001FFu
+#define SQ_WAVE_LDS_ALLOC__LDS_SIZE__SHIFT  12
+#define SQ_WAVE_LDS_ALLOC__LDS_SIZE_MASK    0x001FF000u
+#define SQ_WAVE_PC_HI__PC_HI__SHIFT  0
+#define SQ_WAVE_PC_HI__PC_HI_MASK    0x0000FFFFu
+#define SQ_WAVE_HW_ID1__WAVE_ID__SHIFT  0
+#define SQ_WAVE_HW_ID1__WAVE_ID_MASK    0x0000001Fu
+#define SQ_WAVE_HW_ID1__SIMD_ID__SHIFT  8
+#define SQ_WAVE_HW_ID1__SIMD_ID_MASK    0x00000300u
+#define SQ_WAVE_HW_ID1__WGP_ID__SHIFT  10
+#define SQ_WAVE_HW_ID1__WGP_ID_MASK    0x00003C00u
+#define SQ_WAVE_HW_ID1__SA_ID__SHIFT  16
+#define SQ_WAVE_HW_ID1__SA_ID_MASK    0x00010000u
+#define SQ_WAVE_HW_ID1__SE_ID__SHIFT  18
+#define SQ_WAVE_HW_ID1__SE_ID_MASK    0x001C0000u
+#define SQ_WAVE_HW_ID1__DP_RATE__SHIFT  29
+#define SQ_WAVE_HW_ID1__DP_RATE_MASK    0xE0000000u
+#define SQ_WAVE_HW_ID2__QUEUE_ID__SHIFT  0
+#define SQ_WAVE_HW_ID2__QUEUE_ID_MASK    0x0000000Fu
+#define SQ_WAVE_HW_ID2__PIPE_ID__SHIFT  4
+#define SQ_WAVE_HW_ID2__PIPE_ID_MASK    0x00000030u
+#define SQ_WAVE_HW_ID2__ME_ID__SHIFT  8
+#define SQ_WAVE_HW_ID2__ME_ID_MASK    0x00000300u
+#define SQ_WAVE_HW_ID2__STATE_ID__SHIFT  12
+#define SQ_WAVE_HW_ID2__STATE_ID_MASK    0x00007000u
+#define SQ_WAVE_HW_ID2__WG_ID__SHIFT  16
+#define SQ_WAVE_HW_ID2__WG_ID_MASK    0x001F0000u
+#define SQ_WAVE_HW_ID2__VM_ID__SHIFT  24
+#define SQ_WAVE_HW_ID2__VM_ID_MASK    0x0F000000u
+#define SPI_GDBG_WAVE_CNTL__STALL_RA__SHIFT  0
+#define SPI_GDBG_WAVE_CNTL__STALL_RA_MASK    0x00000001u
+#define SPI_GDBG_WAVE_CNTL__STALL_VMID__SHIFT  1
+#define SPI_GDBG_WAVE_CNTL__STALL_VMID_MASK    0x0001FFFEu
+#define SPI_GDBG_TRAP_CONFIG__ME_SEL__SHIFT  0
+#define SPI_GDBG_TRAP_CONFIG__ME_SEL_MASK    0x00000003u
+#define SPI_GDBG_TRAP_CONFIG__PIPE_SEL__SHIFT  2
+#define SPI_GDBG_TRAP_CONFIG__PIPE_SEL_MASK    0x0000000Cu
+#define SPI_GDBG_TRAP_CONFIG__QUEUE_SEL__SHIFT  4
+#define SPI_GDBG_TRAP_CONFIG__QUEUE_SEL_MASK    0x00000070u
+#define SPI_GDBG_TRAP_CONFIG__ME_MATCH__SHIFT  7
+#define SPI_GDBG_TRAP_CONFIG__ME_MATCH_MASK    0x00000080u
+#define SPI_GDBG_TRAP_CONFIG__PIPE_MATCH__SHIFT  8
+#define SPI_GDBG_TRAP_CONFIG__PIPE_MATCH_MASK    0x00000100u
+#define SPI_GDBG_TRAP_CONFIG__QUEUE_MATCH__SHIFT  9
+#define SPI_GDBG_TRAP_CONFIG__QUEUE_MATCH_MASK    0x00000200u
+#define SPI_GDBG_TRAP_CONFIG__TRAP_EN__SHIFT  15
+#define SPI_GDBG_TRAP_CONFIG__TRAP_EN_MASK    0x00008000u
+#define SPI_GDBG_TRAP_CONFIG__VMID_SEL__SHIFT  16
+#define SPI_GDBG_TRAP_CONFIG__VMID_SEL_MASK    0xFFFF0000u
+#define SPI_GDBG_PER_VMID_CNTL__STALL_VMID__SHIFT  0
+#define SPI_GDBG_PER_VMID_CNTL__STALL_VMID_MASK    0x00000001u
+#define SPI_GDBG_PER_VMID_CNTL__LAUNCH_MODE__SHIFT  1
+#define SPI_GDBG_PER_VMID_CNTL__LAUNCH_MODE_MASK    0x00000006u
+#define SPI_GDBG_PER_VMID_CNTL__TRAP_EN__SHIFT  3
+#define SPI_GDBG_PER_VMID_CNTL__TRAP_EN_MASK    0x00000008u
+#define SPI_GDBG_PER_VMID_CNTL__EXCP_EN__SHIFT  4
+#define SPI_GDBG_PER_VMID_CNTL__EXCP_EN_MASK    0x00001FF0u
+#define SPI_GDBG_PER_VMID_CNTL__EXCP_REPLACE__SHIFT  13
+#define SPI_GDBG_PER_VMID_CNTL__EXCP_REPLACE_MASK    0x00002000u
+#define GRBM_STATUS__ME0PIPE0_CMDFIFO_AVAIL__SHIFT  0
+#define GRBM_STATUS__ME0PIPE0_CMDFIFO_AVAIL_MASK    0x0000000Fu
+#define GRBM_STATUS__RLC_BUSY__SHIFT  8
+#define GRBM_STATUS__RLC_BUSY_MASK    0x00000100u
+#define GRBM_STATUS__TC_BUSY__SHIFT  9
+#define GRBM_STATUS__TC_BUSY_MASK    0x00000200u
+#define GRBM_STATUS__SPI_BUSY__SHIFT  22
+#define GRBM_STATUS__SPI_BUSY_MASK    0x00400000u
+#define GRBM_STATUS__CP_BUSY__SHIFT  29
+#define GRBM_STATUS__CP_BUSY_MASK    0x20000000u
+#define GRBM_STATUS__CB_BUSY__SHIFT  30
+#define GRBM_STATUS__CB_BUSY_MASK    0x40000000u
+#define GRBM_STATUS__GUI_ACTIVE__SHIFT  31
+#define GRBM_STATUS__GUI_ACTIVE_MASK    0x80000000u
+#define GRBM_STATUS2__RLC_RQ_PENDING__SHIFT  0
+#define GRBM_STATUS2__RLC_RQ_PENDING_MASK    0x00000001u
+#define GRBM_STATUS2__CPF_RQ_PENDING__SHIFT  4
+#define GRBM_STATUS2__CPF_RQ_PENDING_MASK    0x00000010u
+#define GRBM_STATUS2__CPC_BUSY__SHIFT  28
+#define GRBM_STATUS2__CPC_BUSY_MASK    0x10000000u
+#define GRBM_STATUS2__CPF_BUSY__SHIFT  29
+#define GRBM_STATUS2__CPF_BUSY_MASK    0x20000000u
+#define GRBM_STATUS2__CPG_BUSY__SHIFT  30
+#define GRBM_STATUS2__CPG_BUSY_MASK    0x40000000u
+#define GRBM_GFX_INDEX__INSTANCE_INDEX__SHIFT  0
+#define GRBM_GFX_INDEX__INSTANCE_INDEX_MASK    0x000000FFu
+#define GRBM_GFX_INDEX__SA_INDEX__SHIFT  8
+#define GRBM_GFX_INDEX__SA_INDEX_MASK    0x0000FF00u
+#define GRBM_GFX_INDEX__SE_INDEX__SHIFT  16
+#define GRBM_GFX_INDEX__SE_INDEX_MASK    0x00FF0000u
+#define GRBM_GFX_INDEX__SA_BROADCAST_WRITES__SHIFT  29
+#define GRBM_GFX_INDEX__SA_BROADCAST_WRITES_MASK    0x20000000u
+#define GRBM_GFX_INDEX__INSTANCE_BROADCAST_WRITES__SHIFT  30
+#define GRBM_GFX_INDEX__INSTANCE_BROADCAST_WRITES_MASK    0x40000000u
+#define GRBM_GFX_INDEX__SE_BROADCAST_WRITES__SHIFT  31
+#define GRBM_GFX_INDEX__SE_BROADCAST_WRITES_MASK    0x80000000u
+#define GCVM_L2_PROTECTION_FAULT_STATUS__MORE_FAULTS__SHIFT  0
+#define GCVM_L2_PROTECTION_FAULT_STATUS__MORE_FAULTS_MASK    0x00000001u
+#define GCVM_L2_PROTECTION_FAULT_STATUS__WALKER_ERROR__SHIFT  1
+#define GCVM_L2_PROTECTION_FAULT_STATUS__WALKER_ERROR_MASK    0x0000000Eu
+#define GCVM_L2_PROTECTION_FAULT_STATUS__PERMISSION_FAULTS__SHIFT  4
+#define GCVM_L2_PROTECTION_FAULT_STATUS__PERMISSION_FAULTS_MASK    0x000000F0u
+#define GCVM_L2_PROTECTION_FAULT_STATUS__MAPPING_ERROR__SHIFT  8
+#define GCVM_L2_PROTECTION_FAULT_STATUS__MAPPING_ERROR_MASK    0x00000100u
+#define GCVM_L2_PROTECTION_FAULT_STATUS__CID__SHIFT  9
+#define GCVM_L2_PROTECTION_FAULT_STATUS__CID_MASK    0x0003FE00u
+#define GCVM_L2_PROTECTION_FAULT_STATUS__RW__SHIFT  18
+#define GCVM_L2_PROTECTION_FAULT_STATUS__RW_MASK    0x00040000u
+#define GCVM_L2_PROTECTION_FAULT_STATUS__VMID__SHIFT  20
+#define GCVM_L2_PROTECTION_FAULT_STATUS__VMID_MASK    0x00F00000u
+#define GCVM_L2_PROTECTION_FAULT_STATUS__VF__SHIFT  24
+#define GCVM_L2_PROTECTION_FAULT_STATUS__VF_MASK    0x01000000u
+#define GCVM_L2_PROTECTION_FAULT_STATUS__VFID__SHIFT  25
+#define GCVM_L2_PROTECTION_FAULT_STATUS__VFID_MASK    0x1E000000u
+#define GCVM_L2_PROTECTION_FAULT_ADDR_HI32__LOGICAL_PAGE_ADDR_HI4__SHIFT  0
+#define GCVM_L2_PROTECTION_FAULT_ADDR_HI32__LOGICAL_PAGE_ADDR_HI4_MASK    0x0000000Fu
+#define GCMC_VM_FB_OFFSET__FB_OFFSET__SHIFT  0
+#define GCMC_VM_FB_OFFSET__FB_OFFSET_MASK    0x00FFFFFFu
+#define GCVM_CONTEXT0_CNTL__ENABLE_CONTEXT__SHIFT  0
+#define GCVM_CONTEXT0_CNTL__ENABLE_CONTEXT_MASK    0x00000001u
+#define GCVM_CONTEXT0_CNTL__PAGE_TABLE_DEPTH__SHIFT  1
+#define GCVM_CONTEXT0_CNTL__PAGE_TABLE_DEPTH_MASK    0x00000006u
+#define GCVM_CONTEXT0_CNTL__PAGE_TABLE_BLOCK_SIZE__SHIFT  3
+#define GCVM_CONTEXT0_CNTL__PAGE_TABLE_BLOCK_SIZE_MASK    0x00000078u
@@ -0,0 +1,497 @@
+#include "regfile.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Kernel table for one instruction set.
+ */
+typedef struct {
+    regfile_isa_t isa;
+    const char*   name;
+    void     (*transpose)(uint32_t*, const uint32_t*, uint32_t, uint32_t);
+    uint32_t (*diff)(const uint32_t*, const uint32_t*, uint32_t, uint32_t, uint64_t*);
+    void     (*copy_wc)(void*, const void*, size_t);
+} regfile_kernels_t;
+
+/* ---------------------------------------------------------------------- */
+/* Scalar kernels                                                          */
+/* ---------------------------------------------------------------------- */
+
+/**
+ * Transpose the [r0, rows) x [c0, cols) remainder not covered by blocks.
+ */
+static void transpose_tail(uint32_t* dst, const uint32_t* src, uint32_t rows,
+                           uint32_t cols, uint32_t r0, uint32_t c0) {
+    for_range(r, 0, rows) {
+        for_range(c, (r < r0 ? c0 : 0), cols) {
+            dst[(size_t)c * rows + r] = src[(size_t)r * cols + c];
+        }
+    }
+}
+
+static void transpose_scalar(uint32_t* dst, const uint32_t* src,
+                             uint32_t rows, uint32_t cols) {
+    transpose_tail(dst, src, rows, cols, 0, 0);
+}
+
+static bool row_differs_scalar(const uint32_t* a, const uint32_t* b, uint32_t n) {
+    uint32_t acc = 0;
+    for_range(i, 0, n) {
+        acc |= a[i] ^ b[i];
+    }
+    return acc != 0;
+}
+
+static uint32_t diff_scalar(const uint32_t* a, const uint32_t* b, uint32_t rows,
+                            uint32_t row_dwords, uint64_t* changed) {
+    uint32_t count = 0;
+
+    memset(changed, 0, ((rows + 63) / 64) * sizeof(*changed));
+    for_range(r, 0, rows) {
+        size_t off = (size_t)r * row_dwords;
+        if (row_differs_scalar(a + off, b + off, row_dwords)) {
+            changed[r / 64] |= 1ull << (r % 64);
+            count++;
+        }
+    }
+    return count;
+}
+
+static void copy_wc_scalar(void* dst, const void* src, size_t size) {
+    memcpy(dst, src, size);
+}
+
+static const regfile_kernels_t kernels_scalar = {
+    .isa = REGFILE_ISA_SCALAR,
+    .name = "scalar",
+    .transpose = transpose_scalar,
+    .diff = diff_scalar,
+    .copy_wc = copy_wc_scalar,
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* ---------------------------------------------------------------------- */
+/* SSE4.1 kernels                                                          */
+/* ---------------------------------------------------------------------- */
+
+__attribute__((target("sse4.1")))
+static void transpose_sse41(uint32_t* dst, const uint32_t* src,
+                            uint32_t rows, uint32_t cols) {
+    uint32_t r4 = rows & ~3u;
+    uint32_t c4 = cols & ~3u;
+
+    for (uint32_t r = 0; r < r4; r += 4) {
+        for (uint32_t c = 0; c < c4; c += 4) {
+            __m128 x0 = _mm_loadu_ps((const float*)&src[(size_t)(r + 0) * cols + c]);
+            __m128 x1 = _mm_loadu_ps((const float*)&src[(size_t)(r + 1) * cols + c]);
+            __m128 x2 = _mm_loadu_ps((const float*)&src[(size_t)(r + 2) * cols + c]);
+            __m128 x3 = _mm_loadu_ps((const float*)&src[(size_t)(r + 3) * cols + c]);
+            _MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+            _mm_storeu_ps((float*)&dst[(size_t)(c + 0) * rows + r], x0);
+            _mm_storeu_ps((float*)&dst[(size_t)(c + 1) * rows + r], x1);
+            _mm_storeu_ps((float*)&dst[(size_t)(c + 2) * rows + r], x2);
+            _mm_storeu_ps((float*)&dst[(size_t)(c + 3) * rows + r], x3);
+        }
+    }
+
+    transpose_tail(dst, src, rows, cols, r4, c4);
+}
+
+__attribute__((target("sse4.1")))
+static bool row_differs_sse41(const uint32_t* a, const uint32_t* b, uint32_t n) {
+    __m128i acc = _mm_setzero_si128();
+    uint32_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)&a[i]);
+        __m128i y = _mm_loadu_si128((const __m128i*)&b[i]);
+        acc = _mm_or_si128(acc, _mm_xor_si128(x, y));
+    }
+
+    return !_mm_testz_si128(acc, acc) || row_differs_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t diff_sse41(const uint32_t* a, const uint32_t* b, uint32_t rows,
+                           uint32_t row_dwords, uint64_t* changed) {
+    if (row_dwords != 1) {
+        uint32_t count = 0;
+        memset(changed, 0, ((rows + 63) / 64) * sizeof(*changed));
+        for_range(r, 0, rows) {
+            size_t off = (size_t)r * row_dwords;
+            if (row_differs_sse41(a + off, b + off, row_dwords)) {
+                changed[r / 64] |= 1ull << (r % 64);
+                count++;
+            }
+        }
+        return count;
+    }
+
+    // One dword per row (SGPRs): compare 4 rows per step
+    uint32_t count = 0;
+    uint32_t r = 0;
+    memset(changed, 0, ((rows + 63) / 64) * sizeof(*changed));
+    for (; r + 4 <= rows; r += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)&a[r]);
+        __m128i y = _mm_loadu_si128((const __m128i*)&b[r]);
+        uint32_t eq = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, y)));
+        uint32_t ne = ~eq & 0xFu;
+        changed[r / 64] |= (uint64_t)ne << (r % 64);
+        count += (uint32_t)__builtin_popcount(ne);
+    }
+    for (; r < rows; r++) {
+        if (a[r] != b[r]) {
+            changed[r / 64] |= 1ull << (r % 64);
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Streaming copy without the leading fence (copy_wc_avx2() head and tail).
+ */
+__attribute__((target("sse4.1")))
+static void copy_wc_sse41_stream(void* dst, const void* src, size_t size) {
+    const uint8_t* s = src;
+    uint8_t* d = dst;
+
+    // MOVNTDQA needs 16-byte aligned sources; slot data always is
+    size_t head = MIN(size, (size_t)(-(uintptr_t)s & 15u));
+    memcpy(d, s, head);
+    s += head;
+    d += head;
+    size -= head;
+
+    for (; size >= 64; size -= 64, s += 64, d += 64) {
+        __m128i x0 = _mm_stream_load_si128((__m128i*)(s + 0));
+        __m128i x1 = _mm_stream_load_si128((__m128i*)(s + 16));
+        __m128i x2 = _mm_stream_load_si128((__m128i*)(s + 32));
+        __m128i x3 = _mm_stream_load_si128((__m128i*)(s + 48));
+        _mm_storeu_si128((__m128i*)(d + 0), x0);
+        _mm_storeu_si128((__m128i*)(d + 16), x1);
+        _mm_storeu_si128((__m128i*)(d + 32), x2);
+        _mm_storeu_si128((__m128i*)(d + 48), x3);
+    }
+    for (; size >= 16; size -= 16, s += 16, d += 16) {
+        _mm_storeu_si128((__m128i*)d, _mm_stream_load_si128((__m128i*)s));
+    }
+    memcpy(d, s, size);
+}
+
+/**
+ * MOVNTDQA from WC memory is weakly ordered against earlier loads, so
+ * without the MFENCE it may read a slot ahead of the caller's acquire
+ * load of the slot state and copy stale registers.
+ */
+__attribute__((target("sse4.1")))
+static void copy_wc_sse41(void* dst, const void* src, size_t size) {
+    _mm_mfence();
+    copy_wc_sse41_stream(dst, src, size);
+}
+
+static const regfile_kernels_t kernels_sse41 = {
+    .isa = REGFILE_ISA_SSE41,
+    .name = "sse4.1",
+    .transpose = transpose_sse41,
+    .diff = diff_sse41,
+    .copy_wc = copy_wc_sse41,
+};
+
+/* ---------------------------------------------------------------------- */
+/* AVX2 kernels                                                            */
+/* ---------------------------------------------------------------------- */
+
+__attribute__((target("avx2")))
+static void transpose_avx2(uint32_t* dst, const uint32_t* src,
+                           uint32_t rows, uint32_t cols) {
+    uint32_t r8 = rows & ~7u;
+    uint32_t c8 = cols & ~7u;
+
+    for (uint32_t r = 0; r < r8; r += 8) {
+        for (uint32_t c = 0; c < c8; c += 8) {
+            __m256i x[8];
+            for_range(i, 0, 8) {
+                x[i] = _mm256_loadu_si256((const __m256i*)&src[(size_t)(r + i) * cols + c]);
+            }
+
+            // 8x8 dword transpose: 32-bit, 64-bit, then 128-bit interleave
+            __m256i t0 = _mm256_unpacklo_epi32(x[0], x[1]);
+            __m256i t1 = _mm256_unpackhi_epi32(x[0], x[1]);
+            __m256i t2 = _mm256_unpacklo_epi32(x[2], x[3]);
+            __m256i t3 = _mm256_unpackhi_epi32(x[2], x[3]);
+            __m256i t4 = _mm256_unpacklo_epi32(x[4], x[5]);
+            __m256i t5 = _mm256_unpackhi_epi32(x[4], x[5]);
+            __m256i t6 = _mm256_unpacklo_epi32(x[6], x[7]);
+            __m256i t7 = _mm256_unpackhi_epi32(x[6], x[7]);
+
+            __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+            __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+            __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+            __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+            __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+            __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+            __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+            __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+            __m256i y[8] = {
+                _mm256_permute2x128_si256(u0, u4, 0x20),
+                _mm256_permute2x128_si256(u1, u5, 0x20),
+                _mm256_permute2x128_si256(u2, u6, 0x20),
+                _mm256_permute2x128_si256(u3, u7, 0x20),
+                _mm256_permute2x128_si256(u0, u4, 0x31),
+                _mm256_permute2x128_si256(u1, u5, 0x31),
+                _mm256_permute2x128_si256(u2, u6, 0x31),
+                _mm256_permute2x128_si256(u3, u7, 0x31),
+            };
+            for_range(i, 0, 8) {
+                _mm256_storeu_si256((__m256i*)&dst[(size_t)(c + i) * rows + r], y[i]);
+            }
+        }
+    }
+
+    transpose_tail(dst, src, rows, cols, r8, c8);
+}
+
+__attribute__((target("avx2")))
+static bool row_differs_avx2(const uint32_t* a, const uint32_t* b, uint32_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    uint32_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)&a[i]);
+        __m256i y = _mm256_loadu_si256((const __m256i*)&b[i]);
+        acc = _mm256_or_si256(acc, _mm256_xor_si256(x, y));
+    }
+
+    return !_mm256_testz_si256(acc, acc) || row_differs_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static uint32_t diff_avx2(const uint32_t* a, const uint32_t* b, uint32_t rows,
+                          uint32_t row_dwords, uint64_t* changed) {
+    uint32_t count = 0;
+    memset(changed, 0, ((rows + 63) / 64) * sizeof(*changed));
+
+    if (row_dwords != 1) {
+        for_range(r, 0, rows) {
+            size_t off = (size_t)r * row_dwords;
+            if (row_differs_avx2(a + off, b + off, row_dwords)) {
+                changed[r / 64] |= 1ull << (r % 64);
+                count++;
+            }
+        }
+        return count;
+    }
+
+    // One dword per row (SGPRs): compare 8 rows per step
+    uint32_t r = 0;
+    for (; r + 8 <= rows; r += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)&a[r]);
+        __m256i y = _mm256_loadu_si256((const __m256i*)&b[r]);
+        uint32_t eq = (uint32_t)_mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_cmpeq_epi32(x, y)));
+        uint32_t ne = ~eq & 0xFFu;
+        changed[r / 64] |= (uint64_t)ne << (r % 64);
+        count += (uint32_t)__builtin_popcount(ne);
+    }
+    for (; r < rows; r++) {
+        if (a[r] != b[r]) {
+            changed[r / 64] |= 1ull << (r % 64);
+            count++;
+        }
+    }
+    return count;
+}
+
+__attribute__((target("avx2")))
+static void copy_wc_avx2(void* dst, const void* src, size_t size) {
+    const uint8_t* s = src;
+    uint8_t* d = dst;
+
+    // Ordered after the caller's acquire, as in copy_wc_sse41()
+    _mm_mfence();
+
+    // VMOVNTDQA ymm needs 32-byte aligned sources
+    size_t head = MIN(size, (size_t)(-(uintptr_t)s & 31u));
+    copy_wc_sse41_stream(d, s, head);
+    s += head;
+    d += head;
+    size -= head;
+
+    for (; size >= 128; size -= 128, s += 128, d += 128) {
+        __m256i x0 = _mm256_stream_load_si256((const __m256i*)(s + 0));
+        __m256i x1 = _mm256_stream_load_si256((const __m256i*)(s + 32));
+        __m256i x2 = _mm256_stream_load_si256((const __m256i*)(s + 64));
+        __m256i x3 = _mm256_stream_load_si256((const __m256i*)(s + 96));
+        _mm256_storeu_si256((__m256i*)(d + 0), x0);
+        _mm256_storeu_si256((__m256i*)(d + 32), x1);
+        _mm256_storeu_si256((__m256i*)(d + 64), x2);
+        _mm256_storeu_si256((__m256i*)(d + 96), x3);
+    }
+    copy_wc_sse41_stream(d, s, size);
+}
+
+static const regfile_kernels_t kernels_avx2 = {
+    .isa = REGFILE_ISA_AVX2,
+    .name = "avx2",
+    .transpose = transpose_avx2,
+    .diff = diff_avx2,
+    .copy_wc = copy_wc_avx2,
+};
+
+#endif /* x86 */
+
+/* ---------------------------------------------------------------------- */
+/* Dispatch                                                                */
+/* ---------------------------------------------------------------------- */
+
+static const regfile_kernels_t* regfile_active = NULL;
+
+regfile_isa_t regfile_select_isa(regfile_isa_t isa) {
+    const regfile_kernels_t* k = &kernels_scalar;
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (isa == REGFILE_ISA_AUTO) {
+        isa = REGFILE_ISA_AVX2;
+    }
+    if (isa >= REGFILE_ISA_AVX2 && __builtin_cpu_supports("avx2")) {
+        k = &kernels_avx2;
+    } else if (isa >= REGFILE_ISA_SSE41 && __builtin_cpu_supports("sse4.1")) {
+        k = &kernels_sse41;
+    }
+#else
+    (void)isa;
+#endif
+
+    regfile_active = k;
+    return k->isa;
+}
+
+static inline const regfile_kernels_t* regfile_kernels(void) {
+    // Benign race: every thread resolves to the same table
+    if (regfile_active == NULL) {
+        regfile_select_isa(REGFILE_ISA_AUTO);
+    }
+    return regfile_active;
+}
+
+const char* regfile_isa_name(void) {
+    return regfile_kernels()->name;
+}
+
+void regfile_transpose(uint32_t* dst, const uint32_t* src,
+                       uint32_t rows, uint32_t cols) {
+    regfile_kernels()->transpose(dst, src, rows, cols);
+}
+
+uint32_t regfile_diff(const uint32_t* a, const uint32_t* b, uint32_t rows,
+                      uint32_t row_dwords, uint64_t* changed) {
+    return regfile_kernels()->diff(a, b, rows, row_dwords, changed);
+}
+
+void regfile_copy_wc(void* dst, const void* src, size_t size) {
+    regfile_kernels()->copy_wc(dst, src, size);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Register cache                                                          */
+/* ---------------------------------------------------------------------- */
+
+int32_t regfile_init(regfile_t* rf, uint32_t vgpr_count, uint32_t lanes) {
+    *rf = (regfile_t){
+        .vgpr_count = vgpr_count,
+        .lanes = lanes,
+    };
+
+    size_t regs = MAILBOX_MAX_SGPRS + (size_t)vgpr_count * lanes;
+
+    // One allocation per buffer; sgprs/vgprs are views into the same block
+    // so a capture swaps a single pointer pair
+    rf->sgprs = calloc(regs, sizeof(uint32_t));
+    rf->scratch = calloc(regs, sizeof(uint32_t));
+    rf->sgpr_changed = calloc((MAILBOX_MAX_SGPRS + 63) / 64, sizeof(uint64_t));
+    rf->vgpr_changed = calloc((vgpr_count + 63) / 64, sizeof(uint64_t));
+    if (rf->sgprs == NULL || rf->scratch == NULL ||
+        rf->sgpr_changed == NULL || rf->vgpr_changed == NULL) {
+        regfile_fini(rf);
+        return -ENOMEM;
+    }
+
+    rf->vgprs = rf->sgprs + MAILBOX_MAX_SGPRS;
+    return 0;
+}
+
+void regfile_fini(regfile_t* rf) {
+    free(rf->sgprs);
+    free(rf->scratch);
+    free(rf->sgpr_changed);
+    free(rf->vgpr_changed);
+    *rf = (regfile_t){0};
+}
+
+static void memcpy_void(void* dst, const void* src, size_t size) {
+    memcpy(dst, src, size);
+}
+
+void regfile_reset(regfile_t* rf) {
+    rf->valid = false;
+}
+
+/**
+ * Capture from a slot image; wc selects streaming loads (mailbox memory)
+ * over memcpy (a cached copy of the slot).
+ */
+static void regfile_capture_slot(regfile_t* rf, const uint8_t* slot, bool wc) {
+    const regfile_kernels_t* k = regfile_kernels();
+    uint32_t* next_sgprs = rf->scratch;
+    uint32_t* next_vgprs = rf->scratch + MAILBOX_MAX_SGPRS;
+    size_t vgpr_bytes = (size_t)rf->vgpr_count * rf->lanes * sizeof(uint32_t);
+    void (*copy)(void*, const void*, size_t) = wc ? k->copy_wc : memcpy_void;
+
+    // SGPRs and VGPRs are contiguous in the slot except for the gap
+    // between the SGPR block end and MAILBOX_SLOT_VGPR_OFFSET
+    copy(next_sgprs, slot + MAILBOX_SLOT_SGPR_OFFSET,
+         MAILBOX_MAX_SGPRS * sizeof(uint32_t));
+    copy(next_vgprs, slot + MAILBOX_SLOT_VGPR_OFFSET, vgpr_bytes);
+
+    if (rf->valid) {
+        rf->sgprs_changed = k->diff(rf->sgprs, next_sgprs, MAILBOX_MAX_SGPRS, 1,
+                                    rf->sgpr_changed);
+        rf->vgprs_changed = k->diff(rf->vgprs, next_vgprs, rf->vgpr_count,
+                                    rf->lanes, rf->vgpr_changed);
+    } else {
+        memset(rf->sgpr_changed, 0xFF,
+               ((MAILBOX_MAX_SGPRS + 63) / 64) * sizeof(uint64_t));
+        memset(rf->vgpr_changed, 0, ((rf->vgpr_count + 63) / 64) * sizeof(uint64_t));
+        for_range(v, 0, rf->vgpr_count) {
+            rf->vgpr_changed[v / 64] |= 1ull << (v % 64);
+        }
+        rf->sgprs_changed = MAILBOX_MAX_SGPRS;
+        rf->vgprs_changed = rf->vgpr_count;
+    }
+
+    rf->scratch = rf->sgprs;
+    rf->sgprs = next_sgprs;
+    rf->vgprs = next_vgprs;
+    rf->valid = true;
+}
+
+void regfile_capture(regfile_t* rf, mailbox_t* mb, uint32_t slot) {
+    HDB_ASSERT(rf->vgpr_count == mb->vgpr_count && rf->lanes == mb->lanes,
+               "register cache geometry does not match the mailbox");
+
+    regfile_capture_slot(rf, (const uint8_t*)mailbox_slot(mb, slot), true);
+}
+
+void regfile_capture_copy(regfile_t* rf, const void* slot_copy) {
+    regfile_capture_slot(rf, slot_copy, false);
+}
+
+void regfile_lane_view(const regfile_t* rf, uint32_t* dst) {
+    regfile_kernels()->transpose(dst, rf->vgprs, rf->vgpr_count, rf->lanes);
+}
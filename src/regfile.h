@@ -0,0 +1,157 @@
+#pragma once
+
+#include "mailbox.h"
+
+/**
+ * Register file decoding for saved wave state.
+ *
+ * The trap handler stores VGPRs register-major (vgpr_count rows of lanes
+ * dwords, the global_store_addtid_b32 layout). regfile_t keeps a cached
+ * copy of one wave's registers across stops and, on every capture, marks
+ * which SGPRs / VGPRs changed since the previous stop, so a UI only
+ * re-renders those. regfile_lane_view() transposes VGPRs into a per-lane
+ * (per-thread) view.
+ *
+ * Kernels are picked once at runtime: AVX2, SSE4.1, or scalar. Captures
+ * use streaming loads (MOVNTDQA), which is the fast way to read the
+ * write-combined TMA mapping.
+ */
+
+/**
+ * Kernel implementations (regfile_select_isa()).
+ */
+typedef enum {
+    REGFILE_ISA_AUTO   = 0,  // Best supported by the CPU
+    REGFILE_ISA_SCALAR = 1,
+    REGFILE_ISA_SSE41  = 2,
+    REGFILE_ISA_AVX2   = 3,
+} regfile_isa_t;
+
+/**
+ * regfile_t: Cached registers of one wave plus change bitmaps.
+ *
+ * Bitmaps hold one bit per register (bit r % 64 of word r / 64).
+ */
+typedef struct {
+    uint32_t  vgpr_count;      // VGPRs per wave
+    uint32_t  lanes;           // Lanes per VGPR
+    uint32_t* sgprs;           // MAILBOX_MAX_SGPRS dwords
+    uint32_t* vgprs;           // vgpr_count x lanes dwords, register-major
+    uint32_t* scratch;         // Capture buffer (swapped with the above)
+    uint64_t* sgpr_changed;    // Changed since the previous capture
+    uint64_t* vgpr_changed;
+    uint32_t  sgprs_changed;   // Number of set bits in sgpr_changed
+    uint32_t  vgprs_changed;   // Number of set bits in vgpr_changed
+    bool      valid;           // At least one capture happened
+} regfile_t;
+
+/**
+ * Choose the kernel implementation.
+ *
+ * @param isa: Requested implementation; unsupported ones fall back to the
+ *             best supported one below them
+ * @return: Implementation now in use
+ */
+regfile_isa_t regfile_select_isa(regfile_isa_t isa);
+
+/**
+ * Name of the implementation in use ("avx2", "sse4.1", "scalar").
+ */
+const char* regfile_isa_name(void);
+
+/**
+ * Transpose a row-major dword matrix: dst[c * rows + r] = src[r * cols + c].
+ *
+ * @param dst: Output, cols x rows (must not alias src)
+ * @param src: Input, rows x cols
+ * @param rows: Rows of src
+ * @param cols: Columns of src
+ */
+void regfile_transpose(uint32_t* dst, const uint32_t* src,
+                       uint32_t rows, uint32_t cols);
+
+/**
+ * Compare two register arrays row by row.
+ *
+ * @param a: Previous values, rows x row_dwords
+ * @param b: Current values, rows x row_dwords
+ * @param rows: Number of registers
+ * @param row_dwords: Dwords per register (1 for SGPRs, lanes for VGPRs)
+ * @param changed: Output bitmap of (rows + 63) / 64 words
+ * @return: Number of changed rows
+ */
+uint32_t regfile_diff(const uint32_t* a, const uint32_t* b, uint32_t rows,
+                      uint32_t row_dwords, uint64_t* changed);
+
+/**
+ * Copy out of a write-combined mapping with streaming loads.
+ *
+ * @param dst: Destination (cacheable memory)
+ * @param src: Source (WC or UC mapping)
+ * @param size: Bytes (any size; non-16-byte parts use plain loads)
+ *
+ * The streaming kernels start with an MFENCE, so the copy is ordered after
+ * the caller's acquire load (e.g. of a mailbox slot state) and never reads
+ * data that was published after it.
+ */
+void regfile_copy_wc(void* dst, const void* src, size_t size);
+
+/**
+ * Allocate a register cache for one wave.
+ *
+ * @param rf: Output register cache
+ * @param vgpr_count: VGPRs per wave (mailbox_t.vgpr_count)
+ * @param lanes: Lanes per VGPR (mailbox_t.lanes)
+ * @return: 0 on success, -ENOMEM
+ */
+int32_t regfile_init(regfile_t* rf, uint32_t vgpr_count, uint32_t lanes);
+
+/**
+ * Free a register cache.
+ */
+void regfile_fini(regfile_t* rf);
+
+/**
+ * Capture a trapped wave's registers and update the change bitmaps.
+ *
+ * @param rf: Register cache (geometry must match the mailbox)
+ * @param mb: Mailbox
+ * @param slot: Slot index holding a MAILBOX_SLOT_TRAPPED wave
+ *
+ * On the first capture every register is reported as changed. The slot is
+ * read with regfile_copy_wc(), ordered after the caller's acquire of the
+ * slot state.
+ */
+void regfile_capture(regfile_t* rf, mailbox_t* mb, uint32_t slot);
+
+/**
+ * Capture from a cached copy of a slot (e.g. from sdma_read_slots()).
+ *
+ * @param rf: Register cache (geometry must match the source mailbox)
+ * @param slot_copy: Slot image, laid out like mailbox_slot()
+ */
+void regfile_capture_copy(regfile_t* rf, const void* slot_copy);
+
+/**
+ * Forget the previous stop (next capture reports everything changed).
+ */
+void regfile_reset(regfile_t* rf);
+
+/**
+ * Did a VGPR / SGPR change at the last capture?
+ */
+static inline bool regfile_vgpr_changed(const regfile_t* rf, uint32_t vgpr) {
+    return (rf->vgpr_changed[vgpr / 64] >> (vgpr % 64)) & 1;
+}
+
+static inline bool regfile_sgpr_changed(const regfile_t* rf, uint32_t sgpr) {
+    return (rf->sgpr_changed[sgpr / 64] >> (sgpr % 64)) & 1;
+}
+
+/**
+ * Per-lane view of the cached VGPRs.
+ *
+ * @param rf: Register cache
+ * @param dst: Output, lanes x vgpr_count dwords (dst[lane * vgpr_count + v])
+ */
+void regfile_lane_view(const regfile_t* rf, uint32_t* dst);
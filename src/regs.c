@@ -1,7 +1,12 @@
 #include "regs.h"
+#include "amdgpu_device.h"
+#include "stats.h"
 #include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 
 /**
  * hdb_ioctl: Wrapper for ioctl with error handling.
@@ -15,107 +20,387 @@ static int32_t hdb_ioctl(int fd, unsigned long request, void* arg) {
 }
 
 /**
- * GC 11 register offset table (gfx1100 / Navi31).
+ * GC 11 register tables, generated from regdb/gc_11.txt.
  * 
- * DANGER: These are hardware-specific MMIO offsets.
- * DANGER: Different RDNA3 ASICs may have different offsets.
- * 
- * NOTE: These are PLACEHOLDER offsets for initial implementation.
- * FIXME: These values must be verified against actual RDNA3 hardware
- *        documentation or extracted from UMR register database before
- *        use on real hardware. Using incorrect offsets WILL cause:
+ * FIXME: The offsets carried over from the original placeholder table
+ *        (TBA/TMA/SQ_CMD) and the rest of the database must be verified
+ *        against the Linux amdgpu gc_11_0_0 headers or UMR before use on
+ *        real hardware. Using incorrect offsets WILL cause:
  *        - GPU hangs or resets
  *        - Writes to wrong registers
  *        - System instability
- * 
- * Recommended approach:
- * 1. Use UMR (AMD's register dumper) to extract correct offsets
- * 2. Cross-reference with Linux kernel amdgpu driver sources
- * 3. Test on actual RDNA3 hardware with debugfs validation
  */
 const uint64_t gc_11_regs_offsets[REG_MAX] = {
-    [REG_SQ_SHADER_TBA_LO] = 0x2E00,  // PLACEHOLDER - MUST VERIFY
-    [REG_SQ_SHADER_TBA_HI] = 0x2E01,  // PLACEHOLDER - MUST VERIFY
-    [REG_SQ_SHADER_TMA_LO] = 0x2E02,  // PLACEHOLDER - MUST VERIFY
-    [REG_SQ_SHADER_TMA_HI] = 0x2E03,  // PLACEHOLDER - MUST VERIFY
-    [REG_SQ_CMD]           = 0x2D00,  // PLACEHOLDER - MUST VERIFY
+#define REGDB_OFFSET(name, seg, offset, type, count, stride) [REG_##name] = offset,
+    REGDB_GC11_REGS(REGDB_OFFSET)
+#undef REGDB_OFFSET
+};
+
+const reg_info_t gc_11_regs_infos[REG_MAX] = {
+#define REGDB_INFO(name, seg, offset, kind, n, step) \
+    [REG_##name] = { .soc_index = seg, .type = kind, .count = n, .stride = step },
+    REGDB_GC11_REGS(REGDB_INFO)
+#undef REGDB_INFO
+};
+
+static const char* const gc_11_regs_names[REG_MAX] = {
+#define REGDB_NAME(name, seg, offset, type, count, stride) [REG_##name] = #name,
+    REGDB_GC11_REGS(REGDB_NAME)
+#undef REGDB_NAME
 };
 
+_Static_assert(REG_MAX <= REGDB_MAX_REGS, "raise REGDB_MAX_REGS in bo.h");
+
 /**
- * Register info table.
- * 
- * All registers in this minimal set are MMIO (not indirect).
- * soc_index 0 refers to the first GC register block.
+ * Known ASIC: GC IP version and fallback segment bases.
  */
-const reg_info_t gc_11_regs_infos[REG_MAX] = {
-    [REG_SQ_SHADER_TBA_LO] = { .soc_index = 0, .type = REG_MMIO },
-    [REG_SQ_SHADER_TBA_HI] = { .soc_index = 0, .type = REG_MMIO },
-    [REG_SQ_SHADER_TMA_LO] = { .soc_index = 0, .type = REG_MMIO },
-    [REG_SQ_SHADER_TMA_HI] = { .soc_index = 0, .type = REG_MMIO },
-    [REG_SQ_CMD]           = { .soc_index = 0, .type = REG_MMIO },
+typedef struct {
+    const char* name;
+    uint32_t    gc_version;
+    uint64_t    bases[REGDB_GC11_MAX_SEGMENTS];
+} regdb_asic_t;
+
+#define REGDB_GC_VERSION(major, minor, rev)  ((major) << 16 | (minor) << 8 | (rev))
+
+static const regdb_asic_t gc_11_asics[] = {
+#define REGDB_ASIC(name, major, minor, rev, ...) \
+    { #name, REGDB_GC_VERSION(major, minor, rev), { __VA_ARGS__ } },
+    REGDB_GC11_ASICS(REGDB_ASIC)
+#undef REGDB_ASIC
 };
 
-void dev_op_reg32(amdgpu_t* dev,
-                  gc_11_reg_t reg,
-                  regs2_ioc_data_t ioc_data,
-                  reg_32_op_t op,
-                  uint32_t* value) {
-    int32_t ret = 0;
+static const struct {
+    uint32_t    device_id;
+    const char* asic;
+} gc_11_devices[] = {
+#define REGDB_DEVICE(id, name) { id, #name },
+    REGDB_GC11_DEVICES(REGDB_DEVICE)
+#undef REGDB_DEVICE
+};
+
+const char* regs_name(gc_11_reg_t reg) {
+    return reg < REG_MAX ? gc_11_regs_names[reg] : "?";
+}
+
+/**
+ * Read a small sysfs file into buf (NUL-terminated); returns bytes read.
+ */
+static ssize_t regs_read_sysfs(const char* dir, const char* file, char* buf, size_t size) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n < 0) {
+        return -errno;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+/**
+ * Read the GC version and segment bases from sysfs IP discovery.
+ * 
+ * The directory is /sys/dev/char/<major>:<minor>/device/ip_discovery/
+ * die/0/GC/0 for the opened DRM node; base_addr lists one "0x%08X" base
+ * per segment.
+ */
+static int32_t regs_discover(const amdgpu_t* dev, uint32_t* gc_version,
+                             uint64_t bases[REGDB_GC11_MAX_SEGMENTS]) {
+    struct stat st;
+    if (fstat(dev->drm_fd, &st) != 0) {
+        return -errno;
+    }
+
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "/sys/dev/char/%u:%u/device/ip_discovery/die/0/GC/0",
+             major(st.st_rdev), minor(st.st_rdev));
+
+    const char* parts[] = { "major", "minor", "revision" };
+    uint32_t version[3];
+    char buf[512];
+    for_range(i, 0, ARRAY_SIZE(parts)) {
+        ssize_t n = regs_read_sysfs(dir, parts[i], buf, sizeof(buf));
+        if (n <= 0) {
+            return n < 0 ? (int32_t)n : -ENODATA;
+        }
+        version[i] = (uint32_t)strtoul(buf, NULL, 0);
+    }
+
+    ssize_t n = regs_read_sysfs(dir, "base_addr", buf, sizeof(buf));
+    if (n <= 0) {
+        return n < 0 ? (int32_t)n : -ENODATA;
+    }
+
+    size_t seg = 0;
+    char* p = buf;
+    while (seg < REGDB_GC11_MAX_SEGMENTS) {
+        char* end;
+        uint64_t base = strtoull(p, &end, 0);
+        if (end == p) {
+            break;
+        }
+        bases[seg++] = base;
+        p = end;
+    }
+    if (seg == 0) {
+        return -ENODATA;
+    }
+
+    *gc_version = REGDB_GC_VERSION(version[0], version[1], version[2]);
+    return 0;
+}
+
+int32_t regs_resolve(amdgpu_t* dev) {
+    uint64_t bases[REGDB_GC11_MAX_SEGMENTS] = {0};
+    uint32_t gc_version = 0;
+    const regdb_asic_t* asic = NULL;
+    dev->asic_name = NULL;
+
+    int32_t ret = regs_discover(dev, &gc_version, bases);
+    if (ret == 0) {
+        for_range(i, 0, ARRAY_SIZE(gc_11_asics)) {
+            if (gc_11_asics[i].gc_version == gc_version) {
+                asic = &gc_11_asics[i];
+                break;
+            }
+        }
+    } else {
+        // No IP discovery (older kernel or no sysfs); fall back to the
+        // database bases of the ASIC matching the PCI device ID
+        for_range(i, 0, ARRAY_SIZE(gc_11_devices)) {
+            if (gc_11_devices[i].device_id != dev->device_id) {
+                continue;
+            }
+            for_range(j, 0, ARRAY_SIZE(gc_11_asics)) {
+                if (strcmp(gc_11_asics[j].name, gc_11_devices[i].asic) == 0) {
+                    asic = &gc_11_asics[j];
+                }
+            }
+        }
+        if (asic != NULL) {
+            fprintf(stderr, "[WARN] IP discovery unavailable (%d); using %s "
+                    "fallback register bases\n", ret, asic->name);
+            gc_version = asic->gc_version;
+            memcpy(bases, asic->bases, sizeof(bases));
+        }
+    }
 
-    HDB_ASSERT(dev->regs2_fd >= 0, "regs2_fd not open");
-    HDB_ASSERT(reg < REG_MAX, "invalid register enum");
-    HDB_ASSERT(value != NULL, "value pointer is NULL");
+    if (asic == NULL) {
+        fprintf(stderr, "[WARN] No register database for device 0x%04x (GC %u.%u.%u); "
+                "register access disabled\n", dev->device_id,
+                gc_version >> 16, (gc_version >> 8) & 0xFF, gc_version & 0xFF);
+        return -ENODEV;
+    }
+
+    dev->asic_name = asic->name;
+    dev->gc_version = gc_version;
+    memset(dev->gc_regs_base_addr, 0, sizeof(dev->gc_regs_base_addr));
+    memcpy(dev->gc_regs_base_addr, bases, sizeof(bases));
+
+    // MMIO registers are accessed at 4-byte intervals in regs2; indirect
+    // registers keep their raw SQ_IND_INDEX value
+    for_range(reg, 0, REG_MAX) {
+        reg_info_t info = gc_11_regs_infos[reg];
+        if (info.type == REG_MMIO) {
+            dev->reg_offsets[reg] =
+                (gc_11_regs_offsets[reg] + dev->gc_regs_base_addr[info.soc_index]) * 4;
+        } else {
+            dev->reg_offsets[reg] = gc_11_regs_offsets[reg];
+        }
+    }
+
+    fprintf(stdout, "[INFO] Register database: %s (GC %u.%u.%u)\n", asic->name,
+            gc_version >> 16, (gc_version >> 8) & 0xFF, gc_version & 0xFF);
+    return 0;
+}
 
-    reg_info_t reg_info = gc_11_regs_infos[reg];
-    uint64_t reg_offset = gc_11_regs_offsets[reg];
-    uint64_t base_offset = dev->gc_regs_base_addr[reg_info.soc_index];
-    uint64_t total_offset = reg_offset + base_offset;
+/**
+ * Byte offset of a register within the regs2 file.
+ */
+static inline uint64_t reg_file_offset(const amdgpu_t* dev, const reg_batch_op_t* op) {
+    HDB_ASSERT(dev->asic_name != NULL, "register database not resolved");
+    HDB_ASSERT(gc_11_regs_infos[op->reg].type == REG_MMIO,
+               "indirect registers go through SQ_IND_INDEX / SQ_IND_DATA");
+    return dev_reg_offset_at(dev, op->reg, op->index);
+}
 
-    // MMIO registers are accessed at 4-byte intervals
-    if (reg_info.type == REG_MMIO) {
-        total_offset *= 4;
+/**
+ * Program the SRBM/GRBM selector for subsequent regs2 accesses.
+ * 
+ * Skipped when the selector equals the last one programmed on this fd.
+ */
+static void regs2_set_state(reg_channel_t* ch, const regs2_ioc_data_t* ioc_data) {
+    if (ch->state_valid &&
+        memcmp(&ch->state, ioc_data, sizeof(*ioc_data)) == 0) {
+        return;
     }
 
-    // Set SRBM/GRBM state for this access
-    ret = hdb_ioctl(dev->regs2_fd,
-                    AMDGPU_DEBUGFS_REGS2_IOC_SET_STATE_V2,
-                    &ioc_data);
+    regs2_ioc_data_t state = *ioc_data;
+
+    int32_t ret = hdb_ioctl(ch->fd,
+                            AMDGPU_DEBUGFS_REGS2_IOC_SET_STATE_V2,
+                            &state);
     if (ret != 0) {
+        ch->state_valid = false;
         fprintf(stderr, "[ERROR] Failed to set register state: %d\n", ret);
         HDB_ASSERT(false, "AMDGPU_DEBUGFS_REGS2_IOC_SET_STATE_V2 failed");
     }
 
-    // Seek to register offset
-    off_t pos = lseek(dev->regs2_fd, total_offset, SEEK_SET);
-    if (pos != (off_t)total_offset) {
-        fprintf(stderr, "[ERROR] Failed to seek to register offset 0x%lx: %s\n",
-                total_offset, strerror(errno));
-        HDB_ASSERT(false, "lseek failed");
-    }
+    ch->state = *ioc_data;
+    ch->state_valid = true;
+}
+
+void dev_regs_invalidate_state(amdgpu_t* dev) {
+    dev->regs2_state_valid = false;
+}
 
-    // Perform read or write
+/**
+ * Transfer count dwords at a regs2 byte offset with one syscall.
+ */
+static void regs2_transfer(reg_channel_t* ch, reg_32_op_t op, uint64_t offset,
+                           uint32_t* data, size_t count) {
+    size_t bytes = count * sizeof(uint32_t);
     ssize_t size = 0;
+    uint64_t t0 = stats_begin();
+
     switch (op) {
     case REG_OP_READ:
-        size = read(dev->regs2_fd, value, 4);
+        size = pread(ch->fd, data, bytes, (off_t)offset);
         break;
     case REG_OP_WRITE:
-        size = write(dev->regs2_fd, value, 4);
+        size = pwrite(ch->fd, data, bytes, (off_t)offset);
         break;
     default:
         HDB_ASSERT(false, "unsupported register operation");
     }
+    stats_end(STAT_REG_ACCESS, t0);
+    stats_count(STAT_REG_DWORDS, count);
 
-    if (size != 4) {
-        fprintf(stderr, "[ERROR] Register access failed (expected 4 bytes, got %zd)\n",
-                size);
+    if (size != (ssize_t)bytes) {
+        fprintf(stderr, "[ERROR] Register access at 0x%lx failed "
+                "(expected %zu bytes, got %zd): %s\n",
+                offset, bytes, size, strerror(errno));
         HDB_ASSERT(false, "register read/write failed");
     }
 }
 
-void dev_setup_trap_handler(amdgpu_t* dev, uint64_t tba, uint64_t tma) {
+void dev_op_reg32(amdgpu_t* dev,
+                  gc_11_reg_t reg,
+                  regs2_ioc_data_t ioc_data,
+                  reg_32_op_t op,
+                  uint32_t* value) {
+    reg_batch_op_t batch_op = { .reg = reg, .op = op, .value = value };
+    reg_batch_group_t group = {
+        .ioc_data = ioc_data,
+        .ops = &batch_op,
+        .count = 1,
+    };
+
+    dev_op_reg32_batch(dev, &group, 1);
+}
+
+void dev_op_reg32_batch(amdgpu_t* dev,
+                        const reg_batch_group_t* groups,
+                        size_t group_count) {
+    reg_channel_t ch = {
+        .fd = dev->regs2_fd,
+        .state = dev->regs2_state,
+        .state_valid = dev->regs2_state_valid,
+    };
+
+    reg_channel_batch(dev, &ch, groups, group_count);
+
+    dev->regs2_state = ch.state;
+    dev->regs2_state_valid = ch.state_valid;
+}
+
+int32_t reg_channel_open(const amdgpu_t* dev, reg_channel_t* ch) {
+    *ch = (reg_channel_t){ .fd = -1 };
+
+    int fd = amdgpu_device_open_regs2(dev);
+    if (fd < 0) {
+        return fd;
+    }
+    ch->fd = fd;
+    return 0;
+}
+
+void reg_channel_close(reg_channel_t* ch) {
+    if (ch->fd >= 0) {
+        close(ch->fd);
+    }
+    *ch = (reg_channel_t){ .fd = -1 };
+}
+
+void reg_channel_batch(const amdgpu_t* dev, reg_channel_t* ch,
+                       const reg_batch_group_t* groups, size_t group_count) {
+    HDB_ASSERT(ch->fd >= 0, "regs2_fd not open");
+
+    for_range(g, 0, group_count) {
+        const reg_batch_group_t* group = &groups[g];
+        if (group->count == 0) {
+            continue;
+        }
+
+        regs2_set_state(ch, &group->ioc_data);
+
+        size_t i = 0;
+        while (i < group->count) {
+            const reg_batch_op_t* first = &group->ops[i];
+            HDB_ASSERT(first->value != NULL, "value pointer is NULL");
+
+            // Extend the run over same-kind ops on adjacent offsets
+            uint64_t offset = reg_file_offset(dev, first);
+            size_t run = 1;
+            while (i + run < group->count && run < REG_BATCH_MAX_RUN) {
+                const reg_batch_op_t* next = &group->ops[i + run];
+                if (next->op != first->op ||
+                    reg_file_offset(dev, next) != offset + run * 4) {
+                    break;
+                }
+                HDB_ASSERT(next->value != NULL, "value pointer is NULL");
+                run++;
+            }
+
+            if (run == 1) {
+                regs2_transfer(ch, first->op, offset, first->value, 1);
+            } else {
+                uint32_t buf[REG_BATCH_MAX_RUN];
+
+                if (first->op == REG_OP_WRITE) {
+                    for_range(k, 0, run) {
+                        buf[k] = *group->ops[i + k].value;
+                    }
+                }
+
+                regs2_transfer(ch, first->op, offset, buf, run);
+
+                if (first->op == REG_OP_READ) {
+                    for_range(k, 0, run) {
+                        *group->ops[i + k].value = buf[k];
+                    }
+                }
+            }
+
+            i += run;
+        }
+    }
+}
+
+int32_t dev_setup_trap_handler(amdgpu_t* dev, uint64_t tba, uint64_t tma) {
     HDB_ASSERT((tba & 0xFF) == 0, "TBA must be 256-byte aligned");
 
+    if (!dev_regs_available(dev)) {
+        fprintf(stderr, "[ERROR] Cannot install trap handler: no register access "
+                "for device 0x%04x\n", dev->device_id);
+        return -ENODEV;
+    }
+
     // Prepare register values
     reg_sq_shader_tma_lo_t tma_lo = { .raw = (uint32_t)(tma) };
     reg_sq_shader_tma_hi_t tma_hi = { .raw = (uint32_t)(tma >> 32) };
@@ -146,20 +431,32 @@ void dev_setup_trap_handler(amdgpu_t* dev, uint64_t tba, uint64_t tma) {
     // DANGER: This affects ALL processes using these VMIDs system-wide
     // DANGER: If TBA/TMA are invalid in another process's VA space, that
     //         process will hang or crash when a trap fires
-    fprintf(stdout, "[WARN] Installing trap handler for VMIDs 1-8 (INVASIVE)\n");
-    fprintf(stdout, "[WARN] TBA=0x%lx TMA=0x%lx\n", tba, tma);
+    HDB_LOG(stdout, "[WARN] Installing trap handler for VMIDs 1-8 (INVASIVE)\n");
+    HDB_LOG(stdout, "[WARN] TBA=0x%lx TMA=0x%lx\n", tba, tma);
+
+    // Same four writes for every VMID; TBA_LO..TMA_HI are adjacent, so
+    // each VMID costs one selector ioctl plus one contiguous pwrite
+    reg_batch_op_t ops[] = {
+        { REG_SQ_SHADER_TBA_LO, REG_OP_WRITE, &tba_lo.raw, 0 },
+        { REG_SQ_SHADER_TBA_HI, REG_OP_WRITE, &tba_hi.raw, 0 },
+        { REG_SQ_SHADER_TMA_LO, REG_OP_WRITE, &tma_lo.raw, 0 },
+        { REG_SQ_SHADER_TMA_HI, REG_OP_WRITE, &tma_hi.raw, 0 },
+    };
 
+    reg_batch_group_t groups[8];
     for_range(i, 1, 9) {
         ioc_data.srbm.vmid = i;
 
-        dev_op_reg32(dev, REG_SQ_SHADER_TBA_LO, ioc_data, REG_OP_WRITE, &tba_lo.raw);
-        dev_op_reg32(dev, REG_SQ_SHADER_TBA_HI, ioc_data, REG_OP_WRITE, &tba_hi.raw);
-
-        dev_op_reg32(dev, REG_SQ_SHADER_TMA_LO, ioc_data, REG_OP_WRITE, &tma_lo.raw);
-        dev_op_reg32(dev, REG_SQ_SHADER_TMA_HI, ioc_data, REG_OP_WRITE, &tma_hi.raw);
-
-        fprintf(stdout, "[INFO] VMID %zu: TBA/TMA installed\n", i);
+        groups[i - 1] = (reg_batch_group_t){
+            .ioc_data = ioc_data,
+            .ops = ops,
+            .count = ARRAY_SIZE(ops),
+        };
     }
 
-    fprintf(stdout, "[INFO] Trap handler setup complete\n");
+    dev_op_reg32_batch(dev, groups, ARRAY_SIZE(groups));
+    HDB_LOG(stdout, "[INFO] VMIDs 1-8: TBA/TMA installed\n");
+
+    HDB_LOG(stdout, "[INFO] Trap handler setup complete\n");
+    return 0;
 }
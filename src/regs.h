@@ -2,6 +2,7 @@
 
 #include "util.h"
 #include "bo.h"
+#include "regdb_gc11.h"
 #include <linux/ioctl.h>
 
 /**
@@ -25,30 +26,43 @@ typedef enum {
  * 
  * soc_index: Index into gc_regs_base_addr array for this register's block.
  * type: MMIO or indirect register type.
+ * count/stride: Instances (e.g. one per VMID) and their spacing in dwords.
  */
 typedef struct {
     uint32_t   soc_index;
     reg_type_t type;
+    uint32_t   count;
+    uint32_t   stride;
 } reg_info_t;
 
 /**
  * GC 11 (RDNA3) register enumeration.
  * 
- * This is a minimal subset for trap handler setup and wave control.
- * Full register database would be thousands of entries (see UMR project).
+ * Generated from regdb/gc_11.txt (see regdb_gc11.h): the SQ/SPI/GRBM/GCVM
+ * registers used for trap handler setup, wave control and fault decoding.
+ * Offsets are shared by gfx1100-1103; the ASICs differ in segment bases,
+ * which regs_resolve() reads from IP discovery.
  * 
  * DANGER: Register offsets are hardware-specific and may vary by ASIC.
  * DANGER: Writing wrong values can hang or reset the GPU.
  */
 typedef enum {
-    REG_SQ_SHADER_TBA_LO = 0,  // Trap Base Address (low 32 bits)
-    REG_SQ_SHADER_TBA_HI,      // Trap Base Address (high 32 bits)
-    REG_SQ_SHADER_TMA_LO,      // Trap Memory Address (low 32 bits)
-    REG_SQ_SHADER_TMA_HI,      // Trap Memory Address (high 32 bits)
-    REG_SQ_CMD,                // SQ command register (halt/resume waves)
+#define REGDB_ENUM(name, seg, offset, type, count, stride) REG_##name,
+    REGDB_GC11_REGS(REGDB_ENUM)
+#undef REGDB_ENUM
     REG_MAX,
 } gc_11_reg_t;
 
+/**
+ * Extract / insert a generated bitfield, e.g.
+ * REG_GET_FIELD(status, SQ_WAVE_STATUS, HALT).
+ */
+#define REG_GET_FIELD(value, reg, field) \
+    (((value) & reg##__##field##_MASK) >> reg##__##field##__SHIFT)
+#define REG_SET_FIELD(value, reg, field, x) \
+    (((value) & ~reg##__##field##_MASK) | \
+     (((uint32_t)(x) << reg##__##field##__SHIFT) & reg##__##field##_MASK))
+
 /**
  * SQ_SHADER_TBA_LO register layout.
  * 
@@ -119,24 +133,32 @@ typedef union {
 } reg_sq_cmd_t;
 
 /**
- * debugfs regs2 IOCTL data structure (v2).
+ * HW_REG_HW_ID1 layout (gfx11, read with s_getreg_b32 in the trap handler).
  * 
- * Used to set SRBM/GRBM state before register access.
- * Allows targeting specific SEs, SHs, CUs, VMIDs, etc.
+ * Identifies where a wave lives: SE / SA / WGP / SIMD / wave slot.
  * 
- * DANGER: use_srbm=1 with vmid=X affects that VMID's registers.
- * DANGER: xcc_id=(uint32_t)-1 means "all XCCs" (multi-die GPUs).
+ * DANGER: Field positions are from the RDNA3 ISA guide; verify on hardware.
  */
-typedef struct amdgpu_debugfs_regs2_iocdata_v2 {
-    uint32_t use_srbm, use_grbm, pg_lock;
-    struct {
-        uint32_t se, sh, instance;
-    } grbm;
+typedef union {
     struct {
-        uint32_t me, pipe, queue, vmid;
-    } srbm;
-    uint32_t xcc_id;
-} regs2_ioc_data_t;
+        uint32_t wave_id   : 5;   // Wave slot within the SIMD
+        uint32_t reserved0 : 3;
+        uint32_t simd_id   : 2;   // SIMD within the WGP
+        uint32_t wgp_id    : 4;   // WGP within the shader array
+        uint32_t reserved1 : 2;
+        uint32_t sa_id     : 1;   // Shader array within the SE
+        uint32_t reserved2 : 1;
+        uint32_t se_id     : 3;   // Shader engine
+        uint32_t reserved3 : 8;
+        uint32_t dp_rate   : 3;
+    };
+    uint32_t raw;
+} reg_hw_id1_t;
+
+/**
+ * regs2_ioc_data_t (the debugfs regs2 selector) is defined in bo.h so
+ * the device context can cache the last programmed value.
+ */
 
 /**
  * debugfs regs2 IOCTL magic numbers.
@@ -145,9 +167,8 @@ typedef struct amdgpu_debugfs_regs2_iocdata_v2 {
     _IOW(0x20, 0x2, struct amdgpu_debugfs_regs2_iocdata_v2)
 
 /**
- * Register offset table (populated per-ASIC).
+ * Register offset table (dword offsets within the register's segment).
  * 
- * DANGER: Hardcoded for gfx1100 (Navi31). Other gfx11 variants may differ.
  * DANGER: Using wrong offsets can write to unintended registers.
  */
 extern const uint64_t gc_11_regs_offsets[REG_MAX];
@@ -157,6 +178,52 @@ extern const uint64_t gc_11_regs_offsets[REG_MAX];
  */
 extern const reg_info_t gc_11_regs_infos[REG_MAX];
 
+/**
+ * Resolve the register database for an opened device.
+ * 
+ * Identifies the ASIC and GC segment bases from sysfs IP discovery,
+ * falling back to the database's per-ASIC bases by PCI device ID, then
+ * fills dev->reg_offsets so every access is a single table lookup.
+ * 
+ * @param dev: Device context (drm_fd and device_id set)
+ * @return: 0 on success, -ENODEV if the GPU is not a known gfx11 ASIC
+ *          (offsets then stay unresolved and register access asserts)
+ */
+int32_t regs_resolve(amdgpu_t* dev);
+
+/**
+ * Can registers be accessed (database resolved and regs2 open)?
+ *
+ * Device init succeeds without either; check this before register access.
+ */
+static inline bool dev_regs_available(const amdgpu_t* dev) {
+    return dev->asic_name != NULL && dev->regs2_fd >= 0;
+}
+
+/**
+ * Register name ("SQ_CMD"), for logs and the debugger UI.
+ */
+const char* regs_name(gc_11_reg_t reg);
+
+/**
+ * Resolved regs2 byte offset (MMIO) or SQ_IND_INDEX value (indirect).
+ */
+static inline uint64_t dev_reg_offset(const amdgpu_t* dev, gc_11_reg_t reg) {
+    HDB_ASSERT(reg < REG_MAX, "invalid register enum");
+    return dev->reg_offsets[reg];
+}
+
+/**
+ * Resolved offset of instance index of a per-instance register.
+ */
+static inline uint64_t dev_reg_offset_at(const amdgpu_t* dev, gc_11_reg_t reg,
+                                         uint32_t index) {
+    HDB_ASSERT(reg < REG_MAX, "invalid register enum");
+    HDB_ASSERT(index < gc_11_regs_infos[reg].count, "register instance out of range");
+    uint64_t scale = gc_11_regs_infos[reg].type == REG_MMIO ? 4 : 1;
+    return dev->reg_offsets[reg] + (uint64_t)index * gc_11_regs_infos[reg].stride * scale;
+}
+
 /**
  * Register access helper with SRBM/GRBM state setup.
  * 
@@ -169,6 +236,7 @@ extern const reg_info_t gc_11_regs_infos[REG_MAX];
  * DANGER: Requires root or CAP_SYS_ADMIN to open debugfs regs2.
  * DANGER: Writes to MMIO registers take effect immediately.
  * DANGER: Can affect other processes if VMID is shared.
+ * DANGER: Asserts unless dev_regs_available(); callers check it first.
  */
 void dev_op_reg32(amdgpu_t* dev,
                   gc_11_reg_t reg,
@@ -176,12 +244,106 @@ void dev_op_reg32(amdgpu_t* dev,
                   reg_32_op_t op,
                   uint32_t* value);
 
+/**
+ * One register operation inside a batch.
+ */
+typedef struct {
+    gc_11_reg_t reg;    // Register to access
+    reg_32_op_t op;     // Read or write
+    uint32_t*   value;  // Source (write) or destination (read)
+    uint32_t    index;  // Instance of a per-instance register (e.g. VMID)
+} reg_batch_op_t;
+
+/**
+ * A group of register operations sharing one SRBM/GRBM selector.
+ */
+typedef struct {
+    regs2_ioc_data_t ioc_data;  // Selector programmed once for the group
+    reg_batch_op_t*  ops;       // Operations, executed in order
+    size_t           count;     // Number of operations
+} reg_batch_group_t;
+
+/**
+ * Maximum number of adjacent registers merged into one pread/pwrite.
+ */
+#define REG_BATCH_MAX_RUN  64
+
+/**
+ * Forget the cached regs2 selector.
+ * 
+ * The selector programmed with AMDGPU_DEBUGFS_REGS2_IOC_SET_STATE_V2 is
+ * cached in the device context and the ioctl is skipped when the next
+ * access uses an identical selector. Call this whenever the kernel-side
+ * state may have changed behind our back (e.g. after reopening regs2_fd,
+ * a GPU reset, or sharing the fd with another process).
+ * 
+ * @param dev: Device context
+ */
+void dev_regs_invalidate_state(amdgpu_t* dev);
+
+/**
+ * reg_channel_t: A regs2 file descriptor with its own selector cache.
+ * 
+ * The kernel keeps the regs2 selector per open file, so threads walking
+ * different SE/SH/instances at the same time each need their own channel;
+ * sharing dev->regs2_fd would race on the selector. dev_op_reg32_batch()
+ * is reg_channel_batch() on the device's own descriptor.
+ */
+typedef struct {
+    int               fd;           // regs2 file descriptor (-1 if closed)
+    regs2_ioc_data_t  state;        // Last selector programmed on fd
+    bool              state_valid;  // state matches the kernel
+} reg_channel_t;
+
+/**
+ * Open another regs2 descriptor for the device.
+ * 
+ * @param dev: Device context
+ * @param ch: Output channel
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t reg_channel_open(const amdgpu_t* dev, reg_channel_t* ch);
+
+/**
+ * Close a channel (safe to call on a closed one).
+ */
+void reg_channel_close(reg_channel_t* ch);
+
+/**
+ * dev_op_reg32_batch() on a channel.
+ * 
+ * DANGER: A channel must not be used by two threads at once.
+ */
+void reg_channel_batch(const amdgpu_t* dev, reg_channel_t* ch,
+                       const reg_batch_group_t* groups, size_t group_count);
+
+/**
+ * Batched register access.
+ * 
+ * For each group, the selector is set once, then operations are issued
+ * with pread()/pwrite(). Consecutive operations of the same kind on
+ * adjacent dword offsets (e.g. TBA_LO..TMA_HI) are merged into a single
+ * contiguous transfer.
+ * 
+ * @param dev: Device context
+ * @param groups: Operation groups
+ * @param group_count: Number of groups
+ * 
+ * DANGER: Same privileges and side effects as dev_op_reg32().
+ * DANGER: Merged writes hit registers in ascending offset order.
+ */
+void dev_op_reg32_batch(amdgpu_t* dev,
+                        const reg_batch_group_t* groups,
+                        size_t group_count);
+
 /**
  * Setup trap handler for all user VMIDs (1-8).
  * 
  * @param dev: Device context
  * @param tba: Trap handler code address (GPU VA, 256-byte aligned)
  * @param tma: Trap scratch buffer address (GPU VA)
+ * @return: 0 on success, -ENODEV if registers are not accessible (unknown
+ *          ASIC or no regs2, see dev_regs_available())
  * 
  * DANGER: Affects VMIDs 1-8 globally on the GPU.
  * DANGER: Other processes using these VMIDs will have trap handler enabled.
@@ -189,4 +351,4 @@ void dev_op_reg32(amdgpu_t* dev,
  *         that process's waves will fault or hang when trap fires.
  * DANGER: Only one debugger instance should call this at a time.
  */
-void dev_setup_trap_handler(amdgpu_t* dev, uint64_t tba, uint64_t tma);
+int32_t dev_setup_trap_handler(amdgpu_t* dev, uint64_t tba, uint64_t tma);
@@ -0,0 +1,195 @@
+#include "sdma.h"
+
+/**
+ * SDMA packet encoding (SDMA 4.0+, including the gfx11 SDMA 6.0).
+ */
+#define SDMA_OPCODE_NOP              0
+#define SDMA_OPCODE_COPY             1
+#define SDMA_COPY_SUB_OPCODE_LINEAR  0
+
+#define SDMA_PKT_HEADER(op, sub_op)  (((op) & 0xFF) | (((sub_op) & 0xFF) << 8))
+
+/**
+ * Largest COPY_LINEAR byte count (COUNT holds bytes - 1, 22 bits).
+ */
+#define SDMA_COPY_MAX_BYTES          0x3FFFE0u
+
+/**
+ * SDMA IBs must be a multiple of 8 dwords.
+ */
+#define SDMA_IB_ALIGN_DWORDS         8
+
+/**
+ * Staging offsets of sdma_read() regions are cache-line aligned.
+ */
+#define SDMA_STAGING_ALIGN           64
+
+#define SDMA_XFER_TIMEOUT_NS         (1000ull * 1000 * 1000)
+
+static void sdma_copy_linear(pkt3_packets_t* packets, uint64_t dst, uint64_t src,
+                             uint64_t size) {
+    while (size > 0) {
+        uint32_t bytes = (uint32_t)MIN(size, (uint64_t)SDMA_COPY_MAX_BYTES);
+
+        pkt3_reserve(packets, 7);
+        pkt3_emit(packets, SDMA_PKT_HEADER(SDMA_OPCODE_COPY, SDMA_COPY_SUB_OPCODE_LINEAR));
+        pkt3_emit(packets, bytes - 1);
+        pkt3_emit(packets, 0);  // No endian swap
+        pkt3_emit(packets, (uint32_t)(src & 0xFFFFFFFF));
+        pkt3_emit(packets, (uint32_t)(src >> 32));
+        pkt3_emit(packets, (uint32_t)(dst & 0xFFFFFFFF));
+        pkt3_emit(packets, (uint32_t)(dst >> 32));
+
+        src += bytes;
+        dst += bytes;
+        size -= bytes;
+    }
+}
+
+/**
+ * Pad the stream with NOPs, submit it on the SDMA ring and wait.
+ */
+static int32_t sdma_submit(sdma_xfer_t* x, pkt3_packets_t* packets,
+                           amdgpu_bo_handle other) {
+    while (packets->count % SDMA_IB_ALIGN_DWORDS != 0) {
+        da_append(packets, SDMA_PKT_HEADER(SDMA_OPCODE_NOP, 0));
+    }
+
+    amdgpu_bo_handle bos[2] = { x->staging.bo_handle, other };
+    amdgpu_submit_t submit = {0};
+    int32_t ret = dev_submit_ip(x->dev, AMDGPU_HW_IP_DMA, x->ring, packets,
+                                bos, 2, NULL, 0, &submit);
+    pkt3_free(packets);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] SDMA submission failed: %d\n", ret);
+        return ret;
+    }
+
+    x->submits++;
+    ret = dev_wait(x->dev, &submit, SDMA_XFER_TIMEOUT_NS);
+    dev_submit_cleanup(x->dev, &submit);
+    return ret;
+}
+
+int32_t sdma_xfer_init(amdgpu_t* dev, size_t staging_size, sdma_xfer_t* x) {
+    *x = (sdma_xfer_t){0};
+
+    if (dev->dma_rings == 0) {
+        fprintf(stderr, "[WARN] No SDMA rings; transfer engine unavailable\n");
+        return -ENODEV;
+    }
+
+    if (staging_size == 0) {
+        staging_size = SDMA_STAGING_DEFAULT_SIZE;
+    }
+
+    // Cached GTT: the CPU reads results at system memory speed
+    int32_t ret = bo_alloc(dev, staging_size, AMDGPU_GEM_DOMAIN_GTT, false, &x->staging);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to allocate SDMA staging BO: %d\n", ret);
+        *x = (sdma_xfer_t){0};
+        return ret;
+    }
+
+    x->dev = dev;
+    x->ring = (uint32_t)__builtin_ctz(dev->dma_rings);
+    return 0;
+}
+
+void sdma_xfer_fini(sdma_xfer_t* x) {
+    if (x->dev == NULL) {
+        return;
+    }
+
+    bo_free(x->dev, &x->staging);
+    *x = (sdma_xfer_t){0};
+}
+
+int32_t sdma_read(sdma_xfer_t* x, const amdgpu_bo_t* src,
+                  const sdma_region_t* regions, uint32_t count,
+                  const void** data) {
+    size_t total = 0;
+    for_range(i, 0, count) {
+        HDB_ASSERT(regions[i].offset + regions[i].size <= src->size,
+                   "SDMA read outside the source BO");
+        total = ALIGN_UP(total, SDMA_STAGING_ALIGN) + regions[i].size;
+    }
+    if (total > x->staging.size) {
+        return -E2BIG;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    pkt3_packets_t packets;
+    dev_packets_begin(x->dev, &packets);
+
+    size_t at = 0;
+    for_range(i, 0, count) {
+        at = ALIGN_UP(at, SDMA_STAGING_ALIGN);
+        sdma_copy_linear(&packets, x->staging.va_addr + at,
+                         src->va_addr + regions[i].offset, regions[i].size);
+        data[i] = (const uint8_t*)x->staging.host_addr + at;
+        at += regions[i].size;
+    }
+
+    int32_t ret = sdma_submit(x, &packets, src->bo_handle);
+    if (ret == 0) {
+        x->bytes_read += total;
+    }
+    return ret;
+}
+
+int32_t sdma_write(sdma_xfer_t* x, amdgpu_bo_t* dst, uint64_t offset,
+                   const void* src, size_t size) {
+    HDB_ASSERT(offset + size <= dst->size, "SDMA write outside the destination BO");
+
+    const uint8_t* bytes = src;
+    while (size > 0) {
+        size_t chunk = MIN(size, x->staging.size);
+        memcpy(x->staging.host_addr, bytes, chunk);
+
+        pkt3_packets_t packets;
+        dev_packets_begin(x->dev, &packets);
+        sdma_copy_linear(&packets, dst->va_addr + offset, x->staging.va_addr, chunk);
+
+        int32_t ret = sdma_submit(x, &packets, dst->bo_handle);
+        if (ret != 0) {
+            return ret;
+        }
+
+        x->bytes_written += chunk;
+        bytes += chunk;
+        offset += chunk;
+        size -= chunk;
+    }
+    return 0;
+}
+
+int32_t sdma_read_slots(sdma_xfer_t* x, mailbox_t* mb, const uint32_t* slots,
+                        uint32_t count, const void** data) {
+    if (count == 0) {
+        return 0;
+    }
+
+    sdma_region_t stack_regions[64];
+    sdma_region_t* regions = count <= ARRAY_SIZE(stack_regions) ? stack_regions :
+                             malloc(count * sizeof(*regions));
+    if (regions == NULL) {
+        return -ENOMEM;
+    }
+
+    for_range(i, 0, count) {
+        HDB_ASSERT(slots[i] < mb->slot_count, "mailbox slot out of range");
+        regions[i] = (sdma_region_t){
+            .offset = mb->slots_offset + (uint64_t)slots[i] * mb->slot_stride,
+            .size = mb->slot_stride,
+        };
+    }
+
+    int32_t ret = sdma_read(x, &mb->bo, regions, count, data);
+    if (regions != stack_regions) {
+        free(regions);
+    }
+    return ret;
+}
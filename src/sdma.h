@@ -0,0 +1,103 @@
+#pragma once
+
+#include "amdgpu_device.h"
+#include "mailbox.h"
+
+/**
+ * SDMA transfer engine.
+ *
+ * CPU reads of VRAM through the BAR, and of uncached / write-combined
+ * GTT such as the TMA mailbox, are uncached and very slow. The transfer
+ * engine copies just the requested regions into a cacheable GTT staging
+ * BO with SDMA COPY_LINEAR packets (an AMDGPU_HW_IP_DMA submission), then
+ * the CPU reads them from system memory at cache speed. Large uploads
+ * take the reverse path: memcpy into staging, SDMA into the destination.
+ *
+ * Every call submits once and waits for the copy; the staging BO holds
+ * the results until the next call.
+ *
+ * DANGER: Not thread-safe; one user per engine.
+ */
+
+#define SDMA_STAGING_DEFAULT_SIZE  (4 * 1024 * 1024)
+
+/**
+ * sdma_region_t: Byte range of a BO.
+ */
+typedef struct {
+    uint64_t offset;
+    uint32_t size;
+} sdma_region_t;
+
+/**
+ * sdma_xfer_t: Transfer engine state.
+ */
+typedef struct {
+    amdgpu_t*    dev;
+    amdgpu_bo_t  staging;        // Cacheable GTT staging BO
+    uint32_t     ring;           // SDMA ring used
+    uint64_t     bytes_read;     // Statistics
+    uint64_t     bytes_written;
+    uint64_t     submits;
+} sdma_xfer_t;
+
+/**
+ * Create a transfer engine.
+ *
+ * @param dev: Device context
+ * @param staging_size: Staging BO size (0 = SDMA_STAGING_DEFAULT_SIZE);
+ *                      bounds one sdma_read()
+ * @param x: Output engine
+ * @return: 0 on success, -ENODEV without SDMA rings, negative error code
+ */
+int32_t sdma_xfer_init(amdgpu_t* dev, size_t staging_size, sdma_xfer_t* x);
+
+/**
+ * Free the staging BO.
+ *
+ * @param x: Engine (safe to call on a zeroed engine)
+ */
+void sdma_xfer_fini(sdma_xfer_t* x);
+
+/**
+ * Copy regions of a BO into staging and wait.
+ *
+ * @param x: Engine
+ * @param src: Source BO (any domain)
+ * @param regions: Byte ranges of src
+ * @param count: Number of regions
+ * @param data: Output, one pointer into staging per region (valid until
+ *              the next call on x)
+ * @return: 0 on success, -E2BIG if the regions do not fit in staging,
+ *          negative error code on failure
+ */
+int32_t sdma_read(sdma_xfer_t* x, const amdgpu_bo_t* src,
+                  const sdma_region_t* regions, uint32_t count,
+                  const void** data);
+
+/**
+ * Upload host memory into a BO through staging (any size).
+ *
+ * @param x: Engine
+ * @param dst: Destination BO (any domain)
+ * @param offset: Byte offset in dst
+ * @param src: Host data
+ * @param size: Bytes
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t sdma_write(sdma_xfer_t* x, amdgpu_bo_t* dst, uint64_t offset,
+                   const void* src, size_t size);
+
+/**
+ * Copy trapped waves' slots out of the mailbox.
+ *
+ * @param x: Engine
+ * @param mb: Mailbox
+ * @param slots: Slot indices (e.g. from mailbox_drain())
+ * @param count: Number of slots
+ * @param data: Output slot copies, laid out like mailbox_slot() (feed them
+ *              to regfile_capture_copy())
+ * @return: 0 on success, negative error code (as sdma_read())
+ */
+int32_t sdma_read_slots(sdma_xfer_t* x, mailbox_t* mb, const uint32_t* slots,
+                        uint32_t count, const void** data);
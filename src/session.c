@@ -0,0 +1,183 @@
+#include "session.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/**
+ * Wake source: session_stop() ends the device's event_loop_run().
+ */
+static void session_on_wake(event_loop_t* loop, event_source_t* src, uint32_t events) {
+    (void)events;
+
+    uint64_t count = 0;
+    if (read(src->fd, &count, sizeof(count)) != sizeof(count)) {
+        return;
+    }
+    event_loop_stop(loop);
+}
+
+/**
+ * Open one device plus its event loop and wake eventfd.
+ */
+static int32_t session_device_open(session_t* s, const char* path,
+                                   const amdgpu_device_desc_t* desc) {
+    session_device_t* sd = &s->devices[s->count];
+    *sd = (session_device_t){
+        .session = s,
+        .index = s->count,
+        .wake_fd = -1,
+    };
+    if (desc != NULL) {
+        sd->desc = *desc;
+    }
+
+    int32_t ret = amdgpu_device_init(path, &sd->dev);
+    if (ret != 0) {
+        fprintf(stderr, "[WARN] Skipping %s: %d\n", path, ret);
+        return ret;
+    }
+
+    if (desc == NULL) {
+        memcpy(sd->desc.pci_bus_id, sd->dev.pci_bus_id, sizeof(sd->desc.pci_bus_id));
+        sd->desc.device_id = sd->dev.device_id;
+        char* node = strstr(path, "renderD") ? sd->desc.render_path : sd->desc.primary_path;
+        snprintf(node, sizeof(sd->desc.render_path), "%s", path);
+    }
+
+    ret = event_loop_init(&sd->loop);
+    if (ret != 0) {
+        goto fail_dev;
+    }
+
+    sd->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (sd->wake_fd < 0) {
+        ret = -errno;
+        fprintf(stderr, "[ERROR] Failed to create session wake eventfd: %d\n", ret);
+        goto fail_loop;
+    }
+
+    ret = event_loop_add_fd(&sd->loop, sd->wake_fd, EPOLLIN, session_on_wake, sd, NULL);
+    if (ret != 0) {
+        goto fail_wake;
+    }
+
+    fprintf(stdout, "[INFO] Session device %u: %s (%s, device_id=0x%x)\n",
+            sd->index, path, sd->desc.pci_bus_id, sd->desc.device_id);
+    s->count++;
+    return 0;
+
+fail_wake:
+    close(sd->wake_fd);
+fail_loop:
+    event_loop_fini(&sd->loop);
+fail_dev:
+    amdgpu_device_cleanup(&sd->dev);
+    return ret;
+}
+
+int32_t session_open(session_t* s, const char* const* paths, uint32_t path_count) {
+    *s = (session_t){0};
+
+    if (paths != NULL) {
+        for_range(i, 0, MIN(path_count, (uint32_t)SESSION_MAX_DEVICES)) {
+            session_device_open(s, paths[i], NULL);
+        }
+    } else {
+        amdgpu_device_desc_t descs[SESSION_MAX_DEVICES];
+        uint32_t found = 0;
+        int32_t ret = amdgpu_enumerate_devices(descs, SESSION_MAX_DEVICES, &found);
+        if (ret != 0) {
+            return ret;
+        }
+
+        for_range(i, 0, found) {
+            const char* path = descs[i].render_path[0] ? descs[i].render_path :
+                                                         descs[i].primary_path;
+            session_device_open(s, path, &descs[i]);
+        }
+    }
+
+    if (s->count == 0) {
+        fprintf(stderr, "[ERROR] No GPU could be opened for the session\n");
+        return -ENODEV;
+    }
+    return 0;
+}
+
+void session_close(session_t* s) {
+    session_stop(s);
+    session_join(s);
+
+    for_range(i, 0, s->count) {
+        session_device_t* sd = &s->devices[i];
+        event_loop_fini(&sd->loop);
+        close(sd->wake_fd);
+        amdgpu_device_cleanup(&sd->dev);
+    }
+    *s = (session_t){0};
+}
+
+static void* session_thread_main(void* arg) {
+    session_device_t* sd = arg;
+    session_t* s = sd->session;
+
+    sd->result = s->fn != NULL ? s->fn(sd, s->user) : event_loop_run(&sd->loop);
+    return NULL;
+}
+
+int32_t session_start(session_t* s, session_device_fn_t fn, void* user) {
+    s->fn = fn;
+    s->user = user;
+
+    for_range(i, 0, s->count) {
+        session_device_t* sd = &s->devices[i];
+        HDB_ASSERT(!sd->running, "session device thread already running");
+
+        sd->result = 0;
+        int32_t ret = -pthread_create(&sd->thread, NULL, session_thread_main, sd);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] Failed to start thread for device %u: %d\n",
+                    sd->index, ret);
+            return ret;
+        }
+        sd->running = true;
+    }
+    return 0;
+}
+
+void session_stop(session_t* s) {
+    uint64_t one = 1;
+
+    for_range(i, 0, s->count) {
+        if (write(s->devices[i].wake_fd, &one, sizeof(one)) != sizeof(one)) {
+            fprintf(stderr, "[WARN] Failed to wake session device %zu\n", i);
+        }
+    }
+}
+
+int32_t session_join(session_t* s) {
+    int32_t result = 0;
+
+    for_range(i, 0, s->count) {
+        session_device_t* sd = &s->devices[i];
+        if (!sd->running) {
+            continue;
+        }
+
+        pthread_join(sd->thread, NULL);
+        sd->running = false;
+        if (result == 0 && sd->result != 0) {
+            result = sd->result;
+        }
+    }
+    return result;
+}
+
+session_device_t* session_find(session_t* s, const char* pci_bus_id) {
+    for_range(i, 0, s->count) {
+        if (strcmp(s->devices[i].desc.pci_bus_id, pci_bus_id) == 0) {
+            return &s->devices[i];
+        }
+    }
+    return NULL;
+}
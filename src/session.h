@@ -0,0 +1,110 @@
+#pragma once
+
+#include "amdgpu_device.h"
+#include "event_loop.h"
+
+/**
+ * Multi-GPU debugger session.
+ *
+ * A session opens several GPUs (every AMD GPU by default), each with its
+ * own amdgpu_t context (regs2 paired by PCI address) and its own event
+ * loop. session_start() runs one thread per device, so dispatches on
+ * every GPU of a node can be driven and debugged at once without any
+ * device waiting on another.
+ *
+ * Each device thread owns its amdgpu_t and event loop; nothing in a
+ * session_device_t may be touched from another thread while it runs.
+ * session_stop() is the exception: it interrupts every loop.
+ */
+
+#define SESSION_MAX_DEVICES  AMDGPU_MAX_DEVICES
+
+typedef struct session session_t;
+typedef struct session_device session_device_t;
+
+/**
+ * Per-device thread body.
+ *
+ * @param sd: Device (sd->dev, sd->loop are owned by this thread)
+ * @param user: session_start() argument
+ * @return: 0 on success, negative error code on failure
+ */
+typedef int32_t (*session_device_fn_t)(session_device_t* sd, void* user);
+
+/**
+ * session_device_t: One GPU of a session.
+ */
+struct session_device {
+    session_t*            session;
+    uint32_t              index;    // Position in session->devices
+    amdgpu_device_desc_t  desc;     // Nodes and PCI address
+    amdgpu_t              dev;      // Device context
+    event_loop_t          loop;     // Device event loop (fences, traps)
+    int                   wake_fd;  // eventfd in loop; session_stop() writes it
+    pthread_t             thread;
+    int32_t               result;   // Thread function return value
+    bool                  running;  // Thread started and not yet joined
+};
+
+/**
+ * session_t: Set of GPUs debugged together.
+ */
+struct session {
+    session_device_t     devices[SESSION_MAX_DEVICES];
+    uint32_t             count;
+    session_device_fn_t  fn;
+    void*                user;
+};
+
+/**
+ * Open GPUs into a session.
+ *
+ * @param s: Output session
+ * @param paths: DRM node paths, or NULL for every AMD GPU in the system
+ * @param path_count: Number of paths
+ * @return: 0 on success (at least one device opened), negative error code
+ *
+ * A GPU that fails to open is skipped with a warning.
+ */
+int32_t session_open(session_t* s, const char* const* paths, uint32_t path_count);
+
+/**
+ * Stop and join the device threads, then close every device.
+ *
+ * @param s: Session
+ */
+void session_close(session_t* s);
+
+/**
+ * Start one thread per device.
+ *
+ * @param s: Session
+ * @param fn: Thread body; NULL runs event_loop_run() on sd->loop until
+ *            session_stop()
+ * @param user: Passed to fn
+ * @return: 0 on success, negative error code if a thread failed to start
+ *          (already started threads keep running)
+ */
+int32_t session_start(session_t* s, session_device_fn_t fn, void* user);
+
+/**
+ * Interrupt every device's event_loop_run() (threadsafe).
+ *
+ * @param s: Session
+ */
+void session_stop(session_t* s);
+
+/**
+ * Wait for every device thread to return.
+ *
+ * @param s: Session
+ * @return: 0 if all threads returned 0, else the first failing result
+ */
+int32_t session_join(session_t* s);
+
+/**
+ * Look up a device by PCI address ("dddd:bb:dd.f").
+ *
+ * @return: Device, or NULL if not in the session
+ */
+session_device_t* session_find(session_t* s, const char* pci_bus_id);
@@ -0,0 +1,351 @@
+#include "shader_cache.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * hdb_compile_spirv_to_bin() is not thread-safe; misses take this lock.
+ */
+static pthread_mutex_t shader_cache_compile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline uint64_t shader_cache_rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t shader_cache_fmix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * Chain size bytes into a 64-bit hash (MurmurHash3 block mixing).
+ */
+static uint64_t shader_cache_hash(uint64_t h, const void* data, size_t size) {
+    const uint8_t* p = data;
+
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t k;
+        memcpy(&k, p, sizeof(k));
+        k *= 0x87C37B91114253D5ull;
+        k = shader_cache_rotl(k, 31);
+        k *= 0x4CF5AD432745937Full;
+        h ^= k;
+        h = shader_cache_rotl(h, 27) * 5 + 0x52DCE729;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, p, size);
+    h ^= shader_cache_fmix(tail ^ size);
+    return h;
+}
+
+/**
+ * 128-bit key of (SPIR-V, stage, family, compiler version).
+ */
+static void shader_cache_key(const shader_cache_t* c, const void* spirv, size_t size,
+                             hdb_shader_stage_t stage, uint64_t key[2]) {
+    const char* version = hdb_compiler_version();
+    uint32_t stage_u32 = stage;
+    uint64_t seeds[2] = { 0x6864625F73686164ull, 0x9E3779B97F4A7C15ull };
+
+    for_range(i, 0, 2) {
+        uint64_t h = seeds[i];
+        h = shader_cache_hash(h, spirv, size);
+        h = shader_cache_hash(h, &stage_u32, sizeof(stage_u32));
+        h = shader_cache_hash(h, c->family, strlen(c->family) + 1);
+        h = shader_cache_hash(h, version, strlen(version) + 1);
+        key[i] = shader_cache_fmix(h);
+    }
+}
+
+static void shader_cache_path(const shader_cache_t* c, const uint64_t key[2],
+                              char* path, size_t size) {
+    snprintf(path, size, "%s/%016lx%016lx.bin", c->dir, key[0], key[1]);
+}
+
+/**
+ * mkdir -p.
+ */
+static int32_t shader_cache_mkdirs(char* path) {
+    for (char* p = path + 1; ; p++) {
+        if (*p != '/' && *p != '\0') {
+            continue;
+        }
+
+        char saved = *p;
+        *p = '\0';
+        int ret = mkdir(path, 0755);
+        *p = saved;
+        if (ret != 0 && errno != EEXIST) {
+            return -errno;
+        }
+        if (saved == '\0') {
+            return 0;
+        }
+    }
+}
+
+int32_t shader_cache_open(const char* dir, const char* family, shader_cache_t* c) {
+    *c = (shader_cache_t){ .family = family };
+
+    int n;
+    if (dir != NULL) {
+        n = snprintf(c->dir, sizeof(c->dir), "%s", dir);
+    } else if (getenv("XDG_CACHE_HOME") != NULL) {
+        n = snprintf(c->dir, sizeof(c->dir), "%s/hdb/shaders", getenv("XDG_CACHE_HOME"));
+    } else if (getenv("HOME") != NULL) {
+        n = snprintf(c->dir, sizeof(c->dir), "%s/.cache/hdb/shaders", getenv("HOME"));
+    } else {
+        return -ENOENT;
+    }
+    if (n <= 0 || (size_t)n >= sizeof(c->dir)) {
+        return -ENAMETOOLONG;
+    }
+
+    int32_t ret = shader_cache_mkdirs(c->dir);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to create shader cache %s: %d\n", c->dir, ret);
+    }
+    return ret;
+}
+
+/**
+ * Map and validate an entry; -ENOENT if absent, -EINVAL if corrupt.
+ */
+static int32_t shader_cache_lookup(const shader_cache_t* c, const uint64_t key[2],
+                                   shader_cache_entry_t* e) {
+    char path[PATH_MAX];
+    shader_cache_path(c, key, path, sizeof(path));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(shader_cache_header_t)) {
+        close(fd);
+        return -EINVAL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -errno;
+    }
+
+    const shader_cache_header_t* h = map;
+    bool valid = h->magic == SHADER_CACHE_MAGIC && h->version == SHADER_CACHE_VERSION &&
+                 h->key[0] == key[0] && h->key[1] == key[1] &&
+                 h->bin_offset <= size && h->bin_size <= size - h->bin_offset &&
+                 (h->debug_info_size == 0 ||
+                  (h->debug_offset <= size && h->debug_info_size <= size - h->debug_offset));
+    if (!valid) {
+        munmap(map, size);
+        return -EINVAL;
+    }
+
+    const uint8_t* base = map;
+    *e = (shader_cache_entry_t){
+        .map = map,
+        .map_size = size,
+        .shader = {
+            .bin = base + h->bin_offset,
+            .bin_size = h->bin_size,
+            .rsrc1 = h->rsrc1,
+            .rsrc2 = h->rsrc2,
+            .rsrc3 = h->rsrc3,
+            .debug_info = h->debug_info_size ? base + h->debug_offset : NULL,
+            .debug_info_count = h->debug_info_count,
+            .debug_info_size = h->debug_info_size,
+        },
+    };
+    return 0;
+}
+
+/**
+ * Copy a freshly compiled shader into an anonymous mapping, for when it
+ * could not be stored; shader_cache_release() unmaps it like an entry.
+ */
+static int32_t shader_cache_copy_out(const hdb_shader_t* shader, shader_cache_entry_t* e) {
+    size_t debug_offset = ALIGN_UP(shader->bin_size, (size_t)8);
+    size_t debug_size = shader->debug_info ? shader->debug_info_size : 0;
+    size_t size = MAX(debug_offset + debug_size, (size_t)1);
+
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        return -errno;
+    }
+
+    uint8_t* base = map;
+    memcpy(base, shader->bin, shader->bin_size);
+    if (debug_size != 0) {
+        memcpy(base + debug_offset, shader->debug_info, debug_size);
+    }
+
+    *e = (shader_cache_entry_t){
+        .map = map,
+        .map_size = size,
+        .shader = {
+            .bin = base,
+            .bin_size = shader->bin_size,
+            .rsrc1 = shader->rsrc1,
+            .rsrc2 = shader->rsrc2,
+            .rsrc3 = shader->rsrc3,
+            .debug_info = debug_size ? base + debug_offset : NULL,
+            .debug_info_count = debug_size ? shader->debug_info_count : 0,
+            .debug_info_size = debug_size,
+        },
+    };
+    return 0;
+}
+
+static int32_t shader_cache_write_all(int fd, const void* data, size_t size) {
+    const uint8_t* p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+int32_t shader_cache_put(shader_cache_t* c, const void* spirv, size_t size,
+                         hdb_shader_stage_t stage, const hdb_shader_t* shader) {
+    uint64_t key[2];
+    shader_cache_key(c, spirv, size, stage, key);
+
+    uint64_t bin_offset = ALIGN_UP(sizeof(shader_cache_header_t), SHADER_CACHE_ALIGN);
+    uint64_t debug_offset = ALIGN_UP(bin_offset + shader->bin_size, SHADER_CACHE_ALIGN);
+    shader_cache_header_t h = {
+        .magic = SHADER_CACHE_MAGIC,
+        .version = SHADER_CACHE_VERSION,
+        .key = { key[0], key[1] },
+        .stage = stage,
+        .rsrc1 = shader->rsrc1,
+        .rsrc2 = shader->rsrc2,
+        .rsrc3 = shader->rsrc3,
+        .bin_offset = bin_offset,
+        .bin_size = shader->bin_size,
+        .debug_offset = debug_offset,
+        .debug_info_size = shader->debug_info ? shader->debug_info_size : 0,
+        .debug_info_count = shader->debug_info ? shader->debug_info_count : 0,
+    };
+
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s/.tmp-XXXXXX", c->dir);
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        int32_t ret = -errno;
+        fprintf(stderr, "[WARN] Failed to store shader in cache %s: %d\n", c->dir, ret);
+        return ret;
+    }
+
+    static const uint8_t zeros[SHADER_CACHE_ALIGN];
+    int32_t ret = shader_cache_write_all(fd, &h, sizeof(h));
+    if (ret == 0) {
+        ret = shader_cache_write_all(fd, zeros, bin_offset - sizeof(h));
+    }
+    if (ret == 0) {
+        ret = shader_cache_write_all(fd, shader->bin, shader->bin_size);
+    }
+    if (ret == 0 && h.debug_info_size != 0) {
+        ret = shader_cache_write_all(fd, zeros, debug_offset - bin_offset - shader->bin_size);
+        if (ret == 0) {
+            ret = shader_cache_write_all(fd, shader->debug_info, h.debug_info_size);
+        }
+    }
+    if (close(fd) != 0 && ret == 0) {
+        ret = -errno;
+    }
+
+    // Publishing by rename keeps entries immutable for lock-free readers
+    char path[PATH_MAX];
+    shader_cache_path(c, key, path, sizeof(path));
+    if (ret == 0 && rename(tmp, path) != 0) {
+        ret = -errno;
+    }
+    if (ret != 0) {
+        unlink(tmp);
+        fprintf(stderr, "[WARN] Failed to store shader in cache %s: %d\n", c->dir, ret);
+    }
+    return ret;
+}
+
+int32_t shader_cache_find(shader_cache_t* c, const void* spirv, size_t size,
+                          hdb_shader_stage_t stage, shader_cache_entry_t* e) {
+    *e = (shader_cache_entry_t){0};
+
+    uint64_t key[2];
+    shader_cache_key(c, spirv, size, stage, key);
+
+    int32_t ret = shader_cache_lookup(c, key, e);
+    __atomic_add_fetch(ret == 0 ? &c->hits : &c->misses, 1, __ATOMIC_RELAXED);
+    return ret;
+}
+
+int32_t shader_cache_get(shader_cache_t* c, const void* spirv, size_t size,
+                         hdb_shader_stage_t stage, shader_cache_entry_t* e) {
+    *e = (shader_cache_entry_t){0};
+
+    uint64_t key[2];
+    shader_cache_key(c, spirv, size, stage, key);
+
+    if (shader_cache_lookup(c, key, e) == 0) {
+        __atomic_add_fetch(&c->hits, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    pthread_mutex_lock(&shader_cache_compile_lock);
+
+    // Another thread may have compiled it while we waited
+    int32_t ret = shader_cache_lookup(c, key, e);
+    if (ret == 0) {
+        pthread_mutex_unlock(&shader_cache_compile_lock);
+        __atomic_add_fetch(&c->hits, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    __atomic_add_fetch(&c->misses, 1, __ATOMIC_RELAXED);
+
+    hdb_shader_t shader = {0};
+    ret = hdb_compile_spirv_to_bin(spirv, size, stage, &shader);
+    if (ret != 0) {
+        pthread_mutex_unlock(&shader_cache_compile_lock);
+        return ret;
+    }
+
+    // The cache is only an optimization: a shader that could not be
+    // stored (shader_cache_put() warned) is still handed out
+    ret = shader_cache_put(c, spirv, size, stage, &shader);
+    if (ret != 0) {
+        ret = shader_cache_copy_out(&shader, e);
+        pthread_mutex_unlock(&shader_cache_compile_lock);
+        return ret;
+    }
+    pthread_mutex_unlock(&shader_cache_compile_lock);
+
+    // Hand out the stored copy so the entry outlives the compiler's memory
+    return shader_cache_lookup(c, key, e);
+}
+
+void shader_cache_release(shader_cache_entry_t* e) {
+    if (e->map != NULL) {
+        munmap(e->map, e->map_size);
+    }
+    *e = (shader_cache_entry_t){0};
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "spirv_compile.h"
+#include <limits.h>
+#include <stdbool.h>
+
+/**
+ * Persistent SPIR-V -> GFX11 compile cache.
+ *
+ * Compiled shaders are stored one file per shader, named by a 128-bit
+ * hash of the SPIR-V, the stage, the target family and the compiler
+ * version (hdb_compiler_version()). On a hit, the file is mmapped and the
+ * returned hdb_shader_t points into the mapping, so a repeated debug
+ * session never runs the compiler.
+ *
+ * Files are written to a temporary name and renamed into place, so they
+ * are immutable once visible: lookups take no lock and several debugger
+ * processes can share one directory. Only misses are serialized, because
+ * hdb_compile_spirv_to_bin() is not thread-safe.
+ *
+ * Entry layout:
+ *
+ *   shader_cache_header_t
+ *   bin                       bin_size bytes at bin_offset
+ *   debug info                debug_info_size bytes at debug_offset
+ */
+
+#define SHADER_CACHE_MAGIC    0x43534448u  // "HDSC"
+#define SHADER_CACHE_VERSION  1
+#define SHADER_CACHE_ALIGN    64           // Section alignment in the file
+#define SHADER_CACHE_DIR_MAX  (PATH_MAX - 64)  // Leaves room for entry names
+
+/**
+ * shader_cache_header_t: Start of a cache entry.
+ */
+typedef struct {
+    uint32_t magic;              // SHADER_CACHE_MAGIC
+    uint32_t version;            // SHADER_CACHE_VERSION
+    uint64_t key[2];             // Must match the file name
+    uint32_t stage;              // hdb_shader_stage_t
+    uint32_t rsrc1;
+    uint32_t rsrc2;
+    uint32_t rsrc3;
+    uint64_t bin_offset;
+    uint64_t bin_size;
+    uint64_t debug_offset;
+    uint64_t debug_info_size;
+    uint64_t debug_info_count;
+} shader_cache_header_t;
+
+_Static_assert(sizeof(shader_cache_header_t) == 80, "shader cache header is part of the file format");
+
+/**
+ * shader_cache_t: Cache directory.
+ */
+typedef struct {
+    char         dir[SHADER_CACHE_DIR_MAX];
+    const char*  family;         // Target family ("navi31")
+    uint64_t     hits;           // Statistics (updated atomically)
+    uint64_t     misses;
+} shader_cache_t;
+
+/**
+ * shader_cache_entry_t: A cached shader, valid until shader_cache_release().
+ */
+typedef struct {
+    void*         map;
+    size_t        map_size;
+    hdb_shader_t  shader;        // Points into map
+} shader_cache_entry_t;
+
+/**
+ * Open (and create) a cache directory.
+ *
+ * @param dir: Directory (NULL = $XDG_CACHE_HOME/hdb/shaders, or
+ *             ~/.cache/hdb/shaders)
+ * @param family: Target family the shaders are compiled for
+ * @param c: Output cache
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t shader_cache_open(const char* dir, const char* family, shader_cache_t* c);
+
+/**
+ * Look up a shader, compiling and storing it on a miss.
+ *
+ * @param c: Cache
+ * @param spirv: SPIR-V bytecode
+ * @param size: Size of spirv in bytes
+ * @param stage: Shader stage
+ * @param e: Output entry
+ * @return: 0 on success, negative error code from the compiler or the
+ *          cache directory
+ *
+ * Thread-safe. A corrupt entry is treated as a miss and replaced. If the
+ * compiled shader cannot be stored (disk full, rename failure), it is
+ * handed out from memory with a warning.
+ */
+int32_t shader_cache_get(shader_cache_t* c, const void* spirv, size_t size,
+                         hdb_shader_stage_t stage, shader_cache_entry_t* e);
+
+/**
+ * Look up a shader without compiling on a miss.
+ *
+ * @param c: Cache
+ * @param spirv: SPIR-V bytecode
+ * @param size: Size of spirv in bytes
+ * @param stage: Shader stage
+ * @param e: Output entry
+ * @return: 0 on a hit, -ENOENT on a miss, -EINVAL for a corrupt entry
+ */
+int32_t shader_cache_find(shader_cache_t* c, const void* spirv, size_t size,
+                          hdb_shader_stage_t stage, shader_cache_entry_t* e);
+
+/**
+ * Store a compiled shader without looking it up.
+ *
+ * @param c: Cache
+ * @param spirv: SPIR-V bytecode the shader was compiled from
+ * @param size: Size of spirv in bytes
+ * @param stage: Shader stage
+ * @param shader: Compiled shader
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t shader_cache_put(shader_cache_t* c, const void* spirv, size_t size,
+                         hdb_shader_stage_t stage, const hdb_shader_t* shader);
+
+/**
+ * Unmap an entry.
+ *
+ * @param e: Entry (safe to call on a zeroed entry)
+ */
+void shader_cache_release(shader_cache_entry_t* e);
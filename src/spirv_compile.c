@@ -33,3 +33,11 @@ int32_t hdb_compile_spirv_to_bin(const void* spirv_binary,
     return -ENOSYS;
 }
 
+
+const char* hdb_compiler_version(void) {
+#ifdef HDB_MESA_VERSION
+    return HDB_MESA_VERSION;
+#else
+    return "none";
+#endif
+}
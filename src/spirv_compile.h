@@ -13,6 +13,22 @@ typedef enum {
     HDB_SHADER_STAGE_FRAGMENT,
 } hdb_shader_stage_t;
 
+/**
+ * Source location entry of hdb_shader_t::debug_info.
+ * 
+ * debug_info holds debug_info_count entries followed by the source file
+ * names, NUL-terminated and back to back; file indexes that list. The
+ * compiler flattens ACO's debug info (which points at compiler-owned file
+ * strings) into this self-contained form so it can be cached on disk and
+ * passed between processes.
+ */
+typedef struct {
+    uint32_t offset;  // Byte offset of the instruction in bin
+    uint32_t line;    // Source line (1-based, 0 = unknown)
+    uint16_t column;  // Source column (0 = unknown)
+    uint16_t file;    // Index into the file name list
+} hdb_debug_loc_t;
+
 /**
  * Compiled shader result.
  * 
@@ -28,8 +44,9 @@ typedef struct {
     uint32_t      rsrc1;            // SPI_SHADER_PGM_RSRC1 value
     uint32_t      rsrc2;            // SPI_SHADER_PGM_RSRC2 value
     uint32_t      rsrc3;            // SPI_SHADER_PGM_RSRC3 value
-    const void*   debug_info;       // ACO debug info (nullable)
-    size_t        debug_info_count; // Number of debug entries
+    const void*   debug_info;       // hdb_debug_loc_t[] + file names (nullable)
+    size_t        debug_info_count; // Number of hdb_debug_loc_t entries
+    size_t        debug_info_size;  // Size of debug_info in bytes
 } hdb_shader_t;
 
 /**
@@ -53,3 +70,14 @@ int32_t hdb_compile_spirv_to_bin(const void* spirv_binary,
                                  size_t size,
                                  hdb_shader_stage_t stage,
                                  hdb_shader_t* shader);
+
+/**
+ * Version of the compiler behind hdb_compile_spirv_to_bin().
+ * 
+ * Part of the shader cache key: a different Mesa produces different code
+ * for the same SPIR-V.
+ * 
+ * @return: Mesa version string (HDB_MESA_VERSION at build time), or
+ *          "none" when no compiler is linked
+ */
+const char* hdb_compiler_version(void);
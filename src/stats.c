@@ -0,0 +1,254 @@
+#include "stats.h"
+#include <pthread.h>
+#include <stdarg.h>
+
+__thread stats_thread_t* stats_self;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static stats_thread_t* stats_threads;  // Push-only list, protected by stats_lock
+
+static const char* const stats_metric_names[] = {
+#define STATS_NAME(id, name, help) name,
+    STATS_METRICS(STATS_NAME)
+};
+static const char* const stats_counter_names[] = {
+    STATS_COUNTERS(STATS_NAME)
+#undef STATS_NAME
+};
+
+static const char* const stats_metric_help[] = {
+#define STATS_HELP(id, name, help) help,
+    STATS_METRICS(STATS_HELP)
+};
+static const char* const stats_counter_help[] = {
+    STATS_COUNTERS(STATS_HELP)
+#undef STATS_HELP
+};
+
+stats_thread_t* stats_thread_attach(void) {
+    stats_thread_t* t = calloc(1, sizeof(*t));
+    if (t == NULL) {
+        return NULL;
+    }
+
+    // Blocks outlive their thread so its samples stay in the totals
+    pthread_mutex_lock(&stats_lock);
+    t->next = stats_threads;
+    __atomic_store_n(&stats_threads, t, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&stats_lock);
+
+    stats_self = t;
+    return t;
+}
+
+void stats_snapshot(stats_snapshot_t* s) {
+    *s = (stats_snapshot_t){0};
+
+    pthread_mutex_lock(&stats_lock);
+    for (const stats_thread_t* t = stats_threads; t != NULL; t = t->next) {
+        for_range(m, 0, STAT_METRIC_COUNT) {
+            const stats_histogram_t* src = &t->metrics[m];
+            stats_histogram_t* dst = &s->metrics[m];
+
+            dst->count += __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+            dst->sum += __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+            dst->max = MAX(dst->max, __atomic_load_n(&src->max, __ATOMIC_RELAXED));
+            for_range(b, 0, STATS_BUCKETS) {
+                dst->buckets[b] += __atomic_load_n(&src->buckets[b], __ATOMIC_RELAXED);
+            }
+        }
+        for_range(c, 0, STAT_COUNTER_COUNT) {
+            s->counters[c] += __atomic_load_n(&t->counters[c], __ATOMIC_RELAXED);
+        }
+        s->threads++;
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+uint64_t stats_quantile(const stats_histogram_t* h, double q) {
+    // Buckets are read one by one while threads record, so use their sum
+    uint64_t total = 0;
+    for_range(b, 0, STATS_BUCKETS) {
+        total += h->buckets[b];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    double target = MIN(MAX(q, 0.0), 1.0) * (double)total;
+    uint64_t rank = (uint64_t)target;
+    rank += (double)rank < target || rank == 0;
+
+    uint64_t seen = 0;
+    for_range(b, 0, STATS_BUCKETS) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            // Highest value of the bucket, but never above the real maximum
+            uint64_t high = b + 1 < STATS_BUCKETS ? stats_bucket_low((uint32_t)b + 1) - 1 :
+                                                    UINT64_MAX;
+            return h->max ? MIN(high, h->max) : high;
+        }
+    }
+    return h->max;
+}
+
+int32_t stats_write_json(FILE* out, const stats_snapshot_t* s) {
+    fprintf(out, "{\n  \"threads\": %u,\n  \"counters\": {", s->threads);
+    for_range(c, 0, STAT_COUNTER_COUNT) {
+        fprintf(out, "%s\n    \"%s\": %lu", c ? "," : "", stats_counter_names[c],
+                s->counters[c]);
+    }
+    fprintf(out, "\n  },\n  \"metrics\": {");
+
+    for_range(m, 0, STAT_METRIC_COUNT) {
+        const stats_histogram_t* h = &s->metrics[m];
+        fprintf(out, "%s\n    \"%s\": {\"count\": %lu, \"sum_ns\": %lu, \"max_ns\": %lu, "
+                "\"p50_ns\": %lu, \"p90_ns\": %lu, \"p99_ns\": %lu, \"p999_ns\": %lu, "
+                "\"buckets\": [",
+                m ? "," : "", stats_metric_names[m], h->count, h->sum, h->max,
+                stats_quantile(h, 0.5), stats_quantile(h, 0.9), stats_quantile(h, 0.99),
+                stats_quantile(h, 0.999));
+
+        bool first = true;
+        for_range(b, 0, STATS_BUCKETS) {
+            if (h->buckets[b] != 0) {
+                fprintf(out, "%s[%lu, %lu]", first ? "" : ", ",
+                        stats_bucket_low((uint32_t)b), h->buckets[b]);
+                first = false;
+            }
+        }
+        fprintf(out, "]}");
+    }
+    fprintf(out, "\n  }\n}\n");
+
+    return ferror(out) ? -EIO : 0;
+}
+
+int32_t stats_write_prometheus(FILE* out, const stats_snapshot_t* s) {
+    for_range(c, 0, STAT_COUNTER_COUNT) {
+        fprintf(out, "# HELP hdb_%s_total %s\n# TYPE hdb_%s_total counter\n"
+                "hdb_%s_total %lu\n",
+                stats_counter_names[c], stats_counter_help[c], stats_counter_names[c],
+                stats_counter_names[c], s->counters[c]);
+    }
+
+    for_range(m, 0, STAT_METRIC_COUNT) {
+        const stats_histogram_t* h = &s->metrics[m];
+        const char* name = stats_metric_names[m];
+
+        fprintf(out, "# HELP hdb_%s_seconds %s\n# TYPE hdb_%s_seconds histogram\n",
+                name, stats_metric_help[m], name);
+
+        // Cumulative "le" buckets, emitted only where the count changes
+        uint64_t cumulative = 0;
+        for_range(b, 0, STATS_BUCKETS - 1) {
+            if (h->buckets[b] == 0) {
+                continue;
+            }
+            cumulative += h->buckets[b];
+            uint64_t le_ns = stats_bucket_low((uint32_t)b + 1) - 1;
+            fprintf(out, "hdb_%s_seconds_bucket{le=\"%.9g\"} %lu\n",
+                    name, (double)le_ns * 1e-9, cumulative);
+        }
+        cumulative += h->buckets[STATS_BUCKETS - 1];
+        fprintf(out, "hdb_%s_seconds_bucket{le=\"+Inf\"} %lu\n"
+                "hdb_%s_seconds_sum %.9f\nhdb_%s_seconds_count %lu\n",
+                name, cumulative, name, (double)h->sum * 1e-9, name, cumulative);
+    }
+
+    return ferror(out) ? -EIO : 0;
+}
+
+/**
+ * Log ring: multi-producer, drained by one thread at a time.
+ *
+ * A writer claims a ticket, marks its slot busy (seq 0), formats the line
+ * and publishes it with seq = ticket + 1. The reader copies a slot whose
+ * seq matches the next ticket and re-checks seq afterwards; a slot a
+ * writer has lapped counts as a dropped line.
+ */
+#define HDB_LOG_RING_SLOTS  1024
+#define HDB_LOG_LINE_MAX    240
+
+typedef struct {
+    uint64_t  seq;
+    FILE*     stream;
+    char      text[HDB_LOG_LINE_MAX];
+} hdb_log_slot_t;
+
+static hdb_log_slot_t hdb_log_ring[HDB_LOG_RING_SLOTS];
+static uint64_t hdb_log_head;
+static uint64_t hdb_log_tail;                 // Protected by hdb_log_drain_lock
+static pthread_mutex_t hdb_log_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#ifdef HDB_LOG_RING
+static pthread_once_t hdb_log_once = PTHREAD_ONCE_INIT;
+
+static void hdb_log_ring_atexit(void) {
+    hdb_log_ring_drain();
+}
+
+static void hdb_log_ring_register(void) {
+    atexit(hdb_log_ring_atexit);
+}
+
+void hdb_log_ring_printf(FILE* stream, const char* fmt, ...) {
+    pthread_once(&hdb_log_once, hdb_log_ring_register);
+
+    uint64_t ticket = __atomic_fetch_add(&hdb_log_head, 1, __ATOMIC_RELAXED);
+    hdb_log_slot_t* slot = &hdb_log_ring[ticket % HDB_LOG_RING_SLOTS];
+
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(slot->text, sizeof(slot->text), fmt, ap);
+    va_end(ap);
+    slot->stream = stream;
+
+    __atomic_store_n(&slot->seq, ticket + 1, __ATOMIC_RELEASE);
+}
+#endif
+
+size_t hdb_log_ring_drain(void) {
+    size_t written = 0;
+    uint64_t dropped = 0;
+    char text[HDB_LOG_LINE_MAX];
+
+    pthread_mutex_lock(&hdb_log_drain_lock);
+
+    uint64_t head = __atomic_load_n(&hdb_log_head, __ATOMIC_ACQUIRE);
+    if (head - hdb_log_tail > HDB_LOG_RING_SLOTS) {
+        dropped += head - hdb_log_tail - HDB_LOG_RING_SLOTS;
+        hdb_log_tail = head - HDB_LOG_RING_SLOTS;
+    }
+
+    while (hdb_log_tail < head) {
+        hdb_log_slot_t* slot = &hdb_log_ring[hdb_log_tail % HDB_LOG_RING_SLOTS];
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq == 0 || seq < hdb_log_tail + 1) {
+            break;  // Still being written; pick it up next time
+        }
+
+        FILE* stream = slot->stream;
+        memcpy(text, slot->text, sizeof(text));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq != hdb_log_tail + 1 ||
+            __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+            dropped++;  // Lapped by a newer line
+        } else {
+            text[sizeof(text) - 1] = '\0';
+            fputs(text, stream);
+            written++;
+        }
+        hdb_log_tail++;
+    }
+
+    pthread_mutex_unlock(&hdb_log_drain_lock);
+
+    if (dropped != 0) {
+        fprintf(stderr, "[WARN] Log ring overflowed: %lu lines dropped\n", dropped);
+    }
+    return written;
+}
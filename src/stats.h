@@ -0,0 +1,217 @@
+#pragma once
+
+#include "util.h"
+
+/**
+ * Hot-path instrumentation.
+ *
+ * Each thread records into its own block of counters and log-linear
+ * (HDR-style) latency histograms, so recording is a clock read plus a few
+ * uncontended stores. Blocks are registered on a thread's first record
+ * and live until exit; exporters sum them with relaxed loads.
+ *
+ * Histograms have 2^STATS_SUB_BITS linear sub-buckets per power of two
+ * (about 12% relative error) and cover the full uint64_t nanosecond range.
+ *
+ * Built with -DHDB_STATS=0 (make HDB_STATS=0), recording compiles away.
+ */
+
+#ifndef HDB_STATS
+#define HDB_STATS 1
+#endif
+
+/**
+ * Latency metrics: X(id, name, help).
+ */
+#define STATS_METRICS(X) \
+    X(IB_ALLOC,   "ib_alloc",   "IB ring slice or dedicated IB BO allocation") \
+    X(BO_LIST,    "bo_list",    "BO list lookup or creation for a submission") \
+    X(CS_SUBMIT,  "cs_submit",  "amdgpu_cs_submit_raw2() ioctl") \
+    X(FENCE_WAIT, "fence_wait", "dev_wait() fence wait") \
+    X(REG_ACCESS, "reg_access", "regs2 register pread / pwrite") \
+    X(TRAP_WAIT,  "trap_wait",  "Host wait until a trap is seen in the mailbox")
+
+/**
+ * Event counters: X(id, name, help).
+ */
+#define STATS_COUNTERS(X) \
+    X(IB_FALLBACK, "ib_fallback",  "Submissions that needed a dedicated IB BO") \
+    X(REG_DWORDS,  "reg_dwords",   "Register dwords transferred through regs2") \
+    X(SUBMIT_FAIL, "submit_fail",  "Failed submissions")
+
+typedef enum {
+#define STATS_ENUM(id, name, help) STAT_##id,
+    STATS_METRICS(STATS_ENUM)
+    STAT_METRIC_COUNT
+} stats_metric_t;
+
+typedef enum {
+    STATS_COUNTERS(STATS_ENUM)
+    STAT_COUNTER_COUNT
+#undef STATS_ENUM
+} stats_counter_t;
+
+#define STATS_SUB_BITS  3
+#define STATS_BUCKETS   ((65 - STATS_SUB_BITS) << STATS_SUB_BITS)
+
+/**
+ * stats_histogram_t: One latency distribution (nanoseconds).
+ */
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[STATS_BUCKETS];
+} stats_histogram_t;
+
+/**
+ * stats_thread_t: Per-thread block, written only by its thread.
+ */
+typedef struct stats_thread {
+    stats_histogram_t     metrics[STAT_METRIC_COUNT];
+    uint64_t              counters[STAT_COUNTER_COUNT];
+    struct stats_thread*  next;
+} stats_thread_t;
+
+/**
+ * stats_snapshot_t: Sum over all threads.
+ */
+typedef struct {
+    stats_histogram_t  metrics[STAT_METRIC_COUNT];
+    uint64_t           counters[STAT_COUNTER_COUNT];
+    uint32_t           threads;
+} stats_snapshot_t;
+
+extern __thread stats_thread_t* stats_self;
+
+/**
+ * Register the calling thread's block (first record only).
+ */
+stats_thread_t* stats_thread_attach(void);
+
+static inline uint32_t stats_bucket(uint64_t v) {
+    if (v < (2u << STATS_SUB_BITS)) {
+        return (uint32_t)v;
+    }
+    uint32_t shift = 63 - (uint32_t)__builtin_clzll(v) - STATS_SUB_BITS;
+    return (shift << STATS_SUB_BITS) + (uint32_t)(v >> shift);
+}
+
+/**
+ * Smallest value of a bucket.
+ */
+static inline uint64_t stats_bucket_low(uint32_t b) {
+    if (b < (2u << STATS_SUB_BITS)) {
+        return b;
+    }
+    uint32_t shift = (b >> STATS_SUB_BITS) - 1;
+    return (uint64_t)((b & ((1u << STATS_SUB_BITS) - 1)) | (1u << STATS_SUB_BITS)) << shift;
+}
+
+/**
+ * Single-writer increment that exporters can read concurrently.
+ */
+static inline void stats_add(uint64_t* p, uint64_t n) {
+    __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+/**
+ * Record one latency sample.
+ */
+static inline void stats_record(stats_metric_t m, uint64_t ns) {
+#if HDB_STATS
+    stats_thread_t* t = stats_self ? stats_self : stats_thread_attach();
+    if (t == NULL) {
+        return;
+    }
+    stats_histogram_t* h = &t->metrics[m];
+    stats_add(&h->buckets[stats_bucket(ns)], 1);
+    stats_add(&h->count, 1);
+    stats_add(&h->sum, ns);
+    if (ns > h->max) {
+        __atomic_store_n(&h->max, ns, __ATOMIC_RELAXED);
+    }
+#else
+    (void)m;
+    (void)ns;
+#endif
+}
+
+/**
+ * Start a timed section (0 when stats are compiled out).
+ */
+static inline uint64_t stats_begin(void) {
+#if HDB_STATS
+    return hdb_now_ns();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * End a timed section started with stats_begin().
+ */
+static inline void stats_end(stats_metric_t m, uint64_t start) {
+#if HDB_STATS
+    stats_record(m, hdb_now_ns() - start);
+#else
+    (void)m;
+    (void)start;
+#endif
+}
+
+/**
+ * Bump an event counter.
+ */
+static inline void stats_count(stats_counter_t c, uint64_t n) {
+#if HDB_STATS
+    stats_thread_t* t = stats_self ? stats_self : stats_thread_attach();
+    if (t != NULL) {
+        stats_add(&t->counters[c], n);
+    }
+#else
+    (void)c;
+    (void)n;
+#endif
+}
+
+/**
+ * Sum all thread blocks.
+ *
+ * @param s: Output snapshot
+ */
+void stats_snapshot(stats_snapshot_t* s);
+
+/**
+ * Value below which a fraction q of the samples fall (bucket resolution).
+ *
+ * @param h: Histogram
+ * @param q: Quantile in [0, 1]
+ * @return: Nanoseconds (0 without samples)
+ */
+uint64_t stats_quantile(const stats_histogram_t* h, double q);
+
+/**
+ * Write a snapshot as JSON: counters, and per metric count / sum / max,
+ * p50 / p90 / p99 / p999 and the non-empty buckets as [low_ns, count].
+ *
+ * @return: 0 on success, -EIO on a write error
+ */
+int32_t stats_write_json(FILE* out, const stats_snapshot_t* s);
+
+/**
+ * Write a snapshot in the Prometheus text exposition format (hdb_<name>_seconds
+ * histograms and hdb_<name>_total counters).
+ *
+ * @return: 0 on success, -EIO on a write error
+ */
+int32_t stats_write_prometheus(FILE* out, const stats_snapshot_t* s);
+
+/**
+ * Write out lines queued by HDB_LOG() in HDB_LOG_RING builds.
+ *
+ * @return: Lines written (0 in stdio builds)
+ *
+ * Lines overwritten before a drain are counted and reported once.
+ */
+size_t hdb_log_ring_drain(void);
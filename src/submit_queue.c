@@ -0,0 +1,211 @@
+#include "submit_queue.h"
+
+/**
+ * How long submit_queue_fini() waits for submissions still in flight.
+ */
+#define SUBMIT_QUEUE_FINI_TIMEOUT_NS  (1000ull * 1000 * 1000)
+
+static inline amdgpu_submit_t* sq_entry(submit_queue_t* q, uint64_t ticket) {
+    return &q->entries[ticket % q->depth];
+}
+
+/**
+ * Retire the oldest submission in flight if it completes in time.
+ *
+ * @return: 0 if retired, -ETIMEDOUT if still in flight, libdrm error code
+ *          if the fence query failed
+ */
+static int32_t sq_retire_oldest(submit_queue_t* q, uint64_t timeout_ns) {
+    uint64_t ticket = q->retired + 1;
+    amdgpu_submit_t* entry = sq_entry(q, ticket);
+
+    uint32_t expired = 0;
+    int32_t ret = amdgpu_cs_query_fence_status(&entry->fence, timeout_ns,
+                                               0, &expired);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Submission %lu fence query failed: %d\n",
+                ticket, ret);
+        return ret;
+    }
+
+    if (!expired) {
+        return -ETIMEDOUT;
+    }
+
+    dev_submit_cleanup(q->dev, entry);
+    *entry = (amdgpu_submit_t){0};
+    q->retired = ticket;
+    return 0;
+}
+
+int32_t submit_queue_init(amdgpu_t* dev, uint32_t depth, uint32_t ring,
+                          submit_queue_t* q) {
+    if (depth == 0) {
+        depth = SUBMIT_QUEUE_MAX_DEPTH;
+    }
+    if (depth > SUBMIT_QUEUE_MAX_DEPTH) {
+        fprintf(stderr, "[ERROR] Submit queue depth %u exceeds %d\n",
+                depth, SUBMIT_QUEUE_MAX_DEPTH);
+        return -EINVAL;
+    }
+
+    int32_t ring_index = dev_pick_ring(dev, ring);
+    if (ring_index < 0) {
+        fprintf(stderr, "[ERROR] No compute ring %u for submit queue\n", ring);
+        return ring_index;
+    }
+
+    *q = (submit_queue_t){
+        .dev = dev,
+        .depth = depth,
+        .ring = (uint32_t)ring_index,
+        .next_ticket = 1,
+    };
+    return 0;
+}
+
+void submit_queue_fini(submit_queue_t* q) {
+    if (q->dev == NULL) {
+        return;
+    }
+
+    if (submit_queue_drain(q, SUBMIT_QUEUE_FINI_TIMEOUT_NS) != 0) {
+        fprintf(stderr, "[WARN] %u submissions still busy at teardown\n",
+                submit_queue_pending(q));
+
+        // Same policy as ib_ring_fini(): release anyway
+        while (submit_queue_pending(q) > 0) {
+            dev_submit_cleanup(q->dev, sq_entry(q, ++q->retired));
+        }
+    }
+
+    *q = (submit_queue_t){0};
+}
+
+int32_t submit_queue_reclaim(submit_queue_t* q) {
+    int32_t retired = 0;
+
+    while (submit_queue_pending(q) > 0) {
+        int32_t ret = sq_retire_oldest(q, 0);
+        if (ret == -ETIMEDOUT) {
+            break;
+        }
+        if (ret != 0) {
+            return ret;
+        }
+        retired++;
+    }
+    return retired;
+}
+
+int32_t submit_queue_push(submit_queue_t* q,
+                          pkt3_packets_t* packets,
+                          amdgpu_bo_handle* buffers,
+                          uint32_t buffers_count,
+                          uint32_t flags,
+                          const uint64_t* deps,
+                          uint32_t dep_count,
+                          uint64_t timeout_ns,
+                          uint64_t* ticket) {
+    int32_t ret = submit_queue_reclaim(q);
+    if (ret < 0) {
+        return ret;
+    }
+
+    // Only block when the GPU is a full queue behind
+    if (submit_queue_pending(q) == q->depth) {
+        q->full_waits++;
+        ret = sq_retire_oldest(q, timeout_ns);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    // Tickets -> fences; retired tickets need no dependency
+    struct amdgpu_cs_fence fences[DEV_SUBMIT_MAX_DEPS];
+    uint32_t fence_count = 0;
+    uint64_t last = q->next_ticket - 1;
+
+    if ((flags & SUBMIT_QUEUE_AFTER_PREVIOUS) && last > q->retired) {
+        fences[fence_count++] = sq_entry(q, last)->fence;
+    }
+
+    for_range(i, 0, dep_count) {
+        if (deps[i] == 0 || deps[i] > last) {
+            fprintf(stderr, "[ERROR] Unknown dependency ticket %lu\n", deps[i]);
+            return -EINVAL;
+        }
+        if (deps[i] <= q->retired) {
+            continue;
+        }
+        if (fence_count == DEV_SUBMIT_MAX_DEPS) {
+            fprintf(stderr, "[ERROR] Too many submission dependencies\n");
+            return -EINVAL;
+        }
+        fences[fence_count++] = sq_entry(q, deps[i])->fence;
+    }
+
+    uint64_t t = q->next_ticket;
+    ret = dev_submit_ex(q->dev, packets, buffers, buffers_count, q->ring,
+                        fences, fence_count, sq_entry(q, t));
+    if (ret != 0) {
+        return ret;
+    }
+
+    q->next_ticket++;
+    if (ticket != NULL) {
+        *ticket = t;
+    }
+    return 0;
+}
+
+int32_t submit_queue_wait(submit_queue_t* q, uint64_t ticket, uint64_t timeout_ns) {
+    if (ticket == 0 || ticket >= q->next_ticket) {
+        return -EINVAL;
+    }
+    if (ticket <= q->retired) {
+        return 0;
+    }
+
+    // One ring retires in order: once this fence signals, so have all
+    // earlier ones, and reclaiming up to it cannot block
+    uint32_t expired = 0;
+    int32_t ret = amdgpu_cs_query_fence_status(
+        &sq_entry(q, ticket)->fence,
+        timeout_ns == 0 ? AMDGPU_TIMEOUT_INFINITE : timeout_ns,
+        0, &expired);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Submission %lu fence query failed: %d\n",
+                ticket, ret);
+        return ret;
+    }
+
+    if (!expired) {
+        return -ETIMEDOUT;
+    }
+
+    while (q->retired < ticket) {
+        ret = sq_retire_oldest(q, 0);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+int32_t submit_queue_drain(submit_queue_t* q, uint64_t timeout_ns) {
+    if (submit_queue_pending(q) == 0) {
+        return 0;
+    }
+    return submit_queue_wait(q, q->next_ticket - 1, timeout_ns);
+}
+
+int32_t submit_queue_sync_file(submit_queue_t* q, uint64_t ticket, int* fd) {
+    if (ticket == 0 || ticket >= q->next_ticket) {
+        return -EINVAL;
+    }
+    if (ticket <= q->retired) {
+        return -EALREADY;
+    }
+    return dev_fence_to_sync_file(q->dev, &sq_entry(q, ticket)->fence, fd);
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "amdgpu_device.h"
+
+/**
+ * Pipelined asynchronous submission.
+ *
+ * dev_submit() + dev_wait() leaves the GPU idle while the CPU builds the
+ * next stream. A submit queue keeps up to depth submissions in flight:
+ * submit_queue_push() returns as soon as the kernel accepted the job and
+ * identifies it by a ticket (1, 2, ...). Dependencies on earlier tickets
+ * are resolved by the kernel scheduler, never by blocking the caller.
+ *
+ * Retired submissions are reclaimed without blocking on every push (and
+ * by submit_queue_reclaim()): fences on one ring signal in order, so the
+ * queue only ever checks its oldest entries. A push only waits when all
+ * depth entries are still in flight. That order is why a queue stays on
+ * the one compute ring it picked at creation; use one queue per ring to
+ * spread work.
+ *
+ * DANGER: Not thread-safe; shares the device IB ring with dev_submit().
+ */
+
+#define SUBMIT_QUEUE_MAX_DEPTH  64
+
+/**
+ * Push flags.
+ */
+#define SUBMIT_QUEUE_AFTER_PREVIOUS  (1u << 0)  // Start after the last push retires
+
+/**
+ * submit_queue_t: Ring of in-flight submissions.
+ */
+typedef struct {
+    amdgpu_t*        dev;
+    uint32_t         depth;                           // Max in flight
+    uint32_t         ring;                            // Compute ring of every push
+    amdgpu_submit_t  entries[SUBMIT_QUEUE_MAX_DEPTH]; // entries[ticket % depth]
+    uint64_t         next_ticket;                     // Ticket of the next push
+    uint64_t         retired;                         // All tickets <= this retired
+    uint64_t         full_waits;                      // Pushes that had to block
+} submit_queue_t;
+
+/**
+ * Create an empty queue.
+ *
+ * @param dev: Device context
+ * @param depth: Max submissions in flight (1..SUBMIT_QUEUE_MAX_DEPTH,
+ *               0 = SUBMIT_QUEUE_MAX_DEPTH)
+ * @param ring: Compute ring index, DEV_RING_ANY (next work ring),
+ *              DEV_RING_DEFAULT or DEV_RING_CONTROL
+ * @param q: Output queue
+ * @return: 0 on success, -EINVAL on a bad depth or ring
+ */
+int32_t submit_queue_init(amdgpu_t* dev, uint32_t depth, uint32_t ring,
+                          submit_queue_t* q);
+
+/**
+ * Wait for everything in flight and release the queue.
+ *
+ * @param q: Queue
+ */
+void submit_queue_fini(submit_queue_t* q);
+
+/**
+ * Submit a packet stream without waiting for it.
+ *
+ * @param q: Queue
+ * @param packets: PM4 packet array (emptied if built by dev_packets_begin())
+ * @param buffers: BO handles used by the stream
+ * @param buffers_count: Number of BOs
+ * @param flags: SUBMIT_QUEUE_*
+ * @param deps: Tickets that must retire first (NULL if none); tickets that
+ *              already retired are ignored
+ * @param dep_count: Number of tickets
+ * @param timeout_ns: How long to wait for a free entry when the queue is full
+ * @param ticket: Output ticket (may be NULL)
+ * @return: 0 on success
+ *          -EINVAL on an unknown (future) dependency ticket
+ *          -ETIMEDOUT if no entry freed up in time
+ *          negative error code if the submission failed
+ *
+ * The packets may be rebuilt (pkt3_reset()) right after this returns.
+ */
+int32_t submit_queue_push(submit_queue_t* q,
+                          pkt3_packets_t* packets,
+                          amdgpu_bo_handle* buffers,
+                          uint32_t buffers_count,
+                          uint32_t flags,
+                          const uint64_t* deps,
+                          uint32_t dep_count,
+                          uint64_t timeout_ns,
+                          uint64_t* ticket);
+
+/**
+ * Reclaim submissions whose fences have signaled (never blocks).
+ *
+ * @param q: Queue
+ * @return: Number of submissions retired, or negative error code if a
+ *          fence query failed
+ */
+int32_t submit_queue_reclaim(submit_queue_t* q);
+
+/**
+ * Wait for a ticket (and everything pushed before it) to retire.
+ *
+ * @param q: Queue
+ * @param ticket: Ticket from submit_queue_push()
+ * @param timeout_ns: Timeout in nanoseconds (0 = infinite)
+ * @return: 0 on success, -EINVAL on an unknown ticket, -ETIMEDOUT, or
+ *          negative error code if the fence query failed
+ */
+int32_t submit_queue_wait(submit_queue_t* q, uint64_t ticket, uint64_t timeout_ns);
+
+/**
+ * Wait for every submission in flight.
+ *
+ * @param q: Queue
+ * @param timeout_ns: Timeout in nanoseconds (0 = infinite)
+ * @return: 0 on success, negative error code on timeout/error
+ */
+int32_t submit_queue_drain(submit_queue_t* q, uint64_t timeout_ns);
+
+/**
+ * Export a ticket's fence as a sync_file fd (see dev_fence_to_sync_file()).
+ *
+ * @param q: Queue
+ * @param ticket: Ticket from submit_queue_push()
+ * @param fd: Output fd (caller closes it)
+ * @return: 0 on success, -EALREADY if the ticket already retired,
+ *          -EINVAL on an unknown ticket, negative error code on failure
+ */
+int32_t submit_queue_sync_file(submit_queue_t* q, uint64_t ticket, int* fd);
+
+/**
+ * Has a ticket retired (as of the last reclaim)?
+ */
+static inline bool submit_queue_done(const submit_queue_t* q, uint64_t ticket) {
+    return ticket <= q->retired;
+}
+
+/**
+ * Number of submissions in flight (as of the last reclaim).
+ */
+static inline uint32_t submit_queue_pending(const submit_queue_t* q) {
+    return (uint32_t)(q->next_ticket - 1 - q->retired);
+}
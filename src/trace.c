@@ -0,0 +1,192 @@
+#include "trace.h"
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+int32_t trace_init(amdgpu_t* dev, const mailbox_t* mb, uint32_t records,
+                   uint32_t sgpr_first, trace_t* t) {
+    if (records == 0) {
+        records = TRACE_DEFAULT_RECORDS;
+    }
+
+    *t = (trace_t){0};
+
+    if ((records & (records - 1)) != 0) {
+        fprintf(stderr, "[ERROR] Trace records must be a power of 2: %u\n", records);
+        return -EINVAL;
+    }
+    if (records <= 2 * (uint64_t)mb->slot_count) {
+        fprintf(stderr, "[ERROR] Trace ring of %u records too small for %u mailbox slots\n",
+                records, mb->slot_count);
+        return -EINVAL;
+    }
+    if (sgpr_first > TRACE_MAX_SGPRS - TRACE_RECORD_SGPRS) {
+        fprintf(stderr, "[ERROR] Trace SGPR window s%u+%u outside the wave's SGPRs\n",
+                sgpr_first, TRACE_RECORD_SGPRS);
+        return -EINVAL;
+    }
+
+    size_t size = TRACE_HEADER_SIZE + (size_t)records * TRACE_RECORD_SIZE;
+    int32_t ret = bo_alloc(dev, size, AMDGPU_GEM_DOMAIN_GTT, false, &t->bo);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to allocate trace ring: %d\n", ret);
+        return ret;
+    }
+
+    // The clear leaves every tag 0, which only record 0 could match; make
+    // it mismatch too so nothing reads as committed before the first append
+    t->header = t->bo.host_addr;
+    t->records = (trace_record_t*)((uint8_t*)t->bo.host_addr + TRACE_HEADER_SIZE);
+    t->records[0].tag = UINT32_MAX;
+
+    t->record_mask = records - 1;
+    *t->header = (trace_header_t){
+        .magic = TRACE_MAGIC,
+        .version = TRACE_VERSION,
+        .record_mask = records - 1,
+        .sgpr_first = sgpr_first,
+        .limit = records - mb->slot_count,
+    };
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return 0;
+}
+
+void trace_fini(amdgpu_t* dev, trace_t* t) {
+    bo_free(dev, &t->bo);
+    *t = (trace_t){0};
+}
+
+uint32_t trace_peek(trace_t* t, const trace_record_t** records) {
+    uint32_t first = t->rptr & t->record_mask;
+    uint32_t span = t->record_mask + 1 - first;
+
+    uint32_t count = 0;
+    while (count < span &&
+           __atomic_load_n(&t->records[first + count].tag, __ATOMIC_ACQUIRE) ==
+           t->rptr + count) {
+        count++;
+    }
+
+    *records = &t->records[first];
+    return count;
+}
+
+void trace_release(trace_t* t, uint32_t count) {
+    t->rptr += count;
+    __atomic_store_n(&t->header->rptr, t->rptr, __ATOMIC_RELEASE);
+}
+
+int32_t trace_sink_fd(void* user, const trace_record_t* records, uint32_t count) {
+    int fd = *(int*)user;
+    const uint8_t* p = (const uint8_t*)records;
+    size_t left = (size_t)count * sizeof(*records);
+
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * Deliver every committed record; returns how many (or a sink error).
+ */
+static int64_t trace_consume(trace_consumer_t* c) {
+    int64_t delivered = 0;
+
+    for (;;) {
+        const trace_record_t* records;
+        uint32_t count = trace_peek(c->trace, &records);
+        if (count == 0) {
+            return delivered;
+        }
+
+        int32_t ret = c->sink(c->user, records, count);
+        if (ret != 0) {
+            return ret;
+        }
+
+        trace_release(c->trace, count);
+        c->records += count;
+        delivered += count;
+    }
+}
+
+static void* trace_consumer_main(void* arg) {
+    trace_consumer_t* c = arg;
+
+    uint64_t sleep_ns = MAX(c->cfg.sleep_min_ns, 1000ull);
+    while (!__atomic_load_n(&c->stop, __ATOMIC_ACQUIRE)) {
+        int64_t delivered = trace_consume(c);
+        if (delivered < 0) {
+            c->result = (int32_t)delivered;
+            fprintf(stderr, "[ERROR] Trace sink failed: %d\n", c->result);
+            return NULL;
+        }
+
+        if (delivered != 0) {
+            sleep_ns = MAX(c->cfg.sleep_min_ns, 1000ull);
+            continue;
+        }
+        sleep_ns = MIN(sleep_ns * 2, MAX(c->cfg.sleep_max_ns, sleep_ns));
+
+        // Sleeping on the stop word makes trace_consumer_stop() immediate
+        struct timespec ts = {
+            .tv_sec = (time_t)(sleep_ns / 1000000000ull),
+            .tv_nsec = (long)(sleep_ns % 1000000000ull),
+        };
+        syscall(SYS_futex, &c->stop, FUTEX_WAIT_PRIVATE, 0, &ts, NULL, 0);
+    }
+
+    // Flush what the GPU committed before the stop
+    int64_t delivered = trace_consume(c);
+    if (delivered < 0) {
+        c->result = (int32_t)delivered;
+    }
+    return NULL;
+}
+
+int32_t trace_consumer_start(trace_t* t, trace_sink_fn_t sink, void* user,
+                             const mailbox_wait_cfg_t* cfg, trace_consumer_t* c) {
+    *c = (trace_consumer_t){
+        .trace = t,
+        .sink = sink,
+        .user = user,
+        .cfg = cfg ? *cfg : MAILBOX_WAIT_CFG_DEFAULT,
+    };
+
+    int32_t ret = -pthread_create(&c->thread, NULL, trace_consumer_main, c);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to start trace consumer thread: %d\n", ret);
+        *c = (trace_consumer_t){0};
+        return ret;
+    }
+    return 0;
+}
+
+int32_t trace_consumer_stop(trace_consumer_t* c) {
+    if (c->trace == NULL) {
+        return 0;
+    }
+
+    __atomic_store_n(&c->stop, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &c->stop, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    pthread_join(c->thread, NULL);
+
+    uint32_t dropped = trace_dropped(c->trace);
+    if (dropped != 0) {
+        fprintf(stderr, "[WARN] Trace ring overflowed: %u records dropped\n", dropped);
+    }
+
+    int32_t result = c->result;
+    *c = (trace_consumer_t){0};
+    return result;
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include "mailbox.h"
+#include <pthread.h>
+#include <stddef.h>
+
+/**
+ * Non-stop trace mode.
+ *
+ * Breakpoints stop the world; timing-sensitive kernels change behavior
+ * under them. In trace mode every plain trap (DEBUG_MODE stepping,
+ * TRAP_ON_START; not exceptions or s_trap) appends one fixed-size record
+ * to a large ring in cached GTT and returns straight away. A host consumer
+ * thread streams the ring to a sink (a file by default) and publishes its
+ * progress back to the GPU.
+ *
+ * Layout (byte offsets from the BO base):
+ *
+ *   0x000  trace_header_t   geometry, ring indices (256 bytes)
+ *   0x100  records          record_mask + 1 trace_record_t
+ *
+ * Append protocol (trace path of src/trap_handler.s):
+ * 1. If wptr - rptr >= limit the ring is full: bump dropped, return.
+ * 2. An atomic add on wptr reserves ring index i.
+ * 3. Dwords 1-15 of record i & record_mask are stored, then dword 0
+ *    (tag) = i. A record is complete once its tag equals its index, so
+ *    stale records from the previous lap never look committed and the
+ *    host never has to clear anything.
+ *
+ * limit leaves slot_count records of headroom: every wave position has at
+ * most one append in flight, so waves racing past the full check can
+ * never overwrite records the host has not consumed.
+ *
+ * The per-trap cost is fixed (no loops, no waiting on the host): save v0
+ * and v1 to the wave's mailbox slot, two header loads, one atomic, two
+ * record stores, two restore loads.
+ *
+ * DANGER: The layout is shared with src/trap_handler.s; any change is an
+ *         ABI change (bump TRACE_VERSION).
+ * DANGER: The ring is cached GTT so the host streams it at memory speed;
+ *         this relies on GPU accesses to system memory being snooped.
+ * DANGER: The wptr atomic needs PCIe atomics, like the trap ring.
+ * DANGER: One consumer per trace ring.
+ */
+
+#define TRACE_MAGIC            0x52544448u  // "HDTR"
+#define TRACE_VERSION          1
+#define TRACE_HEADER_SIZE      256
+#define TRACE_RECORD_SIZE      64
+#define TRACE_RECORD_SGPRS     8
+#define TRACE_MAX_SGPRS        106          // SGPR_COUNT in trap_handler.s
+#define TRACE_DEFAULT_RECORDS  (1u << 20)   // 64 MiB ring
+
+/**
+ * trace_record_t: One traced instruction (written by the trap handler).
+ */
+typedef struct {
+    uint32_t tag;       // Ring index; equals the index once committed
+    uint32_t hw_id1;    // HW_REG_HW_ID1
+    uint32_t pc_lo;     // PC of the next instruction
+    uint32_t pc_hi;     // [15:0] PC_HI, [23:16] trap ID
+    uint32_t exec_lo;   // EXEC
+    uint32_t exec_hi;
+    uint64_t time;      // MSG_RTN_GET_REALTIME (100 MHz on gfx11)
+    uint32_t sgprs[TRACE_RECORD_SGPRS];  // s[sgpr_first ..]
+} trace_record_t;
+
+_Static_assert(sizeof(trace_record_t) == TRACE_RECORD_SIZE,
+               "trace record size is part of the GPU ABI");
+
+/**
+ * trace_header_t: Start of the trace BO.
+ *
+ * Written by the host at init, except wptr / dropped (GPU atomics) and
+ * rptr (host progress, read by the GPU full check). As in the mailbox,
+ * GPU atomics and host stores sit on separate 64-byte lines.
+ */
+typedef struct {
+    uint32_t magic;         // TRACE_MAGIC
+    uint32_t version;       // TRACE_VERSION
+    uint32_t record_mask;   // 0x08: records - 1 (records is a power of 2)
+    uint32_t sgpr_first;    // 0x0C: first SGPR of the recorded window
+    uint32_t reserved0[12];
+    uint32_t wptr;          // 0x40: records reserved by trapping waves
+    uint32_t limit;         // 0x44: records in flight before dropping
+    uint32_t dropped;       // 0x48: records lost to a full ring
+    uint32_t reserved1[13];
+    uint32_t rptr;          // 0x80: records consumed by the host
+    uint32_t reserved2[31];
+} trace_header_t;
+
+_Static_assert(sizeof(trace_header_t) == TRACE_HEADER_SIZE,
+               "trace header size is part of the GPU ABI");
+_Static_assert(offsetof(trace_header_t, wptr) == 0x40 &&
+               offsetof(trace_header_t, limit) == 0x44 &&
+               offsetof(trace_header_t, rptr) == 0x80,
+               "trace header layout is part of the GPU ABI");
+
+/**
+ * trace_t: Host view of a trace ring.
+ */
+typedef struct {
+    amdgpu_bo_t      bo;           // Cached GTT BO (header + records)
+    trace_header_t*  header;
+    trace_record_t*  records;
+    uint32_t         record_mask;  // Records - 1
+    uint32_t         rptr;         // Next record to consume
+} trace_t;
+
+/**
+ * Allocate a trace ring sized for a mailbox.
+ *
+ * @param dev: Device context
+ * @param mb: Mailbox the ring will be attached to (slot_count sets the
+ *            headroom)
+ * @param records: Ring records, a power of 2 above 2 x mb->slot_count
+ *                 (0 = TRACE_DEFAULT_RECORDS)
+ * @param sgpr_first: First of the TRACE_RECORD_SGPRS SGPRs recorded
+ * @param t: Output trace ring (zeroed on failure)
+ * @return: 0 on success, -EINVAL if records or sgpr_first is out of range,
+ *          negative error code on failure
+ *
+ * Attach with mailbox_set_trace(mb, t->bo.va_addr).
+ */
+int32_t trace_init(amdgpu_t* dev, const mailbox_t* mb, uint32_t records,
+                   uint32_t sgpr_first, trace_t* t);
+
+/**
+ * Free the trace BO.
+ *
+ * DANGER: Detach it (mailbox_set_trace(mb, 0)) and let traced waves
+ *         finish first.
+ */
+void trace_fini(amdgpu_t* dev, trace_t* t);
+
+/**
+ * Committed records from the read pointer (never blocks).
+ *
+ * @param t: Trace ring
+ * @param records: Output pointer to the first record
+ * @return: Number of contiguous committed records (stops at the ring
+ *          wrap and at the first record still being written)
+ */
+uint32_t trace_peek(trace_t* t, const trace_record_t** records);
+
+/**
+ * Hand consumed records back to the GPU.
+ *
+ * @param t: Trace ring
+ * @param count: Records consumed (at most the last trace_peek() result)
+ */
+void trace_release(trace_t* t, uint32_t count);
+
+/**
+ * Records the GPU dropped because the ring was full.
+ */
+static inline uint32_t trace_dropped(const trace_t* t) {
+    return __atomic_load_n(&t->header->dropped, __ATOMIC_RELAXED);
+}
+
+/**
+ * Consumer sink: receives committed records in ring order.
+ *
+ * @param user: trace_consumer_start() argument
+ * @param records: Records (valid only during the call)
+ * @param count: Number of records
+ * @return: 0 on success, negative error code stops the consumer
+ */
+typedef int32_t (*trace_sink_fn_t)(void* user, const trace_record_t* records,
+                                   uint32_t count);
+
+/**
+ * Sink writing raw records to a file descriptor.
+ *
+ * @param user: int* file descriptor
+ */
+int32_t trace_sink_fd(void* user, const trace_record_t* records, uint32_t count);
+
+/**
+ * trace_consumer_t: Thread streaming a trace ring to a sink.
+ */
+typedef struct {
+    trace_t*            trace;
+    trace_sink_fn_t     sink;
+    void*               user;
+    mailbox_wait_cfg_t  cfg;      // Backoff range when the ring is empty
+    pthread_t           thread;
+    uint32_t            stop;     // Futex word, set by trace_consumer_stop()
+    int32_t             result;   // First sink error
+    uint64_t            records;  // Records delivered to the sink
+} trace_consumer_t;
+
+/**
+ * Start streaming a trace ring.
+ *
+ * @param t: Trace ring (must outlive the consumer)
+ * @param sink: Record sink (called on the consumer thread)
+ * @param user: Passed to sink
+ * @param cfg: Backoff tuning (NULL = MAILBOX_WAIT_CFG_DEFAULT)
+ * @param c: Output consumer
+ * @return: 0 on success, negative error code on failure
+ *
+ * DANGER: The thread keeps a pointer to c; do not move or copy it.
+ */
+int32_t trace_consumer_start(trace_t* t, trace_sink_fn_t sink, void* user,
+                             const mailbox_wait_cfg_t* cfg, trace_consumer_t* c);
+
+/**
+ * Stop the consumer after it has delivered every committed record.
+ *
+ * @param c: Consumer (safe to call on a zeroed or stopped consumer)
+ * @return: 0, or the first sink error
+ */
+int32_t trace_consumer_stop(trace_consumer_t* c);
@@ -0,0 +1,557 @@
+#include "trace_file.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define VARINT_MAX_BYTES        10
+
+/**
+ * Chunks (and so the directory) start 8-byte aligned in the file, so the
+ * mapped index structs can be read in place.
+ */
+#define TRACE_FILE_CHUNK_ALIGN  8
+
+static inline uint64_t zigzag_encode(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t zigzag_decode(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline uint8_t* varint_put(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+/**
+ * Decode a varint; returns NULL past end or on an overlong encoding.
+ */
+static inline const uint8_t* varint_get(const uint8_t* p, const uint8_t* end,
+                                        uint64_t* v) {
+    uint64_t result = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        if (p == end) {
+            return NULL;
+        }
+        uint8_t byte = *p++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *v = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static inline uint32_t bitmap_bytes(uint32_t reg_count) {
+    return (reg_count + 7) / 8;
+}
+
+/**
+ * Worst-case encoded bytes of one record.
+ */
+static inline size_t record_max_bytes(uint32_t reg_count) {
+    return 2 * VARINT_MAX_BYTES + bitmap_bytes(reg_count) + (size_t)reg_count * 5;
+}
+
+/**
+ * Writer buffer bytes per pending record: raw fields, a wave table entry
+ * and the worst-case encoding.
+ */
+static inline size_t record_buffer_bytes(uint32_t reg_count) {
+    return sizeof(uint32_t) + 2 * sizeof(uint64_t) + (size_t)reg_count * sizeof(uint32_t) +
+           sizeof(trace_file_wave_t) + record_max_bytes(reg_count);
+}
+
+uint32_t trace_file_chunk_records(uint32_t reg_count, size_t bytes) {
+    size_t records = bytes / record_buffer_bytes(reg_count);
+    return (uint32_t)MIN(MAX(records, (size_t)1), (size_t)TRACE_FILE_DEFAULT_CHUNK);
+}
+
+static int32_t write_all(int fd, const void* data, size_t size) {
+    const uint8_t* p = data;
+
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+int32_t trace_file_create(const char* path, uint64_t code_va, uint32_t reg_count,
+                          uint32_t chunk_records, trace_file_writer_t* w) {
+    HDB_ASSERT(reg_count <= TRACE_FILE_MAX_REGS, "too many registers per trace record");
+
+    if (chunk_records == 0) {
+        chunk_records = trace_file_chunk_records(reg_count, TRACE_FILE_CHUNK_BYTES);
+    }
+    if ((size_t)chunk_records * record_buffer_bytes(reg_count) > TRACE_FILE_MAX_CHUNK_BYTES) {
+        fprintf(stderr, "[ERROR] Trace chunk of %u records x %u registers is too large\n",
+                chunk_records, reg_count);
+        *w = (trace_file_writer_t){ .fd = -1 };
+        return -EINVAL;
+    }
+
+    *w = (trace_file_writer_t){
+        .fd = -1,
+        .code_va = code_va,
+        .reg_count = reg_count,
+        .chunk_records = chunk_records,
+    };
+
+    w->waves = malloc(chunk_records * sizeof(*w->waves));
+    w->pcs = malloc(chunk_records * sizeof(*w->pcs));
+    w->times = malloc(chunk_records * sizeof(*w->times));
+    w->regs = malloc(MAX((size_t)chunk_records * reg_count, 1) * sizeof(*w->regs));
+    w->encoded = malloc(sizeof(trace_file_chunk_t) +
+                        (size_t)chunk_records * sizeof(trace_file_wave_t) +
+                        (size_t)chunk_records * record_max_bytes(reg_count) +
+                        TRACE_FILE_CHUNK_ALIGN);
+    if (!w->waves || !w->pcs || !w->times || !w->regs || !w->encoded) {
+        trace_file_finish(w);
+        return -ENOMEM;
+    }
+
+    w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (w->fd < 0) {
+        int32_t ret = -errno;
+        fprintf(stderr, "[ERROR] Failed to create trace file %s: %d\n", path, ret);
+        trace_file_finish(w);
+        return ret;
+    }
+
+    trace_file_header_t header = {
+        .magic = TRACE_FILE_MAGIC,
+        .version = TRACE_FILE_VERSION,
+        .code_va = code_va,
+        .reg_count = reg_count,
+        .chunk_records = chunk_records,
+    };
+    int32_t ret = write_all(w->fd, &header, sizeof(header));
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to write trace file header: %d\n", ret);
+        trace_file_finish(w);
+        return ret;
+    }
+
+    w->offset = sizeof(header);
+    return 0;
+}
+
+typedef struct {
+    uint32_t wave_id;
+    uint32_t index;
+} wave_order_t;
+
+static int wave_order_cmp(const void* a, const void* b) {
+    const wave_order_t* x = a;
+    const wave_order_t* y = b;
+
+    if (x->wave_id != y->wave_id) {
+        return x->wave_id < y->wave_id ? -1 : 1;
+    }
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+/**
+ * Encode the pending records as one chunk, grouped by wave, and write it.
+ */
+static int32_t trace_file_flush(trace_file_writer_t* w) {
+    if (w->pending == 0) {
+        return 0;
+    }
+
+    wave_order_t* order = malloc(w->pending * sizeof(*order));
+    uint32_t* prev = calloc(MAX(w->reg_count, 1u), sizeof(*prev));
+    if (order == NULL || prev == NULL) {
+        free(order);
+        free(prev);
+        return -ENOMEM;
+    }
+    for_range(i, 0, w->pending) {
+        order[i] = (wave_order_t){ .wave_id = w->waves[i], .index = (uint32_t)i };
+    }
+    qsort(order, w->pending, sizeof(*order), wave_order_cmp);
+
+    uint32_t wave_count = 0;
+    for_range(i, 0, w->pending) {
+        wave_count += (i == 0 || order[i].wave_id != order[i - 1].wave_id);
+    }
+
+    trace_file_chunk_t* chunk = (trace_file_chunk_t*)w->encoded;
+    trace_file_wave_t* waves = (trace_file_wave_t*)(chunk + 1);
+    uint8_t* payload = (uint8_t*)(waves + wave_count);
+    uint8_t* p = payload;
+    uint32_t bm_bytes = bitmap_bytes(w->reg_count);
+
+    trace_file_dir_t entry = {
+        .offset = w->offset,
+        .pc_min = UINT64_MAX,
+        .time_min = UINT64_MAX,
+        .records = w->pending,
+        .wave_count = wave_count,
+    };
+
+    trace_file_wave_t* wave = NULL;
+    uint64_t prev_time = 0;
+    for_range(i, 0, w->pending) {
+        uint32_t r = order[i].index;
+
+        // New stream: deltas restart from zero
+        if (wave == NULL || wave->wave_id != order[i].wave_id) {
+            if (wave != NULL) {
+                wave->size = (uint64_t)(p - payload) - wave->offset;
+            }
+            wave = wave == NULL ? waves : wave + 1;
+            *wave = (trace_file_wave_t){
+                .wave_id = order[i].wave_id,
+                .offset = (uint64_t)(p - payload),
+                .pc_min = UINT64_MAX,
+            };
+            memset(prev, 0, w->reg_count * sizeof(*prev));
+            prev_time = 0;
+        }
+
+        uint64_t pc_off = w->pcs[r] - w->code_va;
+        uint64_t time = w->times[r];
+        p = varint_put(p, zigzag_encode((int64_t)pc_off));
+        p = varint_put(p, zigzag_encode((int64_t)(time - prev_time)));
+
+        const uint32_t* regs = &w->regs[(size_t)r * w->reg_count];
+        uint8_t* bitmap = p;
+        memset(bitmap, 0, bm_bytes);
+        p += bm_bytes;
+        for_range(reg, 0, w->reg_count) {
+            uint32_t delta = regs[reg] ^ prev[reg];
+            if (delta != 0) {
+                bitmap[reg / 8] |= (uint8_t)(1u << (reg % 8));
+                p = varint_put(p, delta);
+                prev[reg] = regs[reg];
+            }
+        }
+
+        wave->records++;
+        wave->pc_min = MIN(wave->pc_min, pc_off);
+        wave->pc_max = MAX(wave->pc_max, pc_off);
+        entry.pc_min = MIN(entry.pc_min, pc_off);
+        entry.pc_max = MAX(entry.pc_max, pc_off);
+        entry.time_min = MIN(entry.time_min, time);
+        entry.time_max = MAX(entry.time_max, time);
+        prev_time = time;
+    }
+    wave->size = (uint64_t)(p - payload) - wave->offset;
+
+    free(order);
+    free(prev);
+
+    *chunk = (trace_file_chunk_t){
+        .magic = TRACE_FILE_CHUNK_MAGIC,
+        .wave_count = wave_count,
+        .records = w->pending,
+        .payload_size = (uint64_t)(p - payload),
+    };
+    while ((p - w->encoded) % TRACE_FILE_CHUNK_ALIGN != 0) {
+        *p++ = 0;
+    }
+    entry.size = (uint64_t)(p - w->encoded);
+
+    if (w->chunk_count == w->dir_capacity) {
+        uint64_t capacity = MAX(w->dir_capacity * 2, 64ull);
+        trace_file_dir_t* dir = realloc(w->dir, capacity * sizeof(*dir));
+        if (dir == NULL) {
+            return -ENOMEM;
+        }
+        w->dir = dir;
+        w->dir_capacity = capacity;
+    }
+
+    int32_t ret = write_all(w->fd, w->encoded, entry.size);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] Failed to write trace chunk: %d\n", ret);
+        return ret;
+    }
+
+    w->dir[w->chunk_count++] = entry;
+    w->offset += entry.size;
+    w->pending = 0;
+    return 0;
+}
+
+int32_t trace_file_append(trace_file_writer_t* w, uint32_t wave_id, uint64_t pc,
+                          uint64_t time, const uint32_t* regs) {
+    if (w->error != 0) {
+        return w->error;
+    }
+
+    uint32_t i = w->pending++;
+    w->waves[i] = wave_id;
+    w->pcs[i] = pc;
+    w->times[i] = time;
+    memcpy(&w->regs[(size_t)i * w->reg_count], regs, w->reg_count * sizeof(*regs));
+
+    if (w->pending == w->chunk_records) {
+        // A failed flush leaves the chunk full; never store past it
+        w->error = trace_file_flush(w);
+    }
+    return w->error;
+}
+
+int32_t trace_file_sink(void* user, const trace_record_t* records, uint32_t count) {
+    trace_file_writer_t* w = user;
+    HDB_ASSERT(w->reg_count == TRACE_FILE_TRACE_REGS,
+               "trace file not created with TRACE_FILE_TRACE_REGS");
+
+    for_range(i, 0, count) {
+        const trace_record_t* rec = &records[i];
+        uint32_t regs[TRACE_FILE_TRACE_REGS] = { rec->exec_lo, rec->exec_hi };
+        memcpy(&regs[2], rec->sgprs, sizeof(rec->sgprs));
+
+        uint64_t pc = ((uint64_t)(rec->pc_hi & 0xFFFF) << 32) | rec->pc_lo;
+        int32_t ret = trace_file_append(w, rec->hw_id1, pc, rec->time, regs);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+int32_t trace_file_finish(trace_file_writer_t* w) {
+    int32_t ret = 0;
+
+    if (w->fd >= 0) {
+        ret = w->error != 0 ? w->error : trace_file_flush(w);
+
+        trace_file_footer_t footer = {
+            .dir_offset = w->offset,
+            .chunk_count = w->chunk_count,
+            .magic = TRACE_FILE_MAGIC,
+        };
+        if (ret == 0 && w->chunk_count != 0) {
+            ret = write_all(w->fd, w->dir, w->chunk_count * sizeof(*w->dir));
+        }
+        if (ret == 0) {
+            ret = write_all(w->fd, &footer, sizeof(footer));
+        }
+        if (close(w->fd) != 0 && ret == 0) {
+            ret = -errno;
+        }
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] Failed to finish trace file: %d\n", ret);
+        }
+    }
+
+    free(w->waves);
+    free(w->pcs);
+    free(w->times);
+    free(w->regs);
+    free(w->encoded);
+    free(w->dir);
+    *w = (trace_file_writer_t){ .fd = -1 };
+    return ret;
+}
+
+int32_t trace_file_open(const char* path, trace_file_t* f) {
+    *f = (trace_file_t){0};
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        int32_t ret = -errno;
+        fprintf(stderr, "[ERROR] Failed to open trace file %s: %d\n", path, ret);
+        return ret;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int32_t ret = -errno;
+        close(fd);
+        return ret;
+    }
+
+    size_t size = (size_t)st.st_size;
+    if (size < sizeof(trace_file_header_t) + sizeof(trace_file_footer_t)) {
+        close(fd);
+        return -EINVAL;
+    }
+
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        int32_t ret = -errno;
+        fprintf(stderr, "[ERROR] Failed to map trace file %s: %d\n", path, ret);
+        return ret;
+    }
+
+    // Queries jump between chunks; readahead past a stream is wasted
+    madvise(map, size, MADV_RANDOM);
+
+    f->map = map;
+    f->size = size;
+    f->header = map;
+
+    const trace_file_footer_t* footer =
+        (const trace_file_footer_t*)(f->map + size - sizeof(*footer));
+    if (f->header->magic != TRACE_FILE_MAGIC || f->header->version != TRACE_FILE_VERSION ||
+        f->header->reg_count > TRACE_FILE_MAX_REGS || footer->magic != TRACE_FILE_MAGIC ||
+        footer->dir_offset > size - sizeof(*footer) ||
+        footer->chunk_count > (size - sizeof(*footer) - footer->dir_offset) /
+                              sizeof(trace_file_dir_t)) {
+        fprintf(stderr, "[ERROR] %s is not a complete trace file\n", path);
+        trace_file_close(f);
+        return -EINVAL;
+    }
+
+    f->dir = (const trace_file_dir_t*)(f->map + footer->dir_offset);
+    f->chunk_count = footer->chunk_count;
+    for_range(i, 0, f->chunk_count) {
+        if (f->dir[i].offset > footer->dir_offset ||
+            f->dir[i].size > footer->dir_offset - f->dir[i].offset) {
+            fprintf(stderr, "[ERROR] Trace chunk %zu out of bounds\n", i);
+            trace_file_close(f);
+            return -EINVAL;
+        }
+    }
+
+    f->regs = calloc(MAX(f->header->reg_count, 1u), sizeof(*f->regs));
+    if (f->regs == NULL) {
+        trace_file_close(f);
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+void trace_file_close(trace_file_t* f) {
+    if (f->map != NULL) {
+        munmap((void*)f->map, f->size);
+    }
+    free(f->regs);
+    *f = (trace_file_t){0};
+}
+
+/**
+ * Decode one wave stream, reporting records at pc_off (UINT64_MAX = all).
+ */
+static int32_t trace_file_walk_stream(trace_file_t* f, const trace_file_wave_t* wave,
+                                      const uint8_t* p, const uint8_t* end,
+                                      uint64_t pc_off, trace_file_record_fn_t fn,
+                                      void* user) {
+    uint32_t reg_count = f->header->reg_count;
+    uint32_t bm_bytes = bitmap_bytes(reg_count);
+    uint64_t time = 0;
+
+    memset(f->regs, 0, reg_count * sizeof(*f->regs));
+    for_range(i, 0, wave->records) {
+        uint64_t zpc, ztime;
+        p = varint_get(p, end, &zpc);
+        p = p ? varint_get(p, end, &ztime) : NULL;
+        if (p == NULL || (size_t)(end - p) < bm_bytes) {
+            return -EINVAL;
+        }
+
+        const uint8_t* bitmap = p;
+        p += bm_bytes;
+        for_range(reg, 0, reg_count) {
+            if (bitmap[reg / 8] & (1u << (reg % 8))) {
+                uint64_t delta;
+                p = varint_get(p, end, &delta);
+                if (p == NULL) {
+                    return -EINVAL;
+                }
+                f->regs[reg] ^= (uint32_t)delta;
+            }
+        }
+
+        uint64_t off = (uint64_t)zigzag_decode(zpc);
+        time += (uint64_t)zigzag_decode(ztime);
+        if (pc_off != UINT64_MAX && off != pc_off) {
+            continue;
+        }
+
+        trace_file_record_t rec = {
+            .wave_id = wave->wave_id,
+            .pc = f->header->code_va + off,
+            .time = time,
+            .regs = f->regs,
+        };
+        int32_t ret = fn(user, &rec);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+int32_t trace_file_find(trace_file_t* f, uint32_t wave_id, uint64_t pc,
+                        trace_file_record_fn_t fn, void* user) {
+    uint64_t pc_off = pc == UINT64_MAX ? UINT64_MAX : pc - f->header->code_va;
+
+    for_range(c, 0, f->chunk_count) {
+        const trace_file_dir_t* entry = &f->dir[c];
+        if (pc_off != UINT64_MAX && (pc_off < entry->pc_min || pc_off > entry->pc_max)) {
+            continue;
+        }
+
+        const uint8_t* base = f->map + entry->offset;
+        const trace_file_chunk_t* chunk = (const trace_file_chunk_t*)base;
+        size_t table_bytes = (size_t)chunk->wave_count * sizeof(trace_file_wave_t);
+        if (entry->size < sizeof(*chunk) || chunk->magic != TRACE_FILE_CHUNK_MAGIC ||
+            table_bytes > entry->size - sizeof(*chunk) ||
+            chunk->payload_size > entry->size - sizeof(*chunk) - table_bytes) {
+            return -EINVAL;
+        }
+
+        const trace_file_wave_t* waves = (const trace_file_wave_t*)(chunk + 1);
+        const uint8_t* payload = (const uint8_t*)(waves + chunk->wave_count);
+
+        // The wave table is sorted: binary search for one wave, or walk all
+        uint32_t first = 0, last = chunk->wave_count;
+        if (wave_id != UINT32_MAX) {
+            uint32_t lo = 0, hi = chunk->wave_count;
+            while (lo < hi) {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (waves[mid].wave_id < wave_id) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (lo == chunk->wave_count || waves[lo].wave_id != wave_id) {
+                continue;
+            }
+            first = lo;
+            last = lo + 1;
+        }
+
+        for_range(w, first, last) {
+            const trace_file_wave_t* wave = &waves[w];
+            if (pc_off != UINT64_MAX && (pc_off < wave->pc_min || pc_off > wave->pc_max)) {
+                continue;
+            }
+            if (wave->offset > chunk->payload_size ||
+                wave->size > chunk->payload_size - wave->offset) {
+                return -EINVAL;
+            }
+
+            const uint8_t* p = payload + wave->offset;
+            int32_t ret = trace_file_walk_stream(f, wave, p, p + wave->size, pc_off,
+                                                 fn, user);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+    }
+    return 0;
+}
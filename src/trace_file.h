@@ -0,0 +1,254 @@
+#pragma once
+
+#include "trace.h"
+#include <stddef.h>
+
+/**
+ * Compact trace file: chunked, delta-encoded, indexed.
+ *
+ * Holds per-wave register records: trace mode output (trace_file_sink())
+ * or snapshots taken at stops (trace_file_append()). Captures reach tens
+ * of GB, so records are grouped in chunks and every chunk carries an index
+ * that lets trace_file_find() decode only the streams that can match.
+ *
+ * File layout:
+ *
+ *   trace_file_header_t
+ *   chunk 0 .. N-1         written as they fill
+ *   trace_file_dir_t[N]    one entry per chunk (PC / time ranges, offset)
+ *   trace_file_footer_t    locates the directory
+ *
+ * Chunk layout:
+ *
+ *   trace_file_chunk_t
+ *   trace_file_wave_t[wave_count]   sorted by wave_id
+ *   wave streams                    one per wave, in table order
+ *
+ * Within a stream, each record is encoded as:
+ *
+ *   varint  zigzag(pc - code_va)
+ *   varint  zigzag(time - previous time)
+ *   bytes   changed-register bitmap, (reg_count + 7) / 8
+ *   varint  reg ^ previous reg, for every register set in the bitmap
+ *
+ * "Previous" is the previous record of the same wave in the same chunk
+ * (zero for the first one), so any stream decodes on its own.
+ *
+ * DANGER: Not thread-safe; one writer per file.
+ */
+
+#define TRACE_FILE_MAGIC          0x46524448u  // "HDRF"
+#define TRACE_FILE_CHUNK_MAGIC    0x4B484348u  // "HCHK"
+#define TRACE_FILE_VERSION        1
+#define TRACE_FILE_MAX_REGS       16384
+#define TRACE_FILE_DEFAULT_CHUNK  65536        // Max records per default chunk
+#define TRACE_FILE_CHUNK_BYTES    (16u << 20)  // Default chunk buffer budget
+#define TRACE_FILE_MAX_CHUNK_BYTES (256u << 20) // Largest chunk buffers accepted
+
+/**
+ * Registers per record written by trace_file_sink(): EXEC lo/hi, then the
+ * trace_record_t SGPR window.
+ */
+#define TRACE_FILE_TRACE_REGS     (2 + TRACE_RECORD_SGPRS)
+
+/**
+ * trace_file_header_t: Start of the file.
+ */
+typedef struct {
+    uint32_t magic;          // TRACE_FILE_MAGIC
+    uint32_t version;        // TRACE_FILE_VERSION
+    uint64_t code_va;        // PCs are stored relative to this VA
+    uint32_t reg_count;      // Registers per record
+    uint32_t chunk_records;  // Records per full chunk
+    uint32_t reserved[2];
+} trace_file_header_t;
+
+/**
+ * trace_file_chunk_t: Start of a chunk.
+ */
+typedef struct {
+    uint32_t magic;          // TRACE_FILE_CHUNK_MAGIC
+    uint32_t wave_count;     // Entries in the wave table
+    uint32_t records;        // Records in all streams
+    uint32_t reserved;
+    uint64_t payload_size;   // Bytes of streams after the wave table
+} trace_file_chunk_t;
+
+/**
+ * trace_file_wave_t: Per-chunk index entry for one wave's stream.
+ */
+typedef struct {
+    uint32_t wave_id;        // HW_ID1 for trace mode records
+    uint32_t records;
+    uint64_t offset;         // Stream offset from the payload start
+    uint64_t size;           // Stream bytes
+    uint64_t pc_min;         // PC range, as offsets from code_va
+    uint64_t pc_max;
+} trace_file_wave_t;
+
+/**
+ * trace_file_dir_t: Directory entry for one chunk.
+ */
+typedef struct {
+    uint64_t offset;         // File offset of trace_file_chunk_t
+    uint64_t size;           // Chunk bytes
+    uint64_t pc_min;         // PC range, as offsets from code_va
+    uint64_t pc_max;
+    uint64_t time_min;
+    uint64_t time_max;
+    uint32_t records;
+    uint32_t wave_count;
+} trace_file_dir_t;
+
+/**
+ * trace_file_footer_t: End of the file.
+ */
+typedef struct {
+    uint64_t dir_offset;     // File offset of the directory
+    uint64_t chunk_count;
+    uint32_t magic;          // TRACE_FILE_MAGIC
+    uint32_t reserved;
+} trace_file_footer_t;
+
+_Static_assert(sizeof(trace_file_header_t) == 32 && sizeof(trace_file_chunk_t) == 24 &&
+               sizeof(trace_file_wave_t) == 40 && sizeof(trace_file_dir_t) == 56 &&
+               sizeof(trace_file_footer_t) == 24,
+               "trace file structs are part of the file format");
+
+/**
+ * trace_file_record_t: Decoded record.
+ */
+typedef struct {
+    uint32_t         wave_id;
+    uint64_t         pc;             // Absolute VA
+    uint64_t         time;
+    const uint32_t*  regs;           // reg_count registers (valid during the callback)
+} trace_file_record_t;
+
+/**
+ * Record callback.
+ *
+ * @return: 0 to continue, anything else stops the walk and is returned
+ */
+typedef int32_t (*trace_file_record_fn_t)(void* user, const trace_file_record_t* rec);
+
+/**
+ * trace_file_writer_t: Open capture.
+ */
+typedef struct {
+    int        fd;
+    uint64_t   code_va;
+    uint32_t   reg_count;
+    uint32_t   chunk_records;
+    uint64_t   offset;         // Next file offset
+    int32_t    error;          // First failed chunk write (sticky)
+
+    // Pending chunk
+    uint32_t   pending;
+    uint32_t*  waves;
+    uint64_t*  pcs;
+    uint64_t*  times;
+    uint32_t*  regs;           // chunk_records x reg_count
+    uint8_t*   encoded;        // Chunk encoding buffer
+
+    trace_file_dir_t*  dir;
+    uint64_t           chunk_count;
+    uint64_t           dir_capacity;
+} trace_file_writer_t;
+
+/**
+ * Records per chunk whose writer buffers fit a byte budget.
+ *
+ * @param reg_count: Registers per record
+ * @param bytes: Buffer budget (raw records plus worst-case encoding)
+ * @return: 1..TRACE_FILE_DEFAULT_CHUNK
+ */
+uint32_t trace_file_chunk_records(uint32_t reg_count, size_t bytes);
+
+/**
+ * Create a trace file.
+ *
+ * @param path: Output path (truncated)
+ * @param code_va: Base VA of the traced code object
+ * @param reg_count: Registers per record (TRACE_FILE_TRACE_REGS for
+ *                   trace_file_sink(); at most TRACE_FILE_MAX_REGS)
+ * @param chunk_records: Records per chunk (0 = as many as fit
+ *                       TRACE_FILE_CHUNK_BYTES)
+ * @param w: Output writer
+ * @return: 0 on success, -EINVAL if the chunk buffers would exceed
+ *          TRACE_FILE_MAX_CHUNK_BYTES, negative error code on failure
+ */
+int32_t trace_file_create(const char* path, uint64_t code_va, uint32_t reg_count,
+                          uint32_t chunk_records, trace_file_writer_t* w);
+
+/**
+ * Append one record.
+ *
+ * @param w: Writer
+ * @param wave_id: Stream key (HW_ID1)
+ * @param pc: Absolute PC
+ * @param time: Timestamp
+ * @param regs: reg_count registers
+ * @return: 0 on success, negative error code on a failed chunk write
+ *
+ * After a failed chunk write the writer stays failed: later appends and
+ * trace_file_finish() return the same error without writing.
+ */
+int32_t trace_file_append(trace_file_writer_t* w, uint32_t wave_id, uint64_t pc,
+                          uint64_t time, const uint32_t* regs);
+
+/**
+ * trace_sink_fn_t appending trace mode records (pass the writer as user).
+ */
+int32_t trace_file_sink(void* user, const trace_record_t* records, uint32_t count);
+
+/**
+ * Flush the last chunk, write the directory and close the file.
+ *
+ * @param w: Writer (safe to call on a closed writer)
+ * @return: 0 on success, negative error code on failure
+ */
+int32_t trace_file_finish(trace_file_writer_t* w);
+
+/**
+ * trace_file_t: Memory-mapped capture.
+ */
+typedef struct {
+    const uint8_t*              map;
+    size_t                      size;
+    const trace_file_header_t*  header;
+    const trace_file_dir_t*     dir;
+    uint64_t                    chunk_count;
+    uint32_t*                   regs;     // Decode scratch (reg_count)
+} trace_file_t;
+
+/**
+ * Map a trace file and validate its directory.
+ *
+ * @param path: File path
+ * @param f: Output reader
+ * @return: 0 on success, -EINVAL for a truncated or foreign file, negative
+ *          error code on failure
+ */
+int32_t trace_file_open(const char* path, trace_file_t* f);
+
+/**
+ * Unmap a trace file.
+ */
+void trace_file_close(trace_file_t* f);
+
+/**
+ * Visit every record of one wave at one PC.
+ *
+ * @param f: Reader
+ * @param wave_id: Wave to match (UINT32_MAX = any)
+ * @param pc: Absolute PC to match (UINT64_MAX = any)
+ * @param fn: Callback, in chunk order then stream order
+ * @param user: Passed to fn
+ * @return: 0 when done, the first nonzero fn result, or -EINVAL on a
+ *          corrupt stream
+ *
+ * Only streams whose chunk and wave index entries cover pc are decoded.
+ */
+int32_t trace_file_find(trace_file_t* f, uint32_t wave_id, uint64_t pc,
+                        trace_file_record_fn_t fn, void* user);
@@ -0,0 +1,474 @@
+// GFX11 trap handler: park trapped waves in per-wave TMA mailbox slots.
+//
+// Installed through TBA (see dev_setup_trap_handler()); TMA points at a
+// mailbox created by mailbox_init(). The TMA layout is defined in
+// src/mailbox.h and every offset below must match it.
+//
+// Compile with: scripts/ll-as.sh src/trap_handler.s
+//
+// Flow per trapping wave:
+// 0. Fast path: a trap that is not an exception or s_trap, with a
+//    breakpoint table attached and filtering on, binary-searches the
+//    table (src/breakpoint.h) for PC - code_base and returns straight
+//    away on a miss. Only TTMPs and SCC are touched.
+//    With a trace ring attached, plain traps take the trace path instead:
+//    save v0/v1 to the slot, append one record (src/trace.h), restore,
+//    return. No host involvement, no loops.
+// 1. Save STATUS (for SCC), compute the wave's slot from HW_ID1.
+// 2. Save EXEC, then v0, SGPRs, slot header fields and v1..vN to the slot.
+// 3. Publish: state = TRAPPED, append the slot offset to the trap ring.
+// 4. Spin until the host stores RESUME.
+// 5. Restore everything from the slot (host edits included), store EMPTY.
+// 6. Advance PC past s_trap, restore SCC, s_rfe_b64.
+//
+// TTMP usage (TTMP7-TTMP11 are left alone; hardware may initialize them):
+// - ttmp[0:1]:  PC (hardware), ttmp1[23:16] trap ID
+// - ttmp2:      HW_ID1 / trap ID (fast path: search bounds, table scratch)
+// - ttmp3:      slot byte offset from the TMA base
+// - ttmp[4:5]:  saved EXEC
+// - ttmp6:      saved STATUS
+// - ttmp12/13:  slot index scratch
+// - ttmp[14:15]: TMA base, then slot base
+//
+// Once SGPRs are saved, s0-s6 and m0 are scratch; they are restored from
+// the slot before returning.
+//
+// Trace path: ttmp[2:3] trace header then record address, ttmp[4:5] EXEC,
+// ttmp[12:13] slot base, ttmp14/15 scratch; m0 is stashed in v1 lane 1
+// and v0/v1 are parked in the slot's VGPR / SGPR areas.
+//
+// DANGER: HW_ID1 field positions and the number of SGPRs (106) follow the
+//         RDNA3 ISA guide; verify on hardware.
+
+// mailbox_header_t
+.set HDR_SLOT_STRIDE,   0x0C    // slot_stride, slots_offset (adjacent)
+.set HDR_VGPR_COUNT,    0x14    // vgpr_count, lanes (adjacent)
+.set HDR_SLOT_DIMS,     0x1C
+.set HDR_RING_OFFSET,   0x20    // ring_offset, ring_mask (adjacent)
+.set HDR_BP_TABLE,      0x28
+.set HDR_TRACE,         0x30
+.set HDR_SLOT_SE,       0x38
+.set HDR_RING_WPTR,     0x40
+
+// bp_table_header_t
+.set BP_FLAGS,          0x00    // flags, active
+.set BP_COUNT,          0x08    // count[0], count[1]
+.set BP_CODE_BASE,      0x10
+.set BP_CAPACITY,       0x18
+.set BP_ENTRIES,        0x40
+.set BP_TABLE_FILTER,   1
+
+// trace_header_t
+.set TR_RECORD_MASK,    0x08    // record_mask, sgpr_first (adjacent)
+.set TR_WPTR,           0x40    // wptr, limit (adjacent)
+.set TR_DROPPED,        0x48
+.set TR_RPTR,           0x80
+.set TR_RECORDS,        0x100
+.set TR_RECORD_SHIFT,   6       // 64-byte records
+.set TR_RECORD_SGPRS,   8
+
+// TRAPSTS exception bits that always go to the host:
+// EXCP[8:0], ILLEGAL_INST[11], EXCP_HI[14:12]
+.set TRAPSTS_EXCP_MASK, 0x79FF
+
+// mailbox_slot_t
+.set SLOT_SEQ,          0x04
+.set SLOT_SGPRS,        0x40
+.set SLOT_VGPRS,        0x240
+.set SLOT_HDR_LANES,    0x3FFE  // seq .. trap_id (lanes 1-13)
+
+.set STATE_EMPTY,       0
+.set STATE_TRAPPED,     1
+.set STATE_RESUME,      2
+
+.set SGPR_COUNT,        106
+
+// Multiply the slot index by one grid dimension and add the clamped
+// HW_ID1 field for it.
+.macro SLOT_LEVEL field_shift, field_width, dim_shift
+    s_bfe_u32 ttmp13, ttmp12, (\dim_shift | (8 << 16))
+    s_mul_i32 ttmp3, ttmp3, ttmp13
+    s_bfe_u32 ttmp4, ttmp2, (\field_shift | (\field_width << 16))
+    s_sub_u32 ttmp13, ttmp13, 1
+    s_min_u32 ttmp4, ttmp4, ttmp13
+    s_add_u32 ttmp3, ttmp3, ttmp4
+.endm
+
+// ttmp3 = byte offset of this wave's slot from the TMA base in ttmp[14:15].
+// Clobbers ttmp2, ttmp4, ttmp12, ttmp13.
+.macro SLOT_OFFSET
+    s_load_b32 ttmp12, ttmp[14:15], HDR_SLOT_DIMS
+    s_load_b32 ttmp13, ttmp[14:15], HDR_SLOT_SE
+    s_getreg_b32 ttmp2, hwreg(HW_REG_HW_ID1)
+    s_waitcnt lgkmcnt(0)
+
+    // slot = ((((se * SA + sa) * WGP + wgp) * SIMD + simd) * WAVES + wave)
+    s_bfe_u32 ttmp3, ttmp2, (18 | (3 << 16))        // se
+    s_sub_u32 ttmp13, ttmp13, 1
+    s_min_u32 ttmp3, ttmp3, ttmp13
+    SLOT_LEVEL 16, 1, 24                            // sa
+    SLOT_LEVEL 10, 4, 16                            // wgp
+    SLOT_LEVEL 8,  2, 8                             // simd
+    SLOT_LEVEL 0,  5, 0                             // wave
+
+    // ttmp3 = slots_offset + slot * slot_stride
+    s_load_b64 ttmp[12:13], ttmp[14:15], HDR_SLOT_STRIDE
+    s_waitcnt lgkmcnt(0)
+    s_mul_i32 ttmp3, ttmp3, ttmp12
+    s_add_u32 ttmp3, ttmp3, ttmp13
+.endm
+
+// Record s[sgpr_first + i] (sgpr_first in m0 on entry) in v0 lane 8 + i.
+.macro TRACE_SGPRS
+    .set lane, 0
+    .rept TR_RECORD_SGPRS
+        s_movrels_b32 ttmp14, s0
+        v_writelane_b32 v0, ttmp14, (8 + lane)
+        s_add_u32 m0, m0, 1
+        .set lane, lane + 1
+    .endr
+.endm
+
+// Save SGPRs [first, first + count) through v0 lanes 0..count-1.
+.macro SAVE_SGPRS first, count, offset
+    .set lane, 0
+    .rept \count
+        v_writelane_b32 v0, s[\first + lane], lane
+        .set lane, lane + 1
+    .endr
+    global_store_addtid_b32 v0, ttmp[14:15] offset:\offset
+.endm
+
+// Restore SGPRs [first, first + count) from the slot through v0.
+.macro RESTORE_SGPRS first, count, offset
+    global_load_addtid_b32 v0, ttmp[14:15] offset:\offset glc dlc
+    s_waitcnt vmcnt(0)
+    .set lane, 0
+    .rept \count
+        v_readlane_b32 s[\first + lane], v0, lane
+        .set lane, lane + 1
+    .endr
+.endm
+
+.text
+.globl trap_handler
+.type trap_handler, @function
+
+trap_handler:
+    // STATUS first: it holds the interrupted wave's SCC
+    s_getreg_b32 ttmp6, hwreg(HW_REG_STATUS)
+
+    // Fast path only for plain traps: no trap ID / host trap, no exception
+    s_bfe_u32 ttmp2, ttmp1, (16 | (9 << 16))
+    s_cbranch_scc1 L_SLOW
+    s_getreg_b32 ttmp2, hwreg(HW_REG_TRAPSTS)
+    s_and_b32 ttmp2, ttmp2, TRAPSTS_EXCP_MASK
+    s_cbranch_scc1 L_SLOW
+
+    s_sendmsg_rtn_b64 ttmp[14:15], sendmsg(MSG_RTN_GET_TMA)
+    s_waitcnt lgkmcnt(0)
+    s_load_b64 ttmp[2:3], ttmp[14:15], HDR_TRACE glc dlc
+    s_load_b64 ttmp[12:13], ttmp[14:15], HDR_BP_TABLE glc dlc
+    s_waitcnt lgkmcnt(0)
+    s_cmp_lg_u64 ttmp[2:3], 0
+    s_cbranch_scc1 L_TRACE
+    s_cmp_eq_u64 ttmp[12:13], 0
+    s_cbranch_scc1 L_SLOW
+
+    // ttmp2 = flags, ttmp3 = active, ttmp4/5 = count[0]/count[1]
+    s_load_b64 ttmp[2:3], ttmp[12:13], BP_FLAGS glc dlc
+    s_load_b64 ttmp[4:5], ttmp[12:13], BP_COUNT glc dlc
+    s_load_b64 ttmp[14:15], ttmp[12:13], BP_CODE_BASE glc dlc
+    s_waitcnt lgkmcnt(0)
+    s_bitcmp1_b32 ttmp2, 0
+    s_cbranch_scc0 L_SLOW
+    s_cmp_eq_u32 ttmp3, 0
+    s_cselect_b32 ttmp4, ttmp4, ttmp5                // count of active copy
+
+    // ttmp14 = PC - code_base; PCs more than 4 GiB above it cannot match
+    s_and_b32 ttmp2, ttmp1, 0xFFFF
+    s_sub_u32 ttmp14, ttmp0, ttmp14
+    s_subb_u32 ttmp15, ttmp2, ttmp15
+    s_cmp_lg_u32 ttmp15, 0
+    s_cbranch_scc1 L_BP_MISS
+
+    // ttmp[12:13] = active copy
+    s_load_b32 ttmp5, ttmp[12:13], BP_CAPACITY glc dlc
+    s_waitcnt lgkmcnt(0)
+    s_mul_i32 ttmp3, ttmp3, ttmp5
+    s_lshl_b32 ttmp3, ttmp3, 2
+    s_add_u32 ttmp3, ttmp3, BP_ENTRIES
+    s_add_u32 ttmp12, ttmp12, ttmp3
+    s_addc_u32 ttmp13, ttmp13, 0
+
+    // Binary search [ttmp2, ttmp4) for ttmp14
+    s_mov_b32 ttmp2, 0
+L_BP_SEARCH:
+    s_cmp_ge_u32 ttmp2, ttmp4
+    s_cbranch_scc1 L_BP_MISS
+    s_add_u32 ttmp3, ttmp2, ttmp4
+    s_lshr_b32 ttmp3, ttmp3, 1
+    s_lshl_b32 ttmp15, ttmp3, 2
+    s_load_b32 ttmp5, ttmp[12:13], ttmp15 glc dlc
+    s_waitcnt lgkmcnt(0)
+    s_cmp_eq_u32 ttmp5, ttmp14
+    s_cbranch_scc1 L_SLOW                           // hit: report to the host
+    s_cmp_lt_u32 ttmp5, ttmp14
+    s_cbranch_scc0 L_BP_LEFT
+    s_add_u32 ttmp2, ttmp3, 1
+    s_branch L_BP_SEARCH
+L_BP_LEFT:
+    s_mov_b32 ttmp4, ttmp3
+    s_branch L_BP_SEARCH
+
+    // Miss: PC already points at the next instruction; nothing else changed
+L_BP_MISS:
+    s_and_b32 ttmp1, ttmp1, 0xFFFF
+    s_and_b32 ttmp6, ttmp6, 1                       // SCC = saved STATUS.SCC
+    s_rfe_b64 ttmp[0:1]
+
+    // Trace: append a record and return without the host
+L_TRACE:
+    SLOT_OFFSET
+    s_add_u32 ttmp12, ttmp14, ttmp3
+    s_addc_u32 ttmp13, ttmp15, 0                    // ttmp[12:13] = slot base
+    s_load_b64 ttmp[2:3], ttmp[14:15], HDR_TRACE glc dlc
+
+    // Park v0 in the slot's v0 position and v1 in its (unused) SGPR area
+    s_mov_b64 ttmp[4:5], exec
+    s_mov_b64 exec, -1
+    global_store_addtid_b32 v0, ttmp[12:13] offset:SLOT_VGPRS
+    global_store_addtid_b32 v1, ttmp[12:13] offset:SLOT_SGPRS
+    v_writelane_b32 v1, m0, 1
+    s_waitcnt lgkmcnt(0)
+
+    // Full when wptr - limit - rptr >= 0 (signed: indices wrap)
+    s_load_b64 ttmp[14:15], ttmp[2:3], TR_WPTR glc dlc
+    s_waitcnt lgkmcnt(0)
+    s_sub_u32 ttmp14, ttmp14, ttmp15
+    s_load_b32 ttmp15, ttmp[2:3], TR_RPTR glc dlc
+    s_waitcnt lgkmcnt(0)
+    s_sub_u32 ttmp14, ttmp14, ttmp15
+    s_mov_b32 exec_lo, 1
+    s_mov_b32 exec_hi, 0
+    v_mov_b32 v0, 1
+    v_mov_b32 v1, 0
+    s_cmp_ge_i32 ttmp14, 0
+    s_cbranch_scc1 L_TRACE_DROP
+
+    // Reserve ring index i; v0 lane 0 = tag = i
+    s_load_b64 ttmp[14:15], ttmp[2:3], TR_RECORD_MASK
+    global_atomic_add_u32 v1, v1, v0, ttmp[2:3] offset:TR_WPTR glc
+    s_waitcnt vmcnt(0) lgkmcnt(0)
+    v_mov_b32 v0, v1
+    v_readfirstlane_b32 m0, v1
+
+    // ttmp[2:3] = record (i & record_mask)
+    s_and_b32 m0, m0, ttmp14
+    s_lshl_b32 m0, m0, TR_RECORD_SHIFT
+    s_add_u32 m0, m0, TR_RECORDS
+    s_add_u32 ttmp2, ttmp2, m0
+    s_addc_u32 ttmp3, ttmp3, 0
+
+    // Record body in v0 lanes 1-15 (trace_record_t)
+    s_getreg_b32 m0, hwreg(HW_REG_HW_ID1)
+    v_writelane_b32 v0, m0, 1
+    v_writelane_b32 v0, ttmp0, 2
+    s_and_b32 m0, ttmp1, 0xFFFFFF                   // PC_HI, trap ID
+    v_writelane_b32 v0, m0, 3
+    v_writelane_b32 v0, ttmp4, 4
+    v_writelane_b32 v0, ttmp5, 5
+    s_mov_b32 m0, ttmp15
+    TRACE_SGPRS
+    s_sendmsg_rtn_b64 ttmp[14:15], sendmsg(MSG_RTN_GET_REALTIME)
+    s_waitcnt lgkmcnt(0)
+    v_writelane_b32 v0, ttmp14, 6
+    v_writelane_b32 v0, ttmp15, 7
+
+    // Body first, then the tag that commits it
+    s_mov_b32 exec_lo, 0xFFFE
+    global_store_addtid_b32 v0, ttmp[2:3] offset:0
+    s_waitcnt_vscnt null, 0
+    s_mov_b32 exec_lo, 1
+    global_store_addtid_b32 v0, ttmp[2:3] offset:0
+    s_branch L_TRACE_RESTORE
+
+L_TRACE_DROP:
+    global_atomic_add_u32 v1, v0, ttmp[2:3] offset:TR_DROPPED
+
+L_TRACE_RESTORE:
+    v_readlane_b32 m0, v1, 1
+    s_mov_b64 exec, -1
+    s_waitcnt_vscnt null, 0
+    global_load_addtid_b32 v0, ttmp[12:13] offset:SLOT_VGPRS glc dlc
+    global_load_addtid_b32 v1, ttmp[12:13] offset:SLOT_SGPRS glc dlc
+    s_waitcnt vmcnt(0)
+    s_mov_b64 exec, ttmp[4:5]
+    s_and_b32 ttmp1, ttmp1, 0xFFFF
+    s_and_b32 ttmp6, ttmp6, 1                       // SCC = saved STATUS.SCC
+    s_rfe_b64 ttmp[0:1]
+
+L_SLOW:
+    s_sendmsg_rtn_b64 ttmp[14:15], sendmsg(MSG_RTN_GET_TMA)
+    s_waitcnt lgkmcnt(0)
+    SLOT_OFFSET
+
+    // ttmp[14:15] = slot base
+    s_add_u32 ttmp14, ttmp14, ttmp3
+    s_addc_u32 ttmp15, ttmp15, 0
+
+    // Save EXEC; v0 goes first so it can carry everything else
+    s_mov_b64 ttmp[4:5], exec
+    s_mov_b64 exec, -1
+    global_store_addtid_b32 v0, ttmp[14:15] offset:SLOT_VGPRS
+
+    // SGPRs, 32 per store (lanes 0-31 only, so wave64 writes no extra)
+    s_mov_b32 exec_lo, -1
+    s_mov_b32 exec_hi, 0
+    SAVE_SGPRS 0,  32, (SLOT_SGPRS + 0x000)
+    SAVE_SGPRS 32, 32, (SLOT_SGPRS + 0x080)
+    SAVE_SGPRS 64, 32, (SLOT_SGPRS + 0x100)
+    SAVE_SGPRS 96, (SGPR_COUNT - 96), (SLOT_SGPRS + 0x180)
+
+    // Slot header fields (mailbox_slot_t lanes 1-13; state is lane 0)
+    s_load_b32 s0, ttmp[14:15], SLOT_SEQ glc dlc
+    s_getreg_b32 s1, hwreg(HW_REG_HW_ID1)
+    s_getreg_b32 s2, hwreg(HW_REG_HW_ID2)
+    s_getreg_b32 s3, hwreg(HW_REG_TRAPSTS)
+    s_and_b32 s4, ttmp1, 0xFFFF                     // PC_HI
+    s_bfe_u32 s5, ttmp1, (16 | (8 << 16))           // trap ID
+    s_waitcnt lgkmcnt(0)
+    s_add_u32 s0, s0, 1
+    v_writelane_b32 v0, s0, 1
+    v_writelane_b32 v0, s1, 2
+    v_writelane_b32 v0, s2, 3
+    v_writelane_b32 v0, ttmp0, 4
+    v_writelane_b32 v0, s4, 5
+    v_writelane_b32 v0, ttmp4, 6
+    v_writelane_b32 v0, ttmp5, 7
+    v_writelane_b32 v0, vcc_lo, 8
+    v_writelane_b32 v0, vcc_hi, 9
+    v_writelane_b32 v0, ttmp6, 10
+    v_writelane_b32 v0, s3, 11
+    v_writelane_b32 v0, m0, 12
+    v_writelane_b32 v0, s5, 13
+    s_mov_b32 exec_lo, SLOT_HDR_LANES
+    global_store_addtid_b32 v0, ttmp[14:15] offset:0
+
+    // VGPRs v1..v(vgpr_count-1), one register (lanes dwords) per store
+    s_sendmsg_rtn_b64 s[0:1], sendmsg(MSG_RTN_GET_TMA)
+    s_waitcnt lgkmcnt(0)
+    s_load_b64 s[2:3], s[0:1], HDR_VGPR_COUNT
+    s_waitcnt lgkmcnt(0)
+    s_lshl_b32 s3, s3, 2                            // bytes per VGPR
+    s_add_u32 s4, ttmp14, SLOT_VGPRS
+    s_addc_u32 s5, ttmp15, 0
+    s_mov_b64 exec, -1
+    s_mov_b32 m0, 1
+L_SAVE_VGPR:
+    s_cmp_lt_u32 m0, s2
+    s_cbranch_scc0 L_SAVE_VGPR_DONE
+    s_add_u32 s4, s4, s3
+    s_addc_u32 s5, s5, 0
+    v_movrels_b32 v0, v0                            // v0 = v[m0]
+    global_store_addtid_b32 v0, s[4:5] offset:0
+    s_add_u32 m0, m0, 1
+    s_branch L_SAVE_VGPR
+L_SAVE_VGPR_DONE:
+
+    // Publish the slot once every save store has landed
+    s_waitcnt_vscnt null, 0
+    s_mov_b32 exec_lo, 1
+    s_mov_b32 exec_hi, 0
+    v_mov_b32 v0, STATE_TRAPPED
+    global_store_addtid_b32 v0, ttmp[14:15] offset:0
+    s_waitcnt_vscnt null, 0
+
+    // Reserve a ring entry and store the slot offset into it
+    s_load_b64 s[2:3], s[0:1], HDR_RING_OFFSET
+    v_mov_b32 v0, 0
+    v_mov_b32 v1, 1
+    global_atomic_add_u32 v1, v0, v1, s[0:1] offset:HDR_RING_WPTR glc
+    s_waitcnt vmcnt(0) lgkmcnt(0)
+    v_readfirstlane_b32 s6, v1
+    s_and_b32 s6, s6, s3
+    s_lshl_b32 s6, s6, 2
+    s_add_u32 s6, s6, s2
+    v_mov_b32 v0, s6
+    v_mov_b32 v1, ttmp3
+    global_store_b32 v0, v1, s[0:1]
+    s_waitcnt_vscnt null, 0
+
+    // Park until the host releases the slot
+L_WAIT_RESUME:
+    s_sleep 2
+    s_load_b32 s6, ttmp[14:15], 0 glc dlc
+    s_waitcnt lgkmcnt(0)
+    s_cmp_eq_u32 s6, STATE_RESUME
+    s_cbranch_scc0 L_WAIT_RESUME
+
+    // VGPRs v1..v(vgpr_count-1)
+    s_load_b64 s[2:3], s[0:1], HDR_VGPR_COUNT
+    s_waitcnt lgkmcnt(0)
+    s_lshl_b32 s3, s3, 2
+    s_add_u32 s4, ttmp14, SLOT_VGPRS
+    s_addc_u32 s5, ttmp15, 0
+    s_mov_b64 exec, -1
+    s_mov_b32 m0, 1
+L_RESTORE_VGPR:
+    s_cmp_lt_u32 m0, s2
+    s_cbranch_scc0 L_RESTORE_VGPR_DONE
+    s_add_u32 s4, s4, s3
+    s_addc_u32 s5, s5, 0
+    global_load_addtid_b32 v0, s[4:5] offset:0 glc dlc
+    s_waitcnt vmcnt(0)
+    v_movreld_b32 v0, v0                            // v[m0] = v0
+    s_add_u32 m0, m0, 1
+    s_branch L_RESTORE_VGPR
+L_RESTORE_VGPR_DONE:
+
+    // Slot header fields (host may have edited PC / EXEC / VCC / M0)
+    s_mov_b32 exec_lo, 0xFFFF
+    s_mov_b32 exec_hi, 0
+    global_load_addtid_b32 v0, ttmp[14:15] offset:0 glc dlc
+    s_waitcnt vmcnt(0)
+    v_readlane_b32 ttmp0, v0, 4
+    v_readlane_b32 ttmp1, v0, 5
+    v_readlane_b32 ttmp4, v0, 6
+    v_readlane_b32 ttmp5, v0, 7
+    v_readlane_b32 vcc_lo, v0, 8
+    v_readlane_b32 vcc_hi, v0, 9
+    v_readlane_b32 m0, v0, 12
+    v_readlane_b32 ttmp2, v0, 13
+
+    // SGPRs (after the scratch SGPRs are no longer needed)
+    s_mov_b32 exec_lo, -1
+    RESTORE_SGPRS 0,  32, (SLOT_SGPRS + 0x000)
+    RESTORE_SGPRS 32, 32, (SLOT_SGPRS + 0x080)
+    RESTORE_SGPRS 64, 32, (SLOT_SGPRS + 0x100)
+    RESTORE_SGPRS 96, (SGPR_COUNT - 96), (SLOT_SGPRS + 0x180)
+
+    // Free the slot, then restore v0 and EXEC
+    s_mov_b32 exec_lo, 1
+    v_mov_b32 v0, STATE_EMPTY
+    global_store_addtid_b32 v0, ttmp[14:15] offset:0
+    s_waitcnt_vscnt null, 0
+    s_mov_b64 exec, -1
+    global_load_addtid_b32 v0, ttmp[14:15] offset:SLOT_VGPRS glc dlc
+    s_waitcnt vmcnt(0)
+    s_mov_b64 exec, ttmp[4:5]
+
+    // s_trap leaves PC on the s_trap itself; exceptions and single-step
+    // already point at the next instruction to execute
+    s_cmp_eq_u32 ttmp2, 0
+    s_cbranch_scc1 L_RETURN
+    s_add_u32 ttmp0, ttmp0, 4
+    s_addc_u32 ttmp1, ttmp1, 0
+L_RETURN:
+    s_and_b32 ttmp1, ttmp1, 0xFFFF
+    s_and_b32 ttmp6, ttmp6, 1                       // SCC = saved STATUS.SCC (last SALU)
+    s_rfe_b64 ttmp[0:1]
+
+.size trap_handler, .-trap_handler
+
+.section .note.GNU-stack,"",@progbits
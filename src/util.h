@@ -6,6 +6,11 @@
 #include <stdbool.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 /**
  * HDB_ASSERT: Fatal assertion with message.
@@ -36,18 +41,42 @@
     } \
 } while (0)
 
+/**
+ * HDB_LOG: fprintf for [INFO] / [WARN] lines on hot paths.
+ *
+ * Built with -DHDB_LOG_RING (make HDB_LOG_RING=1), lines are formatted into
+ * a lock-free in-memory ring instead of going through stdio, and written
+ * out by hdb_log_ring_drain() (src/stats.c) or at exit.
+ *
+ * HDB_LOG_DRAIN() is called wherever a thread is about to block: before
+ * every epoll_wait() in event_loop_run_once() and before every wait in the
+ * batch executor. Lines logged by other code between those points wait for
+ * the next drain. If more than the ring holds (1024 lines) pile up, the
+ * oldest are dropped and counted.
+ */
+#ifdef HDB_LOG_RING
+void hdb_log_ring_printf(FILE* stream, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+size_t hdb_log_ring_drain(void);
+#define HDB_LOG(stream, ...) hdb_log_ring_printf((stream), __VA_ARGS__)
+#define HDB_LOG_DRAIN() ((void)hdb_log_ring_drain())
+#else
+#define HDB_LOG(stream, ...) fprintf((stream), __VA_ARGS__)
+#define HDB_LOG_DRAIN() ((void)0)
+#endif
+
 /**
  * HDB_WARN: Non-fatal warning for suspicious but recoverable conditions.
  */
 #define HDB_WARN(msg) do { \
-    fprintf(stderr, "[WARN] %s:%d: %s\n", __FILE__, __LINE__, (msg)); \
+    HDB_LOG(stderr, "[WARN] %s:%d: %s\n", __FILE__, __LINE__, (msg)); \
 } while (0)
 
 /**
  * HDB_INFO: Informational logging for debugging.
  */
 #define HDB_INFO(msg) do { \
-    fprintf(stdout, "[INFO] %s\n", (msg)); \
+    HDB_LOG(stdout, "[INFO] %s\n", (msg)); \
 } while (0)
 
 /**
@@ -83,3 +112,78 @@
  * PAGE_SIZE: Standard 4K page size for GPU operations.
  */
 #define PAGE_SIZE 4096
+
+/**
+ * hdb_cpu_relax: Spin-wait hint (PAUSE on x86, YIELD on arm64).
+ * 
+ * Use inside busy-wait loops to reduce power and pipeline pressure.
+ */
+static inline void hdb_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/**
+ * hdb_wc_fence: Order stores to write-combined (USWC / BAR) mappings.
+ * 
+ * x86 WC stores can become visible out of order; SFENCE drains them.
+ */
+static inline void hdb_wc_fence(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_sfence();
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * hdb_now_ns: Monotonic clock in nanoseconds.
+ */
+static inline uint64_t hdb_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * hdb_read_file: Read a whole file into a malloc'd buffer.
+ *
+ * @param path: File path
+ * @param data: Output buffer (caller frees)
+ * @param size: Output size in bytes
+ * @return: 0 on success, -ENODATA for an empty file, negative error code
+ *          on failure
+ */
+static inline int32_t hdb_read_file(const char* path, void** data, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return -errno;
+    }
+
+    int32_t ret = -EIO;
+    long len = -1;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        len = ftell(f);
+    }
+    if (len > 0 && fseek(f, 0, SEEK_SET) == 0) {
+        void* buf = malloc((size_t)len);
+        if (buf == NULL) {
+            ret = -ENOMEM;
+        } else if (fread(buf, 1, (size_t)len, f) != (size_t)len) {
+            free(buf);
+        } else {
+            *data = buf;
+            *size = (size_t)len;
+            ret = 0;
+        }
+    } else if (len == 0) {
+        ret = -ENODATA;
+    }
+    fclose(f);
+    return ret;
+}
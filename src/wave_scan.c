@@ -0,0 +1,237 @@
+#include "wave_scan.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+/**
+ * Registers read for each valid wave after SQ_WAVE_STATUS.
+ */
+static const gc_11_reg_t wave_scan_regs[] = {
+    REG_SQ_WAVE_TRAPSTS,
+    REG_SQ_WAVE_PC_LO,
+    REG_SQ_WAVE_PC_HI,
+    REG_SQ_WAVE_EXEC_LO,
+    REG_SQ_WAVE_EXEC_HI,
+    REG_SQ_WAVE_HW_ID1,
+    REG_SQ_WAVE_HW_ID2,
+};
+
+#define WAVE_SCAN_REGS  ARRAY_SIZE(wave_scan_regs)
+
+/**
+ * Per-SE worker state.
+ */
+typedef struct {
+    const amdgpu_t*  dev;
+    uint32_t         se;
+    reg_channel_t    ch;
+    wave_state_t*    waves;
+    size_t           count;
+    size_t           capacity;
+    uint32_t         slots_scanned;
+    int32_t          result;
+} wave_scan_se_t;
+
+/**
+ * Active-CU bitmap of one SE / SA (two bits per WGP).
+ *
+ * amdgpu_gpu_info::cu_bitmap is [4][4]; GPUs with more than four SEs fold
+ * SE n into row n % 4, columns offset by 2 * (n / 4).
+ */
+static uint32_t wave_scan_cu_bitmap(const amdgpu_t* dev, uint32_t se, uint32_t sa) {
+    uint32_t col = sa + (se / 4) * 2;
+    return col < 4 ? dev->cu_bitmap[se % 4][col] : 0;
+}
+
+/**
+ * SQ_IND_INDEX value selecting one indirect register of one wave slot.
+ */
+static uint32_t wave_scan_ind_index(const amdgpu_t* dev, uint32_t slot, gc_11_reg_t reg) {
+    uint32_t index = REG_SET_FIELD(0, SQ_IND_INDEX, WAVE_ID, slot);
+    return REG_SET_FIELD(index, SQ_IND_INDEX, INDEX, dev_reg_offset(dev, reg));
+}
+
+/**
+ * Scan the slots of one SIMD; appends its valid waves to w.
+ */
+static int32_t wave_scan_simd(wave_scan_se_t* w, uint32_t sa, uint32_t wgp, uint32_t simd) {
+    const amdgpu_t* dev = w->dev;
+
+    regs2_ioc_data_t ioc_data = {
+        .use_grbm = 1,
+        .grbm = {
+            .se = w->se,
+            .sh = sa,
+            .instance = (wgp << 2) | simd,
+        },
+    };
+
+    // One write/read pair per slot: SQ_IND_INDEX then SQ_IND_DATA
+    uint32_t index[WAVE_SCAN_SLOTS];
+    uint32_t status[WAVE_SCAN_SLOTS];
+    reg_batch_op_t ops[WAVE_SCAN_SLOTS * WAVE_SCAN_REGS * 2];
+    size_t op_count = 0;
+
+    for_range(slot, 0, WAVE_SCAN_SLOTS) {
+        index[slot] = wave_scan_ind_index(dev, slot, REG_SQ_WAVE_STATUS);
+        ops[op_count++] = (reg_batch_op_t){ REG_SQ_IND_INDEX, REG_OP_WRITE, &index[slot], 0 };
+        ops[op_count++] = (reg_batch_op_t){ REG_SQ_IND_DATA, REG_OP_READ, &status[slot], 0 };
+    }
+
+    reg_batch_group_t group = { .ioc_data = ioc_data, .ops = ops, .count = op_count };
+    reg_channel_batch(dev, &w->ch, &group, 1);
+    w->slots_scanned += WAVE_SCAN_SLOTS;
+
+    size_t valid = 0;
+    for_range(slot, 0, WAVE_SCAN_SLOTS) {
+        valid += REG_GET_FIELD(status[slot], SQ_WAVE_STATUS, VALID);
+    }
+    if (valid == 0) {
+        return 0;
+    }
+
+    if (w->count + valid > w->capacity) {
+        size_t capacity = MAX(w->capacity * 2, w->count + valid);
+        wave_state_t* waves = realloc(w->waves, capacity * sizeof(*waves));
+        if (waves == NULL) {
+            return -ENOMEM;
+        }
+        w->waves = waves;
+        w->capacity = capacity;
+    }
+
+    // Second pass over the valid slots only, in one group
+    uint32_t indices[WAVE_SCAN_SLOTS * WAVE_SCAN_REGS];
+    op_count = 0;
+
+    for_range(slot, 0, WAVE_SCAN_SLOTS) {
+        if (!REG_GET_FIELD(status[slot], SQ_WAVE_STATUS, VALID)) {
+            continue;
+        }
+
+        wave_state_t* wave = &w->waves[w->count++];
+        *wave = (wave_state_t){
+            .se = (uint8_t)w->se,
+            .sa = (uint8_t)sa,
+            .wgp = (uint8_t)wgp,
+            .simd = (uint8_t)simd,
+            .slot = (uint8_t)slot,
+            .status = status[slot],
+        };
+
+        uint32_t* values[WAVE_SCAN_REGS] = {
+            &wave->trapsts, &wave->pc_lo, &wave->pc_hi, &wave->exec_lo,
+            &wave->exec_hi, &wave->hw_id1, &wave->hw_id2,
+        };
+        for_range(r, 0, WAVE_SCAN_REGS) {
+            uint32_t* ind = &indices[op_count / 2];
+            *ind = wave_scan_ind_index(dev, slot, wave_scan_regs[r]);
+            ops[op_count++] = (reg_batch_op_t){ REG_SQ_IND_INDEX, REG_OP_WRITE, ind, 0 };
+            ops[op_count++] = (reg_batch_op_t){ REG_SQ_IND_DATA, REG_OP_READ, values[r], 0 };
+        }
+    }
+
+    // A wave that retires between the passes keeps its first-pass status
+    // and reads back whatever the slot holds next
+    group.count = op_count;
+    reg_channel_batch(dev, &w->ch, &group, 1);
+    return 0;
+}
+
+static void* wave_scan_se_main(void* arg) {
+    wave_scan_se_t* w = arg;
+    const amdgpu_t* dev = w->dev;
+
+    for_range(sa, 0, dev->num_shader_arrays_per_engine) {
+        uint32_t bitmap = wave_scan_cu_bitmap(dev, w->se, (uint32_t)sa);
+
+        for_range(wgp, 0, WAVE_SCAN_MAX_WGPS) {
+            // Harvested WGPs must not be selected
+            if (((bitmap >> (2 * wgp)) & 3) == 0) {
+                continue;
+            }
+
+            for_range(simd, 0, WAVE_SCAN_SIMDS) {
+                int32_t ret = wave_scan_simd(w, (uint32_t)sa, (uint32_t)wgp, (uint32_t)simd);
+                if (ret != 0) {
+                    w->result = ret;
+                    return NULL;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+int32_t wave_scan(const amdgpu_t* dev, wave_snapshot_t* snap) {
+    *snap = (wave_snapshot_t){0};
+
+    if (!dev_regs_available(dev)) {
+        return -ENODEV;
+    }
+
+    uint32_t se_count = MIN(dev->num_shader_engines, (uint32_t)WAVE_SCAN_MAX_SE);
+    wave_scan_se_t workers[WAVE_SCAN_MAX_SE] = {0};
+    pthread_t threads[WAVE_SCAN_MAX_SE];
+    bool started[WAVE_SCAN_MAX_SE] = {0};
+    int32_t ret = 0;
+
+    uint64_t start = hdb_now_ns();
+
+    for_range(se, 0, se_count) {
+        workers[se] = (wave_scan_se_t){ .dev = dev, .se = (uint32_t)se };
+
+        ret = reg_channel_open(dev, &workers[se].ch);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] Failed to open regs2 channel for SE %zu: %d\n", se, ret);
+            break;
+        }
+
+        ret = -pthread_create(&threads[se], NULL, wave_scan_se_main, &workers[se]);
+        if (ret != 0) {
+            fprintf(stderr, "[ERROR] Failed to start scanner thread for SE %zu: %d\n", se, ret);
+            break;
+        }
+        started[se] = true;
+    }
+
+    size_t total = 0;
+    for_range(se, 0, se_count) {
+        if (started[se]) {
+            pthread_join(threads[se], NULL);
+        }
+        reg_channel_close(&workers[se].ch);
+
+        if (ret == 0) {
+            ret = workers[se].result;
+        }
+        total += workers[se].count;
+        snap->slots_scanned += workers[se].slots_scanned;
+    }
+
+    // Concatenating the SEs in order keeps the snapshot sorted
+    if (ret == 0 && total > 0) {
+        snap->waves = malloc(total * sizeof(*snap->waves));
+        if (snap->waves == NULL) {
+            ret = -ENOMEM;
+        }
+    }
+    for_range(se, 0, se_count) {
+        if (ret == 0 && workers[se].count > 0) {
+            memcpy(&snap->waves[snap->count], workers[se].waves,
+                   workers[se].count * sizeof(*snap->waves));
+            snap->count += workers[se].count;
+        }
+        free(workers[se].waves);
+    }
+
+    snap->elapsed_ns = hdb_now_ns() - start;
+    if (ret != 0) {
+        wave_snapshot_free(snap);
+    }
+    return ret;
+}
+
+void wave_snapshot_free(wave_snapshot_t* snap) {
+    free(snap->waves);
+    *snap = (wave_snapshot_t){0};
+}
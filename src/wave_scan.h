@@ -0,0 +1,80 @@
+#pragma once
+
+#include "regs.h"
+
+/**
+ * Host-side wave scanner.
+ *
+ * Snapshots every resident wave through the SQ indexed registers
+ * (SQ_IND_INDEX / SQ_IND_DATA) without involving the trap handler: for
+ * each SE / SA / WGP / SIMD the GRBM selector is programmed once and the
+ * wave slots are read with batched register operations. SQ_WAVE_STATUS is
+ * read first for every slot; the rest of the state only for valid waves.
+ *
+ * Shader engines are walked in parallel, one thread and one regs2
+ * channel (reg_channel_t) per SE, since the selector is per descriptor.
+ *
+ * DANGER: Waves that are not halted keep running while they are read, so
+ *         the fields of one wave may come from different instructions.
+ * DANGER: The GRBM instance encoding ((wgp << 2) | simd) and the SE >= 4
+ *         cu_bitmap layout follow the amdgpu gfx11 code; verify on hardware.
+ */
+
+#define WAVE_SCAN_MAX_SE         8
+#define WAVE_SCAN_MAX_WGPS      16   // Per shader array (cu_bitmap holds 2 CUs each)
+#define WAVE_SCAN_SIMDS          4   // Per WGP
+#define WAVE_SCAN_SLOTS         16   // Wave slots per SIMD
+
+/**
+ * wave_state_t: One resident wave.
+ */
+typedef struct {
+    uint8_t   se;
+    uint8_t   sa;
+    uint8_t   wgp;
+    uint8_t   simd;
+    uint8_t   slot;
+    uint32_t  status;    // SQ_WAVE_STATUS
+    uint32_t  trapsts;   // SQ_WAVE_TRAPSTS
+    uint32_t  pc_lo;     // SQ_WAVE_PC_LO
+    uint32_t  pc_hi;     // SQ_WAVE_PC_HI
+    uint32_t  exec_lo;   // SQ_WAVE_EXEC_LO
+    uint32_t  exec_hi;   // SQ_WAVE_EXEC_HI
+    uint32_t  hw_id1;    // SQ_WAVE_HW_ID1
+    uint32_t  hw_id2;    // SQ_WAVE_HW_ID2 (VMID, queue)
+} wave_state_t;
+
+static inline uint64_t wave_state_pc(const wave_state_t* w) {
+    return (uint64_t)REG_GET_FIELD(w->pc_hi, SQ_WAVE_PC_HI, PC_HI) << 32 | w->pc_lo;
+}
+
+static inline uint64_t wave_state_exec(const wave_state_t* w) {
+    return (uint64_t)w->exec_hi << 32 | w->exec_lo;
+}
+
+/**
+ * wave_snapshot_t: Result of a scan, ordered by SE / SA / WGP / SIMD / slot.
+ */
+typedef struct {
+    wave_state_t*  waves;
+    size_t         count;
+    uint32_t       slots_scanned;   // Wave slots probed
+    uint64_t       elapsed_ns;      // Wall time of the scan
+} wave_snapshot_t;
+
+/**
+ * Snapshot all resident waves.
+ *
+ * @param dev: Device context (register database resolved)
+ * @param snap: Output snapshot (free with wave_snapshot_free())
+ * @return: 0 on success, -ENODEV if registers are unavailable, negative
+ *          error code on failure
+ */
+int32_t wave_scan(const amdgpu_t* dev, wave_snapshot_t* snap);
+
+/**
+ * Free a snapshot.
+ *
+ * @param snap: Snapshot (safe to call on a zeroed one)
+ */
+void wave_snapshot_free(wave_snapshot_t* snap);